@@ -5,9 +5,11 @@
 //   - Qubit 0: The unknown state we want to teleport (for demonstration, we create it using X or H).
 //   - Qubits 1 and 2: An entangled EPR pair to teleport the state from qubit 0 to qubit 2.
 //
-// Note: This example doesn't implement classical if-statements for the final correction
-// (which often require a classical register). 
-// We're just illustrating the main steps for educational purposes.
+// The measurement results are kept in two one-bit classical registers (m0, m1) and the
+// final corrections are applied in-engine with IF, so the whole protocol runs in one pass.
+
+CREG m0 1
+CREG m1 1
 
 // 1. (Optional) Prepare an example state on qubit 0 (|psi>):
 //    Let's create a superposition for demonstration:
@@ -24,13 +26,11 @@ CNOT 0 1
 //    - Hadamard on qubit 0
 H 0
 
-// 4. Measure qubits 0 and 1 in the computational basis
-MEASURE 0
-MEASURE 1
+// 4. Measure qubits 0 and 1 in the computational basis, into the classical registers
+MEASURE 0 -> m0[0]
+MEASURE 1 -> m1[0]
 
-// 5. Normally, we'd conditionally apply X/Z gates on qubit 2 based on the measured bits.
-//    That would "correct" the final state to match the original unknown state on qubit 2.
-//    In a fully featured simulator with classical logic, you'd do something like:
-//      IF measure(0) == 1 THEN X 2
-//      IF measure(1) == 1 THEN Z 2
-//    Instead, we stop here to show the main quantum steps.
+// 5. Conditionally apply X/Z on qubit 2 based on the measured bits.
+//    This "corrects" the final state to match the original unknown state on qubit 2.
+IF m1==1 X 2
+IF m0==1 Z 2
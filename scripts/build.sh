@@ -21,13 +21,19 @@ rm -f ./*.o
 rm -f $OUTPUT
 
 # 2) Compile core modules
-$CC $CFLAGS $INCLUDES -c src/core/qubit.c src/core/state_vector.c src/core/gate_operations.c src/core/measurement.c
+$CC $CFLAGS $INCLUDES -c src/core/qubit.c src/core/state_vector.c src/core/gate_operations.c src/core/measurement.c \
+    src/core/compressed_state_vector.c src/core/sparse_state_vector.c \
+    src/core/stabilizer_tableau.c src/core/mps_state.c src/core/noise_channels.c src/core/pauli_expectation.c
 
 # 3) Compile assembly modules
-$CC $CFLAGS $INCLUDES -c src/assembly/lexer.c src/assembly/parser.c src/assembly/interpreter.c
+$CC $CFLAGS $INCLUDES -c src/assembly/lexer.c src/assembly/parser.c src/assembly/interpreter.c \
+    src/assembly/stream_interpreter.c src/assembly/bytecode.c src/assembly/parallel_frontend.c
 
 # 4) Compile backend modules
-$CC $CFLAGS $INCLUDES -c src/backend/circuit_optimizer.c src/backend/parallel_execution.c src/backend/memory_management.c
+$CC $CFLAGS $INCLUDES -c src/backend/circuit_optimizer.c src/backend/parallel_execution.c src/backend/memory_management.c \
+    src/backend/memory_planner.c src/backend/simulator.c src/backend/circuit_cache.c src/backend/cost_model.c \
+    src/backend/circuit_partition.c src/backend/noise_trajectories.c src/backend/tensor_network.c \
+    src/backend/engine_selector.c
 
 # 5) Compile utils
 $CC $CFLAGS $INCLUDES -c src/utils/file_io.c src/utils/logger.c src/utils/math_utils.c
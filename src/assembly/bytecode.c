@@ -0,0 +1,859 @@
+#include "bytecode.h"
+#include "interpreter.h"
+#include "gate_operations.h"
+#include "measurement.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MATRIX_FLOATS 8
+#define UNITARY_FLOATS 32  /* A 4x4 block occupies four consecutive matrix slots */
+#define NO_BLOCK SIZE_MAX
+
+static int emit(BytecodeProgram* p, uint32_t opcode, size_t q0, size_t q1, const float* matrix) {
+    if (p->size == p->capacity) {
+        size_t cap = p->capacity ? p->capacity * 2 : 64;
+        BytecodeOp* code = (BytecodeOp*)realloc(p->code, cap * sizeof(BytecodeOp));
+        if (!code) return -1;
+        p->code = code;
+        p->capacity = cap;
+    }
+    BytecodeOp* op = &p->code[p->size++];
+    op->opcode = opcode;
+    op->q0 = (uint32_t)q0;
+    op->q1 = (uint32_t)q1;
+    op->flip = 0;
+    op->matrix = matrix;
+    return 0;
+}
+
+/**
+ * \brief Computes a binding's matrix slot from the current parameter values.
+ */
+static void evaluate_binding(BytecodeProgram* p, const BytecodeBinding* b) {
+    float angles[MAX_GATE_PARAMS];
+    for (size_t k = 0; k < b->param_count; k++) {
+        angles[k] = b->param_ids[k] >= 0
+            ? (float)(b->params[k] * p->param_values[b->param_ids[k]])
+            : b->params[k];
+    }
+    parameterized_gate_matrix(b->gate_name, angles, &p->matrices[(size_t)b->slot * MATRIX_FLOATS]);
+}
+
+/**
+ * \brief Builds the parameter -> binding index (CSR) used to limit rebinding to affected gates.
+ */
+static int index_bindings(BytecodeProgram* p) {
+    p->param_offsets = (size_t*)calloc(p->num_params + 1, sizeof(size_t));
+    p->param_values = (double*)calloc(p->num_params ? p->num_params : 1, sizeof(double));
+    if (!p->param_offsets || !p->param_values) return -1;
+
+    // Count, prefix-sum, then fill (a binding using the same symbol twice is listed once)
+    for (size_t b = 0; b < p->num_bindings; b++) {
+        const BytecodeBinding* bd = &p->bindings[b];
+        for (size_t k = 0; k < bd->param_count; k++) {
+            int16_t id = bd->param_ids[k];
+            int seen = 0;
+            for (size_t j = 0; j < k; j++) seen |= (bd->param_ids[j] == id);
+            if (id >= 0 && !seen) p->param_offsets[id + 1]++;
+        }
+    }
+    for (size_t q = 0; q < p->num_params; q++) p->param_offsets[q + 1] += p->param_offsets[q];
+
+    size_t total = p->param_offsets[p->num_params];
+    p->param_bindings = (uint32_t*)malloc((total ? total : 1) * sizeof(uint32_t));
+    size_t* fill = (size_t*)malloc((p->num_params ? p->num_params : 1) * sizeof(size_t));
+    if (!p->param_bindings || !fill) {
+        free(fill);
+        return -1;
+    }
+    memcpy(fill, p->param_offsets, p->num_params * sizeof(size_t));
+    for (size_t b = 0; b < p->num_bindings; b++) {
+        const BytecodeBinding* bd = &p->bindings[b];
+        for (size_t k = 0; k < bd->param_count; k++) {
+            int16_t id = bd->param_ids[k];
+            int seen = 0;
+            for (size_t j = 0; j < k; j++) seen |= (bd->param_ids[j] == id);
+            if (id >= 0 && !seen) p->param_bindings[fill[id]++] = (uint32_t)b;
+        }
+    }
+    free(fill);
+    return 0;
+}
+
+/**
+ * \brief out = b * a for 2x2 complex matrices stored as {re00, im00, re01, im01, re10, ...}.
+ */
+static void multiply_2x2(const float* b, const float* a, float* out) {
+    float r[MATRIX_FLOATS];
+    for (size_t row = 0; row < 2; row++) {
+        for (size_t col = 0; col < 2; col++) {
+            const float* b0 = &b[row * 4];         // b[row][0]
+            const float* b1 = &b[row * 4 + 2];     // b[row][1]
+            const float* a0 = &a[col * 2];         // a[0][col]
+            const float* a1 = &a[4 + col * 2];     // a[1][col]
+            r[row * 4 + col * 2]     = b0[0] * a0[0] - b0[1] * a0[1] + b1[0] * a1[0] - b1[1] * a1[1];
+            r[row * 4 + col * 2 + 1] = b0[0] * a0[1] + b0[1] * a0[0] + b1[0] * a1[1] + b1[1] * a1[0];
+        }
+    }
+    memcpy(out, r, sizeof(r));
+}
+
+/**
+ * \brief Compile-time state for block lowering and single-qubit fusion.
+ */
+typedef struct {
+    size_t* op_of;     /**< Instruction index -> op index (block markers only) */
+    size_t* pending;   /**< Per qubit: op index of a fusable OP_GATE_1Q, or SIZE_MAX */
+    size_t  barrier;   /**< Ops before this index belong to another block; never fuse into them */
+    size_t  depth;     /**< Open loop frames in the current body */
+    size_t  need;      /**< Deepest frame stack of the current body */
+    size_t  saved_depth, saved_need; /**< Main program state while compiling a DEF */
+} CompileState;
+
+/**
+ * \brief Emits a constant single-qubit gate, folding it into the previous gate on the same
+ *        qubit when nothing else touched that qubit in between.
+ */
+static int emit_fused_gate(BytecodeProgram* p, CompileState* cs, size_t q, const float* gate,
+                           int fusable) {
+    size_t prev = cs->pending[q];
+    if (fusable && prev != SIZE_MAX && prev >= cs->barrier) {
+        BytecodeOp* op = &p->code[prev];
+        float* slot = (float*)op->matrix;
+        if (op->matrix < p->matrices || op->matrix >= p->matrices + p->num_matrices * MATRIX_FLOATS) {
+            // Still the shared gate table: move it into a slot of our own first
+            slot = &p->matrices[p->num_matrices++ * MATRIX_FLOATS];
+            memcpy(slot, op->matrix, MATRIX_FLOATS * sizeof(float));
+            op->matrix = slot;
+        }
+        multiply_2x2(gate, slot, slot);
+        return 0;
+    }
+    cs->pending[q] = fusable ? p->size : SIZE_MAX;
+    return emit(p, OP_GATE_1Q, q, 0, gate);
+}
+
+/**
+ * \brief Lowers REPEAT/DEF/CALL/BLOCK_END. Loops become OP_REPEAT ... OP_LOOP_END; a DEF
+ *        body is jumped over in sequence and ends in OP_RETURN; a call is one OP_CALL.
+ */
+static int emit_block_marker(BytecodeProgram* p, CompileState* cs, const InstructionList* list, size_t i) {
+    const Instruction* instr = &list->data[i];
+    cs->op_of[i] = p->size;
+
+    switch (instr->type) {
+        case INSTR_REPEAT:
+            if (instr->repeat_count == 0) return emit(p, OP_JUMP, 0, 0, NULL); // patched at '}'
+            if (++cs->depth > cs->need) cs->need = cs->depth;
+            return emit(p, OP_REPEAT, instr->repeat_count, 0, NULL);
+        case INSTR_DEF:
+            cs->saved_depth = cs->depth;
+            cs->saved_need = cs->need;
+            cs->depth = cs->need = 0;
+            return emit(p, OP_JUMP, 0, 0, NULL); // patched at '}'
+        case INSTR_CALL: {
+            const BytecodeOp* def = &p->code[cs->op_of[instr->link]];
+            size_t need = cs->depth + 1 + def->q0; // q0 of the DEF's jump holds its body's need
+            if (need > cs->need) cs->need = need;
+            return emit(p, OP_CALL, 0, cs->op_of[instr->link] + 1, NULL);
+        }
+        case INSTR_BLOCK_END: {
+            const Instruction* open = &list->data[instr->link];
+            BytecodeOp* head = &p->code[cs->op_of[instr->link]];
+            int rc;
+            if (open->type == INSTR_DEF) {
+                rc = emit(p, OP_RETURN, 0, 0, NULL);
+                head = &p->code[cs->op_of[instr->link]];
+                head->q0 = (uint32_t)cs->need;
+                cs->depth = cs->saved_depth;
+                cs->need = cs->saved_need;
+            } else if (open->repeat_count == 0) {
+                rc = 0;
+            } else {
+                cs->depth--;
+                rc = emit(p, OP_LOOP_END, 0, cs->op_of[instr->link] + 1, NULL);
+                head = &p->code[cs->op_of[instr->link]];
+            }
+            if (rc == 0 && head->opcode == OP_JUMP) head->q1 = (uint32_t)p->size;
+            return rc;
+        }
+        default:
+            return 0;
+    }
+}
+
+/**
+ * \brief A run of gates acting only on qubits a and b, multiplied into one 4x4 unitary.
+ */
+typedef struct {
+    size_t a, b;                  /**< Qubits for the high / low bit of the local index */
+    size_t first;                 /**< Instruction index of the opening two-qubit gate */
+    size_t gates;                 /**< Gates multiplied in */
+    double separate_seconds;      /**< Predicted time of running the members one by one */
+    int    single_run[2];         /**< Last member on a / b was a single-qubit gate */
+    double u[UNITARY_FLOATS];     /**< Product so far, apply_two_qubit_gate layout */
+} TwoQubitBlock;
+
+/**
+ * \brief Roofline seconds of one dense kernel call on a num_qubits register.
+ */
+static double kernel_seconds(DenseKernel kernel, size_t num_qubits, size_t q0, size_t q1) {
+    KernelCost cost;
+    size_t lo = q0 < q1 ? q0 : q1, hi = q0 < q1 ? q1 : q0;
+    if (dense_kernel_cost(kernel, num_qubits, kernel == KERNEL_CNOT ? q0 : lo, hi, &cost) != 0) return 0.0;
+    return kernel_cost_seconds(&cost, KERNEL_DEFAULT_BANDWIDTH, KERNEL_DEFAULT_FLOP_RATE);
+}
+
+/**
+ * \brief Adds what a member would cost outside the block. Consecutive single-qubit members on
+ *        one qubit are fused into one matrix anyway, so only the first of a run is charged.
+ */
+static void charge_member(TwoQubitBlock* blk, const Instruction* instr, size_t num_qubits) {
+    if (instr->type == INSTR_GATE_SINGLE) {
+        int side = instr->qubits[0] == blk->a ? 0 : 1;
+        if (!blk->single_run[side]) blk->separate_seconds += kernel_seconds(KERNEL_GATE_1Q, num_qubits, 0, 0);
+        blk->single_run[side] = 1;
+        return;
+    }
+    int cnot = strcasecmp(instr->gate_name, "CNOT") == 0;
+    blk->separate_seconds += kernel_seconds(cnot ? KERNEL_CNOT : KERNEL_CPHASE, num_qubits,
+                                            instr->qubits[0], instr->qubits[1]);
+    blk->single_run[0] = blk->single_run[1] = 0;
+}
+
+/**
+ * \brief A block pays off when one 4x4 sweep is predicted to beat its members' kernels;
+ *        a lone CNOT/CPHASE, or one with a single neighbour, keeps its cheaper kernel.
+ */
+static int block_pays_off(const TwoQubitBlock* blk, size_t num_qubits) {
+    return blk->gates >= 2 &&
+           blk->separate_seconds > kernel_seconds(KERNEL_GATE_2Q, num_qubits, blk->a, blk->b);
+}
+
+/**
+ * \brief u = m * u for 4x4 complex matrices.
+ */
+static void multiply_4x4(const double* m, double* u) {
+    double r[UNITARY_FLOATS];
+    for (size_t row = 0; row < 4; row++) {
+        for (size_t col = 0; col < 4; col++) {
+            double re = 0.0, im = 0.0;
+            for (size_t k = 0; k < 4; k++) {
+                double mr = m[8 * row + 2 * k], mi = m[8 * row + 2 * k + 1];
+                double ur = u[8 * k + 2 * col], ui = u[8 * k + 2 * col + 1];
+                re += mr * ur - mi * ui;
+                im += mr * ui + mi * ur;
+            }
+            r[8 * row + 2 * col] = re;
+            r[8 * row + 2 * col + 1] = im;
+        }
+    }
+    memcpy(u, r, sizeof(r));
+}
+
+/**
+ * \brief Matrix of a constant single-qubit gate, or NULL if it is not one.
+ */
+static const float* constant_single_qubit_matrix(const Instruction* instr, float* storage) {
+    if (instr->has_matrix) return instr->matrix;
+    if (instr->param_count == 0) return find_single_qubit_gate(instr->gate_name);
+    float angles[MAX_GATE_PARAMS];
+    for (size_t k = 0; k < instr->param_count; k++) {
+        if (instr->param_ids[k] >= 0) return NULL;
+        angles[k] = instr->params[k];
+    }
+    return parameterized_gate_matrix(instr->gate_name, angles, storage) == 0 ? storage : NULL;
+}
+
+/**
+ * \brief Multiplies a block member into the block's product.
+ * \return 1 if the instruction is a constant CNOT/CPHASE/single-qubit gate on the block's qubits
+ */
+static int absorb_into_block(TwoQubitBlock* blk, const Instruction* instr, size_t num_qubits) {
+    double m[UNITARY_FLOATS];
+    memset(m, 0, sizeof(m));
+    if (instr->type == INSTR_GATE_SINGLE) {
+        float storage[MATRIX_FLOATS];
+        const float* g = constant_single_qubit_matrix(instr, storage);
+        if (!g) return 0;
+        int high = instr->qubits[0] == blk->a;
+        for (size_t r = 0; r < 2; r++) {
+            for (size_t c = 0; c < 2; c++) {
+                for (size_t k = 0; k < 2; k++) {
+                    size_t row = high ? (r << 1) | k : (k << 1) | r;
+                    size_t col = high ? (c << 1) | k : (k << 1) | c;
+                    m[8 * row + 2 * col] = g[4 * r + 2 * c];
+                    m[8 * row + 2 * col + 1] = g[4 * r + 2 * c + 1];
+                }
+            }
+        }
+    } else if (strcasecmp(instr->gate_name, "CNOT") == 0) {
+        size_t control = instr->qubits[0] == blk->a ? 2 : 1;
+        size_t target = control == 2 ? 1 : 2;
+        for (size_t i = 0; i < 4; i++) {
+            size_t j = (i & control) ? i ^ target : i;
+            m[8 * j + 2 * i] = 1.0;
+        }
+    } else {
+        float phase[MATRIX_FLOATS];
+        float angle = instr->params[0];
+        if (instr->param_count != 1 || instr->param_ids[0] >= 0 ||
+            parameterized_gate_matrix("CPHASE", &angle, phase) != 0) {
+            return 0;
+        }
+        for (size_t i = 0; i < 3; i++) m[8 * i + 2 * i] = 1.0;
+        m[8 * 3 + 2 * 3] = phase[0];
+        m[8 * 3 + 2 * 3 + 1] = phase[1];
+    }
+    multiply_4x4(m, blk->u);
+    charge_member(blk, instr, num_qubits);
+    blk->gates++;
+    return 1;
+}
+
+static void close_block(size_t* open, const TwoQubitBlock* blocks, size_t b) {
+    if (b == NO_BLOCK) return;
+    open[blocks[b].a] = NO_BLOCK;
+    open[blocks[b].b] = NO_BLOCK;
+}
+
+/**
+ * \brief Groups gates into two-qubit blocks: a constant CNOT/CPHASE opens a block on its
+ *        pair, and constant gates confined to that pair join it until another gate touches
+ *        one of its qubits. Guarded, symbolic and unknown gates, measurements and block
+ *        markers end blocks. Every gate on a or b between a block's first and last member is
+ *        a member, so the whole block can run where its first gate stood.
+ * \param num_qubits Qubits the instructions use (size of 'open')
+ * \param register_qubits Register size the member costs are predicted for
+ * \param block_of Per instruction: block index, or NO_BLOCK
+ * \return Number of blocks
+ */
+static size_t plan_two_qubit_blocks(const InstructionList* list, size_t num_qubits, size_t register_qubits,
+                                    size_t* open, TwoQubitBlock* blocks, size_t* block_of) {
+    size_t count = 0;
+    for (size_t q = 0; q < num_qubits; q++) open[q] = NO_BLOCK;
+    for (size_t i = 0; i < list->size; i++) {
+        const Instruction* instr = &list->data[i];
+        block_of[i] = NO_BLOCK;
+        if (is_block_marker(instr)) {
+            for (size_t q = 0; q < num_qubits; q++) open[q] = NO_BLOCK;
+            continue;
+        }
+        int in_range = instr->qubit_count <= 2;
+        for (size_t s = 0; s < instr->qubit_count && s < 2; s++) in_range &= instr->qubits[s] < num_qubits;
+        if (!in_range) continue; // compile_bytecode reports it
+
+        int pair_gate = instr->type == INSTR_GATE_MULTI && instr->qubit_count == 2 &&
+                        instr->qubits[0] != instr->qubits[1] && instr->cond_reg == 0 &&
+                        (strcasecmp(instr->gate_name, "CNOT") == 0 || strcasecmp(instr->gate_name, "CPHASE") == 0);
+        int single = instr->type == INSTR_GATE_SINGLE && instr->qubit_count == 1 && instr->cond_reg == 0;
+        if (single && open[instr->qubits[0]] != NO_BLOCK) {
+            size_t b = open[instr->qubits[0]];
+            if (absorb_into_block(&blocks[b], instr, register_qubits)) {
+                block_of[i] = b;
+                continue;
+            }
+        } else if (pair_gate) {
+            size_t qa = instr->qubits[0], qb = instr->qubits[1];
+            size_t b = open[qa];
+            if (b != NO_BLOCK && b == open[qb]) {
+                if (absorb_into_block(&blocks[b], instr, register_qubits)) {
+                    block_of[i] = b;
+                    continue;
+                }
+            } else {
+                TwoQubitBlock* blk = &blocks[count];
+                blk->a = qa;
+                blk->b = qb;
+                blk->first = i;
+                blk->gates = 0;
+                blk->separate_seconds = 0.0;
+                blk->single_run[0] = blk->single_run[1] = 0;
+                memset(blk->u, 0, sizeof(blk->u));
+                for (size_t d = 0; d < 4; d++) blk->u[8 * d + 2 * d] = 1.0;
+                if (absorb_into_block(blk, instr, register_qubits)) {
+                    close_block(open, blocks, open[qa]);
+                    close_block(open, blocks, open[qb]);
+                    open[qa] = open[qb] = count;
+                    block_of[i] = count++;
+                    continue;
+                }
+            }
+        }
+        // Anything else ends the blocks on its qubits
+        for (size_t s = 0; s < instr->qubit_count && s < 2; s++) {
+            close_block(open, blocks, open[instr->qubits[s]]);
+        }
+    }
+    return count;
+}
+
+/**
+ * \brief Allocation counts of lowering an instruction list (see compile_bytecode).
+ */
+typedef struct {
+    size_t ops;            /**< Ops: one per instruction, one guard per IF, plus OP_HALT */
+    size_t slots;          /**< 8-float matrix slots */
+    size_t parameterized;  /**< Bindings */
+    size_t pair_gates;     /**< Two-qubit blocks the planner may open */
+} LoweringCounts;
+
+static void count_lowering(const InstructionList* instructions, LoweringCounts* counts) {
+    memset(counts, 0, sizeof(*counts));
+    size_t guards = 0;
+    for (size_t i = 0; i < instructions->size; i++) {
+        const Instruction* instr = &instructions->data[i];
+        if (instr->param_count > 0) counts->parameterized++;
+        if (instr->param_count > 0 || instr->type == INSTR_GATE_SINGLE) counts->slots++;
+        counts->pair_gates += (instr->type == INSTR_GATE_MULTI);
+        guards += (instr->cond_reg != 0);
+    }
+    counts->slots += counts->pair_gates * (UNITARY_FLOATS / MATRIX_FLOATS); // at most one block per two-qubit gate
+    counts->ops = instructions->size + guards + 1;
+}
+
+void bytecode_footprint(const InstructionList* instructions, size_t* program_bytes, size_t* scratch_bytes) {
+    size_t program = 0, scratch = 0;
+    if (instructions) {
+        LoweringCounts counts;
+        count_lowering(instructions, &counts);
+        size_t used_qubits = instruction_list_num_qubits(instructions);
+        size_t n = instructions->size ? instructions->size : 1;
+        // Kept by the program: code, matrix slots, bindings and the parameter -> binding index
+        program = counts.ops * sizeof(BytecodeOp) +
+                  (counts.slots ? counts.slots : 1) * MATRIX_FLOATS * sizeof(float) +
+                  (counts.parameterized ? counts.parameterized : 1) * sizeof(BytecodeBinding) +
+                  (instructions->num_params + 1) * (sizeof(size_t) + sizeof(double)) +
+                  (counts.parameterized ? counts.parameterized * MAX_GATE_PARAMS : 1) * sizeof(uint32_t);
+        // Freed after compiling: op_of, block_of, pending and the two-qubit blocks
+        scratch = 2 * n * sizeof(size_t) + (used_qubits ? used_qubits : 1) * sizeof(size_t) +
+                  (counts.pair_gates ? counts.pair_gates : 1) * sizeof(TwoQubitBlock);
+        // Execution: frames and registers spill to the heap past their on-stack arrays
+        size_t frames = 0;
+        for (size_t i = 0; i < instructions->size; i++) {
+            frames += (instructions->data[i].type == INSTR_REPEAT || instructions->data[i].type == INSTR_CALL);
+        }
+        if (frames > MAX_BLOCK_DEPTH) scratch += frames * sizeof(uint32_t);
+        if (instructions->num_cregs > 16) scratch += instructions->num_cregs * sizeof(uint32_t);
+    }
+    if (program_bytes) *program_bytes = program;
+    if (scratch_bytes) *scratch_bytes = scratch;
+}
+
+int compile_bytecode(const InstructionList* instructions, size_t num_qubits, BytecodeProgram* program) {
+    if (!instructions || !program) return -1;
+    memset(program, 0, sizeof(*program));
+
+    size_t used_qubits = instruction_list_num_qubits(instructions);
+    if (num_qubits == 0) num_qubits = used_qubits;
+    if (num_qubits > UINT32_MAX || instructions->size >= UINT32_MAX) return -2;
+    program->num_qubits = num_qubits;
+    program->num_params = instructions->num_params;
+    program->num_cregs = instructions->num_cregs;
+    program->bound = (instructions->num_params == 0);
+
+    // Exact sizes are known up front (at most one op per instruction, one guard per IF and
+    // OP_HALT; one matrix slot per parameterized gate or fused run), so slot pointers never move
+    LoweringCounts counts;
+    count_lowering(instructions, &counts);
+    size_t slots = counts.slots;
+    size_t parameterized = counts.parameterized;
+    size_t pair_gates = counts.pair_gates;
+    program->capacity = counts.ops;
+    program->code = (BytecodeOp*)malloc(program->capacity * sizeof(BytecodeOp));
+    program->matrices = (float*)malloc((slots ? slots : 1) * MATRIX_FLOATS * sizeof(float));
+    program->bindings = (BytecodeBinding*)malloc((parameterized ? parameterized : 1) * sizeof(BytecodeBinding));
+
+    CompileState cs;
+    memset(&cs, 0, sizeof(cs));
+    cs.op_of = (size_t*)malloc((instructions->size ? instructions->size : 1) * sizeof(size_t));
+    cs.pending = (size_t*)malloc((used_qubits ? used_qubits : 1) * sizeof(size_t));
+    size_t* block_of = (size_t*)malloc((instructions->size ? instructions->size : 1) * sizeof(size_t));
+    TwoQubitBlock* blocks = (TwoQubitBlock*)malloc((pair_gates ? pair_gates : 1) * sizeof(TwoQubitBlock));
+    if (!program->code || !program->matrices || !program->bindings || !cs.op_of || !cs.pending ||
+        !block_of || !blocks) {
+        free(cs.op_of);
+        free(cs.pending);
+        free(block_of);
+        free(blocks);
+        free_bytecode(program);
+        return -3;
+    }
+    for (size_t q = 0; q < used_qubits; q++) cs.pending[q] = SIZE_MAX;
+    // cs.pending doubles as the open-block table of the planner (it is reset right after)
+    plan_two_qubit_blocks(instructions, used_qubits, num_qubits, cs.pending, blocks, block_of);
+    for (size_t q = 0; q < used_qubits; q++) cs.pending[q] = SIZE_MAX;
+
+    int rc = 0;
+    for (size_t i = 0; i < instructions->size && rc == 0; i++) {
+        const Instruction* instr = &instructions->data[i];
+        if (instr->type == INSTR_NOISE) continue; // bytecode runs are ideal runs
+        // "IF c==v" becomes a guard that skips the single op emitted for this instruction
+        size_t guard = SIZE_MAX;
+        if (instr->cond_reg) {
+            guard = program->size;
+            rc = emit(program, OP_SKIP_UNLESS, instr->cond_reg - 1u, instr->cond_value, NULL);
+            if (rc != 0) break;
+        }
+        if (is_block_marker(instr)) {
+            rc = emit_block_marker(program, &cs, instructions, i);
+            cs.barrier = program->size; // nothing fuses across a block boundary
+            continue;
+        }
+
+        for (size_t q = 0; q < instr->qubit_count; q++) {
+            if (instr->qubits[q] >= num_qubits) {
+                fprintf(stderr, "Compile error: instruction %zu ('%s') uses qubit %zu, register has %zu.\n",
+                        i, instr->gate_name, instr->qubits[q], num_qubits);
+                rc = -2;
+            }
+        }
+        if (rc != 0) break;
+
+        if (block_of[i] != NO_BLOCK && block_pays_off(&blocks[block_of[i]], num_qubits)) {
+            // The whole block runs where its first gate stood, as one sweep
+            const TwoQubitBlock* blk = &blocks[block_of[i]];
+            if (blk->first != i) continue;
+            float* unitary = &program->matrices[program->num_matrices * MATRIX_FLOATS];
+            program->num_matrices += UNITARY_FLOATS / MATRIX_FLOATS;
+            for (size_t k = 0; k < UNITARY_FLOATS; k++) unitary[k] = (float)blk->u[k];
+            cs.pending[blk->a] = SIZE_MAX;
+            cs.pending[blk->b] = SIZE_MAX;
+            rc = emit(program, OP_GATE_2Q, blk->a, blk->b, unitary);
+            continue;
+        }
+
+        // Parameterized gates get their own matrix slot; constant ones are evaluated right away
+        float* slot = NULL;
+        int symbolic = 0;
+        if (instr->param_count > 0) {
+            float probe[MATRIX_FLOATS];
+            float zeros[MAX_GATE_PARAMS] = { 0.0f };
+            if (parameterized_gate_matrix(instr->gate_name, zeros, probe) != 0) {
+                fprintf(stderr, "Compile warning: unrecognized parameterized gate '%s' dropped.\n",
+                        instr->gate_name);
+                continue;
+            }
+            BytecodeBinding b;
+            memset(&b, 0, sizeof(b));
+            b.slot = (uint32_t)program->num_matrices++;
+            b.param_count = instr->param_count;
+            memcpy(b.param_ids, instr->param_ids, sizeof(b.param_ids));
+            memcpy(b.params, instr->params, sizeof(b.params));
+            snprintf(b.gate_name, sizeof(b.gate_name), "%.7s", instr->gate_name);
+            slot = &program->matrices[(size_t)b.slot * MATRIX_FLOATS];
+
+            for (size_t k = 0; k < b.param_count; k++) symbolic |= (b.param_ids[k] >= 0);
+            if (symbolic) {
+                program->bindings[program->num_bindings++] = b;
+                memset(slot, 0, MATRIX_FLOATS * sizeof(float)); // filled in by the first bind
+            } else {
+                parameterized_gate_matrix(b.gate_name, b.params, slot);
+            }
+        }
+
+        switch (instr->type) {
+            case INSTR_GATE_SINGLE: {
+                const float* gate = slot ? slot : find_single_qubit_gate(instr->gate_name);
+                if (instr->has_matrix) {
+                    // Ops outlive the instruction list: copy fused matrices into the pool
+                    float* own = &program->matrices[program->num_matrices++ * MATRIX_FLOATS];
+                    memcpy(own, instr->matrix, MATRIX_FLOATS * sizeof(float));
+                    gate = own;
+                }
+                if (!gate) {
+                    fprintf(stderr, "Warning: unrecognized single-qubit gate '%s'. Dropped as identity.\n",
+                            instr->gate_name);
+                    break;
+                }
+                // Symbolic slots are rewritten by every bind and guarded gates may not run,
+                // so neither takes part in fusion
+                rc = emit_fused_gate(program, &cs, instr->qubits[0], gate, !symbolic && !instr->cond_reg);
+                break;
+            }
+            case INSTR_GATE_MULTI: {
+                int is_cnot = strcasecmp(instr->gate_name, "CNOT") == 0;
+                int is_cphase = slot && strcasecmp(instr->gate_name, "CPHASE") == 0;
+                if ((is_cnot || is_cphase) && instr->qubit_count == 2) {
+                    if (instr->qubits[0] == instr->qubits[1]) {
+                        fprintf(stderr, "Compile error: instruction %zu: %s control equals target.\n",
+                                i, instr->gate_name);
+                        rc = -2;
+                        break;
+                    }
+                    cs.pending[instr->qubits[0]] = SIZE_MAX;
+                    cs.pending[instr->qubits[1]] = SIZE_MAX;
+                    rc = emit(program, is_cnot ? OP_CNOT : OP_CPHASE, instr->qubits[0], instr->qubits[1],
+                              is_cnot ? NULL : slot);
+                } else {
+                    fprintf(stderr, "Compile warning: unrecognized multi-qubit gate '%s' dropped.\n",
+                            instr->gate_name);
+                }
+                break;
+            }
+            case INSTR_MEASURE:
+                cs.pending[instr->qubits[0]] = SIZE_MAX;
+                if (instr->target_reg) {
+                    rc = emit(program, OP_MEASURE_CREG, instr->qubits[0],
+                              (instr->target_reg - 1u) * MAX_CREG_BITS + instr->target_bit, NULL);
+                } else {
+                    rc = emit(program, OP_MEASURE, instr->qubits[0], instr->source_qubit, NULL);
+                }
+                if (rc == 0) program->code[program->size - 1].flip = instr->invert_result;
+                break;
+            case INSTR_UNKNOWN:
+            default:
+                fprintf(stderr, "Compile warning: unknown instruction type for gate '%s' dropped.\n",
+                        instr->gate_name);
+                break;
+        }
+        if (rc == 0 && guard != SIZE_MAX && guard == program->size - 1) program->size--; // guarded op was dropped
+    }
+
+    program->max_depth = cs.need;
+    free(cs.op_of);
+    free(cs.pending);
+    free(block_of);
+    free(blocks);
+    if (rc == 0) rc = emit(program, OP_HALT, 0, 0, NULL);
+    if (rc == 0 && index_bindings(program) != 0) rc = -3;
+    if (rc != 0) {
+        free_bytecode(program);
+        return rc;
+    }
+    return 0;
+}
+
+int bind_bytecode_parameters(BytecodeProgram* program, const double* values, size_t count) {
+    if (!program || (!values && count > 0)) return -1;
+    if (count != program->num_params) {
+        fprintf(stderr, "Bind error: program has %zu parameter(s), got %zu value(s).\n",
+                program->num_params, count);
+        return -2;
+    }
+
+    for (size_t p = 0; p < count; p++) {
+        if (program->bound && program->param_values[p] == values[p]) continue;
+        program->param_values[p] = values[p];
+        // Recompute only the gates that reference this parameter
+        for (size_t j = program->param_offsets[p]; j < program->param_offsets[p + 1]; j++) {
+            evaluate_binding(program, &program->bindings[program->param_bindings[j]]);
+        }
+    }
+    program->bound = 1;
+    return 0;
+}
+
+void free_bytecode(BytecodeProgram* program) {
+    if (!program) return;
+    free(program->code);
+    free(program->matrices);
+    free(program->bindings);
+    free(program->param_offsets);
+    free(program->param_bindings);
+    free(program->param_values);
+    memset(program, 0, sizeof(*program));
+}
+
+int execute_bytecode(const BytecodeProgram* program, StateVector* sv) {
+    if (!program) return -1;
+    uint32_t local_cregs[16] = { 0 };
+    uint32_t* cregs = local_cregs;
+    if (program->num_cregs > 16) {
+        cregs = (uint32_t*)calloc(program->num_cregs, sizeof(uint32_t));
+        if (!cregs) return -1;
+    }
+    int rc = execute_bytecode_classical(program, sv, cregs);
+    if (cregs != local_cregs) free(cregs);
+    return rc;
+}
+
+int execute_bytecode_classical(const BytecodeProgram* program, StateVector* sv, uint32_t* cregs) {
+    if (!program || !program->code || !sv || (!cregs && program->num_cregs > 0)) return -1;
+    if (sv->num_qubits < program->num_qubits) {
+        fprintf(stderr, "Interpret error: program needs %zu qubits, state has %zu.\n",
+                program->num_qubits, sv->num_qubits);
+        return -2;
+    }
+    if (!program->bound) {
+        fprintf(stderr, "Interpret error: program has unbound parameters; call bind_bytecode_parameters.\n");
+        return -3;
+    }
+
+    // Loop frames hold the iterations left, call frames the return op index
+    uint32_t local_frames[MAX_BLOCK_DEPTH];
+    uint32_t* frames = local_frames;
+    if (program->max_depth > MAX_BLOCK_DEPTH) {
+        frames = (uint32_t*)malloc(program->max_depth * sizeof(uint32_t));
+        if (!frames) return -1;
+    }
+    size_t top = 0;
+    const BytecodeOp* code = program->code;
+    const BytecodeOp* pc = code;
+    int outcome;
+    int rc = 0;
+
+#if defined(__GNUC__)
+    // Threaded dispatch: every handler jumps straight to the next op's handler
+    static void* const handlers[OP_COUNT] = {
+        [OP_GATE_1Q]  = &&op_gate_1q,
+        [OP_GATE_2Q]  = &&op_gate_2q,
+        [OP_CNOT]     = &&op_cnot,
+        [OP_CPHASE]   = &&op_cphase,
+        [OP_MEASURE]  = &&op_measure,
+        [OP_MEASURE_CREG] = &&op_measure_creg,
+        [OP_SKIP_UNLESS]  = &&op_skip_unless,
+        [OP_JUMP]     = &&op_jump,
+        [OP_REPEAT]   = &&op_repeat,
+        [OP_LOOP_END] = &&op_loop_end,
+        [OP_CALL]     = &&op_call,
+        [OP_RETURN]   = &&op_return,
+        [OP_HALT]     = &&op_halt
+    };
+#define DISPATCH() goto *handlers[pc->opcode]
+#define NEXT() do { pc++; DISPATCH(); } while (0)
+
+    DISPATCH();
+op_gate_1q:
+    apply_single_qubit_gate(sv, pc->matrix, pc->q0);
+    NEXT();
+op_gate_2q:
+    apply_two_qubit_gate(sv, pc->matrix, pc->q0, pc->q1);
+    NEXT();
+op_cnot:
+    apply_cnot(sv, pc->q0, pc->q1);
+    NEXT();
+op_cphase:
+    apply_controlled_phase(sv, pc->q0, pc->q1, pc->matrix[0], pc->matrix[1]);
+    NEXT();
+op_measure:
+    if (measure_qubit(sv, pc->q0, &outcome) != 0) {
+        fprintf(stderr, "Interpret error: measure_qubit failed.\n");
+        rc = -5;
+        goto op_halt;
+    }
+    outcome ^= (int)pc->flip;
+    report_measurement(pc->q1, outcome);
+    NEXT();
+op_measure_creg: {
+    if (measure_qubit(sv, pc->q0, &outcome) != 0) {
+        fprintf(stderr, "Interpret error: measure_qubit failed.\n");
+        rc = -5;
+        goto op_halt;
+    }
+    outcome ^= (int)pc->flip;
+    uint32_t mask = (uint32_t)1 << (pc->q1 % MAX_CREG_BITS);
+    uint32_t* reg = &cregs[pc->q1 / MAX_CREG_BITS];
+    *reg = outcome ? (*reg | mask) : (*reg & ~mask);
+    NEXT();
+}
+op_skip_unless:
+    if (cregs[pc->q0] == pc->q1) {
+        pc++;
+    } else {
+        if (pc[1].opcode == OP_MEASURE) report_measurement(pc[1].q1, -1);
+        pc += 2;
+    }
+    DISPATCH();
+op_jump:
+    pc = code + pc->q1;
+    DISPATCH();
+op_repeat:
+    frames[top++] = pc->q0;
+    NEXT();
+op_loop_end:
+    if (--frames[top - 1] > 0) {
+        pc = code + pc->q1;
+        DISPATCH();
+    }
+    top--;
+    NEXT();
+op_call:
+    frames[top++] = (uint32_t)(pc - code) + 1;
+    pc = code + pc->q1;
+    DISPATCH();
+op_return:
+    pc = code + frames[--top];
+    DISPATCH();
+op_halt:
+    if (frames != local_frames) free(frames);
+    return rc;
+
+#undef NEXT
+#undef DISPATCH
+#else
+    for (;;) {
+        switch (pc->opcode) {
+            case OP_GATE_1Q:
+                apply_single_qubit_gate(sv, pc->matrix, pc->q0);
+                break;
+            case OP_GATE_2Q:
+                apply_two_qubit_gate(sv, pc->matrix, pc->q0, pc->q1);
+                break;
+            case OP_CNOT:
+                apply_cnot(sv, pc->q0, pc->q1);
+                break;
+            case OP_CPHASE:
+                apply_controlled_phase(sv, pc->q0, pc->q1, pc->matrix[0], pc->matrix[1]);
+                break;
+            case OP_MEASURE:
+                if (measure_qubit(sv, pc->q0, &outcome) != 0) {
+                    fprintf(stderr, "Interpret error: measure_qubit failed.\n");
+                    rc = -5;
+                    goto done;
+                }
+                outcome ^= (int)pc->flip;
+                report_measurement(pc->q1, outcome);
+                break;
+            case OP_MEASURE_CREG: {
+                if (measure_qubit(sv, pc->q0, &outcome) != 0) {
+                    fprintf(stderr, "Interpret error: measure_qubit failed.\n");
+                    rc = -5;
+                    goto done;
+                }
+                outcome ^= (int)pc->flip;
+                uint32_t mask = (uint32_t)1 << (pc->q1 % MAX_CREG_BITS);
+                uint32_t* reg = &cregs[pc->q1 / MAX_CREG_BITS];
+                *reg = outcome ? (*reg | mask) : (*reg & ~mask);
+                break;
+            }
+            case OP_SKIP_UNLESS:
+                if (cregs[pc->q0] == pc->q1) {
+                    pc++;
+                } else {
+                    if (pc[1].opcode == OP_MEASURE) report_measurement(pc[1].q1, -1);
+                    pc += 2;
+                }
+                continue;
+            case OP_JUMP:
+                pc = code + pc->q1;
+                continue;
+            case OP_REPEAT:
+                frames[top++] = pc->q0;
+                break;
+            case OP_LOOP_END:
+                if (--frames[top - 1] > 0) {
+                    pc = code + pc->q1;
+                    continue;
+                }
+                top--;
+                break;
+            case OP_CALL:
+                frames[top++] = (uint32_t)(pc - code) + 1;
+                pc = code + pc->q1;
+                continue;
+            case OP_RETURN:
+                pc = code + frames[--top];
+                continue;
+            case OP_HALT:
+            default:
+                goto done;
+        }
+        pc++;
+    }
+done:
+    if (frames != local_frames) free(frames);
+    return rc;
+#endif
+}
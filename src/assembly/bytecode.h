@@ -0,0 +1,144 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "parser.h"
+#include "state_vector.h"
+
+/**
+ * \brief Opcodes of the lowered instruction stream.
+ */
+typedef enum {
+    OP_GATE_1Q,   /**< Apply 'matrix' to qubit q0 */
+    OP_GATE_2Q,   /**< Apply the 4x4 'matrix' to qubits q0 (high local bit) and q1 */
+    OP_CNOT,      /**< CNOT with control q0, target q1 */
+    OP_CPHASE,    /**< Controlled phase on q0, q1; matrix[0..1] holds e^{i phi} */
+    OP_MEASURE,   /**< Measure qubit q0 and print the outcome as qubit q1's */
+    OP_MEASURE_CREG, /**< Measure qubit q0 into bit (q1 % 32) of classical register (q1 / 32) */
+    OP_SKIP_UNLESS,  /**< Skip the next op unless classical register q0 equals q1 */
+    OP_JUMP,      /**< Continue at op q1 (skips DEF bodies and zero-trip loops) */
+    OP_REPEAT,    /**< Push a loop frame running the following body q0 times */
+    OP_LOOP_END,  /**< Decrement the loop frame; jump back to op q1 until it reaches zero */
+    OP_CALL,      /**< Push the return address and continue at op q1 (a subcircuit body) */
+    OP_RETURN,    /**< Pop the return address pushed by OP_CALL */
+    OP_HALT,      /**< End of program (always the last op) */
+    OP_COUNT
+} Opcode;
+
+/**
+ * \brief One bytecode op. Operands are already validated against the register size.
+ */
+typedef struct {
+    uint32_t     opcode;  /**< Opcode */
+    uint32_t     q0;      /**< First qubit operand (OP_REPEAT: trip count) */
+    uint32_t     q1;      /**< Second qubit operand, or target op index of control-flow ops */
+    uint32_t     flip;    /**< OP_MEASURE/OP_MEASURE_CREG: XORed into the outcome */
+    const float* matrix;  /**< Pre-resolved 2x2 gate (OP_GATE_1Q), 4x4 gate (OP_GATE_2Q) or phase (OP_CPHASE) */
+} BytecodeOp;
+
+/**
+ * \brief Recipe for recomputing one parameterized gate's matrix slot when parameters change.
+ */
+typedef struct {
+    uint32_t slot;                      /**< Index of the 8-float slot in BytecodeProgram.matrices */
+    uint8_t  param_count;
+    int16_t  param_ids[MAX_GATE_PARAMS];/**< Symbol per angle, -1 for constants */
+    float    params[MAX_GATE_PARAMS];   /**< Constant angle or factor applied to the symbol */
+    char     gate_name[8];              /**< "RX", "RY", "RZ", "U3" or "CPHASE" */
+} BytecodeBinding;
+
+/**
+ * \brief A compiled program, ready for execute_bytecode.
+ */
+typedef struct {
+    BytecodeOp* code;       /**< Ops, terminated by OP_HALT */
+    size_t      size;       /**< Number of ops, including OP_HALT */
+    size_t      capacity;
+    size_t      num_qubits; /**< Register size the program was validated against */
+    size_t      max_depth;  /**< Deepest loop/call frame stack the program can reach */
+    size_t      num_cregs;  /**< Classical registers the program reads and writes */
+    float*      matrices;   /**< Owned 8-float slots for parameterized and fused gates */
+    size_t      num_matrices;
+    BytecodeBinding* bindings;  /**< Slots that depend on at least one symbol */
+    size_t      num_bindings;
+    size_t      num_params;     /**< Symbolic parameters (same order as the InstructionList) */
+    size_t*     param_offsets;  /**< CSR: bindings touched by parameter p are */
+    uint32_t*   param_bindings; /**< param_bindings[param_offsets[p] .. param_offsets[p + 1]) */
+    double*     param_values;   /**< Values of the last bind */
+    int         bound;          /**< Nonzero once every parameter has a value */
+} BytecodeProgram;
+
+/**
+ * \brief Lowers an InstructionList into bytecode. Gate names are resolved and qubit
+ *        operands range-checked here, once, so the execution loop does neither.
+ *        Unknown gates are dropped with a warning (the interpreter treats them as identity).
+ *        REPEAT and DEF blocks stay compact (loop and call ops, never unrolled), and runs
+ *        of constant single-qubit gates on the same qubit are fused into one matrix, so a
+ *        loop body is fused once and the fused kernels are reused on every iteration.
+ *        Stretches of constant gates confined to one qubit pair (single-qubit gates
+ *        interleaved with CNOT/CPHASE on that pair) are multiplied into one 4x4 unitary
+ *        and run by apply_two_qubit_gate in a single sweep.
+ * \param instructions Parsed (and optionally optimized) instructions
+ * \param num_qubits Register size to validate against (0 => highest qubit index + 1)
+ * \param program Output program (free with free_bytecode)
+ * \return 0 on success, nonzero on validation or allocation error
+ */
+int compile_bytecode(const InstructionList* instructions, size_t num_qubits, BytecodeProgram* program);
+
+/**
+ * \brief Bytes compile_bytecode and execute_bytecode allocate for an instruction list,
+ *        computed from the same counts without compiling.
+ * \param instructions Parsed (and optionally optimized) instructions
+ * \param program_bytes Output: ops, matrix slots, bindings and parameter index kept by the program
+ * \param scratch_bytes Output: planning tables freed after compiling, plus any heap frames and
+ *        registers of the execution loop
+ */
+void bytecode_footprint(const InstructionList* instructions, size_t* program_bytes, size_t* scratch_bytes);
+
+/**
+ * \brief Binds numeric values to the program's symbolic parameters. Only the matrices of
+ *        gates that use a parameter whose value changed since the last bind are recomputed,
+ *        so sweeping over many parameter points costs one bind plus one execution each.
+ * \param program Program from compile_bytecode
+ * \param values One value (radians) per symbolic parameter, in InstructionList.param_names order
+ * \param count Must equal program->num_params
+ * \return 0 on success, nonzero on error
+ */
+int bind_bytecode_parameters(BytecodeProgram* program, const double* values, size_t count);
+
+/**
+ * \brief Like execute_bytecode, with caller-owned classical registers.
+ * \param program Program from compile_bytecode
+ * \param sv StateVector with at least program->num_qubits qubits
+ * \param cregs program->num_cregs register values (bit i = c[i]); read by IF, written by MEASURE
+ * \return 0 on success, nonzero on error
+ */
+int execute_bytecode_classical(const BytecodeProgram* program, StateVector* sv, uint32_t* cregs);
+
+/**
+ * \brief Frees a compiled program.
+ */
+void free_bytecode(BytecodeProgram* program);
+
+/**
+ * \brief Runs a compiled program on a dense state vector using threaded dispatch
+ *        (computed goto on GCC/Clang, a switch loop elsewhere).
+ * \param program Program from compile_bytecode
+ * \param sv StateVector with at least program->num_qubits qubits
+ * \return 0 on success, nonzero on error (including unbound parameters)
+ *
+ * Classical registers start at zero and are discarded; use execute_bytecode_classical to
+ * seed or read them.
+ */
+int execute_bytecode(const BytecodeProgram* program, StateVector* sv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BYTECODE_H */
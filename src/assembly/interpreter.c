@@ -1,7 +1,9 @@
 #include "interpreter.h"
 #include "gate_operations.h"
 #include "measurement.h"
+#include "noise_channels.h"
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
 
@@ -10,8 +12,8 @@
  *        Format: [r00, i00, r01, i01, r10, i10, r11, i11]
  */
 static const float H_GATE[8] = {
-    0.707f, 0.0f,  0.707f, 0.0f,
-    0.707f, 0.0f, -0.707f, 0.0f
+    0.70710678f, 0.0f,  0.70710678f, 0.0f,
+    0.70710678f, 0.0f, -0.70710678f, 0.0f
 };
 
 static const float X_GATE[8] = {
@@ -37,7 +39,7 @@ static const float S_GATE[8] = {
 
 static const float T_GATE[8] = {
     1.0f, 0.0f, 0.0f, 0.0f,
-    0.0f, 0.0f, 0.7071f, 0.7071f // e^{i\pi/4} = 1/sqrt(2) + i/sqrt(2)
+    0.0f, 0.0f, 0.70710678f, 0.70710678f // e^{i\pi/4} = 1/sqrt(2) + i/sqrt(2)
 };
 
 // If a custom gate name is not recognized, we handle it as identity or throw a warning.
@@ -46,82 +48,519 @@ static const float ID_GATE[8] = {
     0.0f, 0.0f, 1.0f, 0.0f
 };
 
+const float* find_single_qubit_gate(const char* gate_name) {
+    // All built-in single-qubit gates have one-letter names
+    if (!gate_name || gate_name[0] == '\0' || gate_name[1] != '\0') return NULL;
+    switch (gate_name[0] | 0x20) { // ASCII lower-case
+        case 'h': return H_GATE;
+        case 'x': return X_GATE;
+        case 'y': return Y_GATE;
+        case 'z': return Z_GATE;
+        case 's': return S_GATE;
+        case 't': return T_GATE;
+        default:  return NULL;
+    }
+}
+
 /**
  * \brief Returns pointer to a 2x2 float array representing the gate (or ID_GATE if unknown).
  */
-static const float* get_single_qubit_gate(const char* gate_name) {
-    if (strcasecmp(gate_name, "H") == 0)  return H_GATE;
-    if (strcasecmp(gate_name, "X") == 0)  return X_GATE;
-    if (strcasecmp(gate_name, "Y") == 0)  return Y_GATE;
-    if (strcasecmp(gate_name, "Z") == 0)  return Z_GATE;
-    if (strcasecmp(gate_name, "S") == 0)  return S_GATE;
-    if (strcasecmp(gate_name, "T") == 0)  return T_GATE;
+const float* get_single_qubit_gate(const char* gate_name) {
+    const float* gate = find_single_qubit_gate(gate_name);
+    if (gate) return gate;
 
     // Unknown single-qubit gate => identity
     fprintf(stderr, "Warning: unrecognized single-qubit gate '%s'. Using identity.\n", gate_name);
     return ID_GATE;
 }
 
-int interpret_instructions(const InstructionList* instructions, StateVector* sv) {
-    if (!instructions || !sv) return -1;
+int parameterized_gate_matrix(const char* gate_name, const float* angles, float* out) {
+    if (!gate_name || !angles || !out) return -1;
+    double half = 0.5 * angles[0];
+    double c = cos(half), s = sin(half);
 
-    for (size_t i = 0; i < instructions->size; i++) {
-        const Instruction* instr = &instructions->data[i];
-        // Check qubit range
-        for (size_t q = 0; q < instr->qubit_count; q++) {
-            if (instr->qubits[q] >= sv->num_qubits) {
-                fprintf(stderr, "Interpret error: qubit index %zu out of range (max %zu).\n",
-                        instr->qubits[q], sv->num_qubits - 1);
-                return -2;
+    if (strcasecmp(gate_name, "RX") == 0) {
+        // [[cos, -i sin], [-i sin, cos]]
+        const float m[8] = { (float)c, 0.0f, 0.0f, (float)-s, 0.0f, (float)-s, (float)c, 0.0f };
+        memcpy(out, m, sizeof(m));
+    } else if (strcasecmp(gate_name, "RY") == 0) {
+        // [[cos, -sin], [sin, cos]]
+        const float m[8] = { (float)c, 0.0f, (float)-s, 0.0f, (float)s, 0.0f, (float)c, 0.0f };
+        memcpy(out, m, sizeof(m));
+    } else if (strcasecmp(gate_name, "RZ") == 0) {
+        // diag(e^{-i theta/2}, e^{i theta/2})
+        const float m[8] = { (float)c, (float)-s, 0.0f, 0.0f, 0.0f, 0.0f, (float)c, (float)s };
+        memcpy(out, m, sizeof(m));
+    } else if (strcasecmp(gate_name, "U3") == 0) {
+        // [[cos, -e^{i lambda} sin], [e^{i phi} sin, e^{i (phi + lambda)} cos]]
+        double phi = angles[1], lambda = angles[2];
+        const float m[8] = {
+            (float)c, 0.0f,
+            (float)(-cos(lambda) * s), (float)(-sin(lambda) * s),
+            (float)(cos(phi) * s), (float)(sin(phi) * s),
+            (float)(cos(phi + lambda) * c), (float)(sin(phi + lambda) * c)
+        };
+        memcpy(out, m, sizeof(m));
+    } else if (strcasecmp(gate_name, "CPHASE") == 0) {
+        // Only the |11> phase e^{i phi} is stored
+        memset(out, 0, 8 * sizeof(float));
+        out[0] = (float)cos(angles[0]);
+        out[1] = (float)sin(angles[0]);
+    } else {
+        return -2;
+    }
+    return 0;
+}
+
+/**
+ * \brief Resolves an instruction's angles (constants only; the plain interpreter has no bindings).
+ * \return 0 on success, nonzero if an angle depends on a symbolic parameter
+ */
+static int constant_angles(const Instruction* instr, float* angles) {
+    for (size_t k = 0; k < instr->param_count; k++) {
+        if (instr->param_ids[k] >= 0) return -1;
+        angles[k] = instr->params[k];
+    }
+    return 0;
+}
+
+/**
+ * \brief Engine-specific entry points used by the shared instruction dispatcher.
+ *        apply_cphase may be NULL, in which case CPHASE is decomposed into CNOTs and phase gates.
+ *        apply_noise may be NULL, in which case noise channels are skipped (an ideal run), and
+ *        record may be NULL, in which case outcomes without a target register are printed.
+ */
+typedef struct {
+    void*  state;
+    size_t num_qubits;
+    int (*apply_gate)(void* state, const float* gate, size_t qubit_index);
+    int (*apply_cnot)(void* state, size_t control_qubit, size_t target_qubit);
+    int (*measure)(void* state, size_t qubit_index, int* out_result);
+    int (*apply_cphase)(void* state, size_t control_qubit, size_t target_qubit, float re, float im);
+    int (*apply_noise)(void* state, const Instruction* instr);
+    void (*record)(void* state, size_t qubit_index, int outcome);
+} EngineOps;
+
+/**
+ * \brief CPHASE(phi) = P(phi/2)_c . CNOT . P(-phi/2)_t . CNOT . P(phi/2)_t, for engines
+ *        without a native controlled-phase kernel.
+ */
+static int decomposed_cphase(const EngineOps* ops, size_t control, size_t target, float phi) {
+    float plus[8] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, cosf(0.5f * phi), sinf(0.5f * phi) };
+    float minus[8] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, cosf(0.5f * phi), -sinf(0.5f * phi) };
+    if (ops->apply_gate(ops->state, plus, target) != 0) return -1;
+    if (ops->apply_cnot(ops->state, control, target) != 0) return -1;
+    if (ops->apply_gate(ops->state, minus, target) != 0) return -1;
+    if (ops->apply_cnot(ops->state, control, target) != 0) return -1;
+    return ops->apply_gate(ops->state, plus, control);
+}
+
+static int dense_gate(void* s, const float* g, size_t q) { return apply_single_qubit_gate((StateVector*)s, g, q); }
+static int dense_cnot(void* s, size_t c, size_t t) { return apply_cnot((StateVector*)s, c, t); }
+static int dense_measure(void* s, size_t q, int* o) { return measure_qubit((StateVector*)s, q, o); }
+static int dense_cphase(void* s, size_t c, size_t t, float re, float im) {
+    return apply_controlled_phase((StateVector*)s, c, t, re, im);
+}
+
+static int compressed_gate(void* s, const float* g, size_t q) {
+    return compressed_apply_single_qubit_gate((CompressedStateVector*)s, g, q);
+}
+static int compressed_cnot(void* s, size_t c, size_t t) {
+    return compressed_apply_cnot((CompressedStateVector*)s, c, t);
+}
+static int compressed_measure(void* s, size_t q, int* o) {
+    return compressed_measure_qubit((CompressedStateVector*)s, q, o);
+}
+
+static int sparse_gate(void* s, const float* g, size_t q) { return sparse_apply_single_qubit_gate((SparseStateVector*)s, g, q); }
+static int sparse_cnot(void* s, size_t c, size_t t) { return sparse_apply_cnot((SparseStateVector*)s, c, t); }
+static int sparse_measure(void* s, size_t q, int* o) { return sparse_measure_qubit((SparseStateVector*)s, q, o); }
+static int sparse_cphase(void* s, size_t c, size_t t, float re, float im) {
+    return sparse_apply_controlled_phase((SparseStateVector*)s, c, t, re, im);
+}
+
+static int tableau_gate(void* s, const float* g, size_t q) {
+    return tableau_apply_single_qubit_gate((StabilizerTableau*)s, g, q);
+}
+static int tableau_cnot(void* s, size_t c, size_t t) { return tableau_apply_cnot((StabilizerTableau*)s, c, t); }
+static int tableau_measure(void* s, size_t q, int* o) { return tableau_measure_qubit((StabilizerTableau*)s, q, o); }
+static int tableau_cphase(void* s, size_t c, size_t t, float re, float im) {
+    return tableau_apply_controlled_phase((StabilizerTableau*)s, c, t, re, im);
+}
+
+static int mps_gate(void* s, const float* g, size_t q) { return mps_apply_single_qubit_gate((MpsState*)s, g, q); }
+static int mps_cnot(void* s, size_t c, size_t t) { return mps_apply_cnot((MpsState*)s, c, t); }
+static int mps_measure(void* s, size_t q, int* o) { return mps_measure_qubit((MpsState*)s, q, o); }
+static int mps_cphase(void* s, size_t c, size_t t, float re, float im) {
+    return mps_apply_controlled_phase((MpsState*)s, c, t, re, im);
+}
+
+static void dense_ops(EngineOps* ops, StateVector* sv) {
+    ops->state = sv;
+    ops->num_qubits = sv->num_qubits;
+    ops->apply_gate = dense_gate;
+    ops->apply_cnot = dense_cnot;
+    ops->measure = dense_measure;
+    ops->apply_cphase = dense_cphase;
+    ops->apply_noise = NULL;
+    ops->record = NULL;
+}
+
+/**
+ * \brief Where this thread's measurement outcomes go (NULL => stdout).
+ */
+static _Thread_local MeasurementLog* measurement_log = NULL;
+
+void set_measurement_log(MeasurementLog* log) {
+    measurement_log = log;
+}
+
+void report_measurement(size_t qubit, int outcome) {
+    MeasurementLog* log = measurement_log;
+    if (log) {
+        if (log->size == log->capacity) {
+            size_t cap = log->capacity ? log->capacity * 2 : 64;
+            size_t* qubits = (size_t*)realloc(log->qubits, cap * sizeof(size_t));
+            if (qubits) log->qubits = qubits;
+            int* outcomes = qubits ? (int*)realloc(log->outcomes, cap * sizeof(int)) : NULL;
+            if (outcomes) log->outcomes = outcomes;
+            if (qubits && outcomes) log->capacity = cap;
+        }
+        if (log->size < log->capacity) {
+            log->qubits[log->size] = qubit;
+            log->outcomes[log->size] = outcome;
+            log->size++;
+            return;
+        }
+        // Out of memory: printing out of order beats losing the outcome
+    }
+    if (outcome >= 0) printf("Measurement of qubit %zu => %d\n", qubit, outcome);
+}
+
+void free_measurement_log(MeasurementLog* log) {
+    if (!log) return;
+    free(log->qubits);
+    free(log->outcomes);
+    memset(log, 0, sizeof(*log));
+}
+
+/**
+ * \brief Executes one instruction on whichever engine 'ops' describes. cregs holds one value
+ *        per classical register and receives "MEASURE q -> c[i]" outcomes (NULL if none).
+ * \return 0 on success, nonzero on error
+ */
+static int execute_instruction(const EngineOps* ops, const Instruction* instr, uint32_t* cregs) {
+    // Check qubit range
+    for (size_t q = 0; q < instr->qubit_count; q++) {
+        if (instr->qubits[q] >= ops->num_qubits) {
+            fprintf(stderr, "Interpret error: qubit index %zu out of range (max %zu).\n",
+                    instr->qubits[q], ops->num_qubits - 1);
+            return -2;
+        }
+    }
+
+    if (instr->type == INSTR_NOISE) {
+        if (ops->apply_noise && ops->apply_noise(ops->state, instr) != 0) {
+            fprintf(stderr, "Interpret error: failed to apply noise channel '%s'.\n", instr->gate_name);
+            return -8;
+        }
+        return 0;
+    }
+
+    float angles[MAX_GATE_PARAMS];
+    float matrix[8];
+    if (instr->param_count > 0) {
+        if (constant_angles(instr, angles) != 0) {
+            fprintf(stderr, "Interpret error: gate '%s' has an unbound parameter; compile and bind it first.\n",
+                    instr->gate_name);
+            return -6;
+        }
+        if (parameterized_gate_matrix(instr->gate_name, angles, matrix) != 0) {
+            fprintf(stderr, "Interpret warning: unrecognized parameterized gate '%s'.\n", instr->gate_name);
+            return 0;
+        }
+    }
+
+    switch (instr->type) {
+        case INSTR_GATE_SINGLE: {
+            const float* gate = instr->param_count > 0 ? matrix
+                              : instr->has_matrix ? instr->matrix : get_single_qubit_gate(instr->gate_name);
+            if (ops->apply_gate(ops->state, gate, instr->qubits[0]) != 0) {
+                fprintf(stderr, "Interpret error: failed to apply single-qubit gate '%s'.\n",
+                        instr->gate_name);
+                return -3;
+            }
+            break;
+        }
+        case INSTR_GATE_MULTI: {
+            // Currently, only "CNOT" or multi-qubit gates recognized
+            // We check if gate_name is "CNOT"
+            if (strcasecmp(instr->gate_name, "CNOT") == 0 && instr->qubit_count == 2) {
+                if (ops->apply_cnot(ops->state, instr->qubits[0], instr->qubits[1]) != 0) {
+                    fprintf(stderr, "Interpret error: failed to apply CNOT.\n");
+                    return -4;
+                }
+            } else if (strcasecmp(instr->gate_name, "CPHASE") == 0 && instr->qubit_count == 2 &&
+                       instr->param_count == 1) {
+                int rc = ops->apply_cphase
+                    ? ops->apply_cphase(ops->state, instr->qubits[0], instr->qubits[1], matrix[0], matrix[1])
+                    : decomposed_cphase(ops, instr->qubits[0], instr->qubits[1], angles[0]);
+                if (rc != 0) {
+                    fprintf(stderr, "Interpret error: failed to apply CPHASE.\n");
+                    return -4;
+                }
+            } else {
+                fprintf(stderr, "Interpret warning: unrecognized multi-qubit gate '%s'.\n", instr->gate_name);
             }
+            break;
         }
+        case INSTR_MEASURE: {
+            // measure => collapses the state
+            int outcome = -1;
+            if (ops->measure(ops->state, instr->qubits[0], &outcome) != 0) {
+                fprintf(stderr, "Interpret error: measure_qubit failed.\n");
+                return -5;
+            }
+            outcome ^= instr->invert_result;
+            if (ops->record) ops->record(ops->state, instr->qubits[0], outcome);
+            if (instr->target_reg) {
+                // Stays in the register for later IFs; no text round-trip
+                uint32_t mask = (uint32_t)1 << instr->target_bit;
+                uint32_t* reg = &cregs[instr->target_reg - 1];
+                *reg = outcome ? (*reg | mask) : (*reg & ~mask);
+            } else if (!ops->record) {
+                report_measurement(instr->source_qubit, outcome);
+            }
+            break;
+        }
+        case INSTR_UNKNOWN:
+        default:
+            // Possibly an unrecognized instruction with partial data
+            fprintf(stderr, "Interpret warning: unknown instruction type for gate '%s'.\n",
+                    instr->gate_name);
+            break;
+    }
+    return 0;
+}
 
+/**
+ * \brief One open REPEAT (iterations left, index of the REPEAT) or CALL (return index).
+ */
+typedef struct {
+    int      is_call;
+    uint32_t remaining;
+    size_t   index;
+} BlockFrame;
+
+/**
+ * \brief Runs a list on one engine, following REPEAT/DEF/CALL blocks without unrolling them
+ *        and skipping statements whose IF condition does not hold.
+ *        after_step (optional) runs after every executed gate or measurement.
+ * \return 0 on success, nonzero on error
+ */
+static int run_instructions(EngineOps* ops, const InstructionList* list, uint32_t* cregs,
+                            int (*after_step)(EngineOps* ops, void* ctx), void* ctx) {
+    BlockFrame* frames = NULL;
+    size_t depth = 0, capacity = 0;
+    int rc = 0;
+    size_t pc = 0;
+
+    while (pc < list->size && rc == 0) {
+        const Instruction* instr = &list->data[pc];
+        if (instr->cond_reg && cregs[instr->cond_reg - 1] != instr->cond_value) {
+            if (instr->type == INSTR_MEASURE && !instr->target_reg && !ops->record) {
+                report_measurement(instr->source_qubit, -1);
+            }
+            pc++;
+            continue;
+        }
         switch (instr->type) {
-            case INSTR_GATE_SINGLE: {
-                const float* gate = get_single_qubit_gate(instr->gate_name);
-                if (apply_single_qubit_gate(sv, gate, instr->qubits[0]) != 0) {
-                    fprintf(stderr, "Interpret error: failed to apply single-qubit gate '%s'.\n",
-                            instr->gate_name);
-                    return -3;
+            case INSTR_REPEAT:
+            case INSTR_CALL:
+                if (instr->type == INSTR_REPEAT && instr->repeat_count == 0) {
+                    pc = instr->link + 1; // skip the body
+                    break;
                 }
-                break;
-            }
-            case INSTR_GATE_MULTI: {
-                // Currently, only "CNOT" or multi-qubit gates recognized
-                // We check if gate_name is "CNOT"
-                if (strcasecmp(instr->gate_name, "CNOT") == 0 && instr->qubit_count == 2) {
-                    if (apply_cnot(sv, instr->qubits[0], instr->qubits[1]) != 0) {
-                        fprintf(stderr, "Interpret error: failed to apply CNOT.\n");
-                        return -4;
+                if (depth == capacity) {
+                    capacity = capacity ? capacity * 2 : 16;
+                    BlockFrame* grown = (BlockFrame*)realloc(frames, capacity * sizeof(BlockFrame));
+                    if (!grown) {
+                        rc = -1;
+                        break;
                     }
-                } else {
-                    fprintf(stderr, "Interpret warning: unrecognized multi-qubit gate '%s'.\n", instr->gate_name);
+                    frames = grown;
                 }
+                frames[depth].is_call = (instr->type == INSTR_CALL);
+                frames[depth].remaining = instr->repeat_count;
+                frames[depth].index = (instr->type == INSTR_CALL) ? pc + 1 : pc;
+                depth++;
+                pc = (instr->type == INSTR_CALL) ? (size_t)instr->link + 1 : pc + 1;
                 break;
-            }
-            case INSTR_MEASURE: {
-                // measure_qubit => collapses the state
-                int outcome = -1;
-                if (measure_qubit(sv, instr->qubits[0], &outcome) != 0) {
-                    fprintf(stderr, "Interpret error: measure_qubit failed.\n");
-                    return -5;
+            case INSTR_DEF:
+                pc = instr->link + 1; // definitions only run when called
+                break;
+            case INSTR_BLOCK_END: {
+                if (depth == 0) {
+                    fprintf(stderr, "Interpret error: '}' without an open block.\n");
+                    rc = -7;
+                    break;
+                }
+                BlockFrame* top = &frames[depth - 1];
+                if (top->is_call) {
+                    pc = top->index;
+                    depth--;
+                } else if (--top->remaining > 0) {
+                    pc = top->index + 1;
+                } else {
+                    depth--;
+                    pc++;
                 }
-                // You could store the outcome in a classical register if you want
-                printf("Measurement of qubit %zu => %d\n", instr->qubits[0], outcome);
                 break;
             }
-            case INSTR_UNKNOWN:
             default:
-                // Possibly an unrecognized instruction with partial data
-                fprintf(stderr, "Interpret warning: unknown instruction type for gate '%s'.\n",
-                        instr->gate_name);
+                rc = execute_instruction(ops, instr, cregs);
+                if (rc == 0 && after_step) rc = after_step(ops, ctx);
+                pc++;
                 break;
         }
     }
+    free(frames);
+    return rc;
+}
+
+/**
+ * \brief Runs 'list' with zero-initialized registers that are discarded afterwards.
+ */
+static int run_with_scratch_registers(EngineOps* ops, const InstructionList* list,
+                                      int (*after_step)(EngineOps* ops, void* ctx), void* ctx) {
+    uint32_t* cregs = NULL;
+    if (list->num_cregs > 0) {
+        cregs = (uint32_t*)calloc(list->num_cregs, sizeof(uint32_t));
+        if (!cregs) return -1;
+    }
+    int rc = run_instructions(ops, list, cregs, after_step, ctx);
+    free(cregs);
+    return rc;
+}
+
+int interpret_instructions(const InstructionList* instructions, StateVector* sv) {
+    if (!instructions || !sv) return -1;
+
+    EngineOps ops;
+    dense_ops(&ops, sv);
+    return run_with_scratch_registers(&ops, instructions, NULL, NULL);
+}
+
+int interpret_instructions_classical(const InstructionList* instructions, StateVector* sv, uint32_t* cregs) {
+    if (!instructions || !sv || (!cregs && instructions->num_cregs > 0)) return -1;
+
+    EngineOps ops;
+    dense_ops(&ops, sv);
+    return run_instructions(&ops, instructions, cregs, NULL, NULL);
+}
+
+int interpret_instruction(const Instruction* instr, StateVector* sv) {
+    if (!instr || !sv) return -1;
+    if (is_block_marker(instr)) {
+        fprintf(stderr, "Interpret error: REPEAT/DEF blocks need the whole program; use interpret_instructions.\n");
+        return -7;
+    }
+    if (instr->cond_reg || instr->target_reg) {
+        fprintf(stderr, "Interpret error: classical registers need the whole program; use interpret_instructions.\n");
+        return -7;
+    }
+    EngineOps ops;
+    dense_ops(&ops, sv);
+    return execute_instruction(&ops, instr, NULL);
+}
+
+int interpret_instruction_classical(const Instruction* instr, StateVector* sv, uint32_t* cregs) {
+    if (!instr || !sv || (!cregs && (instr->cond_reg || instr->target_reg))) return -1;
+    if (is_block_marker(instr)) {
+        fprintf(stderr, "Interpret error: REPEAT/DEF blocks need the whole program; use interpret_instructions.\n");
+        return -7;
+    }
+    if (instr->cond_reg && cregs[instr->cond_reg - 1] != instr->cond_value) return 0;
+    EngineOps ops;
+    dense_ops(&ops, sv);
+    return execute_instruction(&ops, instr, cregs);
+}
+
+int interpret_instructions_compressed(const InstructionList* instructions, CompressedStateVector* csv) {
+    if (!instructions || !csv) return -1;
 
+    EngineOps ops = { csv, csv->num_qubits, compressed_gate, compressed_cnot, compressed_measure, NULL, NULL, NULL };
+    return run_with_scratch_registers(&ops, instructions, NULL, NULL);
+}
+
+typedef struct {
+    SparseStateVector* ssv;
+    StateVector*       sv;
+    int*               promoted;
+} SparsePromotion;
+
+static int sparse_after_step(EngineOps* ops, void* ctx) {
+    SparsePromotion* sp = (SparsePromotion*)ctx;
+    if (*sp->promoted || !sparse_should_promote(sp->ssv)) return 0;
+
+    // Too dense to pay off: continue on the dense StateVector from here on
+    if (sparse_promote_to_dense(sp->ssv, sp->sv) != 0) {
+        fprintf(stderr, "Interpret warning: dense promotion failed, staying sparse.\n");
+        sp->ssv->density_threshold = 2.0; // never retry
+        return 0;
+    }
+    *sp->promoted = 1;
+    dense_ops(ops, sp->sv);
     return 0;
 }
 
+int interpret_instructions_sparse(const InstructionList* instructions, SparseStateVector* ssv,
+                                  StateVector* sv, int* promoted) {
+    if (!instructions || !ssv || !sv || !promoted) return -1;
+    *promoted = 0;
+
+    EngineOps ops = { ssv, ssv->num_qubits, sparse_gate, sparse_cnot, sparse_measure, sparse_cphase, NULL, NULL };
+    SparsePromotion sp = { ssv, sv, promoted };
+    return run_with_scratch_registers(&ops, instructions, sparse_after_step, &sp);
+}
+
+int interpret_instructions_stabilizer(const InstructionList* instructions, StabilizerTableau* tableau) {
+    if (!instructions || !tableau) return -1;
+
+    EngineOps ops = { tableau, tableau->num_qubits, tableau_gate, tableau_cnot, tableau_measure, tableau_cphase, NULL, NULL };
+    return run_with_scratch_registers(&ops, instructions, NULL, NULL);
+}
+
+int interpret_instructions_mps(const InstructionList* instructions, MpsState* mps) {
+    if (!instructions || !mps) return -1;
+
+    EngineOps ops = { mps, mps->num_qubits, mps_gate, mps_cnot, mps_measure, mps_cphase, NULL, NULL };
+    return run_with_scratch_registers(&ops, instructions, NULL, NULL);
+}
+
+int circuit_is_clifford(const InstructionList* instructions) {
+    if (!instructions) return 0;
+    for (size_t i = 0; i < instructions->size; i++) {
+        const Instruction* instr = &instructions->data[i];
+        float angles[MAX_GATE_PARAMS];
+        float matrix[8];
+        if (instr->type != INSTR_GATE_SINGLE && instr->type != INSTR_GATE_MULTI) continue;
+        if (instr->param_count > 0) {
+            if (constant_angles(instr, angles) != 0) return 0;
+            if (parameterized_gate_matrix(instr->gate_name, angles, matrix) != 0) continue; // skipped at run time
+        }
+        if (instr->type == INSTR_GATE_SINGLE) {
+            // Unknown names run as the identity
+            const float* gate = instr->param_count > 0 ? matrix
+                              : instr->has_matrix ? instr->matrix : find_single_qubit_gate(instr->gate_name);
+            if (gate && !is_clifford_gate(gate)) return 0;
+        } else if (strcasecmp(instr->gate_name, "CPHASE") == 0 && instr->param_count == 1) {
+            if (fabsf(matrix[1]) > 1e-4f || fabsf(fabsf(matrix[0]) - 1.0f) > 1e-4f) return 0;
+        }
+    }
+    return 1;
+}
+
 /*
  * Basic test stub (optional).
  * Compile with (assuming other .o files are built):
@@ -172,3 +611,50 @@ int main(void) {
     return 0;
 }
 #endif
+
+static int trajectory_gate(void* s, const float* g, size_t q) {
+    return apply_single_qubit_gate(((TrajectoryState*)s)->sv, g, q);
+}
+static int trajectory_cnot(void* s, size_t c, size_t t) { return apply_cnot(((TrajectoryState*)s)->sv, c, t); }
+static int trajectory_cphase(void* s, size_t c, size_t t, float re, float im) {
+    return apply_controlled_phase(((TrajectoryState*)s)->sv, c, t, re, im);
+}
+
+static int trajectory_measure(void* s, size_t q, int* o) {
+    TrajectoryState* ts = (TrajectoryState*)s;
+    if (measure_qubit_sampled(ts->sv, q, random_uniform(ts->rng), o) != 0) return -1;
+    // The state collapses to the true outcome; only the reported bit is wrong
+    if (ts->readout[q] > 0.0f && random_uniform(ts->rng) < ts->readout[q]) *o ^= 1;
+    return 0;
+}
+
+static int trajectory_noise(void* s, const Instruction* instr) {
+    TrajectoryState* ts = (TrajectoryState*)s;
+    NoiseChannel channel;
+    if (noise_channel_from_name(instr->gate_name, &channel) != 0) return -1;
+    if (channel == NOISE_READOUT) {
+        ts->readout[instr->qubits[0]] = instr->params[0];
+        return 0;
+    }
+    return apply_noise_channel(ts->sv, channel, instr->params[0], instr->qubits[0], random_uniform(ts->rng));
+}
+
+static void trajectory_record(void* s, size_t q, int outcome) {
+    ((TrajectoryState*)s)->outcomes[q] = (int8_t)outcome;
+}
+
+int interpret_instructions_trajectory(const InstructionList* instructions, TrajectoryState* trajectory) {
+    if (!instructions || !trajectory || !trajectory->sv || !trajectory->rng ||
+        !trajectory->readout || !trajectory->outcomes) {
+        return -1;
+    }
+    size_t n = trajectory->sv->num_qubits;
+    for (size_t q = 0; q < n; q++) {
+        trajectory->readout[q] = 0.0f;
+        trajectory->outcomes[q] = -1;
+    }
+
+    EngineOps ops = { trajectory, n, trajectory_gate, trajectory_cnot, trajectory_measure, trajectory_cphase,
+                      trajectory_noise, trajectory_record };
+    return run_with_scratch_registers(&ops, instructions, NULL, NULL);
+}
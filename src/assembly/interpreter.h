@@ -7,15 +7,174 @@ extern "C" {
 
 #include "parser.h"
 #include "state_vector.h"
+#include "compressed_state_vector.h"
+#include "sparse_state_vector.h"
+#include "stabilizer_tableau.h"
+#include "mps_state.h"
+#include "math_utils.h"
+
+/**
+ * \brief Printed measurement outcomes of a run, in execution order (see set_measurement_log).
+ */
+typedef struct MeasurementLog {
+    size_t* qubits;    /**< Qubit number each outcome is printed under */
+    int*    outcomes;  /**< 0 or 1, or -1 where an IF skipped the measurement */
+    size_t  size;
+    size_t  capacity;
+} MeasurementLog;
+
+/**
+ * \brief Makes the calling thread's interpreters and bytecode runs append the outcomes they would
+ *        print ("Measurement of qubit q => b") to 'log' instead, so runs on several threads can
+ *        print them in program order afterwards.
+ * \param log Destination (initialized to zeros), NULL to print again
+ */
+void set_measurement_log(MeasurementLog* log);
+
+/**
+ * \brief Prints one outcome, or appends it to the calling thread's log. An outcome of -1 marks
+ *        a measurement its IF skipped and is only logged.
+ */
+void report_measurement(size_t qubit, int outcome);
+
+/**
+ * \brief Frees a MeasurementLog.
+ */
+void free_measurement_log(MeasurementLog* log);
 
 /**
  * \brief Interprets a list of quantum assembly instructions and applies them to the given state vector.
  * \param instructions InstructionList to interpret
  * \param sv Pointer to a StateVector
  * \return 0 on success, nonzero on error
+ *
+ * REPEAT bodies and DEF subcircuits are executed in place by following the block links,
+ * never unrolled.
  */
 int interpret_instructions(const InstructionList* instructions, StateVector* sv);
 
+/**
+ * \brief Like interpret_instructions, but with caller-owned classical registers, so a driver
+ *        can seed them and read measurement results without parsing stdout.
+ * \param instructions InstructionList to interpret
+ * \param sv Pointer to a StateVector
+ * \param cregs instructions->num_cregs values, one per register (bit i = c[i]); updated in place
+ * \return 0 on success, nonzero on error
+ */
+int interpret_instructions_classical(const InstructionList* instructions, StateVector* sv, uint32_t* cregs);
+
+/**
+ * \brief Applies a single instruction to the given state vector. Block markers and
+ *        classical-register statements need the surrounding program and are rejected.
+ * \param instr Instruction to execute
+ * \param sv Pointer to a StateVector
+ * \return 0 on success, nonzero on error
+ */
+int interpret_instruction(const Instruction* instr, StateVector* sv);
+
+/**
+ * \brief Applies a single instruction with caller-owned classical registers: skipped if its IF
+ *        condition does not hold, and a "MEASURE q -> c[i]" stores the outcome. Block markers are
+ *        rejected as in interpret_instruction.
+ * \param instr Instruction to execute
+ * \param sv Pointer to a StateVector
+ * \param cregs Register values covering every register the instruction names (bit i = c[i])
+ * \return 0 on success, nonzero on error
+ */
+int interpret_instruction_classical(const Instruction* instr, StateVector* sv, uint32_t* cregs);
+
+/**
+ * \brief Interprets a list of instructions on a block-compressed state vector.
+ * \param instructions InstructionList to interpret
+ * \param csv Pointer to an initialized CompressedStateVector
+ * \return 0 on success, nonzero on error
+ */
+int interpret_instructions_compressed(const InstructionList* instructions, CompressedStateVector* csv);
+
+/**
+ * \brief Interprets a list of instructions on the sparse engine, promoting to a dense
+ *        StateVector as soon as the density crosses ssv->density_threshold.
+ * \param instructions InstructionList to interpret
+ * \param ssv Pointer to an initialized SparseStateVector (freed if promotion happens)
+ * \param sv Uninitialized StateVector that receives the state on promotion
+ * \param promoted Set to 1 if execution finished on sv, 0 if it stayed sparse
+ * \return 0 on success, nonzero on error
+ */
+int interpret_instructions_sparse(const InstructionList* instructions, SparseStateVector* ssv,
+                                  StateVector* sv, int* promoted);
+
+/**
+ * \brief Interprets a list of instructions on a stabilizer tableau. Every gate must be
+ *        Clifford (see circuit_is_clifford); any other gate stops the run with an error.
+ * \param instructions InstructionList to interpret
+ * \param tableau Pointer to an initialized StabilizerTableau
+ * \return 0 on success, nonzero on error
+ */
+int interpret_instructions_stabilizer(const InstructionList* instructions, StabilizerTableau* tableau);
+
+/**
+ * \brief Interprets a list of instructions on a matrix product state. Two-qubit gates may
+ *        truncate the state within mps->max_bond and mps->truncation_threshold; the error
+ *        accumulated so far is in mps->fidelity.
+ * \param instructions InstructionList to interpret
+ * \param mps Pointer to an initialized MpsState
+ * \return 0 on success, nonzero on error
+ */
+int interpret_instructions_mps(const InstructionList* instructions, MpsState* mps);
+
+/**
+ * \brief One noisy run of a circuit on a dense state vector (a quantum trajectory).
+ *        Every field is owned by the caller, so a worker can reuse them across trajectories.
+ */
+typedef struct TrajectoryState {
+    StateVector*  sv;       /**< Initialized state; the circuit is applied to it as is */
+    RandomStream* rng;      /**< Draws measurement outcomes and noise branches */
+    float*        readout;  /**< sv->num_qubits readout flip probabilities, set by READOUT */
+    int8_t*       outcomes; /**< sv->num_qubits last reported outcomes, -1 if never measured */
+} TrajectoryState;
+
+/**
+ * \brief Interprets a list as one quantum trajectory: noise channels are sampled with
+ *        apply_noise_channel, and every measurement (with or without a target register) is
+ *        recorded in trajectory->outcomes instead of printed. readout and outcomes are reset
+ *        first. Ideal runs (all other interpret_* functions) skip noise channels.
+ * \param instructions InstructionList to interpret
+ * \param trajectory Pointer to a filled-in TrajectoryState
+ * \return 0 on success, nonzero on error
+ */
+int interpret_instructions_trajectory(const InstructionList* instructions, TrajectoryState* trajectory);
+
+/**
+ * \brief Returns 1 if every gate of the circuit is Clifford, so it can run on a stabilizer
+ *        tableau: H, X, Y, Z, S, CNOT, fused or constant-angle single-qubit gates that are
+ *        Clifford up to a phase, and CPHASE by 0 or pi. Symbolic angles count as non-Clifford.
+ */
+int circuit_is_clifford(const InstructionList* instructions);
+
+/**
+ * \brief Returns the 2x2 matrix for a named single-qubit gate (identity, with a warning, if unknown).
+ * \param gate_name Gate string, e.g. "H", "T"
+ * \return Pointer to a static 8-float matrix in apply_single_qubit_gate layout
+ */
+const float* get_single_qubit_gate(const char* gate_name);
+
+/**
+ * \brief Like get_single_qubit_gate, but silent: returns NULL for unknown gate names.
+ * \param gate_name Gate string, e.g. "H", "T"
+ * \return Pointer to a static 8-float matrix, or NULL
+ */
+const float* find_single_qubit_gate(const char* gate_name);
+
+/**
+ * \brief Builds the matrix of a parameterized gate from resolved angles (radians).
+ *        RX/RY/RZ/U3 produce an 8-float 2x2 matrix; CPHASE stores e^{i phi} in out[0], out[1].
+ * \param gate_name "RX", "RY", "RZ", "U3" or "CPHASE"
+ * \param angles One angle (three for U3: theta, phi, lambda)
+ * \param out 8 floats
+ * \return 0 on success, nonzero for an unknown gate
+ */
+int parameterized_gate_matrix(const char* gate_name, const float* angles, float* out);
+
 #ifdef __cplusplus
 }
 #endif
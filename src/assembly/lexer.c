@@ -62,8 +62,8 @@ void free_token_list(TokenList* list) {
 
 static int is_all_digits(const char* str) {
     // Return 1 if all characters in str are digits, else 0
-    for (size_t i = 0; i < strlen(str); i++) {
-        if (!isdigit((unsigned char)str[i])) {
+    for (; *str; str++) {
+        if (!isdigit((unsigned char)*str)) {
             return 0;
         }
     }
@@ -111,9 +111,30 @@ void lex_line(const char* line, TokenList* list) {
             continue;
         }
 
-        // Collect a chunk of non-whitespace as a token
+        // A parameter list runs to the closing parenthesis, spaces included
+        if (line[i] == '(') {
+            buffer_index = 0;
+            while (i < len && i != comment_start && buffer_index < 255) {
+                char c = line[i++];
+                buffer[buffer_index++] = c;
+                if (c == ')') break;
+            }
+            buffer[buffer_index] = '\0';
+            append_token(list, TOKEN_PARAMS, buffer);
+            continue;
+        }
+
+        // Braces are tokens of their own, even when written against a word ("layer{")
+        if (line[i] == '{' || line[i] == '}') {
+            append_token(list, line[i] == '{' ? TOKEN_LBRACE : TOKEN_RBRACE, line[i] == '{' ? "{" : "}");
+            i++;
+            continue;
+        }
+
+        // Collect a chunk of non-whitespace as a token ("RX(theta)" splits before the '(')
         buffer_index = 0;
-        while (i < len && !isspace((unsigned char)line[i]) && i != comment_start && buffer_index < 255) {
+        while (i < len && !isspace((unsigned char)line[i]) && line[i] != '(' &&
+               line[i] != '{' && line[i] != '}' && i != comment_start && buffer_index < 255) {
             buffer[buffer_index++] = line[i++];
         }
         buffer[buffer_index] = '\0';
@@ -129,3 +150,141 @@ void lex_line(const char* line, TokenList* list) {
         }
     }
 }
+
+/**
+ * \brief Character classes for the buffer lexer, looked up once per byte.
+ */
+enum {
+    CC_OTHER   = 0,
+    CC_SPACE   = 1,   /* ' ', \t, \r, \v, \f */
+    CC_NEWLINE = 2,
+    CC_DIGIT   = 4,
+    CC_HASH    = 8,   /* '#' starts a comment */
+    CC_SLASH   = 16,  /* '/' starts a comment if followed by another '/' */
+    CC_LPAREN  = 32,  /* '(' starts a parameter list */
+    CC_BRACE   = 64   /* '{' and '}' are single-character tokens */
+};
+
+static const unsigned char CHAR_CLASS[256] = {
+    [' '] = CC_SPACE, ['\t'] = CC_SPACE, ['\r'] = CC_SPACE, ['\v'] = CC_SPACE, ['\f'] = CC_SPACE,
+    ['\n'] = CC_NEWLINE,
+    ['0'] = CC_DIGIT, ['1'] = CC_DIGIT, ['2'] = CC_DIGIT, ['3'] = CC_DIGIT, ['4'] = CC_DIGIT,
+    ['5'] = CC_DIGIT, ['6'] = CC_DIGIT, ['7'] = CC_DIGIT, ['8'] = CC_DIGIT, ['9'] = CC_DIGIT,
+    ['#'] = CC_HASH,
+    ['/'] = CC_SLASH,
+    ['('] = CC_LPAREN,
+    ['{'] = CC_BRACE, ['}'] = CC_BRACE
+};
+
+int init_token_view_list(TokenViewList* list) {
+    if (!list) return -1;
+    list->data = (TokenView*)malloc(INITIAL_CAPACITY * sizeof(TokenView));
+    if (!list->data) return -2;
+    list->size = 0;
+    list->capacity = INITIAL_CAPACITY;
+    return 0;
+}
+
+void free_token_view_list(TokenViewList* list) {
+    if (!list) return;
+    free(list->data);
+    list->data = NULL;
+    list->size = 0;
+    list->capacity = 0;
+}
+
+static inline int push_view(TokenViewList* list, TokenType type, size_t offset, size_t length, size_t line) {
+    if (list->size >= list->capacity) {
+        size_t new_capacity = list->capacity * 2;
+        TokenView* new_data = (TokenView*)realloc(list->data, new_capacity * sizeof(TokenView));
+        if (!new_data) return -2;
+        list->data = new_data;
+        list->capacity = new_capacity;
+    }
+    TokenView* v = &list->data[list->size++];
+    v->offset = offset;
+    v->length = (uint32_t)length;
+    v->line = (uint32_t)line;
+    v->type = type;
+    return 0;
+}
+
+static inline int starts_comment(const char* data, size_t i, size_t size) {
+    unsigned char cls = CHAR_CLASS[(unsigned char)data[i]];
+    return (cls & CC_HASH) || ((cls & CC_SLASH) && i + 1 < size && data[i + 1] == '/');
+}
+
+int lex_buffer(const char* data, size_t size, TokenViewList* list) {
+    return lex_buffer_lines(data, size, 1, list);
+}
+
+int lex_buffer_lines(const char* data, size_t size, size_t first_line, TokenViewList* list) {
+    if (!data || !list) return -1;
+
+    // Generated circuits run about 2 bytes per token ("H 0\n" is two, "CNOT 0 1\n" three);
+    // reserving up front avoids repeated realloc copies of a list that can reach hundreds of MB
+    // (untouched pages are free, so comment-heavy files pay nothing for the overestimate)
+    size_t estimate = list->size + size / 2 + INITIAL_CAPACITY;
+    if (list->capacity < estimate) {
+        TokenView* new_data = (TokenView*)realloc(list->data, estimate * sizeof(TokenView));
+        if (!new_data) return -2;
+        list->data = new_data;
+        list->capacity = estimate;
+    }
+
+    size_t i = 0;
+    size_t line = first_line;
+    while (i < size) {
+        unsigned char cls = CHAR_CLASS[(unsigned char)data[i]];
+
+        if (cls & CC_NEWLINE) {
+            line++;
+            i++;
+            continue;
+        }
+        if (cls & CC_SPACE) {
+            i++;
+            continue;
+        }
+
+        if (starts_comment(data, i, size)) {
+            // Comment runs to end of line; memchr scans it with the C library's SIMD routine
+            const char* nl = (const char*)memchr(data + i, '\n', size - i);
+            size_t end = nl ? (size_t)(nl - data) : size;
+            if (push_view(list, TOKEN_COMMENT, i, end - i, line) != 0) return -2;
+            i = end;
+            continue;
+        }
+
+        if (cls & CC_LPAREN) {
+            // Parameter list: through the closing ')' (spaces allowed), never past the line end
+            size_t start = i;
+            while (i < size && data[i] != '\n') {
+                if (data[i++] == ')') break;
+            }
+            if (push_view(list, TOKEN_PARAMS, start, i - start, line) != 0) return -2;
+            continue;
+        }
+
+        if (cls & CC_BRACE) {
+            if (push_view(list, data[i] == '{' ? TOKEN_LBRACE : TOKEN_RBRACE, i, 1, line) != 0) return -2;
+            i++;
+            continue;
+        }
+
+        // Token body: run of non-space bytes that does not start a comment, parameter list or block
+        size_t start = i;
+        int all_digits = 1;
+        while (i < size) {
+            cls = CHAR_CLASS[(unsigned char)data[i]];
+            if ((cls & (CC_SPACE | CC_NEWLINE | CC_LPAREN | CC_BRACE)) ||
+                (i > start && starts_comment(data, i, size))) break;
+            all_digits &= (cls & CC_DIGIT) ? 1 : 0;
+            i++;
+        }
+        if (push_view(list, all_digits ? TOKEN_INTEGER : TOKEN_GATE, start, i - start, line) != 0) {
+            return -2;
+        }
+    }
+    return 0;
+}
@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * \brief Token types for our quantum assembly language.
@@ -14,6 +15,9 @@ typedef enum {
     TOKEN_GATE,      /**< e.g. "H", "X", "Y", "Z", "CNOT", "MEASURE", etc. */
     TOKEN_INTEGER,   /**< e.g. "0", "1", "2" for qubit indices */
     TOKEN_COMMENT,   /**< e.g. "// This is a comment" or "# Another comment" */
+    TOKEN_PARAMS,    /**< Parenthesized gate parameters, e.g. "(theta)" or "(pi/2, 0, phi)" */
+    TOKEN_LBRACE,    /**< "{" opening a REPEAT or DEF block */
+    TOKEN_RBRACE,    /**< "}" closing a block */
     TOKEN_UNKNOWN,   /**< Unrecognized token */
     TOKEN_EOF        /**< End of file/input */
 } TokenType;
@@ -35,6 +39,26 @@ typedef struct {
     size_t  capacity;
 } TokenList;
 
+/**
+ * \brief A token that points back into the source buffer instead of owning a copy.
+ *        Packed into 16 bytes: parse_file holds one view per token of the whole file.
+ */
+typedef struct {
+    uint64_t  offset : 48; /**< Byte offset of the token in the source buffer */
+    uint64_t  type   : 16; /**< TokenType */
+    uint32_t  length;      /**< Length of the token in bytes */
+    uint32_t  line;        /**< 1-based line number of the token */
+} TokenView;
+
+/**
+ * \brief Dynamic array of token views over one source buffer.
+ */
+typedef struct {
+    TokenView* data;
+    size_t     size;
+    size_t     capacity;
+} TokenViewList;
+
 /**
  * \brief Initializes a TokenList with default capacity.
  * \param list Pointer to an uninitialized TokenList
@@ -64,6 +88,39 @@ void free_token_list(TokenList* list);
  */
 void lex_line(const char* line, TokenList* list);
 
+/**
+ * \brief Initializes a TokenViewList with default capacity.
+ * \param list Pointer to an uninitialized TokenViewList
+ * \return 0 on success, nonzero on failure
+ */
+int init_token_view_list(TokenViewList* list);
+
+/**
+ * \brief Frees a TokenViewList (the source buffer is not owned by the list).
+ * \param list Pointer to a TokenViewList
+ */
+void free_token_view_list(TokenViewList* list);
+
+/**
+ * \brief Lexes a whole buffer (e.g. a memory-mapped .qasm file) into views, without copying
+ *        any token text. Produces the same token sequence as calling lex_line on every line.
+ * \param data Source buffer (need not be NUL-terminated)
+ * \param size Length of the buffer in bytes
+ * \param list TokenViewList to which views are appended
+ * \return 0 on success, nonzero on allocation failure
+ */
+int lex_buffer(const char* data, size_t size, TokenViewList* list);
+
+/**
+ * \brief Same as lex_buffer, for a slice of a larger file that starts at line 'first_line'.
+ * \param data Start of the slice
+ * \param size Length of the slice in bytes
+ * \param first_line Line number of the first byte of the slice (1-based)
+ * \param list TokenViewList to which views are appended (offsets are relative to data)
+ * \return 0 on success, nonzero on allocation failure
+ */
+int lex_buffer_lines(const char* data, size_t size, size_t first_line, TokenViewList* list);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,287 @@
+#include "parallel_frontend.h"
+#include "lexer.h"
+#include "file_io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * \brief Per-chunk state, owned by one worker in each phase.
+ */
+typedef struct {
+    const char*     data;        /**< Start of the chunk */
+    size_t          size;
+    size_t          newlines;    /**< Newlines inside the chunk */
+    size_t          first_line;  /**< Global line number of the chunk's first line */
+    int             structured;  /**< Chunk contains braces or CREG */
+    int             rc;
+    TokenViewList   views;
+    InstructionList local;
+    int*            param_map;   /**< Local parameter index -> index in the merged table */
+    char*           diagnostics; /**< Parser messages of the chunk, printed in chunk order */
+    size_t          diagnostics_size;
+    Instruction*    dest;        /**< Where the merge phase copies 'local' to */
+} Chunk;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * \brief Runs fn on every chunk, one thread per chunk (the caller takes chunk 0).
+ */
+static void run_phase(Chunk* chunks, size_t count, void* (*fn)(void*)) {
+    pthread_t* threads = (count > 1) ? (pthread_t*)malloc((count - 1) * sizeof(pthread_t)) : NULL;
+    size_t started = 0;
+    for (size_t c = 1; threads && c < count; c++) {
+        if (pthread_create(&threads[c - 1], NULL, fn, &chunks[c]) != 0) break;
+        started++;
+    }
+    fn(&chunks[0]);
+    for (size_t c = 1; c <= started; c++) pthread_join(threads[c - 1], NULL);
+    // Chunks whose thread could not be started run here
+    for (size_t c = started + 1; c < count; c++) fn(&chunks[c]);
+    free(threads);
+}
+
+static void* lex_chunk(void* arg) {
+    Chunk* ch = (Chunk*)arg;
+    if (init_token_view_list(&ch->views) != 0 ||
+        lex_buffer_lines(ch->data, ch->size, 1, &ch->views) != 0) {
+        ch->rc = -2;
+        return NULL;
+    }
+    for (const char* p = ch->data; (p = memchr(p, '\n', (size_t)(ch->data + ch->size - p))) != NULL; p++) {
+        ch->newlines++;
+    }
+    // Blocks and registers make a statement depend on earlier lines (possibly in other chunks)
+    for (size_t v = 0; v < ch->views.size && !ch->structured; v++) {
+        const TokenView* tv = &ch->views.data[v];
+        ch->structured = tv->type == TOKEN_LBRACE || tv->type == TOKEN_RBRACE ||
+                         (tv->type == TOKEN_GATE && tv->length == 4 &&
+                          strncasecmp(ch->data + tv->offset, "CREG", 4) == 0);
+    }
+    return NULL;
+}
+
+static void* parse_chunk(void* arg) {
+    Chunk* ch = (Chunk*)arg;
+    for (size_t v = 0; v < ch->views.size; v++) {
+        ch->views.data[v].line += (uint32_t)(ch->first_line - 1);
+    }
+    if (init_instruction_list(&ch->local) != 0) {
+        ch->rc = -2;
+        return NULL;
+    }
+    // Buffer messages: chunks finish in any order and only those up to the first error are shown
+    FILE* sink = open_memstream(&ch->diagnostics, &ch->diagnostics_size);
+    set_parser_diagnostics(sink);
+    ch->rc = parse_token_views(ch->data, &ch->views, &ch->local);
+    set_parser_diagnostics(NULL);
+    if (sink) fclose(sink);
+    free_token_view_list(&ch->views);
+    return NULL;
+}
+
+static void* merge_chunk(void* arg) {
+    Chunk* ch = (Chunk*)arg;
+    for (size_t i = 0; i < ch->local.size; i++) {
+        Instruction* out = &ch->dest[i];
+        *out = ch->local.data[i];
+        for (size_t k = 0; k < out->param_count; k++) {
+            if (out->param_ids[k] >= 0) out->param_ids[k] = (int16_t)ch->param_map[out->param_ids[k]];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief Splits [0, size) into at most max_chunks pieces ending just after a newline.
+ * \return Number of chunks
+ */
+static size_t split_chunks(const char* data, size_t size, size_t max_chunks, Chunk* chunks) {
+    size_t count = 0;
+    size_t start = 0;
+    for (size_t c = 1; c <= max_chunks && start < size; c++) {
+        size_t end = (c == max_chunks) ? size : (size / max_chunks) * c;
+        if (end < start) end = start;
+        if (end < size) {
+            const char* nl = (const char*)memchr(data + end, '\n', size - end);
+            end = nl ? (size_t)(nl - data) + 1 : size;
+        }
+        memset(&chunks[count], 0, sizeof(Chunk));
+        chunks[count].data = data + start;
+        chunks[count].size = end - start;
+        count++;
+        start = end;
+    }
+    return count;
+}
+
+/**
+ * \brief Single-threaded parse of all chunks' views, rebased onto the whole buffer.
+ */
+static int parse_sequential(const char* data, Chunk* chunks, size_t count, InstructionList* instructions) {
+    if (count == 1) return parse_token_views(data, &chunks[0].views, instructions);
+
+    TokenViewList all;
+    if (init_token_view_list(&all) != 0) return -2;
+    size_t total = 0;
+    for (size_t c = 0; c < count; c++) total += chunks[c].views.size;
+    TokenView* grown = (TokenView*)realloc(all.data, (total ? total : 1) * sizeof(TokenView));
+    if (!grown) {
+        free_token_view_list(&all);
+        return -2;
+    }
+    all.data = grown;
+    all.capacity = total ? total : 1;
+    for (size_t c = 0; c < count; c++) {
+        size_t base = (size_t)(chunks[c].data - data);
+        for (size_t v = 0; v < chunks[c].views.size; v++) {
+            TokenView tv = chunks[c].views.data[v];
+            tv.offset += base;
+            tv.line += (uint32_t)(chunks[c].first_line - 1);
+            all.data[all.size++] = tv;
+        }
+    }
+    int rc = parse_token_views(data, &all, instructions);
+    free_token_view_list(&all);
+    return rc;
+}
+
+/**
+ * \brief Appends every chunk's local list to 'instructions', renumbering parameters.
+ */
+static int merge_chunks(Chunk* chunks, size_t count, InstructionList* instructions) {
+    if (instructions->size == 0 && instructions->num_params == 0) {
+        // Nothing to append to: the first chunk's list becomes the output, saving its copy
+        InstructionList first = chunks[0].local;
+        memset(&chunks[0].local, 0, sizeof(chunks[0].local));
+        free_instruction_list(instructions);
+        *instructions = first;
+    }
+
+    size_t total = instructions->size;
+    for (size_t c = 0; c < count; c++) total += chunks[c].local.size;
+    if (total > instructions->capacity) {
+        Instruction* grown = (Instruction*)realloc(instructions->data, total * sizeof(Instruction));
+        if (!grown) return -2;
+        instructions->data = grown;
+        instructions->capacity = total;
+    }
+
+    // Parameter tables are tiny: intern them in chunk order so first use still decides the index
+    size_t at = instructions->size;
+    for (size_t c = 0; c < count; c++) {
+        Chunk* ch = &chunks[c];
+        if (ch->local.num_params > 0) {
+            ch->param_map = (int*)malloc(ch->local.num_params * sizeof(int));
+            if (!ch->param_map) return -2;
+            for (size_t p = 0; p < ch->local.num_params; p++) {
+                ch->param_map[p] = intern_parameter_name(instructions, ch->local.param_names[p]);
+                if (ch->param_map[p] < 0) return -2;
+            }
+        }
+        ch->dest = instructions->data + at;
+        at += ch->local.size;
+    }
+    run_phase(chunks, count, merge_chunk);
+    instructions->size = total;
+    return 0;
+}
+
+int parse_buffer_parallel(const char* data, size_t size, InstructionList* instructions,
+                          const FrontendOptions* options, FrontendStats* stats) {
+    if (!data || !instructions) return -1;
+
+    FrontendStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+
+    size_t threads = (options && options->num_threads) ? options->num_threads : 0;
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+    size_t min_chunk = (options && options->min_chunk_bytes) ? options->min_chunk_bytes : FRONTEND_MIN_CHUNK_BYTES;
+    size_t max_chunks = size / min_chunk;
+    if (max_chunks > threads) max_chunks = threads;
+    if (max_chunks == 0) max_chunks = 1;
+
+    Chunk* chunks = (Chunk*)calloc(max_chunks, sizeof(Chunk));
+    if (!chunks) return -2;
+    size_t count = split_chunks(data, size, max_chunks, chunks);
+    if (count == 0) {
+        // Empty input
+        memset(&chunks[0], 0, sizeof(Chunk));
+        chunks[0].data = data;
+        count = 1;
+    }
+    stats->chunks = count;
+
+    double t0 = now_seconds();
+    run_phase(chunks, count, lex_chunk);
+    double t1 = now_seconds();
+    stats->lex_seconds = t1 - t0;
+
+    int rc = 0;
+    int structured = 0;
+    size_t line = 1;
+    for (size_t c = 0; c < count; c++) {
+        if (chunks[c].rc != 0) rc = chunks[c].rc;
+        structured |= chunks[c].structured;
+        chunks[c].first_line = line;
+        line += chunks[c].newlines;
+    }
+    // A list that already holds blocks or registers continues them: parse in one piece
+    structured |= (instructions->num_cregs > 0);
+    for (size_t i = 0; i < instructions->size && !structured; i++) {
+        structured = is_block_marker(&instructions->data[i]);
+    }
+
+    if (rc == 0 && (structured || count == 1)) {
+        stats->sequential_parse = structured;
+        rc = parse_sequential(data, chunks, count, instructions);
+        stats->parse_seconds = now_seconds() - t1;
+    } else if (rc == 0) {
+        run_phase(chunks, count, parse_chunk);
+        double t2 = now_seconds();
+        stats->parse_seconds = t2 - t1;
+        // The first failing chunk decides the result, as in a sequential parse
+        for (size_t c = 0; c < count && rc == 0; c++) {
+            if (chunks[c].diagnostics) fputs(chunks[c].diagnostics, stderr);
+            rc = chunks[c].rc;
+        }
+        if (rc == 0) rc = merge_chunks(chunks, count, instructions);
+        stats->merge_seconds = now_seconds() - t2;
+    }
+
+    for (size_t c = 0; c < count; c++) {
+        free_token_view_list(&chunks[c].views);
+        free_instruction_list(&chunks[c].local);
+        free(chunks[c].param_map);
+        free(chunks[c].diagnostics);
+    }
+    free(chunks);
+    return rc;
+}
+
+int parse_file_parallel(const char* filename, InstructionList* instructions,
+                        const FrontendOptions* options, FrontendStats* stats) {
+    if (!filename || !instructions) return -1;
+
+    MappedFile mf;
+    if (map_file_readonly(filename, &mf) != 0) {
+        fprintf(stderr, "Parser error: cannot open '%s'.\n", filename);
+        return -9;
+    }
+    int rc = parse_buffer_parallel(mf.data, mf.size, instructions, options, stats);
+    unmap_file(&mf);
+    return rc;
+}
@@ -0,0 +1,64 @@
+#ifndef PARALLEL_FRONTEND_H
+#define PARALLEL_FRONTEND_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "parser.h"
+
+/**
+ * \brief Inputs smaller than this per thread are not worth splitting.
+ */
+#define FRONTEND_MIN_CHUNK_BYTES ((size_t)1 << 20)
+
+/**
+ * \brief Tuning knobs for the parallel front end (0 selects the default).
+ */
+typedef struct FrontendOptions {
+    size_t num_threads;     /**< Worker threads, 0 => online CPUs */
+    size_t min_chunk_bytes; /**< Smallest chunk handed to a thread */
+} FrontendOptions;
+
+/**
+ * \brief Counters collected by parse_buffer_parallel.
+ */
+typedef struct FrontendStats {
+    size_t chunks;           /**< Chunks the input was split into */
+    int    sequential_parse; /**< 1 if blocks/registers forced a single-threaded parse */
+    double lex_seconds;      /**< Wall time of the parallel lexing phase */
+    double parse_seconds;    /**< Wall time of the parsing phase */
+    double merge_seconds;    /**< Wall time of concatenating the chunk results */
+} FrontendStats;
+
+/**
+ * \brief Lexes and parses a source buffer on several threads. The buffer is split at newline
+ *        boundaries into chunks; each thread lexes and parses its chunk into a local
+ *        InstructionList, and the lists are concatenated in order (symbolic parameters are
+ *        renumbered into one table in order of first use). Diagnostics carry global line numbers.
+ *        A statement must not continue onto the next line.
+ *        Programs with REPEAT/DEF blocks or classical registers depend on earlier lines, so
+ *        they are lexed in parallel but parsed on one thread.
+ * \param data Source buffer
+ * \param size Length in bytes
+ * \param instructions Initialized InstructionList; the parsed program is appended
+ * \param options Tuning knobs (NULL => defaults)
+ * \param stats Optional output counters
+ * \return 0 on success, nonzero on parse or allocation error
+ */
+int parse_buffer_parallel(const char* data, size_t size, InstructionList* instructions,
+                          const FrontendOptions* options, FrontendStats* stats);
+
+/**
+ * \brief Memory-maps a .qasm file and runs it through parse_buffer_parallel.
+ * \return 0 on success, nonzero on error
+ */
+int parse_file_parallel(const char* filename, InstructionList* instructions,
+                        const FrontendOptions* options, FrontendStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PARALLEL_FRONTEND_H */
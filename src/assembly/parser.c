@@ -1,7 +1,11 @@
 #include "parser.h"
+#include "file_io.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <strings.h>
 
 #define INITIAL_CAPACITY 16
 
@@ -11,6 +15,12 @@ int init_instruction_list(InstructionList* list) {
     if (!list->data) return -2;
     list->size = 0;
     list->capacity = INITIAL_CAPACITY;
+    list->param_names = NULL;
+    list->num_params = 0;
+    list->param_capacity = 0;
+    list->cregs = NULL;
+    list->num_cregs = 0;
+    list->creg_capacity = 0;
     return 0;
 }
 
@@ -31,37 +41,642 @@ int append_instruction(InstructionList* list, const Instruction* instr) {
 void free_instruction_list(InstructionList* list) {
     if (!list) return;
     free(list->data);
+    free(list->param_names);
+    free(list->cregs);
     list->data = NULL;
     list->size = 0;
     list->capacity = 0;
+    list->param_names = NULL;
+    list->num_params = 0;
+    list->param_capacity = 0;
+    list->cregs = NULL;
+    list->num_cregs = 0;
+    list->creg_capacity = 0;
+}
+
+int find_parameter(const InstructionList* list, const char* name) {
+    if (!list || !name) return -1;
+    for (size_t p = 0; p < list->num_params; p++) {
+        if (strcmp(list->param_names[p], name) == 0) return (int)p;
+    }
+    return -1;
+}
+
+static int find_creg(const InstructionList* list, const char* name, size_t length) {
+    for (size_t r = 0; r < list->num_cregs; r++) {
+        if (strncmp(list->cregs[r].name, name, length) == 0 && list->cregs[r].name[length] == '\0') {
+            return (int)r;
+        }
+    }
+    return -1;
+}
+
+int find_classical_register(const InstructionList* list, const char* name) {
+    if (!list || !name) return -1;
+    return find_creg(list, name, strlen(name));
+}
+
+/**
+ * \brief Returns the index of a symbolic parameter, adding it on first use.
+ * \return Index, or -1 if the name is too long or the table cannot grow
+ */
+static int intern_parameter(InstructionList* list, const char* name, size_t length) {
+    if (length == 0 || length >= PARAM_NAME_MAX) return -1;
+    for (size_t p = 0; p < list->num_params; p++) {
+        if (strncmp(list->param_names[p], name, length) == 0 && list->param_names[p][length] == '\0') {
+            return (int)p;
+        }
+    }
+    if (list->num_params >= INT16_MAX) return -1;
+    if (list->num_params == list->param_capacity) {
+        size_t new_cap = list->param_capacity ? list->param_capacity * 2 : 8;
+        char (*names)[PARAM_NAME_MAX] = realloc(list->param_names, new_cap * PARAM_NAME_MAX);
+        if (!names) return -1;
+        list->param_names = names;
+        list->param_capacity = new_cap;
+    }
+    memcpy(list->param_names[list->num_params], name, length);
+    list->param_names[list->num_params][length] = '\0';
+    return (int)list->num_params++;
+}
+
+int intern_parameter_name(InstructionList* list, const char* name) {
+    if (!list || !name) return -1;
+    return intern_parameter(list, name, strlen(name));
+}
+
+size_t instruction_list_num_qubits(const InstructionList* list) {
+    if (!list) return 0;
+    size_t n = 0;
+    for (size_t i = 0; i < list->size; i++) {
+        const Instruction* instr = &list->data[i];
+        for (size_t q = 0; q < instr->qubit_count; q++) {
+            if (instr->qubits[q] + 1 > n) n = instr->qubits[q] + 1;
+        }
+    }
+    return n;
+}
+
+/**
+ * \brief A token as the parser sees it, independent of whether it came from a
+ *        TokenList (owned strings) or a TokenViewList (views into a source buffer).
+ */
+typedef struct {
+    TokenType   type;
+    const char* text;    /**< Not NUL-terminated for views; always use length */
+    size_t      length;
+    size_t      line;    /**< 1-based line, 0 when unknown */
+} TokenRef;
+
+/**
+ * \brief The token sequence being parsed.
+ */
+typedef struct {
+    const Token*     tokens;  /**< Set for TokenList input */
+    const TokenView* views;   /**< Set for TokenViewList input */
+    const char*      base;    /**< Source buffer the views point into */
+    size_t           count;
+} TokenSource;
+
+static inline TokenRef token_at(const TokenSource* src, size_t i) {
+    TokenRef ref;
+    if (src->views) {
+        const TokenView* v = &src->views[i];
+        ref.type = v->type;
+        ref.text = src->base + v->offset;
+        ref.length = v->length;
+        ref.line = v->line;
+    } else {
+        const Token* t = &src->tokens[i];
+        ref.type = t->type;
+        ref.text = t->text;
+        ref.length = strlen(t->text);
+        ref.line = 0;
+    }
+    return ref;
+}
+
+/**
+ * \brief Where this thread's diagnostics go (NULL => stderr).
+ */
+static _Thread_local FILE* diagnostic_stream = NULL;
+
+void set_parser_diagnostics(FILE* stream) {
+    diagnostic_stream = stream;
+}
+
+/**
+ * \brief Prints a parser diagnostic, prefixed with the line number when it is known.
+ */
+static void parser_message(const char* kind, size_t line, const char* format, ...) {
+    FILE* out = diagnostic_stream ? diagnostic_stream : stderr;
+    va_list args;
+    if (line > 0) {
+        fprintf(out, "Parser %s (line %zu): ", kind, line);
+    } else {
+        fprintf(out, "Parser %s: ", kind);
+    }
+    va_start(args, format);
+    vfprintf(out, format, args);
+    va_end(args);
 }
 
 /**
  * \brief Helper function: check if token text is equal to gate name ignoring case.
  */
-static int token_equals(const char* token_text, const char* gate_name) {
-    return strcasecmp(token_text, gate_name) == 0;
+static int token_equals(const TokenRef* tk, const char* gate_name) {
+    size_t n = strlen(gate_name);
+    return tk->length == n && strncasecmp(tk->text, gate_name, n) == 0;
 }
 
 /**
- * \brief Attempt to parse an integer from token text.
+ * \brief Attempt to parse a nonnegative integer from token text.
  */
-static int parse_int(const char* text, size_t* out_val) {
-    if (!text || !out_val) return -1;
-    char* endptr = NULL;
-    long val = strtol(text, &endptr, 10);
-    if (*endptr != '\0' || val < 0) {
-        return -2; // Not a valid nonnegative integer
+static int parse_int(const TokenRef* tk, size_t* out_val) {
+    if (!tk || !out_val || tk->length == 0) return -1;
+    size_t val = 0;
+    for (size_t i = 0; i < tk->length; i++) {
+        char c = tk->text[i];
+        if (c < '0' || c > '9') return -2; // Not a valid nonnegative integer
+        if (val > (SIZE_MAX - (size_t)(c - '0')) / 10) return -3; // overflow
+        val = val * 10 + (size_t)(c - '0');
     }
-    *out_val = (size_t)val;
+    *out_val = val;
     return 0;
 }
 
-int parse_tokens(const TokenList* tokens, InstructionList* instructions) {
-    if (!tokens || !instructions) return -1;
+int is_block_marker(const Instruction* instr) {
+    return instr->type == INSTR_REPEAT || instr->type == INSTR_DEF ||
+           instr->type == INSTR_CALL || instr->type == INSTR_BLOCK_END;
+}
 
-    for (size_t i = 0; i < tokens->size; i++) {
-        Token tk = tokens->data[i];
+/**
+ * \brief Index of the latest DEF named 'name' among defs[0..count), or -1.
+ */
+static long find_def(const InstructionList* list, const size_t* defs, size_t count,
+                     const char* name, size_t length) {
+    for (size_t d = count; d-- > 0;) {
+        const char* def_name = list->data[defs[d]].gate_name;
+        if (strncmp(def_name, name, length) == 0 && def_name[length] == '\0') return (long)defs[d];
+    }
+    return -1;
+}
+
+int link_blocks(InstructionList* list) {
+    if (!list) return -1;
+    if (list->size > UINT32_MAX) return -2;
+
+    size_t stack[MAX_BLOCK_DEPTH + 1];
+    size_t depth = 0;
+    size_t* defs = NULL;
+    size_t num_defs = 0, def_cap = 0;
+    int rc = 0;
+
+    for (size_t i = 0; i < list->size && rc == 0; i++) {
+        Instruction* instr = &list->data[i];
+        switch (instr->type) {
+            case INSTR_REPEAT:
+            case INSTR_DEF:
+                if (depth > MAX_BLOCK_DEPTH) {
+                    rc = -3;
+                    break;
+                }
+                stack[depth++] = i;
+                break;
+            case INSTR_BLOCK_END: {
+                if (depth == 0) {
+                    rc = -4;
+                    break;
+                }
+                size_t open = stack[--depth];
+                instr->link = (uint32_t)open;
+                list->data[open].link = (uint32_t)i;
+                if (list->data[open].type == INSTR_DEF) {
+                    // A subcircuit becomes callable once its body is closed
+                    if (num_defs == def_cap) {
+                        def_cap = def_cap ? def_cap * 2 : 8;
+                        size_t* grown = (size_t*)realloc(defs, def_cap * sizeof(size_t));
+                        if (!grown) {
+                            rc = -5;
+                            break;
+                        }
+                        defs = grown;
+                    }
+                    defs[num_defs++] = open;
+                }
+                break;
+            }
+            case INSTR_CALL: {
+                long def = find_def(list, defs, num_defs, instr->gate_name, strlen(instr->gate_name));
+                if (def < 0) {
+                    rc = -6;
+                    break;
+                }
+                instr->link = (uint32_t)def;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    if (rc == 0 && depth != 0) rc = -4;
+    free(defs);
+    return rc;
+}
+
+static int is_ident_start(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static int is_ident_char(char c) {
+    return is_ident_start(c) || (c >= '0' && c <= '9');
+}
+
+/**
+ * \brief Parses one angle expression: [+|-] factor { ('*'|'/') factor }, where a factor is a
+ *        number, "pi" or a symbolic name. At most one symbol is allowed and never as a divisor,
+ *        so every angle is either a constant or (constant * symbol).
+ * \return 0 on success, nonzero on a malformed expression
+ */
+static int parse_angle(const char* text, size_t length, InstructionList* list,
+                       float* out_value, int16_t* out_id) {
+    size_t i = 0;
+    double scale = 1.0;
+    int symbol = -1;
+    int divide = 0;
+
+    while (i < length && (text[i] == ' ' || text[i] == '\t')) i++;
+    if (i < length && (text[i] == '-' || text[i] == '+')) {
+        if (text[i] == '-') scale = -1.0;
+        i++;
+    }
+
+    for (;;) {
+        while (i < length && (text[i] == ' ' || text[i] == '\t')) i++;
+        if (i >= length) return -1;
+
+        double factor;
+        if (is_ident_start(text[i])) {
+            size_t start = i;
+            while (i < length && is_ident_char(text[i])) i++;
+            if (i - start == 2 && strncasecmp(text + start, "pi", 2) == 0) {
+                factor = 3.14159265358979323846;
+            } else {
+                if (symbol >= 0 || divide) return -2;
+                symbol = intern_parameter(list, text + start, i - start);
+                if (symbol < 0) return -3;
+                factor = 1.0;
+            }
+        } else {
+            char buffer[64];
+            size_t n = 0;
+            while (i < length && n < sizeof(buffer) - 1 &&
+                   ((text[i] >= '0' && text[i] <= '9') || text[i] == '.' || text[i] == 'e' || text[i] == 'E' ||
+                    ((text[i] == '-' || text[i] == '+') && n > 0 && (buffer[n - 1] == 'e' || buffer[n - 1] == 'E')))) {
+                buffer[n++] = text[i++];
+            }
+            buffer[n] = '\0';
+            char* end = NULL;
+            factor = strtod(buffer, &end);
+            if (n == 0 || end != buffer + n) return -4;
+        }
+
+        if (divide) {
+            if (factor == 0.0) return -5;
+            scale /= factor;
+        } else {
+            scale *= factor;
+        }
+
+        while (i < length && (text[i] == ' ' || text[i] == '\t')) i++;
+        if (i >= length) break;
+        if (text[i] != '*' && text[i] != '/') return -6;
+        divide = (text[i] == '/');
+        i++;
+    }
+
+    *out_value = (float)scale;
+    *out_id = (int16_t)symbol;
+    return 0;
+}
+
+/**
+ * \brief Parses a TOKEN_PARAMS "(a, b, ...)" into instr->params / param_ids.
+ * \return 0 on success, nonzero on error
+ */
+static int parse_param_list(const TokenRef* tk, InstructionList* list, Instruction* instr) {
+    if (tk->length < 2 || tk->text[0] != '(' || tk->text[tk->length - 1] != ')') {
+        parser_message("error", tk->line, "unterminated parameter list '%.*s'.\n", (int)tk->length, tk->text);
+        return -1;
+    }
+    const char* p = tk->text + 1;
+    const char* end = tk->text + tk->length - 1;
+    while (p <= end) {
+        const char* comma = (const char*)memchr(p, ',', (size_t)(end - p));
+        const char* stop = comma ? comma : end;
+        if (instr->param_count >= MAX_GATE_PARAMS) {
+            parser_message("error", tk->line, "too many parameters in '%.*s'.\n", (int)tk->length, tk->text);
+            return -2;
+        }
+        size_t k = instr->param_count;
+        if (parse_angle(p, (size_t)(stop - p), list, &instr->params[k], &instr->param_ids[k]) != 0) {
+            parser_message("error", tk->line, "invalid angle '%.*s'.\n", (int)(stop - p), p);
+            return -3;
+        }
+        instr->param_count++;
+        p = stop + 1;
+    }
+    return 0;
+}
+
+/**
+ * \brief Number of angle parameters a gate takes, or -1 for gates that take none.
+ */
+static int gate_param_count(const TokenRef* tk) {
+    if (token_equals(tk, "RX") || token_equals(tk, "RY") || token_equals(tk, "RZ")) return 1;
+    if (token_equals(tk, "U3")) return 3;
+    if (token_equals(tk, "CPHASE")) return 1;
+    if (token_equals(tk, "DEPOLARIZE") || token_equals(tk, "DAMP") || token_equals(tk, "READOUT")) return 1;
+    return -1;
+}
+
+/**
+ * \brief Returns 1 for the noise-channel statements.
+ */
+static int is_noise_channel(const TokenRef* tk) {
+    return token_equals(tk, "DEPOLARIZE") || token_equals(tk, "DAMP") || token_equals(tk, "READOUT");
+}
+
+/**
+ * \brief Returns 1 for the built-in gates and keywords that take no parameter list.
+ */
+static int is_fixed_gate(const TokenRef* tk) {
+    return token_equals(tk, "H") || token_equals(tk, "X") || token_equals(tk, "Y") ||
+           token_equals(tk, "Z") || token_equals(tk, "S") || token_equals(tk, "T") ||
+           token_equals(tk, "CNOT") || token_equals(tk, "MEASURE") ||
+           token_equals(tk, "REPEAT") || token_equals(tk, "DEF") ||
+           token_equals(tk, "CREG") || token_equals(tk, "IF");
+}
+
+/**
+ * \brief Length of the identifier at the start of text (0 if there is none).
+ */
+static size_t ident_length(const char* text, size_t length) {
+    if (length == 0 || !is_ident_start(text[0])) return 0;
+    size_t n = 1;
+    while (n < length && is_ident_char(text[n])) n++;
+    return n;
+}
+
+/**
+ * \brief Handles "CREG name width" starting at token i.
+ * \return Tokens consumed, or < 0 on error
+ */
+static long parse_creg(const TokenSource* src, size_t i, InstructionList* list) {
+    TokenRef tk = token_at(src, i);
+    TokenRef name = (i + 1 < src->count) ? token_at(src, i + 1) : tk;
+    TokenRef width = (i + 2 < src->count) ? token_at(src, i + 2) : tk;
+    if (i + 2 >= src->count || name.type != TOKEN_GATE || width.type != TOKEN_INTEGER) {
+        parser_message("error", tk.line, "expected 'CREG <name> <width>'.\n");
+        return -1;
+    }
+    if (ident_length(name.text, name.length) != name.length || name.length >= PARAM_NAME_MAX ||
+        is_fixed_gate(&name)) {
+        parser_message("error", name.line, "invalid register name '%.*s'.\n", (int)name.length, name.text);
+        return -1;
+    }
+    if (find_creg(list, name.text, name.length) >= 0) {
+        parser_message("error", name.line, "register '%.*s' is already declared.\n", (int)name.length, name.text);
+        return -1;
+    }
+    size_t bits = 0;
+    if (parse_int(&width, &bits) != 0 || bits == 0 || bits > MAX_CREG_BITS) {
+        parser_message("error", width.line, "register width must be 1..%d bits.\n", MAX_CREG_BITS);
+        return -1;
+    }
+    if (list->num_cregs >= UINT16_MAX - 1) {
+        parser_message("error", tk.line, "too many classical registers.\n");
+        return -1;
+    }
+    if (list->num_cregs == list->creg_capacity) {
+        size_t new_cap = list->creg_capacity ? list->creg_capacity * 2 : 4;
+        ClassicalRegister* grown = (ClassicalRegister*)realloc(list->cregs, new_cap * sizeof(ClassicalRegister));
+        if (!grown) return -1;
+        list->cregs = grown;
+        list->creg_capacity = new_cap;
+    }
+    ClassicalRegister* reg = &list->cregs[list->num_cregs++];
+    memset(reg, 0, sizeof(*reg));
+    memcpy(reg->name, name.text, name.length);
+    reg->width = (uint32_t)bits;
+    return 3;
+}
+
+/**
+ * \brief Parses a bit reference "name[index]" (one token) against the declared registers.
+ * \return 0 on success, nonzero on error (already reported)
+ */
+static int parse_bit_ref(const TokenRef* tk, const InstructionList* list, uint16_t* reg, uint8_t* bit) {
+    size_t n = ident_length(tk->text, tk->length);
+    if (n == 0 || tk->length < n + 3 || tk->text[n] != '[' || tk->text[tk->length - 1] != ']') {
+        parser_message("error", tk->line, "expected a register bit like 'c[0]', got '%.*s'.\n",
+                       (int)tk->length, tk->text);
+        return -1;
+    }
+    int r = find_creg(list, tk->text, n);
+    if (r < 0) {
+        parser_message("error", tk->line, "undeclared register '%.*s'.\n", (int)n, tk->text);
+        return -1;
+    }
+    TokenRef digits = { TOKEN_INTEGER, tk->text + n + 1, tk->length - n - 2, tk->line };
+    size_t index = 0;
+    if (parse_int(&digits, &index) != 0 || index >= list->cregs[r].width) {
+        parser_message("error", tk->line, "bit index out of range in '%.*s'.\n", (int)tk->length, tk->text);
+        return -1;
+    }
+    *reg = (uint16_t)r;
+    *bit = (uint8_t)index;
+    return 0;
+}
+
+/**
+ * \brief Parses the condition after IF at token i, written "c==3" or spread over tokens ("c == 3").
+ * \return Tokens consumed (IF included), or < 0 on error
+ */
+static long parse_condition(const TokenSource* src, size_t i, const InstructionList* list,
+                            uint16_t* reg, uint32_t* value) {
+    TokenRef tk = token_at(src, i);
+    char text[3 * PARAM_NAME_MAX];
+    size_t length = 0;
+    size_t j = i + 1;
+    const char* eq = NULL;
+
+    // Join tokens until the text reads "<name>==<digits>"
+    while (j < src->count && j < i + 4) {
+        TokenRef part = token_at(src, j);
+        if ((part.type != TOKEN_GATE && part.type != TOKEN_INTEGER) || length + part.length >= sizeof(text)) break;
+        memcpy(text + length, part.text, part.length);
+        length += part.length;
+        text[length] = '\0';
+        j++;
+        eq = strstr(text, "==");
+        if (eq && (size_t)(eq - text) + 2 < length) break;
+    }
+
+    size_t n = ident_length(text, length);
+    if (!eq || n == 0 || text + n != eq) {
+        parser_message("error", tk.line, "expected 'IF <register>==<value>'.\n");
+        return -1;
+    }
+    int r = find_creg(list, text, n);
+    if (r < 0) {
+        parser_message("error", tk.line, "undeclared register '%.*s'.\n", (int)n, text);
+        return -1;
+    }
+    TokenRef digits = { TOKEN_INTEGER, eq + 2, length - n - 2, tk.line };
+    size_t v = 0;
+    uint32_t width = list->cregs[r].width;
+    if (parse_int(&digits, &v) != 0 || (width < 32 && v >= ((size_t)1 << width)) || v > UINT32_MAX) {
+        parser_message("error", tk.line, "invalid value '%.*s' for %u-bit register '%s'.\n",
+                       (int)digits.length, digits.text, (unsigned)width, list->cregs[r].name);
+        return -1;
+    }
+    *reg = (uint16_t)r;
+    *value = (uint32_t)v;
+    return (long)(j - i);
+}
+
+/**
+ * \brief Parser state for REPEAT/DEF blocks.
+ */
+typedef struct {
+    size_t  open[MAX_BLOCK_DEPTH + 1]; /**< Instruction index of each open block */
+    size_t  open_line[MAX_BLOCK_DEPTH + 1];
+    size_t  depth;
+    int     in_def;                    /**< Nonzero while inside a DEF body */
+    size_t* defs;                      /**< Closed DEFs, callable by name */
+    size_t  num_defs;
+    size_t  def_capacity;
+} BlockState;
+
+static int add_def(BlockState* bs, size_t index) {
+    if (bs->num_defs == bs->def_capacity) {
+        size_t cap = bs->def_capacity ? bs->def_capacity * 2 : 8;
+        size_t* grown = (size_t*)realloc(bs->defs, cap * sizeof(size_t));
+        if (!grown) return -1;
+        bs->defs = grown;
+        bs->def_capacity = cap;
+    }
+    bs->defs[bs->num_defs++] = index;
+    return 0;
+}
+
+/**
+ * \brief Handles "REPEAT n {", "DEF name {" and "}" starting at token i.
+ * \return Tokens consumed (> 0), 0 if token i does not start a block construct, < 0 on error
+ */
+static long parse_block_token(const TokenSource* src, size_t i, InstructionList* instructions,
+                              BlockState* bs) {
+    TokenRef tk = token_at(src, i);
+    Instruction instr;
+    memset(&instr, 0, sizeof(instr));
+    for (size_t k = 0; k < MAX_GATE_PARAMS; k++) instr.param_ids[k] = -1;
+
+    if (tk.type == TOKEN_RBRACE) {
+        if (bs->depth == 0) {
+            parser_message("error", tk.line, "unmatched '}'.\n");
+            return -1;
+        }
+        size_t open = bs->open[--bs->depth];
+        instr.type = INSTR_BLOCK_END;
+        strcpy(instr.gate_name, "}");
+        if (append_instruction(instructions, &instr) != 0) return -1;
+        if (instructions->data[open].type == INSTR_DEF) {
+            bs->in_def = 0;
+            if (add_def(bs, open) != 0) return -1;
+        }
+        return 1;
+    }
+    if (tk.type != TOKEN_GATE || !(token_equals(&tk, "REPEAT") || token_equals(&tk, "DEF"))) return 0;
+
+    int is_repeat = token_equals(&tk, "REPEAT");
+    TokenRef arg = (i + 1 < src->count) ? token_at(src, i + 1) : tk;
+    TokenRef brace = (i + 2 < src->count) ? token_at(src, i + 2) : tk;
+    if (i + 2 >= src->count || brace.type != TOKEN_LBRACE ||
+        arg.type != (is_repeat ? TOKEN_INTEGER : TOKEN_GATE)) {
+        parser_message("error", tk.line, is_repeat ? "expected 'REPEAT <count> {'.\n"
+                                                   : "expected 'DEF <name> {'.\n");
+        return -1;
+    }
+    if (bs->depth >= MAX_BLOCK_DEPTH) {
+        parser_message("error", tk.line, "blocks nested deeper than %d.\n", MAX_BLOCK_DEPTH);
+        return -1;
+    }
+
+    if (is_repeat) {
+        size_t count = 0;
+        if (parse_int(&arg, &count) != 0 || count > UINT32_MAX) {
+            parser_message("error", arg.line, "invalid repeat count '%.*s'.\n", (int)arg.length, arg.text);
+            return -1;
+        }
+        instr.type = INSTR_REPEAT;
+        instr.repeat_count = (uint32_t)count;
+        strcpy(instr.gate_name, "REPEAT");
+    } else {
+        if (bs->in_def) {
+            parser_message("error", tk.line, "DEF blocks cannot be nested.\n");
+            return -1;
+        }
+        if (arg.length >= sizeof(instr.gate_name) || is_fixed_gate(&arg) || gate_param_count(&arg) >= 0) {
+            parser_message("error", arg.line, "invalid subcircuit name '%.*s'.\n", (int)arg.length, arg.text);
+            return -1;
+        }
+        if (find_def(instructions, bs->defs, bs->num_defs, arg.text, arg.length) >= 0) {
+            parser_message("error", arg.line, "subcircuit '%.*s' is already defined.\n",
+                           (int)arg.length, arg.text);
+            return -1;
+        }
+        instr.type = INSTR_DEF;
+        memcpy(instr.gate_name, arg.text, arg.length);
+        bs->in_def = 1;
+    }
+
+    bs->open[bs->depth] = instructions->size;
+    bs->open_line[bs->depth] = tk.line;
+    bs->depth++;
+    if (append_instruction(instructions, &instr) != 0) return -1;
+    return 3;
+}
+
+static int parse_statements(const TokenSource* src, InstructionList* instructions, BlockState* bs);
+
+static int parse_source(const TokenSource* src, InstructionList* instructions) {
+    BlockState bs;
+    memset(&bs, 0, sizeof(bs));
+    // Subcircuits defined by earlier parse calls on the same list stay callable
+    for (size_t i = 0; i < instructions->size; i++) {
+        if (instructions->data[i].type == INSTR_DEF && add_def(&bs, i) != 0) return -2;
+    }
+    int rc = parse_statements(src, instructions, &bs);
+    if (rc == 0 && bs.depth > 0) {
+        parser_message("error", bs.open_line[bs.depth - 1], "block is never closed with '}'.\n");
+        rc = -12;
+    }
+    free(bs.defs);
+    if (rc == 0 && link_blocks(instructions) != 0) {
+        parser_message("error", 0, "unbalanced blocks.\n");
+        rc = -12;
+    }
+    return rc;
+}
+
+static int parse_statements(const TokenSource* src, InstructionList* instructions, BlockState* bs) {
+    uint16_t cond_reg = 0;   // register index + 1 of a pending "IF", 0 if none
+    uint32_t cond_value = 0;
+    size_t   cond_line = 0;
+
+    for (size_t i = 0; i < src->count; i++) {
+        TokenRef tk = token_at(src, i);
         if (tk.type == TOKEN_COMMENT) {
             // Skip comment tokens
             continue;
@@ -71,52 +686,113 @@ int parse_tokens(const TokenList* tokens, InstructionList* instructions) {
             break;
         }
 
+        // Classical control: "CREG c 2" declares, "IF c==1 <statement>" guards the next statement
+        int is_if = tk.type == TOKEN_GATE && token_equals(&tk, "IF");
+        int is_block = tk.type == TOKEN_RBRACE ||
+                       (tk.type == TOKEN_GATE && (token_equals(&tk, "REPEAT") || token_equals(&tk, "DEF")));
+        if (cond_reg && (is_if || is_block || (tk.type == TOKEN_GATE && token_equals(&tk, "CREG")))) {
+            parser_message("error", tk.line, "IF must guard a gate, measurement or subcircuit call.\n");
+            return -13;
+        }
+        if (is_if) {
+            uint16_t reg = 0;
+            long used = parse_condition(src, i, instructions, &reg, &cond_value);
+            if (used < 0) return -13;
+            cond_reg = (uint16_t)(reg + 1);
+            cond_line = tk.line;
+            i += (size_t)used - 1;
+            continue;
+        }
+        if (tk.type == TOKEN_GATE && token_equals(&tk, "CREG")) {
+            long used = parse_creg(src, i, instructions);
+            if (used < 0) return -13;
+            i += (size_t)used - 1;
+            continue;
+        }
+
+        long consumed = parse_block_token(src, i, instructions, bs);
+        if (consumed < 0) return -12;
+        if (consumed > 0) {
+            i += (size_t)consumed - 1;
+            continue;
+        }
+
         // We expect a gate or a recognized keyword here
         if (tk.type != TOKEN_GATE) {
-            fprintf(stderr, "Parser error: unexpected token '%s', expected a gate or comment.\n", tk.text);
+            parser_message("error", tk.line, "unexpected token '%.*s', expected a gate or comment.\n",
+                           (int)tk.length, tk.text);
             return -2;
         }
 
         Instruction instr;
         memset(&instr, 0, sizeof(instr));
         instr.type = INSTR_UNKNOWN;
-        strncpy(instr.gate_name, tk.text, sizeof(instr.gate_name) - 1);
-        instr.gate_name[sizeof(instr.gate_name) - 1] = '\0';
+        size_t name_len = tk.length < sizeof(instr.gate_name) - 1 ? tk.length : sizeof(instr.gate_name) - 1;
+        memcpy(instr.gate_name, tk.text, name_len);
+        instr.gate_name[name_len] = '\0';
+
+        for (size_t k = 0; k < MAX_GATE_PARAMS; k++) instr.param_ids[k] = -1;
+        instr.cond_reg = cond_reg;
+        instr.cond_value = cond_value;
+        cond_reg = 0;
+
+        // Optional parameter list: "RX(theta) 0", "U3(pi/2, 0, phi) 1"
+        int expected_params = gate_param_count(&tk);
+        if (i + 1 < src->count && token_at(src, i + 1).type == TOKEN_PARAMS) {
+            TokenRef params = token_at(src, i + 1);
+            if (parse_param_list(&params, instructions, &instr) != 0) return -10;
+            i++;
+        }
+        if (expected_params >= 0 && instr.param_count != (uint8_t)expected_params) {
+            parser_message("error", tk.line, "gate '%.*s' takes %d parameter(s), got %u.\n",
+                           (int)tk.length, tk.text, expected_params, (unsigned)instr.param_count);
+            return -11;
+        }
+        if (instr.param_count > 0 && is_fixed_gate(&tk)) {
+            parser_message("error", tk.line, "gate '%.*s' takes no parameters.\n", (int)tk.length, tk.text);
+            return -11;
+        }
+
+        TokenRef next = (i + 1 < src->count) ? token_at(src, i + 1) : tk;
+        int has_int1 = (i + 1 < src->count && next.type == TOKEN_INTEGER);
 
         // Check if it's a recognized gate, e.g. "H", "X", "Y", "Z", "CNOT", "MEASURE"
         // Single-qubit gates
-        if (token_equals(tk.text, "H") || token_equals(tk.text, "X") || 
-            token_equals(tk.text, "Y") || token_equals(tk.text, "Z") || 
-            token_equals(tk.text, "S") || token_equals(tk.text, "T")) {
+        if (token_equals(&tk, "H") || token_equals(&tk, "X") ||
+            token_equals(&tk, "Y") || token_equals(&tk, "Z") ||
+            token_equals(&tk, "S") || token_equals(&tk, "T") ||
+            token_equals(&tk, "RX") || token_equals(&tk, "RY") ||
+            token_equals(&tk, "RZ") || token_equals(&tk, "U3")) {
 
             instr.type = INSTR_GATE_SINGLE;
             // Next token should be an integer for the qubit index
-            if (i + 1 < tokens->size && tokens->data[i + 1].type == TOKEN_INTEGER) {
+            if (has_int1) {
                 size_t qubit_idx = 0;
-                if (parse_int(tokens->data[i + 1].text, &qubit_idx) != 0) {
-                    fprintf(stderr, "Parser error: invalid qubit index '%s'.\n", tokens->data[i + 1].text);
+                if (parse_int(&next, &qubit_idx) != 0) {
+                    parser_message("error", next.line, "invalid qubit index '%.*s'.\n",
+                                   (int)next.length, next.text);
                     return -3;
                 }
                 instr.qubits[0] = qubit_idx;
                 instr.qubit_count = 1;
                 i++; // consume next token
             } else {
-                fprintf(stderr, "Parser error: expected qubit index after gate '%s'.\n", tk.text);
+                parser_message("error", tk.line, "expected qubit index after gate '%.*s'.\n",
+                               (int)tk.length, tk.text);
                 return -4;
             }
             append_instruction(instructions, &instr);
         }
-        else if (token_equals(tk.text, "CNOT")) {
+        else if (token_equals(&tk, "CNOT") || token_equals(&tk, "CPHASE")) {
             instr.type = INSTR_GATE_MULTI;
             // Expect 2 integer tokens: control, target
-            if (i + 2 < tokens->size && 
-                tokens->data[i + 1].type == TOKEN_INTEGER &&
-                tokens->data[i + 2].type == TOKEN_INTEGER) {
+            TokenRef second = (i + 2 < src->count) ? token_at(src, i + 2) : tk;
+            if (i + 2 < src->count && has_int1 && second.type == TOKEN_INTEGER) {
 
                 size_t ctrl = 0, tgt = 0;
-                if (parse_int(tokens->data[i + 1].text, &ctrl) != 0 ||
-                    parse_int(tokens->data[i + 2].text, &tgt) != 0) {
-                    fprintf(stderr, "Parser error: invalid CNOT parameters.\n");
+                if (parse_int(&next, &ctrl) != 0 ||
+                    parse_int(&second, &tgt) != 0) {
+                    parser_message("error", tk.line, "invalid %s parameters.\n", instr.gate_name);
                     return -5;
                 }
                 instr.qubits[0] = ctrl;
@@ -124,37 +800,79 @@ int parse_tokens(const TokenList* tokens, InstructionList* instructions) {
                 instr.qubit_count = 2;
                 i += 2; // consume next two tokens
             } else {
-                fprintf(stderr, "Parser error: expected two qubit indices after 'CNOT'.\n");
+                parser_message("error", tk.line, "expected two qubit indices after '%s'.\n", instr.gate_name);
                 return -6;
             }
             append_instruction(instructions, &instr);
         }
-        else if (token_equals(tk.text, "MEASURE")) {
+        else if (is_noise_channel(&tk)) {
+            instr.type = INSTR_NOISE;
+            if (instr.param_ids[0] >= 0 || !(instr.params[0] >= 0.0f && instr.params[0] <= 1.0f)) {
+                parser_message("error", tk.line, "'%s' needs a constant probability in [0, 1].\n", instr.gate_name);
+                return -14;
+            }
+            if (!has_int1) {
+                parser_message("error", tk.line, "expected qubit index after '%s'.\n", instr.gate_name);
+                return -4;
+            }
+            size_t qubit_idx = 0;
+            if (parse_int(&next, &qubit_idx) != 0) {
+                parser_message("error", next.line, "invalid qubit index '%.*s'.\n", (int)next.length, next.text);
+                return -3;
+            }
+            instr.qubits[0] = qubit_idx;
+            instr.qubit_count = 1;
+            i++;
+            append_instruction(instructions, &instr);
+        }
+        else if (token_equals(&tk, "MEASURE")) {
             instr.type = INSTR_MEASURE;
             // Expect 1 integer token
-            if (i + 1 < tokens->size && tokens->data[i + 1].type == TOKEN_INTEGER) {
+            if (has_int1) {
                 size_t qubit_idx = 0;
-                if (parse_int(tokens->data[i + 1].text, &qubit_idx) != 0) {
-                    fprintf(stderr, "Parser error: invalid qubit index '%s' for measurement.\n", tokens->data[i + 1].text);
+                if (parse_int(&next, &qubit_idx) != 0) {
+                    parser_message("error", next.line, "invalid qubit index '%.*s' for measurement.\n",
+                                   (int)next.length, next.text);
                     return -7;
                 }
                 instr.qubits[0] = qubit_idx;
+                instr.source_qubit = qubit_idx;
                 instr.qubit_count = 1;
                 i++; // consume next token
             } else {
-                fprintf(stderr, "Parser error: expected qubit index after 'MEASURE'.\n");
+                parser_message("error", tk.line, "expected qubit index after 'MEASURE'.\n");
                 return -8;
             }
+            // Optional destination: "MEASURE 0 -> c[1]"
+            if (i + 1 < src->count) {
+                TokenRef arrow = token_at(src, i + 1);
+                if (arrow.type == TOKEN_GATE && token_equals(&arrow, "->")) {
+                    uint16_t reg = 0;
+                    TokenRef dest = (i + 2 < src->count) ? token_at(src, i + 2) : arrow;
+                    if (parse_bit_ref(&dest, instructions, &reg, &instr.target_bit) != 0) return -13;
+                    instr.target_reg = (uint16_t)(reg + 1);
+                    i += 2;
+                }
+            }
+            append_instruction(instructions, &instr);
+        }
+        else if (find_def(instructions, bs->defs, bs->num_defs, tk.text, tk.length) >= 0) {
+            // Call of a previously defined subcircuit
+            if (instr.param_count > 0) {
+                parser_message("error", tk.line, "subcircuit '%s' takes no parameters.\n", instr.gate_name);
+                return -11;
+            }
+            instr.type = INSTR_CALL;
             append_instruction(instructions, &instr);
         }
         else {
             // Possibly an unrecognized gate
-            fprintf(stderr, "Parser warning: unrecognized gate '%s'.\n", tk.text);
+            parser_message("warning", tk.line, "unrecognized gate '%.*s'.\n", (int)tk.length, tk.text);
             // We could parse it as single-qubit if there's a param:
-            if (i + 1 < tokens->size && tokens->data[i + 1].type == TOKEN_INTEGER) {
+            if (has_int1) {
                 instr.type = INSTR_GATE_SINGLE;
                 size_t qubit_idx = 0;
-                if (parse_int(tokens->data[i + 1].text, &qubit_idx) == 0) {
+                if (parse_int(&next, &qubit_idx) == 0) {
                     instr.qubits[0] = qubit_idx;
                     instr.qubit_count = 1;
                     i++;
@@ -164,5 +882,50 @@ int parse_tokens(const TokenList* tokens, InstructionList* instructions) {
         }
     }
 
+    if (cond_reg) {
+        parser_message("error", cond_line, "IF is not followed by a statement.\n");
+        return -13;
+    }
     return 0;
 }
+
+int parse_tokens(const TokenList* tokens, InstructionList* instructions) {
+    if (!tokens || !instructions) return -1;
+    TokenSource src = { tokens->data, NULL, NULL, tokens->size };
+    return parse_source(&src, instructions);
+}
+
+int parse_token_views(const char* base, const TokenViewList* views, InstructionList* instructions) {
+    if (!base || !views || !instructions) return -1;
+
+    // Every instruction consumes at least two tokens; size the list once
+    size_t estimate = instructions->size + views->size / 2 + 1;
+    if (instructions->capacity < estimate) {
+        Instruction* new_data = (Instruction*)realloc(instructions->data, estimate * sizeof(Instruction));
+        if (!new_data) return -2;
+        instructions->data = new_data;
+        instructions->capacity = estimate;
+    }
+
+    TokenSource src = { NULL, views->data, base, views->size };
+    return parse_source(&src, instructions);
+}
+
+int parse_file(const char* filename, InstructionList* instructions) {
+    if (!filename || !instructions) return -1;
+
+    MappedFile mf;
+    if (map_file_readonly(filename, &mf) != 0) {
+        fprintf(stderr, "Parser error: cannot open '%s'.\n", filename);
+        return -9;
+    }
+
+    TokenViewList views;
+    int rc = init_token_view_list(&views);
+    if (rc == 0) rc = lex_buffer(mf.data, mf.size, &views);
+    if (rc == 0) rc = parse_token_views(mf.data, &views, instructions);
+
+    free_token_view_list(&views);
+    unmap_file(&mf);
+    return rc;
+}
@@ -7,6 +7,23 @@ extern "C" {
 
 #include "lexer.h"
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * \brief Most angle parameters any gate takes (U3).
+ */
+#define MAX_GATE_PARAMS 3
+
+/**
+ * \brief Longest symbolic parameter name, including the terminating NUL.
+ */
+#define PARAM_NAME_MAX 32
+
+/**
+ * \brief Widest classical register; a register's value fits one uint32_t.
+ */
+#define MAX_CREG_BITS 32
 
 /**
  * \brief Enumerates all possible instruction types in our quantum assembly language.
@@ -15,23 +32,63 @@ typedef enum {
     INSTR_GATE_SINGLE,   /**< Single-qubit gate: "H 0", "X 1", "Z 0", etc. */
     INSTR_GATE_MULTI,    /**< Multi-qubit gate: "CNOT 0 1" */
     INSTR_MEASURE,       /**< "MEASURE <qubit>" */
+    INSTR_REPEAT,        /**< "REPEAT n {": runs the block up to the matching INSTR_BLOCK_END n times */
+    INSTR_DEF,           /**< "DEF name {": subcircuit definition, skipped when reached in sequence */
+    INSTR_CALL,          /**< "name": runs a previously defined subcircuit */
+    INSTR_BLOCK_END,     /**< "}": closes a REPEAT or DEF block */
+    INSTR_NOISE,         /**< "DEPOLARIZE(p) q", "DAMP(gamma) q", "READOUT(p) q": noise channel */
     INSTR_UNKNOWN
 } InstructionType;
 
+/**
+ * \brief Deepest nesting of REPEAT blocks (a DEF body counts as one more level).
+ */
+#define MAX_BLOCK_DEPTH 64
+
 /**
  * \brief Data structure representing one instruction in the quantum assembly language.
  *
  * For a single-qubit gate, qubits[0] is used.
  * For a multi-qubit gate, qubits[0] and qubits[1], etc.
  * For measurement, qubits[0] is the measured qubit.
+ * "IF c==v" sets cond_reg/cond_value on the statement it guards; "MEASURE q -> c[i]" sets
+ * target_reg/target_bit. Register fields hold the register index + 1, so 0 means "none".
+ * Block markers (REPEAT/DEF/CALL/BLOCK_END) have no qubits; 'link' joins each marker to
+ * its partner (REPEAT/DEF <-> BLOCK_END, CALL -> DEF) and gate_name holds the DEF/CALL name.
+ * A fused single-qubit gate (produced by the optimizer, gate_name "FUSED") carries its
+ * 2x2 matrix in 'matrix' and sets has_matrix. A MEASURE with invert_result set reports
+ * and stores 1 - outcome.
+ * A noise channel (INSTR_NOISE) holds its probability in params[0]; ideal runs skip it and
+ * noise-trajectory runs sample it.
  */
 typedef struct {
     InstructionType type;
     char    gate_name[32]; /**< Gate string, e.g. "H", "X", "CNOT", "MEASURE" */
     size_t  qubits[2];     /**< Up to two qubits for standard gates. Extend if needed. */
     size_t  qubit_count;   /**< How many qubits are relevant to this instruction. */
+    float   params[MAX_GATE_PARAMS];    /**< Angle in radians, or the factor applied to a symbol */
+    int16_t param_ids[MAX_GATE_PARAMS]; /**< Symbol index into the list's param_names, -1 for constants */
+    uint8_t param_count;   /**< Angle parameters of RX/RY/RZ/U3/CPHASE (1 for noise), 0 for fixed gates */
+    uint32_t repeat_count; /**< INSTR_REPEAT: trip count */
+    uint32_t link;         /**< Block markers: index of the partner instruction */
+    uint32_t cond_value;   /**< IF: value the register must equal */
+    uint16_t cond_reg;     /**< IF: classical register index + 1, 0 when unconditional */
+    uint16_t target_reg;   /**< MEASURE: register index + 1 receiving the outcome, 0 to print it */
+    uint8_t  target_bit;   /**< MEASURE: bit of the target register */
+    size_t   source_qubit; /**< MEASURE: qubit index printed with the outcome (survives renumbering) */
+    uint8_t  has_matrix;   /**< 1 if 'matrix' defines this single-qubit gate */
+    uint8_t  invert_result; /**< MEASURE: 1 if the outcome is reported flipped (an X folded into the readout) */
+    float    matrix[8];    /**< Explicit 2x2 matrix, [r00, i00, r01, i01, r10, i10, r11, i11] */
 } Instruction;
 
+/**
+ * \brief A classical register declared with "CREG name width".
+ */
+typedef struct {
+    char     name[PARAM_NAME_MAX];
+    uint32_t width;        /**< Bits, 1..MAX_CREG_BITS */
+} ClassicalRegister;
+
 /**
  * \brief Dynamic array of instructions.
  */
@@ -39,6 +96,12 @@ typedef struct {
     Instruction* data;
     size_t       size;
     size_t       capacity;
+    char       (*param_names)[PARAM_NAME_MAX]; /**< Symbolic parameters, in order of first use */
+    size_t       num_params;
+    size_t       param_capacity;
+    ClassicalRegister* cregs;                  /**< Classical registers, in declaration order */
+    size_t       num_cregs;
+    size_t       creg_capacity;
 } InstructionList;
 
 /**
@@ -62,6 +125,48 @@ int append_instruction(InstructionList* list, const Instruction* instr);
  */
 void free_instruction_list(InstructionList* list);
 
+/**
+ * \brief Returns the index of a symbolic parameter name.
+ * \param list Pointer to an InstructionList
+ * \param name Parameter name, e.g. "theta"
+ * \return Index into list->param_names, or -1 if the circuit does not use it
+ */
+int find_parameter(const InstructionList* list, const char* name);
+
+/**
+ * \brief Like find_parameter, but adds the name to list->param_names on first use.
+ * \return Index into list->param_names, or -1 if the name is invalid or the table cannot grow
+ */
+int intern_parameter_name(InstructionList* list, const char* name);
+
+/**
+ * \brief Returns the index of a classical register.
+ * \param list Pointer to an InstructionList
+ * \param name Register name, e.g. "c"
+ * \return Index into list->cregs, or -1 if no such register is declared
+ */
+int find_classical_register(const InstructionList* list, const char* name);
+
+/**
+ * \brief Recomputes the 'link' fields of all block markers from the block structure.
+ *        The parser calls it; passes that insert or remove instructions must call it again.
+ * \param list Pointer to an InstructionList
+ * \return 0 on success, nonzero if blocks are unbalanced or a call has no earlier DEF
+ */
+int link_blocks(InstructionList* list);
+
+/**
+ * \brief Returns 1 for REPEAT/DEF/CALL/BLOCK_END markers.
+ */
+int is_block_marker(const Instruction* instr);
+
+/**
+ * \brief Returns the register size an InstructionList needs (highest qubit index + 1).
+ * \param list Pointer to an InstructionList
+ * \return Number of qubits, 0 if the list touches no qubits
+ */
+size_t instruction_list_num_qubits(const InstructionList* list);
+
 /**
  * \brief Parses the provided TokenList into an InstructionList.
  * \param tokens The TokenList from lexer
@@ -70,6 +175,30 @@ void free_instruction_list(InstructionList* list);
  */
 int parse_tokens(const TokenList* tokens, InstructionList* instructions);
 
+/**
+ * \brief Parses token views produced by lex_buffer; diagnostics carry line numbers.
+ * \param base Source buffer the views point into
+ * \param views The TokenViewList from lex_buffer
+ * \param instructions Output InstructionList
+ * \return 0 on success, nonzero on error
+ */
+int parse_token_views(const char* base, const TokenViewList* views, InstructionList* instructions);
+
+/**
+ * \brief Sends the calling thread's parser diagnostics to 'stream' instead of stderr, so a
+ *        caller parsing on several threads can print them in order afterwards.
+ * \param stream Destination, NULL to restore stderr
+ */
+void set_parser_diagnostics(FILE* stream);
+
+/**
+ * \brief Maps a .qasm file, lexes it with lex_buffer and parses it, without copying token text.
+ * \param filename Path to the .qasm file
+ * \param instructions Initialized InstructionList to append to
+ * \return 0 on success, nonzero on error
+ */
+int parse_file(const char* filename, InstructionList* instructions);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,230 @@
+#include "stream_interpreter.h"
+#include "interpreter.h"
+#include "lexer.h"
+#include "file_io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define CACHE_LINE 64
+
+/**
+ * \brief Single-producer/single-consumer ring of instructions.
+ *        head is only written by the executor, tail only by the producer.
+ */
+typedef struct {
+    Instruction* slots;
+    size_t       mask;
+    _Alignas(CACHE_LINE) _Atomic size_t head;   /**< Next slot to execute */
+    _Alignas(CACHE_LINE) _Atomic size_t tail;   /**< Next slot to fill */
+    _Alignas(CACHE_LINE) _Atomic int producer_done;
+    _Atomic int producer_error;
+    _Atomic int executor_abort;
+} InstructionRing;
+
+typedef struct {
+    InstructionRing* ring;
+    const char*      data;
+    size_t           size;
+    size_t           batch_lines;
+    StreamStats*     stats;
+    size_t           frontend_bytes;
+} ProducerArgs;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * \brief Copies a batch into the ring, waiting for space as needed.
+ * \return 0 on success, nonzero if the executor aborted
+ */
+static int ring_push_batch(InstructionRing* ring, const Instruction* items, size_t count) {
+    size_t done = 0;
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while (done < count) {
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        size_t space = (ring->mask + 1) - (tail - head);
+        if (space == 0) {
+            if (atomic_load_explicit(&ring->executor_abort, memory_order_relaxed)) return -1;
+            sched_yield();
+            continue;
+        }
+        size_t n = (count - done < space) ? count - done : space;
+        for (size_t k = 0; k < n; k++) {
+            ring->slots[(tail + k) & ring->mask] = items[done + k];
+        }
+        tail += n;
+        done += n;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release); // publish the batch
+    }
+    return 0;
+}
+
+/**
+ * \brief Producer: lex + parse bounded batches of lines and feed the ring.
+ */
+static void* producer_thread(void* arg) {
+    ProducerArgs* pa = (ProducerArgs*)arg;
+    InstructionRing* ring = pa->ring;
+    double t0 = now_seconds();
+    double pushing = 0.0;
+    int rc = 0;
+
+    TokenViewList views;
+    InstructionList batch;
+    if (init_token_view_list(&views) != 0 || init_instruction_list(&batch) != 0) {
+        rc = -1;
+    }
+
+    size_t pos = 0;
+    size_t line = 1;
+    while (rc == 0 && pos < pa->size) {
+        if (atomic_load_explicit(&ring->executor_abort, memory_order_relaxed)) break;
+
+        // Cut the batch after batch_lines newlines (or at end of input)
+        size_t end = pos;
+        size_t lines = 0;
+        while (end < pa->size && lines < pa->batch_lines) {
+            const char* nl = (const char*)memchr(pa->data + end, '\n', pa->size - end);
+            end = nl ? (size_t)(nl - pa->data) + 1 : pa->size;
+            lines++;
+        }
+
+        views.size = 0;
+        batch.size = 0;
+        if (lex_buffer_lines(pa->data + pos, end - pos, line, &views) != 0 ||
+            parse_token_views(pa->data + pos, &views, &batch) != 0) {
+            rc = -2;
+            break;
+        }
+
+        size_t bytes = views.capacity * sizeof(TokenView) + batch.capacity * sizeof(Instruction);
+        if (bytes > pa->frontend_bytes) pa->frontend_bytes = bytes;
+
+        double tp = now_seconds();
+        if (ring_push_batch(ring, batch.data, batch.size) != 0) break;
+        pushing += now_seconds() - tp;
+
+        pa->stats->batches++;
+        pos = end;
+        line += lines;
+    }
+
+    free_token_view_list(&views);
+    free_instruction_list(&batch);
+
+    pa->stats->producer_seconds = now_seconds() - t0 - pushing;
+    if (rc != 0) atomic_store_explicit(&ring->producer_error, rc, memory_order_relaxed);
+    atomic_store_explicit(&ring->producer_done, 1, memory_order_release);
+    return NULL;
+}
+
+int interpret_buffer_streaming(const char* data, size_t size, StateVector* sv,
+                               const StreamOptions* options, StreamStats* stats) {
+    if (!data || !sv) return -1;
+
+    StreamStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+
+    size_t batch_lines = (options && options->batch_lines) ? options->batch_lines : STREAM_DEFAULT_BATCH_LINES;
+    size_t capacity = (options && options->ring_capacity) ? options->ring_capacity : STREAM_DEFAULT_RING_CAPACITY;
+    size_t pow2 = 1;
+    while (pow2 < capacity) pow2 <<= 1;
+
+    InstructionRing* ring = (InstructionRing*)aligned_alloc(CACHE_LINE,
+        (sizeof(InstructionRing) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE);
+    if (!ring) return -3;
+    memset(ring, 0, sizeof(*ring));
+    ring->slots = (Instruction*)malloc(pow2 * sizeof(Instruction));
+    if (!ring->slots) {
+        free(ring);
+        return -3;
+    }
+    ring->mask = pow2 - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->producer_done, 0);
+    atomic_init(&ring->producer_error, 0);
+    atomic_init(&ring->executor_abort, 0);
+
+    ProducerArgs pa = { ring, data, size, batch_lines, stats, 0 };
+    pthread_t producer;
+    if (pthread_create(&producer, NULL, producer_thread, &pa) != 0) {
+        free(ring->slots);
+        free(ring);
+        return -4;
+    }
+
+    // Executor: drain whatever has been published, then wait for more
+    int rc = 0;
+    size_t head = 0;
+    uint32_t* cregs = NULL;
+    size_t num_cregs = 0;
+    for (;;) {
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head == tail) {
+            if (atomic_load_explicit(&ring->producer_done, memory_order_acquire)) {
+                // Re-check: the producer may have published right before finishing
+                if (head == atomic_load_explicit(&ring->tail, memory_order_acquire)) break;
+                continue;
+            }
+            double tw = now_seconds();
+            sched_yield();
+            stats->executor_wait_seconds += now_seconds() - tw;
+            continue;
+        }
+        for (; head != tail; head++) {
+            const Instruction* instr = &ring->slots[head & ring->mask];
+            // Registers are numbered by the producer's parser in declaration order; grow on first use
+            size_t reg = instr->cond_reg > instr->target_reg ? instr->cond_reg : instr->target_reg;
+            if (reg > num_cregs) {
+                uint32_t* grown = (uint32_t*)realloc(cregs, reg * sizeof(uint32_t));
+                if (!grown) {
+                    rc = -3;
+                    break;
+                }
+                memset(grown + num_cregs, 0, (reg - num_cregs) * sizeof(uint32_t));
+                cregs = grown;
+                num_cregs = reg;
+            }
+            rc = interpret_instruction_classical(instr, sv, cregs);
+            if (rc != 0) break;
+            stats->instructions++;
+        }
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+        if (rc != 0) {
+            atomic_store_explicit(&ring->executor_abort, 1, memory_order_relaxed);
+            break;
+        }
+    }
+
+    pthread_join(producer, NULL);
+    if (rc == 0) rc = atomic_load_explicit(&ring->producer_error, memory_order_relaxed);
+    stats->peak_frontend_bytes = pa.frontend_bytes + pow2 * sizeof(Instruction);
+
+    free(cregs);
+    free(ring->slots);
+    free(ring);
+    return rc;
+}
+
+int interpret_file_streaming(const char* filename, StateVector* sv,
+                             const StreamOptions* options, StreamStats* stats) {
+    if (!filename || !sv) return -1;
+    MappedFile mf;
+    if (map_file_readonly(filename, &mf) != 0) {
+        fprintf(stderr, "Interpret error: cannot open '%s'.\n", filename);
+        return -2;
+    }
+    int rc = interpret_buffer_streaming(mf.data, mf.size, sv, options, stats);
+    unmap_file(&mf);
+    return rc;
+}
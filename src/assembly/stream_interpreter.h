@@ -0,0 +1,70 @@
+#ifndef STREAM_INTERPRETER_H
+#define STREAM_INTERPRETER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "parser.h"
+#include "state_vector.h"
+
+/**
+ * \brief Default number of source lines lexed and parsed per producer batch.
+ */
+#define STREAM_DEFAULT_BATCH_LINES 4096
+
+/**
+ * \brief Default capacity (instructions) of the producer -> executor ring buffer.
+ */
+#define STREAM_DEFAULT_RING_CAPACITY 16384
+
+/**
+ * \brief Tuning knobs for streaming execution (0 selects the default).
+ */
+typedef struct StreamOptions {
+    size_t batch_lines;    /**< Lines per front-end batch */
+    size_t ring_capacity;  /**< Ring slots, rounded up to a power of two */
+} StreamOptions;
+
+/**
+ * \brief Counters collected during a streaming run.
+ */
+typedef struct StreamStats {
+    size_t instructions;         /**< Instructions executed */
+    size_t batches;              /**< Front-end batches produced */
+    size_t peak_frontend_bytes;  /**< Token views + batch instructions + ring, at their largest */
+    double producer_seconds;     /**< Time the producer spent lexing and parsing */
+    double executor_wait_seconds;/**< Time the executor spent waiting for input */
+} StreamStats;
+
+/**
+ * \brief Lexes, parses and executes a source buffer in a pipeline: a producer thread turns
+ *        bounded batches of lines into instructions and pushes them through a lock-free
+ *        single-producer/single-consumer ring, while the calling thread applies them to sv.
+ *        Instructions must not span batch boundaries (one instruction per line, as in the examples),
+ *        so REPEAT/DEF blocks are rejected here; run such programs through interpret_instructions.
+ *        Classical registers (CREG, "MEASURE q -> c[i]", IF) are kept by the executor for the
+ *        whole run, so a register declared in one batch can be read in later ones.
+ * \param data Source buffer
+ * \param size Length in bytes
+ * \param sv Initialized StateVector large enough for every qubit the program touches
+ * \param options Tuning knobs (NULL => defaults)
+ * \param stats Optional output counters
+ * \return 0 on success, nonzero on parse or execution error
+ */
+int interpret_buffer_streaming(const char* data, size_t size, StateVector* sv,
+                               const StreamOptions* options, StreamStats* stats);
+
+/**
+ * \brief Memory-maps a .qasm file and runs it through interpret_buffer_streaming.
+ * \return 0 on success, nonzero on error
+ */
+int interpret_file_streaming(const char* filename, StateVector* sv,
+                             const StreamOptions* options, StreamStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAM_INTERPRETER_H */
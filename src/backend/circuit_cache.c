@@ -0,0 +1,226 @@
+#include "circuit_cache.h"
+#include "circuit_optimizer.h"
+#include "../assembly/parallel_frontend.h"
+#include "../utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+#define BYTE_ORDER_MARK  0x01020304u
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t fnv1a(uint64_t h, const void* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+static uint32_t optimizer_flags(const CompileOptions* options) {
+    if (!options) return 0u;
+    return (options->optimize ? 1u : 0u) | (options->measured_only ? 2u : 0u);
+}
+
+uint64_t circuit_cache_key(const char* source, size_t size, const CompileOptions* options) {
+    uint32_t settings[3] = { optimizer_flags(options), CIRCUIT_OPTIMIZER_VERSION, CIRCUIT_FORMAT_VERSION };
+    uint64_t h = fnv1a(FNV_OFFSET_BASIS, source, size);
+    return fnv1a(h, settings, sizeof(settings));
+}
+
+int save_compiled_circuit(const char* path, const InstructionList* instructions, uint64_t key,
+                          uint64_t source_size, uint32_t flags) {
+    if (!path || !instructions) return -1;
+
+    CircuitFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CIRCUIT_FORMAT_MAGIC, sizeof(CIRCUIT_FORMAT_MAGIC));
+    header.version = CIRCUIT_FORMAT_VERSION;
+    header.instruction_size = (uint32_t)sizeof(Instruction);
+    header.byte_order = BYTE_ORDER_MARK;
+    header.optimizer_flags = flags;
+    header.key = key;
+    header.source_size = source_size;
+    header.instruction_count = instructions->size;
+    header.num_qubits = instruction_list_num_qubits(instructions);
+    header.data_offset = sizeof(header);
+    header.param_count = instructions->num_params;
+    header.param_offset = header.data_offset + (uint64_t)instructions->size * sizeof(Instruction);
+    header.creg_count = instructions->num_cregs;
+    header.creg_offset = header.param_offset + (uint64_t)instructions->num_params * PARAM_NAME_MAX;
+
+    // Write to a private temporary and rename, so readers never see a partial file. mkstemp
+    // makes the name unique per call, also between threads of one process storing the same key.
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp.XXXXXX", path) >= (int)sizeof(tmp)) return -1;
+    int fd = mkstemp(tmp);
+    if (fd < 0) return -2;
+    fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH); // mkstemp creates the file owner-only
+    FILE* fp = fdopen(fd, "wb");
+    if (!fp) {
+        close(fd);
+        remove(tmp);
+        return -2;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    if (ok && instructions->size > 0) {
+        ok = fwrite(instructions->data, sizeof(Instruction), instructions->size, fp) == instructions->size;
+    }
+    if (ok && instructions->num_params > 0) {
+        ok = fwrite(instructions->param_names, PARAM_NAME_MAX, instructions->num_params, fp) ==
+             instructions->num_params;
+    }
+    if (ok && instructions->num_cregs > 0) {
+        ok = fwrite(instructions->cregs, sizeof(ClassicalRegister), instructions->num_cregs, fp) ==
+             instructions->num_cregs;
+    }
+    if (fclose(fp) != 0) ok = 0;
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return -3;
+    }
+    return 0;
+}
+
+int load_compiled_circuit(const char* path, uint64_t key, uint64_t source_size, CompiledCircuit* out) {
+    if (!path || !out) return -1;
+    memset(out, 0, sizeof(*out));
+
+    MappedFile mf;
+    if (map_file_readonly(path, &mf) != 0) return -2;
+
+    const CircuitFileHeader* h = (const CircuitFileHeader*)mf.data;
+    int valid = mf.size >= sizeof(*h) &&
+                memcmp(h->magic, CIRCUIT_FORMAT_MAGIC, sizeof(CIRCUIT_FORMAT_MAGIC)) == 0 &&
+                h->version == CIRCUIT_FORMAT_VERSION &&
+                h->instruction_size == sizeof(Instruction) &&
+                h->byte_order == BYTE_ORDER_MARK &&
+                h->key == key && h->source_size == source_size &&
+                h->data_offset >= sizeof(*h) && h->data_offset % sizeof(size_t) == 0 &&
+                h->data_offset <= mf.size &&
+                h->instruction_count <= (mf.size - h->data_offset) / sizeof(Instruction) &&
+                h->param_offset == h->data_offset + h->instruction_count * sizeof(Instruction) &&
+                h->param_count <= (mf.size - h->param_offset) / PARAM_NAME_MAX &&
+                h->creg_offset == h->param_offset + h->param_count * PARAM_NAME_MAX &&
+                h->creg_offset % sizeof(uint32_t) == 0 &&
+                h->creg_count <= (mf.size - h->creg_offset) / sizeof(ClassicalRegister);
+    if (!valid) {
+        unmap_file(&mf);
+        return -3;
+    }
+
+    out->backing = mf;
+    out->instructions.data = h->instruction_count
+        ? (Instruction*)(mf.data + h->data_offset) : NULL;
+    out->instructions.size = (size_t)h->instruction_count;
+    out->instructions.capacity = 0; // borrowed from the mapping
+    out->instructions.param_names = h->param_count
+        ? (char (*)[PARAM_NAME_MAX])(mf.data + h->param_offset) : NULL;
+    out->instructions.num_params = (size_t)h->param_count;
+    out->instructions.param_capacity = 0;
+    out->instructions.cregs = h->creg_count
+        ? (ClassicalRegister*)(mf.data + h->creg_offset) : NULL;
+    out->instructions.num_cregs = (size_t)h->creg_count;
+    out->instructions.creg_capacity = 0;
+    out->key = key;
+    out->from_cache = 1;
+    return 0;
+}
+
+static int compile_source(const char* data, size_t size, uint32_t flags, InstructionList* out) {
+    if (init_instruction_list(out) != 0) return -1;
+    int rc = parse_buffer_parallel(data, size, out, NULL, NULL);
+    if (rc == 0 && (flags & 1u)) rc = optimize_circuit(out);
+    if (rc == 0 && (flags & 2u)) {
+        LightConeStats cone;
+        rc = reduce_to_light_cone(out, NULL, &cone);
+        size_t removed = cone.dead.diagonal + cone.dead.flips + cone.dead.unmeasured;
+        if (rc == 0 && (removed > 0 || cone.qubits_after < cone.qubits_before)) {
+            log_message(LOG_LEVEL_INFO, "Compile: light cone keeps %zu of %zu qubits; %zu dead gate(s) removed, "
+                        "%.2f state sweeps saved.", cone.qubits_after, cone.qubits_before, removed,
+                        cone.dead.sweeps_saved);
+        }
+    }
+    if (rc != 0) free_instruction_list(out);
+    return rc;
+}
+
+int compile_circuit_cached(const char* filename, const CompileOptions* options,
+                           CompiledCircuit* out, CacheStats* stats) {
+    if (!filename || !out) return -1;
+    memset(out, 0, sizeof(*out));
+
+    CacheStats local;
+    if (!stats) {
+        memset(&local, 0, sizeof(local));
+        stats = &local;
+    }
+
+    MappedFile source;
+    if (map_file_readonly(filename, &source) != 0) {
+        fprintf(stderr, "Compile error: cannot open '%s'.\n", filename);
+        return -2;
+    }
+
+    double t0 = now_seconds();
+    const char* cache_dir = options ? options->cache_dir : NULL;
+    uint64_t key = circuit_cache_key(source.data, source.size, options);
+    char path[4096] = "";
+    if (cache_dir) {
+        if (snprintf(path, sizeof(path), "%s/%016llx.qbc", cache_dir, (unsigned long long)key)
+                >= (int)sizeof(path)) {
+            path[0] = '\0';
+        } else if (load_compiled_circuit(path, key, source.size, out) == 0) {
+            stats->hits++;
+            stats->lookup_seconds += now_seconds() - t0;
+            unmap_file(&source);
+            return 0;
+        }
+    }
+    double t1 = now_seconds();
+    stats->lookup_seconds += t1 - t0;
+    stats->misses++;
+
+    int rc = compile_source(source.data, source.size, optimizer_flags(options), &out->instructions);
+    stats->compile_seconds += now_seconds() - t1;
+    if (rc != 0) {
+        unmap_file(&source);
+        return rc;
+    }
+    out->key = key;
+
+    if (path[0] != '\0') {
+        if (mkdir(cache_dir, 0755) != 0 && errno != EEXIST) {
+            log_message(LOG_LEVEL_WARN, "Compile cache: cannot create '%s'.", cache_dir);
+        } else if (save_compiled_circuit(path, &out->instructions, key, source.size,
+                                         optimizer_flags(options)) == 0) {
+            stats->stores++;
+        } else {
+            log_message(LOG_LEVEL_WARN, "Compile cache: cannot write '%s'.", path);
+        }
+    }
+    unmap_file(&source);
+    return 0;
+}
+
+void free_compiled_circuit(CompiledCircuit* circuit) {
+    if (!circuit) return;
+    if (circuit->from_cache) {
+        unmap_file(&circuit->backing);
+    } else {
+        free_instruction_list(&circuit->instructions);
+    }
+    memset(circuit, 0, sizeof(*circuit));
+}
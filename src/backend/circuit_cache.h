@@ -0,0 +1,120 @@
+#ifndef CIRCUIT_CACHE_H
+#define CIRCUIT_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../assembly/parser.h"
+#include "../utils/file_io.h"
+
+/**
+ * \brief Version of the binary circuit format. Bump it whenever Instruction or the
+ *        file layout changes; files with another version are treated as cache misses.
+ */
+#define CIRCUIT_FORMAT_VERSION 8
+
+/**
+ * \brief Magic bytes at the start of every compiled circuit file.
+ */
+#define CIRCUIT_FORMAT_MAGIC "QASMBIN"
+
+/**
+ * \brief On-disk header of a compiled circuit. The instruction records follow at
+ *        data_offset as a raw Instruction array in host layout, then the symbolic parameter
+ *        names (PARAM_NAME_MAX bytes each) at param_offset and the classical registers at
+ *        creg_offset, so a hit can be used in place.
+ */
+typedef struct CircuitFileHeader {
+    char     magic[8];          /**< CIRCUIT_FORMAT_MAGIC, NUL-padded */
+    uint32_t version;           /**< CIRCUIT_FORMAT_VERSION */
+    uint32_t instruction_size;  /**< sizeof(Instruction) of the writer */
+    uint32_t byte_order;        /**< 0x01020304 as written by the host */
+    uint32_t optimizer_flags;   /**< Settings the stream was produced with */
+    uint64_t key;               /**< Cache key (source + settings hash) */
+    uint64_t source_size;       /**< Length of the source in bytes */
+    uint64_t instruction_count; /**< Number of records */
+    uint64_t num_qubits;        /**< instruction_list_num_qubits of the stream */
+    uint64_t data_offset;       /**< Byte offset of the first record */
+    uint64_t param_count;       /**< Number of symbolic parameter names */
+    uint64_t param_offset;      /**< Byte offset of the parameter name table */
+    uint64_t creg_count;        /**< Number of classical registers */
+    uint64_t creg_offset;       /**< Byte offset of the ClassicalRegister table */
+} CircuitFileHeader;
+
+/**
+ * \brief Settings that change the compiled output (and therefore the cache key).
+ */
+typedef struct CompileOptions {
+    const char* cache_dir; /**< Directory for compiled files, NULL => no caching */
+    int         optimize;  /**< Nonzero runs optimize_circuit after parsing */
+    int         measured_only; /**< Nonzero runs reduce_to_light_cone (only outcomes are kept) */
+} CompileOptions;
+
+/**
+ * \brief Compile cache counters (accumulated across calls).
+ */
+typedef struct CacheStats {
+    size_t hits;            /**< Compiled form reused */
+    size_t misses;          /**< Source lexed, parsed and optimized */
+    size_t stores;          /**< Compiled files written */
+    double lookup_seconds;  /**< Hashing + probing + mapping */
+    double compile_seconds; /**< Front end on misses */
+} CacheStats;
+
+/**
+ * \brief A compiled circuit. On a cache hit the instructions and parameter names live in
+ *        the mapped file (read-only, capacity == 0); otherwise they are heap-owned.
+ */
+typedef struct CompiledCircuit {
+    InstructionList instructions;
+    MappedFile      backing;    /**< Mapped cache file on a hit */
+    uint64_t        key;        /**< Cache key of the source + settings */
+    int             from_cache; /**< 1 if loaded from the cache */
+} CompiledCircuit;
+
+/**
+ * \brief Computes the cache key: 64-bit FNV-1a over the source, the compile settings,
+ *        the optimizer version and the format version.
+ */
+uint64_t circuit_cache_key(const char* source, size_t size, const CompileOptions* options);
+
+/**
+ * \brief Writes an instruction stream in the binary circuit format (atomically, via rename).
+ * \return 0 on success, nonzero on error
+ */
+int save_compiled_circuit(const char* path, const InstructionList* instructions, uint64_t key,
+                          uint64_t source_size, uint32_t optimizer_flags);
+
+/**
+ * \brief Maps a compiled circuit file and validates it against the expected key.
+ * \return 0 on success, nonzero if the file is missing, stale, foreign or truncated
+ */
+int load_compiled_circuit(const char* path, uint64_t key, uint64_t source_size, CompiledCircuit* out);
+
+/**
+ * \brief Produces the instruction stream of a .qasm file, reusing the compiled form from
+ *        options->cache_dir when the source and settings are unchanged. Misses run
+ *        parse_buffer_parallel and (optionally) optimize_circuit and reduce_to_light_cone,
+ *        then store the result.
+ * \param filename Path to the .qasm file
+ * \param options Compile options (NULL => no cache, no optimization)
+ * \param out Output circuit (release with free_compiled_circuit)
+ * \param stats Optional counters to accumulate into
+ * \return 0 on success, nonzero on error
+ */
+int compile_circuit_cached(const char* filename, const CompileOptions* options,
+                           CompiledCircuit* out, CacheStats* stats);
+
+/**
+ * \brief Releases a CompiledCircuit.
+ */
+void free_compiled_circuit(CompiledCircuit* circuit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CIRCUIT_CACHE_H */
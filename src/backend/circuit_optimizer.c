@@ -1,63 +1,836 @@
 #include "circuit_optimizer.h"
+#include "cost_model.h"
+#include "../assembly/interpreter.h"
+#include "../utils/logger.h"
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+
+#define NONE SIZE_MAX
+#define TWO_PI 6.283185307179586
+#define QUARTER_PI 0.7853981633974483
+
+/**
+ * \brief How a gate acts on one qubit, for commutation purposes.
+ */
+typedef enum {
+    KIND_OTHER,    /**< Commutes with nothing we know of (H, U3, unknown gates) */
+    KIND_DIAGONAL, /**< Z, S, T, RZ: commute with each other, CNOT controls and CPHASE */
+    KIND_X_AXIS,   /**< X, RX: commute with each other and CNOT targets */
+    KIND_Y_AXIS    /**< Y, RY: commute with each other */
+} GateKind;
+
+static GateKind single_qubit_kind(const Instruction* instr) {
+    const char* g = instr->gate_name;
+    if (strcasecmp(g, "Z") == 0 || strcasecmp(g, "S") == 0 || strcasecmp(g, "T") == 0 ||
+        strcasecmp(g, "RZ") == 0) {
+        return KIND_DIAGONAL;
+    }
+    if (strcasecmp(g, "X") == 0 || strcasecmp(g, "RX") == 0) return KIND_X_AXIS;
+    if (strcasecmp(g, "Y") == 0 || strcasecmp(g, "RY") == 0) return KIND_Y_AXIS;
+    return KIND_OTHER;
+}
+
+static int is_cnot(const Instruction* instr) {
+    return instr->type == INSTR_GATE_MULTI && instr->qubit_count == 2 && strcasecmp(instr->gate_name, "CNOT") == 0;
+}
+
+static int is_cphase(const Instruction* instr) {
+    return instr->type == INSTR_GATE_MULTI && instr->qubit_count == 2 && instr->param_count == 1 &&
+           strcasecmp(instr->gate_name, "CPHASE") == 0;
+}
+
+/**
+ * \brief Does 'other' commute with a gate of the given kind acting on qubit q?
+ *        A guarded (IF) gate is either applied or not, so the same rules hold for it.
+ */
+static int commutes_on(const Instruction* other, GateKind kind, size_t q) {
+    if (kind == KIND_OTHER) return 0;
+    if (other->type == INSTR_GATE_SINGLE) {
+        GateKind k = single_qubit_kind(other);
+        return k != KIND_OTHER && k == kind;
+    }
+    if (is_cnot(other)) {
+        return (kind == KIND_DIAGONAL && other->qubits[0] == q) ||
+               (kind == KIND_X_AXIS && other->qubits[1] == q);
+    }
+    if (is_cphase(other)) return kind == KIND_DIAGONAL;
+    return 0; // measurements and unknown gates are barriers
+}
+
+/**
+ * \brief Does 'other' commute with CNOT(control, target) / CPHASE(control, target) on qubit q?
+ */
+static int commutes_with_two_qubit(const Instruction* other, const Instruction* g, size_t q) {
+    if (is_cnot(g)) {
+        // The control wire behaves like a diagonal gate, the target wire like X
+        if (q == g->qubits[0]) {
+            if (is_cnot(other)) return other->qubits[0] == q;
+            if (is_cphase(other)) return other->qubits[0] != g->qubits[1] && other->qubits[1] != g->qubits[1];
+            return commutes_on(other, KIND_DIAGONAL, q);
+        }
+        if (is_cnot(other)) return other->qubits[1] == q && other->qubits[0] != g->qubits[0];
+        return commutes_on(other, KIND_X_AXIS, q);
+    }
+    // CPHASE is diagonal on both wires
+    if (is_cnot(other)) return other->qubits[0] == q && other->qubits[1] != g->qubits[0] &&
+                               other->qubits[1] != g->qubits[1];
+    return commutes_on(other, KIND_DIAGONAL, q);
+}
+
+/**
+ * \brief Per-qubit wire view of the list: prev[2 * i + s] is the previous instruction on the
+ *        wire of instruction i's qubit s. Removed instructions keep their links, so walks
+ *        simply step over them.
+ */
+typedef struct {
+    InstructionList* list;
+    size_t*  prev;
+    size_t*  last;     /**< Latest instruction per qubit while scanning */
+    size_t   num_qubits;
+    uint8_t* removed;
+} WireView;
+
+static size_t wire_prev(const WireView* w, size_t i, size_t q) {
+    const Instruction* instr = &w->list->data[i];
+    return w->prev[2 * i + (instr->qubits[0] == q ? 0 : 1)];
+}
+
+/**
+ * \brief Walks back from instruction j along qubit q. Returns the first live instruction
+ *        accepted by 'match', or NONE if one that does not commute (per 'g') comes first.
+ */
+static size_t walk_back(const WireView* w, size_t j, size_t q, const Instruction* g,
+                        int (*match)(const Instruction* cand, const Instruction* g, size_t q, size_t target),
+                        size_t target) {
+    size_t steps = 0;
+    for (size_t cur = wire_prev(w, j, q); cur != NONE && steps < OPTIMIZER_WINDOW; cur = wire_prev(w, cur, q)) {
+        if (w->removed[cur]) continue;
+        steps++;
+        const Instruction* other = &w->list->data[cur];
+        if (match(other, g, q, target) && (target == NONE || cur == target)) return cur;
+        int ok = (g->type == INSTR_GATE_SINGLE) ? commutes_on(other, single_qubit_kind(g), q)
+                                                : commutes_with_two_qubit(other, g, q);
+        if (!ok) return NONE;
+    }
+    return NONE;
+}
+
+static int same_single_qubit(const Instruction* cand, const Instruction* g, size_t q, size_t target) {
+    (void)q;
+    (void)target;
+    return cand->type == INSTR_GATE_SINGLE && cand->cond_reg == 0 &&
+           strcasecmp(cand->gate_name, g->gate_name) == 0;
+}
+
+static int same_two_qubit(const Instruction* cand, const Instruction* g, size_t q, size_t target) {
+    (void)q;
+    (void)target;
+    if (cand->cond_reg != 0 || strcasecmp(cand->gate_name, g->gate_name) != 0 || cand->qubit_count != 2) return 0;
+    if (is_cnot(g)) return cand->qubits[0] == g->qubits[0] && cand->qubits[1] == g->qubits[1];
+    // CPHASE is symmetric in its qubits
+    return (cand->qubits[0] == g->qubits[0] && cand->qubits[1] == g->qubits[1]) ||
+           (cand->qubits[0] == g->qubits[1] && cand->qubits[1] == g->qubits[0]);
+}
+
+/**
+ * \brief Adds g's angle to f's (both constant, or both the same symbol).
+ * \return 1 if merged, 0 if the angles cannot be combined
+ */
+static int add_angles(Instruction* f, const Instruction* g) {
+    if (f->param_count != 1 || g->param_count != 1 || f->param_ids[0] != g->param_ids[0]) return 0;
+    f->params[0] += g->params[0];
+    return 1;
+}
+
+static int angle_is_identity(const Instruction* f, double period) {
+    if (f->param_ids[0] >= 0) return f->params[0] == 0.0f;
+    double r = fmod(fabs((double)f->params[0]), period);
+    return r < 1e-6 || period - r < 1e-6;
+}
+
+typedef enum { RULE_NONE, RULE_CANCEL, RULE_MERGED } RuleResult;
+
+/**
+ * \brief Applies f . g (f earlier, g later, on the same qubits with only commuting gates between).
+ *        Self-inverse pairs cancel, S.S = Z, T.T = S, rotations about one axis add their angles.
+ */
+static RuleResult combine(Instruction* f, const Instruction* g) {
+    const char* a = f->gate_name;
+    if (f->param_count == 0) {
+        if (strcasecmp(a, "X") == 0 || strcasecmp(a, "Y") == 0 || strcasecmp(a, "Z") == 0 ||
+            strcasecmp(a, "H") == 0 || strcasecmp(a, "CNOT") == 0) {
+            return RULE_CANCEL;
+        }
+        if (strcasecmp(a, "S") == 0) {
+            strcpy(f->gate_name, "Z");
+            return RULE_MERGED;
+        }
+        if (strcasecmp(a, "T") == 0) {
+            strcpy(f->gate_name, "S");
+            return RULE_MERGED;
+        }
+        return RULE_NONE;
+    }
+    int rotation = strcasecmp(a, "RX") == 0 || strcasecmp(a, "RY") == 0 || strcasecmp(a, "RZ") == 0;
+    if ((rotation || strcasecmp(a, "CPHASE") == 0) && add_angles(f, g)) {
+        // A full turn of a rotation is -I (a global phase); CPHASE has period 2 pi
+        return angle_is_identity(f, TWO_PI) ? RULE_CANCEL : RULE_MERGED;
+    }
+    return RULE_NONE;
+}
+
+/**
+ * \brief Tries to cancel or merge instruction j with an earlier partner.
+ * \return 1 if the list changed
+ */
+static int optimize_at(WireView* w, size_t j) {
+    Instruction* g = &w->list->data[j];
+    if (g->cond_reg != 0) return 0;
+
+    size_t partner = NONE;
+    if (g->type == INSTR_GATE_SINGLE && g->qubit_count == 1) {
+        partner = walk_back(w, j, g->qubits[0], g, same_single_qubit, NONE);
+    } else if (is_cnot(g) || is_cphase(g)) {
+        if (g->qubits[0] == g->qubits[1]) return 0;
+        partner = walk_back(w, j, g->qubits[0], g, same_two_qubit, NONE);
+        // The partner must also be reachable along the second wire
+        if (partner != NONE && walk_back(w, j, g->qubits[1], g, same_two_qubit, partner) != partner) {
+            partner = NONE;
+        }
+    }
+    if (partner == NONE) return 0;
+
+    switch (combine(&w->list->data[partner], g)) {
+        case RULE_CANCEL:
+            w->removed[partner] = 1;
+            w->removed[j] = 1;
+            return 1;
+        case RULE_MERGED:
+            w->removed[j] = 1;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * \brief One forward pass over the wire view.
+ * \return Number of instructions removed
+ */
+static size_t optimizer_pass(WireView* w) {
+    InstructionList* list = w->list;
+    size_t removed_before = 0, removed_after = 0;
+    for (size_t i = 0; i < list->size; i++) removed_before += w->removed[i];
+    for (size_t q = 0; q < w->num_qubits; q++) w->last[q] = NONE;
+
+    for (size_t j = 0; j < list->size; j++) {
+        if (w->removed[j]) continue;
+        Instruction* instr = &list->data[j];
+        if (is_block_marker(instr)) {
+            // Loop bodies and calls are barriers on every wire
+            for (size_t q = 0; q < w->num_qubits; q++) w->last[q] = NONE;
+            continue;
+        }
+        for (size_t s = 0; s < 2; s++) {
+            w->prev[2 * j + s] = (s < instr->qubit_count) ? w->last[instr->qubits[s]] : NONE;
+        }
+        if (optimize_at(w, j)) continue; // j is gone
+        for (size_t s = 0; s < instr->qubit_count; s++) w->last[instr->qubits[s]] = j;
+    }
+
+    for (size_t i = 0; i < list->size; i++) removed_after += w->removed[i];
+    return removed_after - removed_before;
+}
+
+/**
+ * \brief Fingerprint of a parity (XOR of path variables): each variable gets two random
+ *        64-bit words and a parity is the XOR of its variables' words, so CNOT is one XOR.
+ */
+typedef struct {
+    uint64_t lo, hi;
+} Parity;
+
+static uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static Parity fresh_variable(uint64_t* state) {
+    Parity p;
+    p.lo = splitmix64(state);
+    p.hi = splitmix64(state);
+    return p;
+}
 
 /**
- * \brief We'll store short sequences for single-qubit gates that produce Identity:
- *        - X then X => Identity
- *        - Y then Y => Identity
- *        - Z then Z => Identity
- *        - H then H => Identity
- *        - S then S then S then S => Identity
- *        - T repeated 8 times => Identity
- *
- * For demonstration, we'll only handle a few simple pairs.
- */
-static int gates_cancel_out(const char* g1, const char* g2) {
-    // Return 1 if g1 followed by g2 => identity for the same qubit.
-    if (!g1 || !g2) return 0;
-    if (strcasecmp(g1, "X") == 0 && strcasecmp(g2, "X") == 0) return 1;
-    if (strcasecmp(g1, "Y") == 0 && strcasecmp(g2, "Y") == 0) return 1;
-    if (strcasecmp(g1, "Z") == 0 && strcasecmp(g2, "Z") == 0) return 1;
-    if (strcasecmp(g1, "H") == 0 && strcasecmp(g2, "H") == 0) return 1;
+ * \brief All phase gates applied to one parity. The merged phase is emitted at the first
+ *        occurrence, where that parity is known to sit on a wire.
+ */
+typedef struct {
+    Parity parity;
+    double angle;   /**< Accumulated phase on the parity, radians */
+    size_t first;   /**< Instruction index of the first occurrence */
+    size_t count;   /**< Occurrences */
+    int    flipped; /**< The wire held parity XOR 1 at the first occurrence */
+} PhaseTerm;
 
+/**
+ * \brief Phase (up to a global phase) that an unconditional Z/S/T/constant RZ applies to |1>.
+ * \return 1 for a foldable phase gate, 0 otherwise
+ */
+static int phase_angle(const Instruction* instr, double* angle) {
+    if (instr->type != INSTR_GATE_SINGLE || instr->qubit_count != 1 || instr->cond_reg != 0 ||
+        instr->has_matrix) {
+        return 0;
+    }
+    const char* g = instr->gate_name;
+    if (instr->param_count == 0) {
+        if (strcasecmp(g, "Z") == 0) *angle = 4 * QUARTER_PI;
+        else if (strcasecmp(g, "S") == 0) *angle = 2 * QUARTER_PI;
+        else if (strcasecmp(g, "T") == 0) *angle = QUARTER_PI;
+        else return 0;
+        return 1;
+    }
+    if (strcasecmp(g, "RZ") == 0 && instr->param_count == 1 && instr->param_ids[0] < 0) {
+        *angle = instr->params[0]; // diag(e^{-i a/2}, e^{i a/2}) = e^{-i a/2} diag(1, e^{i a})
+        return 1;
+    }
     return 0;
 }
 
-int optimize_circuit(InstructionList* instructions) {
-    if (!instructions) return -1;
+/**
+ * \brief Is the gate diagonal, i.e. does it leave every computational basis value alone?
+ */
+static int is_diagonal_gate(const Instruction* instr) {
+    if (instr->type == INSTR_MEASURE) return 1; // the measured value stays on the wire
+    if (instr->has_matrix) {
+        const float* m = instr->matrix;
+        return m[2] == 0.0f && m[3] == 0.0f && m[4] == 0.0f && m[5] == 0.0f;
+    }
+    if (instr->type == INSTR_GATE_SINGLE) return single_qubit_kind(instr) == KIND_DIAGONAL;
+    return is_cphase(instr);
+}
 
-    // We'll do a single pass, merging or removing consecutive gates that form an identity.
-    // A more advanced approach would do multiple passes until no more changes can be applied.
-    size_t write_idx = 0;
-    for (size_t read_idx = 0; read_idx < instructions->size; read_idx++) {
-        Instruction* current = &instructions->data[read_idx];
-
-        if (current->type == INSTR_GATE_SINGLE && read_idx + 1 < instructions->size) {
-            Instruction* next = &instructions->data[read_idx + 1];
-            // If next is also single-qubit gate on the same qubit
-            if (next->type == INSTR_GATE_SINGLE && 
-                current->qubits[0] == next->qubits[0]) {
-
-                // Check if g1 + g2 => Identity
-                if (gates_cancel_out(current->gate_name, next->gate_name)) {
-                    // Skip both instructions => remove them
-                    read_idx++; // consume the next one as well
-                    continue;
-                }
+static size_t find_term(const PhaseTerm* terms, const size_t* table, size_t mask, Parity p, size_t* slot) {
+    size_t h = (size_t)(p.lo ^ (p.hi >> 7)) & mask;
+    while (table[h] != NONE) {
+        const PhaseTerm* t = &terms[table[h]];
+        if (t->parity.lo == p.lo && t->parity.hi == p.hi) break;
+        h = (h + 1) & mask;
+    }
+    *slot = h;
+    return table[h];
+}
+
+/**
+ * \brief Rewrites the first occurrence of a term as the merged phase gate.
+ * \return 1 if the term vanished (a multiple of 2 pi)
+ */
+static int emit_merged_phase(Instruction* instr, const PhaseTerm* t) {
+    double angle = fmod(t->flipped ? -t->angle : t->angle, TWO_PI);
+    if (angle < 0) angle += TWO_PI;
+    double k = floor(angle / QUARTER_PI + 0.5);
+    instr->param_count = 0;
+    if (fabs(angle - k * QUARTER_PI) < 1e-6) {
+        switch ((int)k % 8) {
+            case 0: return 1;
+            case 1: strcpy(instr->gate_name, "T"); return 0;
+            case 2: strcpy(instr->gate_name, "S"); return 0;
+            case 4: strcpy(instr->gate_name, "Z"); return 0;
+            default: break;
+        }
+    }
+    strcpy(instr->gate_name, "RZ");
+    instr->param_count = 1;
+    instr->params[0] = (float)angle;
+    instr->param_ids[0] = -1;
+    return 0;
+}
+
+/**
+ * \brief Phase folding: tracks the parity each wire holds through CNOT and X (any other
+ *        non-diagonal gate starts a fresh variable on its wires; block markers reset all
+ *        wires) and merges phase gates that act on the same parity, wherever they are:
+ *        "T 1; CNOT 0 1; CNOT 0 1; T 1" or "CNOT 0 1; T 1; H 2; CNOT 0 1; CNOT 1 0; T 0"
+ *        each keep one S. Merged phases sum exactly (T.T = S, S.S = Z, Z.Z = I).
+ * \return Number of gates removed, or SIZE_MAX on allocation failure
+ */
+static size_t fold_phases(InstructionList* list, uint8_t* removed, size_t num_qubits) {
+    size_t candidates = 0;
+    double angle;
+    for (size_t i = 0; i < list->size; i++) candidates += phase_angle(&list->data[i], &angle);
+    if (candidates < 2) return 0;
+
+    size_t buckets = 4;
+    while (buckets < 2 * candidates) buckets <<= 1;
+    Parity* wire = (Parity*)malloc((num_qubits ? num_qubits : 1) * sizeof(Parity));
+    uint8_t* flip = (uint8_t*)calloc(num_qubits ? num_qubits : 1, 1);
+    PhaseTerm* terms = (PhaseTerm*)malloc(candidates * sizeof(PhaseTerm));
+    size_t* table = (size_t*)malloc(buckets * sizeof(size_t));
+    size_t* term_of = (size_t*)malloc(list->size * sizeof(size_t));
+    if (!wire || !flip || !terms || !table || !term_of) {
+        free(wire);
+        free(flip);
+        free(terms);
+        free(table);
+        free(term_of);
+        return SIZE_MAX;
+    }
+    uint64_t seed = 0x5eed;
+    for (size_t q = 0; q < num_qubits; q++) wire[q] = fresh_variable(&seed);
+    for (size_t b = 0; b < buckets; b++) table[b] = NONE;
+
+    size_t num_terms = 0;
+    for (size_t i = 0; i < list->size; i++) {
+        term_of[i] = NONE;
+        if (removed[i]) continue;
+        const Instruction* instr = &list->data[i];
+        if (is_block_marker(instr)) {
+            // A block body runs zero or many times: nothing folds across its boundaries
+            for (size_t q = 0; q < num_qubits; q++) wire[q] = fresh_variable(&seed);
+            continue;
+        }
+        if (phase_angle(instr, &angle)) {
+            size_t q = instr->qubits[0];
+            size_t slot;
+            size_t t = find_term(terms, table, buckets - 1, wire[q], &slot);
+            if (t == NONE) {
+                t = num_terms++;
+                table[slot] = t;
+                terms[t].parity = wire[q];
+                terms[t].angle = 0.0;
+                terms[t].first = i;
+                terms[t].count = 0;
+                terms[t].flipped = flip[q];
+            }
+            // A phase on (parity XOR 1) is the opposite phase on the parity, up to a global phase
+            terms[t].angle += flip[q] ? -angle : angle;
+            terms[t].count++;
+            term_of[i] = t;
+            continue;
+        }
+        if (is_cnot(instr) && instr->cond_reg == 0 && instr->qubits[0] != instr->qubits[1]) {
+            size_t c = instr->qubits[0], tq = instr->qubits[1];
+            wire[tq].lo ^= wire[c].lo;
+            wire[tq].hi ^= wire[c].hi;
+            flip[tq] ^= flip[c];
+        } else if (instr->type == INSTR_GATE_SINGLE && instr->cond_reg == 0 && !instr->has_matrix &&
+                   instr->param_count == 0 && strcasecmp(instr->gate_name, "X") == 0) {
+            flip[instr->qubits[0]] ^= 1;
+        } else if (!is_diagonal_gate(instr)) {
+            // Guarded gates count here too: afterwards the wire holds one of two values
+            size_t first = (is_cnot(instr) && instr->qubit_count == 2) ? 1 : 0; // CNOT keeps its control
+            for (size_t s = first; s < instr->qubit_count && s < 2; s++) {
+                wire[instr->qubits[s]] = fresh_variable(&seed);
+                flip[instr->qubits[s]] = 0;
+            }
+        }
+    }
+
+    size_t folded = 0;
+    for (size_t i = 0; i < list->size; i++) {
+        size_t t = term_of[i];
+        if (t == NONE || terms[t].count < 2) continue;
+        if (terms[t].first == i) {
+            if (emit_merged_phase(&list->data[i], &terms[t])) {
+                removed[i] = 1;
+                folded++;
+            }
+        } else {
+            removed[i] = 1;
+            folded++;
+        }
+    }
+    free(wire);
+    free(flip);
+    free(terms);
+    free(table);
+    free(term_of);
+    return folded;
+}
+
+/**
+ * \brief Loads the matrix of an unconditional single-qubit gate with constant angles.
+ * \return 1 if the gate can be fused, 0 otherwise
+ */
+static int fusable_matrix(const Instruction* instr, double* m) {
+    if (instr->type != INSTR_GATE_SINGLE || instr->qubit_count != 1 || instr->cond_reg != 0) return 0;
+    float built[8];
+    const float* src;
+    if (instr->has_matrix) {
+        src = instr->matrix;
+    } else if (instr->param_count > 0) {
+        float angles[MAX_GATE_PARAMS];
+        for (size_t k = 0; k < instr->param_count; k++) {
+            if (instr->param_ids[k] >= 0) return 0; // rebound later, so it must stay separate
+            angles[k] = instr->params[k];
+        }
+        if (parameterized_gate_matrix(instr->gate_name, angles, built) != 0) return 0;
+        src = built;
+    } else {
+        src = find_single_qubit_gate(instr->gate_name);
+        if (!src) return 0;
+    }
+    for (size_t k = 0; k < 8; k++) m[k] = src[k];
+    return 1;
+}
+
+/**
+ * \brief out = b * a for 2x2 complex matrices in apply_single_qubit_gate layout.
+ */
+static void multiply_2x2(const double* b, const double* a, double* out) {
+    double r[8];
+    for (size_t row = 0; row < 2; row++) {
+        for (size_t col = 0; col < 2; col++) {
+            const double* b0 = &b[row * 4];
+            const double* b1 = &b[row * 4 + 2];
+            const double* a0 = &a[col * 2];
+            const double* a1 = &a[4 + col * 2];
+            r[row * 4 + col * 2]     = b0[0] * a0[0] - b0[1] * a0[1] + b1[0] * a1[0] - b1[1] * a1[1];
+            r[row * 4 + col * 2 + 1] = b0[0] * a0[1] + b0[1] * a0[0] + b1[0] * a1[1] + b1[1] * a1[0];
+        }
+    }
+    memcpy(out, r, sizeof(r));
+}
+
+/**
+ * \brief Is m a global phase times the identity (within FUSION_TOLERANCE)?
+ */
+static int is_identity_up_to_phase(const double* m) {
+    return fabs(m[2]) < FUSION_TOLERANCE && fabs(m[3]) < FUSION_TOLERANCE &&
+           fabs(m[4]) < FUSION_TOLERANCE && fabs(m[5]) < FUSION_TOLERANCE &&
+           fabs(m[0] - m[6]) < FUSION_TOLERANCE && fabs(m[1] - m[7]) < FUSION_TOLERANCE &&
+           fabs(m[0] * m[0] + m[1] * m[1] - 1.0) < FUSION_TOLERANCE;
+}
+
+/**
+ * \brief Per-qubit run of fusable gates: the first gate of the run receives the product.
+ */
+typedef struct {
+    size_t head;   /**< Index of the run's first gate, NONE if no run is open */
+    size_t length;
+    double product[8];
+} FusionRun;
+
+static void close_run(InstructionList* list, uint8_t* removed, FusionRun* run, size_t* fused) {
+    if (run->head == NONE) return;
+    Instruction* head = &list->data[run->head];
+    if (is_identity_up_to_phase(run->product)) {
+        removed[run->head] = 1;
+        *fused += run->length;
+    } else if (run->length > 1) {
+        head->type = INSTR_GATE_SINGLE;
+        snprintf(head->gate_name, sizeof(head->gate_name), "FUSED");
+        head->param_count = 0;
+        head->has_matrix = 1;
+        for (size_t k = 0; k < 8; k++) head->matrix[k] = (float)run->product[k];
+        *fused += run->length - 1;
+    }
+    run->head = NONE;
+}
+
+/**
+ * \brief Multiplies every maximal run of single-qubit gates on a qubit (gates on other
+ *        qubits may interleave) into one FUSED gate, so the run costs one sweep of the
+ *        state instead of one per gate. Runs whose product is the identity up to a global
+ *        phase are dropped. Symbolic and IF-guarded gates end a run, as do block markers.
+ * \return Number of gates that disappeared, or SIZE_MAX on allocation failure
+ */
+static size_t fuse_single_qubit_runs(InstructionList* list, uint8_t* removed, size_t num_qubits) {
+    FusionRun* runs = (FusionRun*)malloc((num_qubits ? num_qubits : 1) * sizeof(FusionRun));
+    if (!runs) return SIZE_MAX;
+    for (size_t q = 0; q < num_qubits; q++) runs[q].head = NONE;
+
+    size_t fused = 0;
+    for (size_t j = 0; j < list->size; j++) {
+        if (removed[j]) continue;
+        Instruction* instr = &list->data[j];
+        if (is_block_marker(instr)) {
+            for (size_t q = 0; q < num_qubits; q++) close_run(list, removed, &runs[q], &fused);
+            continue;
+        }
+        double m[8];
+        if (!fusable_matrix(instr, m)) {
+            for (size_t s = 0; s < instr->qubit_count && s < 2; s++) {
+                close_run(list, removed, &runs[instr->qubits[s]], &fused);
+            }
+            continue;
+        }
+        FusionRun* run = &runs[instr->qubits[0]];
+        if (run->head == NONE) {
+            run->head = j;
+            run->length = 1;
+            memcpy(run->product, m, sizeof(m));
+        } else {
+            multiply_2x2(m, run->product, run->product);
+            run->length++;
+            removed[j] = 1;
+        }
+    }
+    for (size_t q = 0; q < num_qubits; q++) close_run(list, removed, &runs[q], &fused);
+    free(runs);
+    return fused;
+}
+
+/**
+ * \brief Is the gate X times a diagonal gate, i.e. a bit flip up to phases?
+ */
+static int is_flip_gate(const Instruction* instr) {
+    if (instr->has_matrix) {
+        const float* m = instr->matrix;
+        return m[0] == 0.0f && m[1] == 0.0f && m[6] == 0.0f && m[7] == 0.0f;
+    }
+    return instr->param_count == 0 &&
+           (strcasecmp(instr->gate_name, "X") == 0 || strcasecmp(instr->gate_name, "Y") == 0);
+}
+
+#define WIRE_USED 1u  /**< Something later touches the qubit */
+#define WIRE_LIVE 2u  /**< A later measurement depends on the qubit */
+#define WIRE_LAST 4u  /**< The next operation, a MEASURE, is the last one on the qubit */
+
+/**
+ * \brief Backward scan behind eliminate_dead_gates: marks dead gates in 'removed' and
+ *        flips the readout of measurements that absorb an X.
+ * \return 0 on success, -3 on allocation failure
+ */
+static int drop_dead_gates(InstructionList* list, uint8_t* removed, size_t num_qubits, int measured_only,
+                           DeadGateStats* stats) {
+    size_t* next_measure = (size_t*)malloc((num_qubits + 1) * sizeof(size_t));
+    uint8_t* wire = (uint8_t*)calloc(num_qubits + 1, 1);
+    if (!next_measure || !wire) {
+        free(next_measure);
+        free(wire);
+        return -3;
+    }
+    for (size_t q = 0; q < num_qubits; q++) next_measure[q] = NONE;
+
+    // Without measurements the final state is the result: keep it
+    int measured = 0;
+    for (size_t i = 0; i < list->size && !measured; i++) {
+        measured = !removed[i] && list->data[i].type == INSTR_MEASURE;
+    }
+    measured_only &= measured;
+
+    CostModel model;
+    init_cost_model(&model, ENGINE_DENSE, num_qubits);
+    for (size_t i = list->size; i-- > 0;) {
+        if (removed[i]) continue;
+        Instruction* instr = &list->data[i];
+        if (is_block_marker(instr)) {
+            for (size_t q = 0; q < num_qubits; q++) {
+                next_measure[q] = NONE;
+                wire[q] = WIRE_USED | WIRE_LIVE;
             }
+            continue;
         }
-        // If we get here, we keep the instruction.
-        if (write_idx != read_idx) {
-            instructions->data[write_idx] = *current; // copy
+        if (instr->type == INSTR_MEASURE) {
+            size_t q = instr->qubits[0];
+            next_measure[q] = instr->cond_reg ? NONE : i;
+            wire[q] = ((wire[q] & WIRE_USED) ? 0 : WIRE_LAST) | WIRE_USED | WIRE_LIVE;
+            continue;
         }
+
+        // Gates under an IF are kept (they only block the gates behind them)
+        size_t* counter = NULL;
+        int gate = (instr->type == INSTR_GATE_SINGLE || instr->type == INSTR_GATE_MULTI) && instr->cond_reg == 0;
+        if (gate && instr->type == INSTR_GATE_SINGLE && instr->qubit_count == 1 &&
+            next_measure[instr->qubits[0]] != NONE) {
+            size_t q = instr->qubits[0];
+            if (is_diagonal_gate(instr)) {
+                counter = &stats->diagonal;
+            } else if (measured_only && (wire[q] & WIRE_LAST) && is_flip_gate(instr)) {
+                list->data[next_measure[q]].invert_result ^= 1;
+                counter = &stats->flips;
+            }
+        }
+        if (gate && !counter && measured_only) {
+            int live = 0;
+            for (size_t s = 0; s < instr->qubit_count && s < 2; s++) live |= wire[instr->qubits[s]] & WIRE_LIVE;
+            if (!live) counter = &stats->unmeasured;
+        }
+        if (counter) {
+            CircuitCost cost;
+            memset(&cost, 0, sizeof(cost));
+            instruction_cost(&model, instr, &cost);
+            stats->sweeps_saved += cost.passes;
+            (*counter)++;
+            removed[i] = 1;
+            continue;
+        }
+        for (size_t s = 0; s < instr->qubit_count && s < 2; s++) {
+            next_measure[instr->qubits[s]] = NONE;
+            wire[instr->qubits[s]] = WIRE_USED | WIRE_LIVE;
+        }
+    }
+    free(next_measure);
+    free(wire);
+    return 0;
+}
+
+/**
+ * \brief Drops the removed instructions and relinks the block markers (a marker is never
+ *        removed, so the structure is unchanged).
+ */
+static int compact_instructions(InstructionList* list, const uint8_t* removed) {
+    size_t write_idx = 0;
+    for (size_t read_idx = 0; read_idx < list->size; read_idx++) {
+        if (removed[read_idx]) continue;
+        if (write_idx != read_idx) list->data[write_idx] = list->data[read_idx];
         write_idx++;
     }
+    list->size = write_idx;
+    return link_blocks(list) != 0 ? -2 : 0;
+}
+
+static size_t count_gates(const InstructionList* list, const uint8_t* removed) {
+    size_t n = 0;
+    for (size_t i = 0; i < list->size; i++) {
+        if (!removed[i] && !is_block_marker(&list->data[i])) n++;
+    }
+    return n;
+}
+
+int optimize_circuit_with_stats(InstructionList* instructions, OptimizerStats* stats) {
+    if (!instructions) return -1;
+
+    OptimizerStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+
+    WireView w;
+    w.list = instructions;
+    w.num_qubits = instruction_list_num_qubits(instructions);
+    w.prev = (size_t*)malloc((2 * instructions->size + 1) * sizeof(size_t));
+    w.last = (size_t*)malloc((w.num_qubits + 1) * sizeof(size_t));
+    w.removed = (uint8_t*)calloc(instructions->size + 1, 1);
+    if (!w.prev || !w.last || !w.removed) {
+        free(w.prev);
+        free(w.last);
+        free(w.removed);
+        return -3;
+    }
+
+    CostModel model;
+    CircuitCost cost;
+    init_cost_model(&model, ENGINE_DENSE, w.num_qubits);
+    if (estimate_circuit_cost(&model, instructions, &cost) == 0) stats->seconds_before = cost.seconds;
+    stats->gates_before = count_gates(instructions, w.removed);
+    size_t folded = fold_phases(instructions, w.removed, w.num_qubits);
+    if (folded == SIZE_MAX) {
+        free(w.prev);
+        free(w.last);
+        free(w.removed);
+        return -3;
+    }
+    stats->folded_phases = folded;
+    size_t gates = stats->gates_before - folded;
+    log_message(LOG_LEVEL_DEBUG, "Optimizer phase folding: %zu -> %zu gates.", stats->gates_before, gates);
 
-    // Now set the new size
-    instructions->size = write_idx;
+    // Each pass can expose new neighbors (e.g. S S S S -> Z Z -> nothing): run to a fixpoint
+    while (stats->passes < OPTIMIZER_MAX_PASSES) {
+        size_t removed = optimizer_pass(&w);
+        size_t after = count_gates(instructions, w.removed);
+        stats->pass_gates[stats->passes++] = after;
+        log_message(LOG_LEVEL_DEBUG, "Optimizer pass %zu: %zu -> %zu gates.", stats->passes, gates, after);
+        gates = after;
+        if (removed == 0) break;
+    }
+
+    DeadGateStats dead;
+    memset(&dead, 0, sizeof(dead));
+    if (drop_dead_gates(instructions, w.removed, w.num_qubits, 0, &dead) != 0) {
+        free(w.prev);
+        free(w.last);
+        free(w.removed);
+        return -3;
+    }
+    stats->dead_gates = dead.diagonal;
 
-    // Additional passes or advanced merges can be done here.
+    size_t fused = fuse_single_qubit_runs(instructions, w.removed, w.num_qubits);
+    if (fused == SIZE_MAX) {
+        free(w.prev);
+        free(w.last);
+        free(w.removed);
+        return -3;
+    }
+    stats->fused_gates = fused;
+    stats->gates_after = count_gates(instructions, w.removed);
+    log_message(LOG_LEVEL_DEBUG, "Optimizer fusion: %zu -> %zu gates (%zu dropped before measurements).",
+                gates - dead.diagonal, stats->gates_after, dead.diagonal);
+
+    int rc = compact_instructions(instructions, w.removed);
+    free(w.prev);
+    free(w.last);
+    free(w.removed);
+    if (rc != 0) return rc;
+    if (estimate_circuit_cost(&model, instructions, &cost) == 0) stats->seconds_after = cost.seconds;
+    log_message(LOG_LEVEL_DEBUG, "Optimizer predicted dense time: %.6g -> %.6g s.",
+                stats->seconds_before, stats->seconds_after);
     return 0;
 }
+
+int optimize_circuit(InstructionList* instructions) {
+    return optimize_circuit_with_stats(instructions, NULL);
+}
+
+int eliminate_dead_gates(InstructionList* instructions, int measured_only, DeadGateStats* stats) {
+    if (!instructions) return -1;
+    DeadGateStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+
+    uint8_t* removed = (uint8_t*)calloc(instructions->size + 1, 1);
+    if (!removed) return -3;
+    int rc = drop_dead_gates(instructions, removed, instruction_list_num_qubits(instructions),
+                             measured_only, stats);
+    if (rc == 0) rc = compact_instructions(instructions, removed);
+    free(removed);
+    log_message(LOG_LEVEL_DEBUG, "Dead gates: %zu diagonal, %zu folded flips, %zu unmeasured (%.2f sweeps saved).",
+                stats->diagonal, stats->flips, stats->unmeasured, stats->sweeps_saved);
+    return rc;
+}
+
+int reduce_to_light_cone(InstructionList* instructions, size_t* qubit_map, LightConeStats* stats) {
+    if (!instructions) return -1;
+    LightConeStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+
+    size_t num_qubits = instruction_list_num_qubits(instructions);
+    stats->qubits_before = stats->qubits_after = num_qubits;
+    size_t* map = qubit_map ? qubit_map : (size_t*)malloc((num_qubits + 1) * sizeof(size_t));
+    if (!map) return -3;
+    for (size_t q = 0; q < num_qubits; q++) map[q] = q;
+
+    int measured = 0;
+    for (size_t i = 0; i < instructions->size && !measured; i++) {
+        measured = instructions->data[i].type == INSTR_MEASURE;
+    }
+    int rc = measured ? eliminate_dead_gates(instructions, 1, &stats->dead) : 0;
+    if (rc == 0 && measured) {
+        // Qubits nothing touches any more stay |0> and never influence a measurement
+        for (size_t q = 0; q < num_qubits; q++) map[q] = NONE;
+        for (size_t i = 0; i < instructions->size; i++) {
+            const Instruction* instr = &instructions->data[i];
+            for (size_t s = 0; s < instr->qubit_count && s < 2; s++) map[instr->qubits[s]] = 0;
+        }
+        size_t next = 0;
+        for (size_t q = 0; q < num_qubits; q++) {
+            if (map[q] != NONE) map[q] = next++;
+        }
+        for (size_t i = 0; i < instructions->size; i++) {
+            Instruction* instr = &instructions->data[i];
+            for (size_t s = 0; s < instr->qubit_count && s < 2; s++) instr->qubits[s] = map[instr->qubits[s]];
+        }
+        stats->qubits_after = next;
+        log_message(LOG_LEVEL_DEBUG, "Light cone: %zu -> %zu qubits, %zu gates removed.", num_qubits, next,
+                    stats->dead.diagonal + stats->dead.flips + stats->dead.unmeasured);
+    }
+    if (!qubit_map) free(map);
+    return rc;
+}
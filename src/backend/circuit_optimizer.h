@@ -5,20 +5,132 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include "../assembly/parser.h"  // for InstructionList, etc.
 
+/**
+ * \brief Bumped whenever optimize_circuit can produce different output for the same input,
+ *        so compiled-circuit caches keyed on it are invalidated.
+ */
+#define CIRCUIT_OPTIMIZER_VERSION 5
+
+/**
+ * \brief Most passes optimize_circuit runs before giving up on reaching a fixpoint.
+ */
+#define OPTIMIZER_MAX_PASSES 16
+
+/**
+ * \brief How many gates on a wire a candidate may be moved back across.
+ */
+#define OPTIMIZER_WINDOW 128
+
+/**
+ * \brief A fused run whose product is within this of a global phase times the identity is dropped.
+ */
+#define FUSION_TOLERANCE 1e-5
+
+/**
+ * \brief Gate counts collected by optimize_circuit_with_stats (block markers not counted).
+ */
+typedef struct OptimizerStats {
+    size_t passes;                           /**< Passes run, including the final no-change pass */
+    size_t gates_before;                     /**< Gates before the first pass */
+    size_t gates_after;                      /**< Gates after the last pass and fusion */
+    size_t pass_gates[OPTIMIZER_MAX_PASSES]; /**< Gates after each pass */
+    size_t folded_phases;                    /**< Phase gates removed by phase folding */
+    size_t fused_gates;                      /**< Gates absorbed by single-qubit fusion */
+    size_t dead_gates;                       /**< Diagonal gates dropped right before a measurement */
+    double seconds_before;                   /**< Predicted dense run time of the input (cost model) */
+    double seconds_after;                    /**< Predicted dense run time of the output */
+} OptimizerStats;
+
+/**
+ * \brief What eliminate_dead_gates removed.
+ */
+typedef struct DeadGateStats {
+    size_t diagonal;     /**< Z/S/T/RZ (or diagonal fused) gates right before a measurement */
+    size_t flips;        /**< X/Y (or anti-diagonal fused) gates folded into a measurement's readout */
+    size_t unmeasured;   /**< Gates no later measurement depends on */
+    double sweeps_saved; /**< State sweeps the removed gates would have cost (cost model passes) */
+} DeadGateStats;
+
 /**
  * \brief Analyzes the InstructionList, simplifying redundant or consecutive gates.
  * \param instructions Pointer to an InstructionList to optimize
  * \return 0 on success, nonzero on error
  *
- * Typical optimizations might include:
- *  - Merging consecutive single-qubit gates on the same qubit (e.g., X followed by X => Identity)
- *  - Removing no-op gates
- *  - Combining adjacent Z, Z => Identity, etc.
+ * Phase folding runs first: the parity of path variables each wire holds is tracked through
+ * CNOT and X, and Z/S/T/RZ gates acting on the same parity are merged into one phase gate at
+ * the first of them, however far apart they are ("CNOT 0 1; T 1; CNOT 0 1; CNOT 0 1; T 1"
+ * keeps a single S). Results may differ from the input by a global phase.
+ * Peephole passes then run to a fixpoint over a per-qubit wire view of the circuit, so a gate meets its
+ * partner across gates on other qubits and across gates it commutes with (diagonal gates
+ * through CNOT controls and CPHASE, X/RX through CNOT targets):
+ *  - Self-inverse pairs (X, Y, Z, H, CNOT) cancel, e.g. "X 0; H 1; X 0" => "H 1"
+ *  - S.S => Z, T.T => S
+ *  - RX/RY/RZ/CPHASE on the same qubits add their angles (constants, or the same symbol);
+ *    a full turn is removed
+ * Finally every maximal run of constant single-qubit gates on a qubit is multiplied into one
+ * "FUSED" gate carrying an explicit matrix ("H 0; T 0; H 0; S 0" costs one sweep of the
+ * state instead of four); a run equal to the identity up to a global phase is removed.
+ * Before fusion, diagonal gates directly in front of a measurement of their qubit are dropped
+ * (eliminate_dead_gates with measured_only = 0).
+ * Gates under an IF are never removed, and REPEAT/DEF blocks are barriers.
  */
 int optimize_circuit(InstructionList* instructions);
 
+/**
+ * \brief optimize_circuit, reporting the gate count before and after each pass
+ *        (also logged at debug level).
+ * \param instructions Pointer to an InstructionList to optimize
+ * \param stats Optional output counters
+ * \return 0 on success, nonzero on error
+ */
+int optimize_circuit_with_stats(InstructionList* instructions, OptimizerStats* stats);
+
+/**
+ * \brief Removes gates that cannot change any measurement outcome.
+ *        Always: Z/S/T/RZ (and diagonal fused) gates whose next operation on their qubit is an
+ *        unconditional MEASURE of it. After the collapse they only add a global phase, so the
+ *        final state is unchanged up to that phase.
+ *        With measured_only, the final state is no longer kept, only the outcome statistics:
+ *         - gates that no later measurement depends on (nothing measured afterwards on their
+ *           qubits, or on qubits they are later coupled to) are removed;
+ *         - an unconditional X or Y (or anti-diagonal fused gate) directly before the last
+ *           operation on its qubit, a MEASURE, is removed and the measurement inverts its result.
+ *        measured_only is ignored for circuits without any measurement, whose final state is
+ *        their only output. REPEAT/DEF blocks and calls are barriers: the analysis restarts
+ *        below them with every qubit assumed measured later.
+ * \param instructions Pointer to an InstructionList to prune
+ * \param measured_only Nonzero to keep only the measurement statistics
+ * \param stats Optional output counters
+ * \return 0 on success, nonzero on error
+ */
+int eliminate_dead_gates(InstructionList* instructions, int measured_only, DeadGateStats* stats);
+
+/**
+ * \brief What reduce_to_light_cone kept.
+ */
+typedef struct LightConeStats {
+    size_t        qubits_before; /**< Register size of the input */
+    size_t        qubits_after;  /**< Register size after renumbering */
+    DeadGateStats dead;          /**< Gates removed outside the cone */
+} LightConeStats;
+
+/**
+ * \brief Restricts a circuit to the backward light cone of its measurements: runs
+ *        eliminate_dead_gates in measured-only mode, then renumbers the qubits that are still
+ *        used to 0..k-1 (in their original order), so the state vector shrinks by 2^(n-k).
+ *        Measurements keep printing their original qubit index (Instruction.source_qubit).
+ *        Circuits without measurements are returned unchanged.
+ * \param instructions Pointer to an InstructionList to reduce
+ * \param qubit_map Optional array of qubits_before entries: new index of each original
+ *                  qubit, or SIZE_MAX if it was dropped
+ * \param stats Optional output counters
+ * \return 0 on success, nonzero on error
+ */
+int reduce_to_light_cone(InstructionList* instructions, size_t* qubit_map, LightConeStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
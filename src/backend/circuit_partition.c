@@ -0,0 +1,158 @@
+#include "circuit_partition.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define UNUSED_QUBIT SIZE_MAX
+
+static size_t find_root(size_t* parent, size_t x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]]; // path halving
+        x = parent[x];
+    }
+    return x;
+}
+
+static void unite(size_t* parent, size_t a, size_t b) {
+    a = find_root(parent, a);
+    b = find_root(parent, b);
+    // The lower index becomes the root, so roots are stable under renumbering order
+    if (a < b) parent[b] = a;
+    else if (b < a) parent[a] = b;
+}
+
+/**
+ * \brief Joins every qubit a DEF body (and the subcircuits it calls) touches with 'node'.
+ */
+static void unite_body(const InstructionList* list, size_t* parent, size_t def, size_t node, size_t depth) {
+    if (depth > MAX_BLOCK_DEPTH) return;
+    for (size_t i = def + 1; i < list->data[def].link && i < list->size; i++) {
+        const Instruction* instr = &list->data[i];
+        if (instr->type == INSTR_CALL) {
+            unite_body(list, parent, instr->link, node, depth + 1);
+            continue;
+        }
+        for (size_t s = 0; s < instr->qubit_count && s < 2; s++) unite(parent, instr->qubits[s], node);
+    }
+}
+
+int partition_circuit(const InstructionList* instructions, size_t num_qubits, CircuitPartition* partition) {
+    if (!instructions || !partition) return -1;
+    memset(partition, 0, sizeof(*partition));
+    size_t used = instruction_list_num_qubits(instructions);
+    if (num_qubits < used) num_qubits = used;
+    partition->num_qubits = num_qubits;
+
+    // Nodes: one per qubit, then one per classical register
+    size_t nodes = num_qubits + instructions->num_cregs;
+    size_t* parent = (size_t*)malloc((nodes + 1) * sizeof(size_t));
+    uint8_t* read = (uint8_t*)calloc(instructions->num_cregs + 1, 1);
+    partition->component_of = (size_t*)malloc((num_qubits + 1) * sizeof(size_t));
+    partition->local_index = (size_t*)malloc((num_qubits + 1) * sizeof(size_t));
+    partition->component_qubits = (size_t*)calloc(num_qubits + 1, sizeof(size_t));
+    if (!parent || !read || !partition->component_of || !partition->local_index || !partition->component_qubits) {
+        free(parent);
+        free(read);
+        free_circuit_partition(partition);
+        return -2;
+    }
+    for (size_t n = 0; n < nodes; n++) parent[n] = n;
+    for (size_t q = 0; q < num_qubits; q++) partition->component_of[q] = UNUSED_QUBIT;
+
+    // A register only couples its writers to its readers if some IF reads it
+    for (size_t i = 0; i < instructions->size; i++) {
+        if (instructions->data[i].cond_reg) read[instructions->data[i].cond_reg - 1] = 1;
+    }
+    for (size_t i = 0; i < instructions->size; i++) {
+        const Instruction* instr = &instructions->data[i];
+        size_t count = instr->qubit_count < 2 ? instr->qubit_count : 2;
+        for (size_t s = 0; s < count; s++) partition->component_of[instr->qubits[s]] = 0; // touched
+        if (count == 2) unite(parent, instr->qubits[0], instr->qubits[1]);
+        if (instr->type == INSTR_MEASURE && instr->target_reg && read[instr->target_reg - 1]) {
+            unite(parent, instr->qubits[0], num_qubits + instr->target_reg - 1u);
+        }
+        if (instr->cond_reg) {
+            size_t reg = num_qubits + instr->cond_reg - 1u;
+            if (instr->type == INSTR_CALL) {
+                unite_body(instructions, parent, instr->link, reg, 0);
+            } else {
+                for (size_t s = 0; s < count; s++) unite(parent, instr->qubits[s], reg);
+            }
+        }
+    }
+
+    // Number components by their lowest qubit; roots are the lowest node of each set
+    size_t* component_of_root = (size_t*)malloc((nodes + 1) * sizeof(size_t));
+    if (!component_of_root) {
+        free(parent);
+        free(read);
+        free_circuit_partition(partition);
+        return -2;
+    }
+    for (size_t n = 0; n < nodes; n++) component_of_root[n] = UNUSED_QUBIT;
+    for (size_t q = 0; q < num_qubits; q++) {
+        if (partition->component_of[q] == UNUSED_QUBIT) continue;
+        size_t root = find_root(parent, q);
+        if (component_of_root[root] == UNUSED_QUBIT) component_of_root[root] = partition->num_components++;
+        size_t c = component_of_root[root];
+        partition->component_of[q] = c;
+        partition->local_index[q] = partition->component_qubits[c]++;
+    }
+    free(component_of_root);
+    free(parent);
+    free(read);
+    return 0;
+}
+
+int extract_component(const InstructionList* instructions, const CircuitPartition* partition,
+                      size_t component, InstructionList* out) {
+    if (!instructions || !partition || !out || component >= partition->num_components) return -1;
+    if (init_instruction_list(out) != 0) return -2;
+
+    // Same parameter and register tables, so bindings and register indices carry over unchanged
+    for (size_t p = 0; p < instructions->num_params; p++) {
+        if (intern_parameter_name(out, instructions->param_names[p]) != (int)p) {
+            free_instruction_list(out);
+            return -2;
+        }
+    }
+    if (instructions->num_cregs > 0) {
+        out->cregs = (ClassicalRegister*)malloc(instructions->num_cregs * sizeof(ClassicalRegister));
+        if (!out->cregs) {
+            free_instruction_list(out);
+            return -2;
+        }
+        memcpy(out->cregs, instructions->cregs, instructions->num_cregs * sizeof(ClassicalRegister));
+        out->num_cregs = out->creg_capacity = instructions->num_cregs;
+    }
+
+    for (size_t i = 0; i < instructions->size; i++) {
+        Instruction instr = instructions->data[i];
+        if (!is_block_marker(&instr)) {
+            // Instructions without qubits (unknown gates) go to the first component only
+            size_t owner = instr.qubit_count ? partition->component_of[instr.qubits[0]] : 0;
+            if (owner != component) continue;
+            for (size_t s = 0; s < instr.qubit_count && s < 2; s++) {
+                instr.qubits[s] = partition->local_index[instr.qubits[s]];
+            }
+        }
+        if (append_instruction(out, &instr) != 0) {
+            free_instruction_list(out);
+            return -2;
+        }
+    }
+    if (link_blocks(out) != 0) {
+        free_instruction_list(out);
+        return -3;
+    }
+    return 0;
+}
+
+void free_circuit_partition(CircuitPartition* partition) {
+    if (!partition) return;
+    free(partition->component_of);
+    free(partition->local_index);
+    free(partition->component_qubits);
+    memset(partition, 0, sizeof(*partition));
+}
@@ -0,0 +1,59 @@
+#ifndef CIRCUIT_PARTITION_H
+#define CIRCUIT_PARTITION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "../assembly/parser.h"
+
+/**
+ * \brief Groups of qubits that never interact. Two qubits are in the same component if a
+ *        multi-qubit gate joins them, or if classical data flows between them (a measurement
+ *        into a register that an IF guarding the other reads). Qubits no instruction touches
+ *        belong to no component.
+ */
+typedef struct CircuitPartition {
+    size_t  num_qubits;       /**< Register size the partition was computed for */
+    size_t  num_components;
+    size_t* component_of;     /**< Per qubit: component index, or SIZE_MAX if unused */
+    size_t* local_index;      /**< Per qubit: index inside its component (original order kept) */
+    size_t* component_qubits; /**< Per component: number of qubits */
+} CircuitPartition;
+
+/**
+ * \brief Finds the independent qubit groups of a circuit (union-find over the operands of
+ *        multi-qubit gates and over classical registers). Components are numbered in order
+ *        of their lowest qubit.
+ * \param instructions Parsed instructions
+ * \param num_qubits Register size (0 => instruction_list_num_qubits)
+ * \param partition Output (release with free_circuit_partition)
+ * \return 0 on success, nonzero on error
+ */
+int partition_circuit(const InstructionList* instructions, size_t num_qubits, CircuitPartition* partition);
+
+/**
+ * \brief Builds the circuit of one component: its gates and measurements with qubits renumbered
+ *        to local_index, plus every block marker (so loops and calls keep their structure),
+ *        the parameter table and the classical registers. Measurements keep printing their
+ *        original qubit numbers.
+ * \param instructions Circuit the partition was computed for
+ * \param partition Partition of that circuit
+ * \param component Component to extract
+ * \param out Output list (initialized here; release with free_instruction_list)
+ * \return 0 on success, nonzero on error
+ */
+int extract_component(const InstructionList* instructions, const CircuitPartition* partition,
+                      size_t component, InstructionList* out);
+
+/**
+ * \brief Releases a CircuitPartition.
+ */
+void free_circuit_partition(CircuitPartition* partition);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CIRCUIT_PARTITION_H */
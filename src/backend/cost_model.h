@@ -0,0 +1,107 @@
+#ifndef COST_MODEL_H
+#define COST_MODEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+#include "memory_planner.h"
+#include "../core/gate_operations.h"
+
+/**
+ * \brief Codec work of the compressed engine relative to a raw sweep (decode + encode of
+ *        every block a gate touches).
+ */
+#define COMPRESSED_COST_FACTOR 3.0
+
+/**
+ * \brief Work per stored amplitude of the sparse engine relative to a dense sweep
+ *        (hash probes plus rebuilding the scratch table).
+ */
+#define SPARSE_COST_FACTOR 4.0
+
+/**
+ * \brief Register size calibrate_cost_model times the kernels on (8 MB of amplitudes,
+ *        larger than most last-level cache slices).
+ */
+#define CALIBRATION_QUBITS 20
+
+/**
+ * \brief Machine and job parameters of the cost model.
+ */
+typedef struct CostModel {
+    EngineKind engine;     /**< Engine the circuit will run on */
+    size_t     num_qubits; /**< Register size */
+    double     bandwidth;  /**< Sustained bytes/s */
+    double     flop_rate;  /**< Sustained float operations/s */
+    int        calibrated; /**< 1 if bandwidth and flop_rate were measured on this host */
+    size_t     max_bond;   /**< MPS bond-dimension cap (0 => MPS_DEFAULT_MAX_BOND) */
+} CostModel;
+
+/**
+ * \brief Predicted work of a whole circuit. REPEAT bodies count once per iteration, calls
+ *        count their subcircuit, and gates under an IF are assumed to run.
+ */
+typedef struct CircuitCost {
+    size_t gates;        /**< Gate executions */
+    size_t measurements; /**< Measurement executions */
+    double passes;       /**< Equivalent full sweeps of the state */
+    double bytes;        /**< Bytes moved to and from memory */
+    double flops;        /**< Float operations */
+    double seconds;      /**< Predicted execution time */
+} CircuitCost;
+
+/**
+ * \brief Fills a model with the default roofline constants (KERNEL_DEFAULT_BANDWIDTH,
+ *        KERNEL_DEFAULT_FLOP_RATE).
+ */
+void init_cost_model(CostModel* model, EngineKind engine, size_t num_qubits);
+
+/**
+ * \brief Times the single- and two-qubit dense kernels on a CALIBRATION_QUBITS register and
+ *        fits bandwidth and flop_rate to them (the two kernels move the same bytes, so their
+ *        difference isolates the arithmetic). Takes a few tens of milliseconds.
+ * \return 0 on success, nonzero if the timing state could not be allocated
+ */
+int calibrate_cost_model(CostModel* model);
+
+/**
+ * \brief Adds the cost of one execution of a gate or measurement. Block markers, CREG and
+ *        unknown gates cost nothing.
+ * \return 0 on success, nonzero on error
+ */
+int instruction_cost(const CostModel* model, const Instruction* instr, CircuitCost* cost);
+
+/**
+ * \brief Predicts the cost of running a circuit on model->engine. The dense estimate is taken
+ *        before bytecode lowering, so two-qubit block consolidation can only make it cheaper.
+ *        Sparse runs are scaled by the support bound of estimate_support_qubits; stabilizer
+ *        runs are costed in tableau columns (tableau_kernel_cost), with every measurement
+ *        assumed random. MPS runs assume every bond at its largest size under max_bond.
+ * \param model Cost model (num_qubits 0 => instruction_list_num_qubits)
+ * \param instructions Parsed (and optionally optimized) instructions
+ * \param cost Output cost
+ * \return 0 on success, nonzero on error
+ */
+int estimate_circuit_cost(const CostModel* model, const InstructionList* instructions, CircuitCost* cost);
+
+/**
+ * \brief Writes a pre-run report as one line of JSON, for schedulers that pack jobs by
+ *        predicted runtime. Keys: engine, num_qubits, gates, measurements, passes, bytes,
+ *        flops, predicted_seconds, bandwidth, flop_rate, calibrated and, if a plan is given,
+ *        peak_bytes.
+ * \param out Destination stream
+ * \param model Model the cost was estimated with
+ * \param cost Estimated cost
+ * \param plan Optional memory plan of the same job
+ * \return 0 on success, nonzero on error
+ */
+int write_cost_report(FILE* out, const CostModel* model, const CircuitCost* cost, const MemoryPlan* plan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COST_MODEL_H */
@@ -0,0 +1,266 @@
+#include "engine_selector.h"
+#include "../assembly/interpreter.h"
+#include "../core/mps_state.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+static size_t sat_add(size_t a, size_t b) {
+    return (a > SIZE_MAX - b) ? SIZE_MAX : a + b;
+}
+
+static size_t sat_mul(size_t a, size_t b) {
+    return (a != 0 && b > SIZE_MAX / a) ? SIZE_MAX : a * b;
+}
+
+/**
+ * \brief Per-qubit state of the profiling walk.
+ */
+typedef struct {
+    const InstructionList* list;
+    size_t          num_qubits;
+    size_t*         layer;    /**< Per qubit: layers scheduled so far */
+    double*         cut;      /**< Difference array of gates spanning each cut (q, q + 1) */
+    unsigned char*  measured; /**< Per qubit: measured, and no gate since */
+    CircuitProfile* profile;
+    int             failed;   /**< 1 if a REPEAT snapshot could not be allocated */
+} ProfileWalk;
+
+static void walk_range(ProfileWalk* w, size_t begin, size_t end, size_t mult, size_t depth);
+
+static void walk_instruction(ProfileWalk* w, const Instruction* instr, size_t mult) {
+    CircuitProfile* p = w->profile;
+    if (instr->cond_reg) p->mid_circuit = 1;
+    switch (instr->type) {
+        case INSTR_GATE_SINGLE: {
+            size_t q = instr->qubits[0];
+            if (q >= w->num_qubits) return;
+            p->gates = sat_add(p->gates, mult);
+            if (w->measured[q]) p->mid_circuit = 1;
+            w->measured[q] = 0;
+            w->layer[q] = sat_add(w->layer[q], 1);
+            break;
+        }
+        case INSTR_GATE_MULTI: {
+            if (instr->qubit_count != 2) return;
+            size_t a = instr->qubits[0], b = instr->qubits[1];
+            if (a >= w->num_qubits || b >= w->num_qubits) return;
+            size_t lo = a < b ? a : b, hi = a ^ b ^ lo;
+            p->gates = sat_add(p->gates, mult);
+            p->two_qubit_gates = sat_add(p->two_qubit_gates, mult);
+            if (hi - lo > p->max_distance) p->max_distance = hi - lo;
+            // The gate spans cuts lo .. hi - 1
+            w->cut[lo] += (double)mult;
+            w->cut[hi] -= (double)mult;
+            if (w->measured[a] || w->measured[b]) p->mid_circuit = 1;
+            w->measured[a] = w->measured[b] = 0;
+            size_t next = sat_add(w->layer[a] > w->layer[b] ? w->layer[a] : w->layer[b], 1);
+            w->layer[a] = w->layer[b] = next;
+            break;
+        }
+        case INSTR_MEASURE: {
+            size_t q = instr->qubits[0];
+            if (q >= w->num_qubits) return;
+            p->measurements = sat_add(p->measurements, mult);
+            w->measured[q] = 1;
+            w->layer[q] = sat_add(w->layer[q], 1);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/**
+ * \brief Walks [begin, end) once; counts are scaled by 'mult', the executions of the range.
+ *        A REPEAT body is walked once and the layers it added are then repeated for every
+ *        further iteration on the qubits it touched.
+ */
+static void walk_range(ProfileWalk* w, size_t begin, size_t end, size_t mult, size_t depth) {
+    if (depth > MAX_BLOCK_DEPTH) return;
+    const InstructionList* list = w->list;
+    for (size_t i = begin; i < end && i < list->size; i++) {
+        const Instruction* instr = &list->data[i];
+        switch (instr->type) {
+            case INSTR_REPEAT: {
+                if (instr->repeat_count == 0) {
+                    i = instr->link;
+                    break;
+                }
+                size_t* before = (size_t*)malloc(w->num_qubits * sizeof(size_t));
+                if (!before) {
+                    w->failed = 1;
+                    return;
+                }
+                memcpy(before, w->layer, w->num_qubits * sizeof(size_t));
+                walk_range(w, i + 1, instr->link, sat_mul(mult, instr->repeat_count), depth + 1);
+                size_t grew = 0;
+                for (size_t q = 0; q < w->num_qubits; q++) {
+                    if (w->layer[q] - before[q] > grew) grew = w->layer[q] - before[q];
+                }
+                size_t extra = sat_mul(grew, instr->repeat_count - 1);
+                for (size_t q = 0; q < w->num_qubits; q++) {
+                    if (w->layer[q] != before[q]) w->layer[q] = sat_add(w->layer[q], extra);
+                }
+                free(before);
+                i = instr->link;
+                break;
+            }
+            case INSTR_DEF:
+                i = instr->link; // walked where it is called
+                break;
+            case INSTR_CALL: {
+                const Instruction* def = &list->data[instr->link];
+                walk_range(w, instr->link + 1, def->link, mult, depth + 1);
+                break;
+            }
+            default:
+                walk_instruction(w, instr, mult);
+                break;
+        }
+    }
+}
+
+int analyze_circuit(const InstructionList* instructions, size_t num_qubits, CircuitProfile* profile) {
+    if (!instructions || !profile) return -1;
+    memset(profile, 0, sizeof(*profile));
+    if (num_qubits == 0) num_qubits = instruction_list_num_qubits(instructions);
+    profile->num_qubits = num_qubits;
+    profile->clifford = circuit_is_clifford(instructions);
+    if (num_qubits == 0) return 0;
+
+    ProfileWalk w;
+    w.list = instructions;
+    w.num_qubits = num_qubits;
+    w.profile = profile;
+    w.failed = 0;
+    w.layer = (size_t*)calloc(num_qubits, sizeof(size_t));
+    w.cut = (double*)calloc(num_qubits + 1, sizeof(double));
+    w.measured = (unsigned char*)calloc(num_qubits, 1);
+    if (!w.layer || !w.cut || !w.measured) {
+        free(w.layer);
+        free(w.cut);
+        free(w.measured);
+        return -2;
+    }
+    walk_range(&w, 0, instructions->size, 1, 0);
+    if (w.failed) {
+        free(w.layer);
+        free(w.cut);
+        free(w.measured);
+        return -2;
+    }
+
+    double crossing = 0.0, widest = 0.0, bond = 0.0;
+    for (size_t q = 0; q < num_qubits; q++) {
+        if (w.layer[q] > profile->depth) profile->depth = w.layer[q];
+        if (q + 1 == num_qubits) break;
+        crossing += w.cut[q];
+        if (crossing > widest) widest = crossing;
+        // A cut's bond is at most 2^(gates across it) and at most the smaller side's dimension
+        double side = (double)(q + 1 < num_qubits - q - 1 ? q + 1 : num_qubits - q - 1);
+        double needed = crossing < side ? crossing : side;
+        if (needed > bond) bond = needed;
+    }
+    profile->max_cut = widest >= (double)SIZE_MAX ? SIZE_MAX : (size_t)widest;
+    profile->bond_qubits = (size_t)bond;
+    profile->support_qubits = estimate_support_qubits(instructions, num_qubits);
+
+    free(w.layer);
+    free(w.cut);
+    free(w.measured);
+    return 0;
+}
+
+int select_engine(const InstructionList* instructions, size_t num_qubits, size_t budget,
+                  const CostModel* model, size_t max_bond, int disable_stabilizer, EngineChoice* choice) {
+    if (!instructions || !choice) return -1;
+    memset(choice, 0, sizeof(*choice));
+    if (num_qubits == 0) num_qubits = instruction_list_num_qubits(instructions);
+    int rc = analyze_circuit(instructions, num_qubits, &choice->profile);
+    if (rc != 0) return rc;
+    const CircuitProfile* p = &choice->profile;
+    choice->memory_budget = budget;
+
+    CostModel m;
+    if (model) {
+        m = *model;
+    } else {
+        init_cost_model(&m, ENGINE_DENSE, num_qubits);
+    }
+    m.num_qubits = num_qubits;
+    size_t cap = max_bond ? max_bond : MPS_DEFAULT_MAX_BOND;
+    if (p->bond_qubits < sizeof(size_t) * 8 - 1) choice->mps_max_bond = (size_t)1 << p->bond_qubits;
+
+    int best = -1, second = -1, smallest = -1;
+    for (int e = 0; e < ENGINE_COUNT; e++) {
+        EngineKind engine = (EngineKind)e;
+        if (engine == ENGINE_STABILIZER &&
+            (disable_stabilizer || !p->clifford || num_qubits < STABILIZER_MIN_QUBITS)) {
+            continue;
+        }
+        // Only an MPS whose bonds can never hit the cap is exact
+        if (engine == ENGINE_MPS && (choice->mps_max_bond == 0 || choice->mps_max_bond > cap)) continue;
+
+        MemoryPlan plan;
+        CircuitCost cost;
+        if (plan_memory(instructions, num_qubits, engine, 0.0f, &plan) != 0 || plan.overflow) continue;
+        m.engine = engine;
+        m.max_bond = choice->mps_max_bond;
+        if (estimate_circuit_cost(&m, instructions, &cost) != 0) continue;
+        choice->eligible[e] = 1;
+        choice->seconds[e] = cost.seconds;
+        choice->peak_bytes[e] = plan.peak_bytes;
+        if (smallest < 0 || plan.peak_bytes < choice->peak_bytes[smallest]) smallest = e;
+        if (budget && plan.peak_bytes > budget) continue;
+        if (best < 0 || cost.seconds < choice->seconds[best]) {
+            second = best;
+            best = e;
+        } else if (second < 0 || cost.seconds < choice->seconds[second]) {
+            second = e;
+        }
+    }
+    choice->fits = (best >= 0);
+    choice->engine = (EngineKind)(best >= 0 ? best : (smallest >= 0 ? smallest : ENGINE_DENSE));
+    if (choice->engine != ENGINE_MPS) choice->mps_max_bond = 0;
+
+    char bond[48] = "";
+    if (choice->engine == ENGINE_MPS) snprintf(bond, sizeof(bond), " (exact at bond %zu)", choice->mps_max_bond);
+    int len = snprintf(choice->explanation, sizeof(choice->explanation),
+                       "%s%s for %zu qubits: %s, depth %zu, widest cut %zu gate(s), support 2^%zu, %s measurements",
+                       engine_name(choice->engine), bond, num_qubits, p->clifford ? "Clifford" : "non-Clifford",
+                       p->depth, p->max_cut, p->support_qubits, p->mid_circuit ? "mid-circuit" : "final");
+    size_t used = len < 0 ? 0 : (size_t)len;
+    if (used < sizeof(choice->explanation)) {
+        char* tail = choice->explanation + used;
+        size_t room = sizeof(choice->explanation) - used;
+        if (!choice->fits) {
+            snprintf(tail, room, "; no engine fits %zu bytes", budget);
+        } else if (second >= 0) {
+            snprintf(tail, room, "; predicted %.3g s vs %.3g s on %s", choice->seconds[best],
+                     choice->seconds[second], engine_name((EngineKind)second));
+        } else {
+            snprintf(tail, room, "; predicted %.3g s, the only engine that fits", choice->seconds[best]);
+        }
+    }
+    return 0;
+}
+
+void print_engine_choice(const EngineChoice* choice) {
+    if (!choice) return;
+    const CircuitProfile* p = &choice->profile;
+    printf("Engine choice: %s\n", engine_name(choice->engine));
+    printf("  circuit   : %zu qubits, %zu gates (%zu two-qubit), depth %zu, %s\n", p->num_qubits, p->gates,
+           p->two_qubit_gates, p->depth, p->clifford ? "Clifford" : "non-Clifford");
+    printf("  coupling  : max distance %zu, widest cut %zu gate(s), exact MPS bond <= 2^%zu\n",
+           p->max_distance, p->max_cut, p->bond_qubits);
+    printf("  sparsity  : at most 2^%zu nonzero amplitudes\n", p->support_qubits);
+    printf("  measures  : %zu, %s\n", p->measurements, p->mid_circuit ? "mid-circuit" : "at the end");
+    for (int e = 0; e < ENGINE_COUNT; e++) {
+        if (!choice->eligible[e]) continue;
+        int over = choice->memory_budget && choice->peak_bytes[e] > choice->memory_budget;
+        printf("  %-10s: %.3g s, %zu bytes%s%s\n", engine_name((EngineKind)e), choice->seconds[e],
+               choice->peak_bytes[e], over ? " (over budget)" : "", e == (int)choice->engine ? " <=" : "");
+    }
+}
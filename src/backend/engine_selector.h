@@ -0,0 +1,98 @@
+#ifndef ENGINE_SELECTOR_H
+#define ENGINE_SELECTOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "memory_planner.h"
+#include "cost_model.h"
+
+/**
+ * \brief Smallest Clifford-only circuit simulate_circuit moves from the dense engine to the
+ *        stabilizer engine. Below it the dense state fits in cache and costs about the same.
+ */
+#define STABILIZER_MIN_QUBITS 16
+
+/**
+ * \brief Length of EngineChoice::explanation, including the terminator.
+ */
+#define ENGINE_EXPLANATION_LENGTH 256
+
+/**
+ * \brief What select_engine looks at. REPEAT bodies count once per iteration and calls count
+ *        their subcircuit, as in estimate_circuit_cost.
+ */
+typedef struct CircuitProfile {
+    size_t num_qubits;
+    size_t gates;             /**< Gate executions */
+    size_t two_qubit_gates;   /**< CNOT/CPHASE executions */
+    size_t measurements;      /**< Measurement executions */
+    size_t depth;             /**< Layers of an as-soon-as-possible schedule (a REPEAT adds its
+                                   body's depth once per iteration) */
+    size_t max_distance;      /**< Largest |a - b| of a two-qubit gate: 1 for nearest neighbours */
+    size_t max_cut;           /**< Most two-qubit gates spanning one cut (q, q + 1) of the line */
+    size_t bond_qubits;       /**< log2 of the largest bond an exact MPS can need: each gate across a
+                                   cut at most doubles it, and a cut never needs more than the
+                                   smaller side's dimension */
+    size_t support_qubits;    /**< estimate_support_qubits: log2 bound on nonzero amplitudes */
+    int    clifford;          /**< 1 if every gate is Clifford (circuit_is_clifford) */
+    int    mid_circuit;       /**< 1 if a gate follows a measurement of its qubit, or an IF reads
+                                   a register; 0 if measurements only end the circuit */
+} CircuitProfile;
+
+/**
+ * \brief Engine chosen by select_engine, with every candidate's prediction.
+ */
+typedef struct EngineChoice {
+    EngineKind     engine;                     /**< Expected-cheapest engine that fits the budget */
+    size_t         mps_max_bond;               /**< ENGINE_MPS: bond cap the run needs to stay exact */
+    int            fits;                       /**< 0 if no engine fits (engine then needs the least memory) */
+    size_t         memory_budget;              /**< Budget the candidates were checked against (0 => none) */
+    int            eligible[ENGINE_COUNT];     /**< 1 if the engine can run the circuit exactly */
+    double         seconds[ENGINE_COUNT];      /**< Predicted execution time of each eligible engine */
+    size_t         peak_bytes[ENGINE_COUNT];   /**< Planned peak memory of each eligible engine */
+    CircuitProfile profile;
+    char           explanation[ENGINE_EXPLANATION_LENGTH]; /**< One line: the choice and why */
+} EngineChoice;
+
+/**
+ * \brief Profiles a circuit: size, gate set, connectivity, depth, measurement placement and
+ *        sparsity.
+ * \param instructions Parsed instructions
+ * \param num_qubits Register size (0 => instruction_list_num_qubits)
+ * \param profile Output profile
+ * \return 0 on success, nonzero on error
+ */
+int analyze_circuit(const InstructionList* instructions, size_t num_qubits, CircuitProfile* profile);
+
+/**
+ * \brief Picks the engine with the lowest predicted time (estimate_circuit_cost) among those that
+ *        run the circuit exactly and fit the budget (plan_memory). The stabilizer engine needs a
+ *        Clifford circuit of at least STABILIZER_MIN_QUBITS qubits; the MPS engine needs a bond
+ *        bound within max_bond, so it never truncates. Ties go to the engine listed first in
+ *        EngineKind. The explanation names the engine, the profile features behind it and the
+ *        runner-up.
+ * \param instructions Parsed instructions
+ * \param num_qubits Register size (0 => instruction_list_num_qubits)
+ * \param budget Budget in bytes (0 => unlimited)
+ * \param model Bandwidth and flop rate to predict with (NULL => init_cost_model defaults)
+ * \param max_bond MPS bond-dimension cap (0 => MPS_DEFAULT_MAX_BOND)
+ * \param disable_stabilizer Nonzero leaves the stabilizer engine out
+ * \param choice Output choice
+ * \return 0 on success, nonzero on error
+ */
+int select_engine(const InstructionList* instructions, size_t num_qubits, size_t budget,
+                  const CostModel* model, size_t max_bond, int disable_stabilizer, EngineChoice* choice);
+
+/**
+ * \brief Prints a choice: the profile and each candidate's predicted time and memory.
+ */
+void print_engine_choice(const EngineChoice* choice);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ENGINE_SELECTOR_H */
@@ -0,0 +1,269 @@
+#include "memory_planner.h"
+#include "../core/compressed_state_vector.h"
+#include "../core/sparse_state_vector.h"
+#include "../core/stabilizer_tableau.h"
+#include "../core/mps_state.h"
+#include "../assembly/interpreter.h"
+#include "../assembly/bytecode.h"
+#include "../utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <strings.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <unistd.h>
+#endif
+
+/**
+ * \brief Saturating helpers: a 64-qubit typo must produce "too big", not a wrapped size.
+ */
+static size_t sat_add(size_t a, size_t b) {
+    return (a > SIZE_MAX - b) ? SIZE_MAX : a + b;
+}
+
+static size_t sat_mul(size_t a, size_t b) {
+    if (a != 0 && b > SIZE_MAX / a) return SIZE_MAX;
+    return a * b;
+}
+
+static size_t sat_pow2(size_t n) {
+    return (n >= sizeof(size_t) * 8) ? SIZE_MAX : ((size_t)1 << n);
+}
+
+static size_t next_pow2(size_t v) {
+    size_t p = 1;
+    while (p < v) {
+        if (p > SIZE_MAX / 2) return SIZE_MAX;
+        p <<= 1;
+    }
+    return p;
+}
+
+/**
+ * \brief Upper bound on log2(nonzero amplitudes): only gates that mix |0> and |1>
+ *        (anything but permutations and diagonal gates) can double the support,
+ *        and the support never exceeds 2^n. A REPEAT body counts once per iteration and a
+ *        call counts its subcircuit's body; def_counts caches each DEF's count.
+ */
+static size_t count_branching(const InstructionList* instructions, size_t begin, size_t end,
+                              size_t cap, size_t* def_counts) {
+    size_t branching = 0;
+    for (size_t i = begin; i < end && branching < cap; i++) {
+        const Instruction* instr = &instructions->data[i];
+        switch (instr->type) {
+            case INSTR_REPEAT: {
+                size_t body = count_branching(instructions, i + 1, instr->link, cap, def_counts);
+                branching = sat_add(branching, sat_mul(body, instr->repeat_count));
+                i = instr->link;
+                continue;
+            }
+            case INSTR_DEF:
+                def_counts[i] = count_branching(instructions, i + 1, instr->link, cap, def_counts);
+                i = instr->link;
+                continue;
+            case INSTR_CALL:
+                branching = sat_add(branching, def_counts[instr->link]);
+                continue;
+            case INSTR_GATE_SINGLE:
+                break;
+            case INSTR_GATE_MULTI:
+                // CNOT permutes and CPHASE is diagonal; any other multi-qubit gate may branch
+                if (instr->qubit_count != 2 ||
+                    (strcasecmp(instr->gate_name, "CNOT") != 0 && strcasecmp(instr->gate_name, "CPHASE") != 0)) {
+                    branching++;
+                }
+                continue;
+            default:
+                continue; // MEASURE shrinks
+        }
+        const char* g = instr->gate_name;
+        if (instr->has_matrix) {
+            // A fused diagonal or anti-diagonal matrix only permutes and rephases
+            const float* m = instr->matrix;
+            int diagonal = m[2] == 0.0f && m[3] == 0.0f && m[4] == 0.0f && m[5] == 0.0f;
+            int anti = m[0] == 0.0f && m[1] == 0.0f && m[6] == 0.0f && m[7] == 0.0f;
+            if (!diagonal && !anti) branching++;
+            continue;
+        }
+        if (strcasecmp(g, "X") == 0 || strcasecmp(g, "Y") == 0 || strcasecmp(g, "Z") == 0 ||
+            strcasecmp(g, "S") == 0 || strcasecmp(g, "T") == 0) {
+            continue;
+        }
+        branching++;
+    }
+    return branching < cap ? branching : cap;
+}
+
+size_t estimate_support_qubits(const InstructionList* instructions, size_t num_qubits) {
+    if (!instructions) return num_qubits;
+    size_t* def_counts = (size_t*)calloc(instructions->size ? instructions->size : 1, sizeof(size_t));
+    if (!def_counts) return num_qubits; // no estimate: assume fully dense
+    size_t branching = count_branching(instructions, 0, instructions->size, num_qubits, def_counts);
+    free(def_counts);
+    return branching;
+}
+
+const char* engine_name(EngineKind engine) {
+    switch (engine) {
+        case ENGINE_DENSE:      return "dense";
+        case ENGINE_COMPRESSED: return "compressed";
+        case ENGINE_SPARSE:     return "sparse";
+        case ENGINE_STABILIZER: return "stabilizer";
+        case ENGINE_MPS:        return "mps";
+        case ENGINE_AUTO:       return "auto";
+        default:                return "unknown";
+    }
+}
+
+int plan_memory(const InstructionList* instructions, size_t num_qubits, EngineKind engine,
+                float compression_max_error, MemoryPlan* plan) {
+    if (!instructions || !plan) return -1;
+    memset(plan, 0, sizeof(*plan));
+    if (num_qubits == 0) num_qubits = instruction_list_num_qubits(instructions);
+    plan->engine = engine;
+    plan->num_qubits = num_qubits;
+    plan->pool_bytes = instructions->capacity * sizeof(Instruction);
+
+    size_t length = sat_pow2(num_qubits);
+    size_t nonzeros = sat_pow2(estimate_support_qubits(instructions, num_qubits));
+    if (nonzeros > length) nonzeros = length;
+
+    switch (engine) {
+        case ENGINE_DENSE:
+            plan->overflow = (num_qubits >= sizeof(size_t) * 8 - 3);
+            plan->state_bytes = sat_mul(length, 2 * sizeof(float));
+            // The dense engine runs the bytecode lowering, not the instruction list
+            bytecode_footprint(instructions, &plan->fusion_bytes, &plan->scratch_bytes);
+            break;
+
+        case ENGINE_COMPRESSED: {
+            plan->overflow = (num_qubits >= sizeof(size_t) * 8 - 1);
+            size_t k = (num_qubits < COMPRESSED_DEFAULT_BLOCK_QUBITS) ? num_qubits : COMPRESSED_DEFAULT_BLOCK_QUBITS;
+            size_t block_len = (size_t)1 << k;
+            size_t num_blocks = sat_pow2(num_qubits - k);
+            // At most one nonzero block per nonzero amplitude, each no larger than raw (or Q16) storage
+            size_t bytes_per_amp = (compression_max_error > 0.0f) ? 2 * sizeof(int16_t) : 2 * sizeof(float);
+            size_t live_blocks = (nonzeros < num_blocks) ? nonzeros : num_blocks;
+            plan->state_bytes = sat_add(sat_mul(live_blocks, sat_mul(block_len, bytes_per_amp)),
+                                        sat_mul(num_blocks, sizeof(CompressedBlock)));
+            plan->scratch_bytes = 4 * block_len * sizeof(float);
+            break;
+        }
+
+        case ENGINE_SPARSE: {
+            plan->overflow = (num_qubits > SPARSE_MAX_QUBITS);
+            // Live table and scratch table, each sized for a doubling gate at <= 50% load
+            size_t slot_bytes = sizeof(uint64_t) + 2 * sizeof(float);
+            size_t slots = next_pow2(sat_mul(nonzeros, 4));
+            plan->state_bytes = sat_mul(slots, slot_bytes);
+            plan->scratch_bytes = plan->state_bytes;
+            break;
+        }
+
+        case ENGINE_STABILIZER:
+            plan->overflow = !circuit_is_clifford(instructions);
+            plan->state_bytes = stabilizer_tableau_bytes(num_qubits);
+            break;
+
+        case ENGINE_MPS:
+            plan->state_bytes = mps_state_bytes(num_qubits, MPS_DEFAULT_MAX_BOND);
+            break;
+
+        default:
+            return -2;
+    }
+
+    plan->peak_bytes = sat_add(sat_add(plan->state_bytes, plan->scratch_bytes),
+                               sat_add(plan->fusion_bytes, plan->pool_bytes));
+    if (plan->overflow) plan->peak_bytes = SIZE_MAX;
+    return 0;
+}
+
+/**
+ * \brief Reads a single unsigned number from a file; returns 0 for "max", missing or unparsable.
+ */
+static size_t read_limit_file(const char* path) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) return 0;
+    char buf[64] = { 0 };
+    size_t limit = 0;
+    if (fgets(buf, sizeof(buf), fp)) {
+        char* end = NULL;
+        unsigned long long v = strtoull(buf, &end, 10);
+        if (end != buf) limit = (size_t)v;
+    }
+    fclose(fp);
+    return limit;
+}
+
+size_t detect_memory_budget(void) {
+    size_t physical = 0;
+#if defined(__unix__) || defined(__APPLE__)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGE_SIZE);
+    if (pages > 0 && page_size > 0) physical = sat_mul((size_t)pages, (size_t)page_size);
+#endif
+
+    size_t cgroup = read_limit_file("/sys/fs/cgroup/memory.max");               // cgroup v2
+    if (cgroup == 0) cgroup = read_limit_file("/sys/fs/cgroup/memory/memory.limit_in_bytes"); // v1
+
+    // v1 reports "unlimited" as a huge page-aligned number; physical RAM is the real cap then
+    if (cgroup != 0 && (physical == 0 || cgroup < physical)) return cgroup;
+    return physical;
+}
+
+AdmissionDecision admit_job(const InstructionList* instructions, size_t num_qubits,
+                            EngineKind requested, size_t budget, int allow_fallback,
+                            float compression_max_error, MemoryPlan* plan) {
+    if (!instructions || !plan) return ADMIT_REFUSED;
+    if (budget == 0) budget = detect_memory_budget();
+    if (budget == 0) budget = SIZE_MAX;
+
+    if (plan_memory(instructions, num_qubits, requested, compression_max_error, plan) != 0) {
+        return ADMIT_REFUSED;
+    }
+    if (!plan->overflow && plan->peak_bytes <= budget) {
+        return ADMIT_OK;
+    }
+
+    log_message(LOG_LEVEL_WARN, "Memory planner: %s engine needs %zu bytes for %zu qubits, budget is %zu.",
+                engine_name(requested), plan->peak_bytes, plan->num_qubits, budget);
+    if (!allow_fallback) return ADMIT_REFUSED;
+
+    // Pick the cheapest engine that fits
+    MemoryPlan best;
+    int found = 0;
+    for (int e = 0; e < ENGINE_COUNT; e++) {
+        if ((EngineKind)e == requested) continue;
+        if ((EngineKind)e == ENGINE_MPS) continue; // approximate: only on request
+        MemoryPlan candidate;
+        if (plan_memory(instructions, num_qubits, (EngineKind)e, compression_max_error, &candidate) != 0) continue;
+        if (candidate.overflow || candidate.peak_bytes > budget) continue;
+        if (!found || candidate.peak_bytes < best.peak_bytes) {
+            best = candidate;
+            found = 1;
+        }
+    }
+    if (!found) return ADMIT_REFUSED;
+
+    log_message(LOG_LEVEL_INFO, "Memory planner: falling back to %s engine (%zu bytes).",
+                engine_name(best.engine), best.peak_bytes);
+    *plan = best;
+    return ADMIT_DOWNGRADED;
+}
+
+void print_memory_plan(const MemoryPlan* plan, size_t budget) {
+    if (!plan) return;
+    printf("Memory plan (%s engine, %zu qubits):\n", engine_name(plan->engine), plan->num_qubits);
+    if (plan->overflow) {
+        printf("  state does not fit in the address space\n");
+        return;
+    }
+    printf("  state   : %zu bytes\n", plan->state_bytes);
+    printf("  scratch : %zu bytes\n", plan->scratch_bytes);
+    printf("  fusion  : %zu bytes\n", plan->fusion_bytes);
+    printf("  pools   : %zu bytes\n", plan->pool_bytes);
+    printf("  peak    : %zu bytes (budget %zu)\n", plan->peak_bytes, budget);
+}
@@ -0,0 +1,107 @@
+#ifndef MEMORY_PLANNER_H
+#define MEMORY_PLANNER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "../assembly/parser.h"  // for InstructionList
+
+/**
+ * \brief Simulation engines the planner can size and choose between.
+ */
+typedef enum {
+    ENGINE_DENSE,       /**< StateVector, 2^n amplitudes */
+    ENGINE_COMPRESSED,  /**< CompressedStateVector, block-compressed amplitudes */
+    ENGINE_SPARSE,      /**< SparseStateVector, nonzero amplitudes only */
+    ENGINE_STABILIZER,  /**< StabilizerTableau, O(n^2) bits; Clifford circuits only */
+    ENGINE_MPS,         /**< MpsState, O(n chi^2) amplitudes; approximate once bonds are capped */
+    ENGINE_COUNT,
+    ENGINE_AUTO         /**< Not an engine: simulate_circuit picks one (select_engine) */
+} EngineKind;
+
+/**
+ * \brief Predicted peak memory of running one circuit on one engine.
+ */
+typedef struct MemoryPlan {
+    EngineKind engine;
+    size_t num_qubits;
+    size_t state_bytes;    /**< Amplitude storage */
+    size_t scratch_bytes;  /**< Working buffers, rebuild tables and compile-time planning tables */
+    size_t fusion_bytes;   /**< Dense engine: lowered bytecode (ops, fused matrices, bindings) */
+    size_t pool_bytes;     /**< Instruction storage and allocator bookkeeping */
+    size_t peak_bytes;     /**< Sum of the above, saturated at SIZE_MAX */
+    int    overflow;       /**< 1 if the engine cannot run the circuit at all (too many qubits,
+                                or a non-Clifford gate on the stabilizer engine) */
+} MemoryPlan;
+
+/**
+ * \brief Outcome of admission control.
+ */
+typedef enum {
+    ADMIT_OK,          /**< Requested engine fits the budget */
+    ADMIT_DOWNGRADED,  /**< A cheaper engine was chosen to fit the budget */
+    ADMIT_REFUSED      /**< No engine fits; nothing should be allocated */
+} AdmissionDecision;
+
+/**
+ * \brief Returns a printable engine name.
+ */
+const char* engine_name(EngineKind engine);
+
+/**
+ * \brief Upper bound on log2 of the number of nonzero amplitudes the circuit can reach from
+ *        |0...0>: only gates that mix |0> and |1> can double the support.
+ * \param instructions Parsed instructions
+ * \param num_qubits Register size (the bound never exceeds it)
+ * \return Bound in qubits
+ */
+size_t estimate_support_qubits(const InstructionList* instructions, size_t num_qubits);
+
+/**
+ * \brief Predicts peak bytes for running the instructions on an engine, without allocating.
+ * \param instructions Parsed (and optionally optimized) instructions
+ * \param num_qubits Register size (0 => instruction_list_num_qubits)
+ * \param engine Engine to size (ENGINE_MPS is sized at MPS_DEFAULT_MAX_BOND)
+ * \param compression_max_error Lossy bound for ENGINE_COMPRESSED (0 => lossless)
+ * \param plan Output plan
+ * \return 0 on success, nonzero on error
+ */
+int plan_memory(const InstructionList* instructions, size_t num_qubits, EngineKind engine,
+                float compression_max_error, MemoryPlan* plan);
+
+/**
+ * \brief Detects the memory available to this process: the cgroup limit (v2 or v1) if set,
+ *        otherwise physical RAM.
+ * \return Budget in bytes, 0 if it cannot be determined
+ */
+size_t detect_memory_budget(void);
+
+/**
+ * \brief Sizes the requested engine and compares it with the budget; if it does not fit and
+ *        fallback is allowed, picks the cheapest engine that does. ENGINE_MPS may truncate the
+ *        state, so it is only used when requested, never as a fallback.
+ * \param instructions Parsed instructions
+ * \param num_qubits Register size (0 => infer)
+ * \param requested Engine the caller asked for
+ * \param budget Budget in bytes (0 => detect_memory_budget, and unlimited if that fails)
+ * \param allow_fallback Nonzero to allow switching engines
+ * \param compression_max_error Lossy bound used when sizing ENGINE_COMPRESSED
+ * \param plan Output plan of the admitted engine (or of the requested one if refused)
+ * \return Admission decision
+ */
+AdmissionDecision admit_job(const InstructionList* instructions, size_t num_qubits,
+                            EngineKind requested, size_t budget, int allow_fallback,
+                            float compression_max_error, MemoryPlan* plan);
+
+/**
+ * \brief Prints a plan and the budget it was checked against.
+ */
+void print_memory_plan(const MemoryPlan* plan, size_t budget);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMORY_PLANNER_H */
@@ -0,0 +1,229 @@
+#include "noise_trajectories.h"
+#include "memory_planner.h"
+#include "../assembly/interpreter.h"
+#include "../core/state_vector.h"
+#include "../utils/math_utils.h"
+#include "../utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/**
+ * \brief Trajectories a worker claims at once: few enough to balance the load, enough to keep
+ *        the queue lock out of small circuits' way.
+ */
+#define TRAJECTORY_CHUNK 16
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void init_trajectory_options(TrajectoryOptions* options) {
+    if (!options) return;
+    memset(options, 0, sizeof(*options));
+    options->trajectories = TRAJECTORY_DEFAULT_COUNT;
+}
+
+typedef struct {
+    const InstructionList* list;
+    size_t                 num_qubits;
+    size_t                 total;  /**< Trajectories to run */
+    size_t                 next;   /**< Next trajectory to hand out, under 'lock' */
+    uint64_t               seed;
+    pthread_mutex_t        lock;
+} TrajectoryQueue;
+
+/**
+ * \brief One worker's state and counts; counts are summed once all workers are done.
+ */
+typedef struct {
+    TrajectoryQueue* queue;
+    size_t*          ones;
+    size_t*          measured;
+    int              rc;
+} TrajectoryWorker;
+
+static void* trajectory_worker(void* arg) {
+    TrajectoryWorker* worker = (TrajectoryWorker*)arg;
+    TrajectoryQueue* queue = worker->queue;
+    size_t n = queue->num_qubits;
+
+    StateVector sv;
+    float* readout = (float*)malloc((n + 1) * sizeof(float));
+    int8_t* outcomes = (int8_t*)malloc(n + 1);
+    if (!readout || !outcomes || init_state_vector(&sv, n) != 0) {
+        free(readout);
+        free(outcomes);
+        worker->rc = -3;
+        return NULL;
+    }
+
+    RandomStream rng;
+    TrajectoryState state = { &sv, &rng, readout, outcomes };
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        size_t begin = queue->next;
+        queue->next = begin + TRAJECTORY_CHUNK;
+        pthread_mutex_unlock(&queue->lock);
+        if (begin >= queue->total) break;
+        size_t end = begin + TRAJECTORY_CHUNK < queue->total ? begin + TRAJECTORY_CHUNK : queue->total;
+
+        for (size_t k = begin; k < end; k++) {
+            reset_state_vector(&sv);
+            seed_random_stream(&rng, queue->seed, k);
+            int rc = interpret_instructions_trajectory(queue->list, &state);
+            if (rc != 0) {
+                worker->rc = rc;
+                // Stop handing out work to everybody
+                pthread_mutex_lock(&queue->lock);
+                queue->next = queue->total;
+                pthread_mutex_unlock(&queue->lock);
+                break;
+            }
+            for (size_t q = 0; q < n; q++) {
+                if (outcomes[q] < 0) continue;
+                worker->measured[q]++;
+                worker->ones[q] += (size_t)outcomes[q];
+            }
+        }
+        if (worker->rc != 0) break;
+    }
+    free_state_vector(&sv);
+    free(readout);
+    free(outcomes);
+    return NULL;
+}
+
+int run_noise_trajectories(const InstructionList* instructions, const TrajectoryOptions* options,
+                           TrajectoryResult* result) {
+    if (!instructions || !result) return -1;
+    TrajectoryOptions defaults;
+    if (!options) {
+        init_trajectory_options(&defaults);
+        options = &defaults;
+    }
+    memset(result, 0, sizeof(*result));
+
+    size_t n = options->num_qubits ? options->num_qubits : instruction_list_num_qubits(instructions);
+    size_t total = options->trajectories ? options->trajectories : TRAJECTORY_DEFAULT_COUNT;
+    size_t budget = options->memory_budget ? options->memory_budget : detect_memory_budget();
+
+    // Every worker holds one dense state: run as many as the budget allows
+    MemoryPlan plan;
+    if (plan_memory(instructions, n, ENGINE_DENSE, 0.0f, &plan) != 0) return -1;
+    size_t fit = (plan.overflow || plan.peak_bytes == 0) ? 0 : budget / plan.peak_bytes;
+    if (budget == 0) fit = 1; // unknown budget: assume one state fits
+    if (fit == 0) {
+        log_message(LOG_LEVEL_ERROR, "Trajectories refused: %zu qubits need %zu bytes per worker, budget is %zu.",
+                    n, plan.peak_bytes, budget);
+        return -2;
+    }
+    size_t threads = options->threads;
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 1 ? (size_t)online : 1;
+    }
+    if (threads > fit) threads = fit;
+    size_t chunks = (total + TRAJECTORY_CHUNK - 1) / TRAJECTORY_CHUNK;
+    if (threads > chunks) threads = chunks ? chunks : 1;
+
+    result->num_qubits = n;
+    result->ones = (size_t*)calloc(n + 1, sizeof(size_t));
+    result->measured = (size_t*)calloc(n + 1, sizeof(size_t));
+    TrajectoryWorker* workers = (TrajectoryWorker*)calloc(threads, sizeof(TrajectoryWorker));
+    size_t* counts = (size_t*)calloc(2 * threads * (n + 1), sizeof(size_t));
+    pthread_t* handles = threads > 1 ? (pthread_t*)malloc((threads - 1) * sizeof(pthread_t)) : NULL;
+    if (!result->ones || !result->measured || !workers || !counts || (threads > 1 && !handles)) {
+        free(workers);
+        free(counts);
+        free(handles);
+        free_trajectory_result(result);
+        return -3;
+    }
+
+    TrajectoryQueue queue = { instructions, n, total, 0, options->seed, PTHREAD_MUTEX_INITIALIZER };
+    for (size_t t = 0; t < threads; t++) {
+        workers[t].queue = &queue;
+        workers[t].ones = &counts[2 * t * (n + 1)];
+        workers[t].measured = &counts[(2 * t + 1) * (n + 1)];
+    }
+
+    // The calling thread is worker 0
+    double t0 = now_seconds();
+    size_t started = 0;
+    for (size_t t = 1; t < threads; t++) {
+        if (pthread_create(&handles[t - 1], NULL, trajectory_worker, &workers[t]) != 0) break;
+        started++;
+    }
+    trajectory_worker(&workers[0]);
+    for (size_t t = 0; t < started; t++) pthread_join(handles[t], NULL);
+    result->seconds = now_seconds() - t0;
+    result->threads = started + 1;
+
+    int rc = 0;
+    for (size_t t = 0; t < started + 1; t++) {
+        if (workers[t].rc != 0 && rc == 0) rc = workers[t].rc;
+        for (size_t q = 0; q < n; q++) {
+            result->ones[q] += workers[t].ones[q];
+            result->measured[q] += workers[t].measured[q];
+        }
+    }
+    free(workers);
+    free(counts);
+    free(handles);
+    if (rc != 0) {
+        free_trajectory_result(result);
+        return rc;
+    }
+
+    result->trajectories = total;
+    for (size_t q = 0; q < n; q++) {
+        if (result->measured[q] == 0) continue;
+        double se = trajectory_standard_error(trajectory_probability(result, q), result->measured[q]);
+        if (se > result->max_standard_error) result->max_standard_error = se;
+    }
+    log_message(LOG_LEVEL_INFO, "Noise trajectories: %zu on %zu thread(s) in %.3f s, max standard error %.3g.",
+                total, result->threads, result->seconds, result->max_standard_error);
+    return 0;
+}
+
+double trajectory_probability(const TrajectoryResult* result, size_t qubit) {
+    if (!result || qubit >= result->num_qubits || !result->measured || result->measured[qubit] == 0) return -1.0;
+    return (double)result->ones[qubit] / (double)result->measured[qubit];
+}
+
+double trajectory_standard_error(double probability, size_t trajectories) {
+    if (trajectories == 0 || probability < 0.0 || probability > 1.0) return 0.0;
+    return sqrt(probability * (1.0 - probability) / (double)trajectories);
+}
+
+size_t trajectories_for_error(double probability, double target_error) {
+    if (!(target_error > 0.0)) return 0;
+    if (probability <= 0.0 || probability >= 1.0) probability = 0.5;
+    double needed = probability * (1.0 - probability) / (target_error * target_error);
+    return (size_t)ceil(needed - 1e-9 * needed); // no extra trajectory for rounding noise
+}
+
+void print_trajectory_result(const TrajectoryResult* result) {
+    if (!result) return;
+    printf("Noise trajectories: %zu on %zu thread(s), %.6f s\n", result->trajectories, result->threads,
+           result->seconds);
+    for (size_t q = 0; q < result->num_qubits; q++) {
+        if (result->measured[q] == 0) continue;
+        double p = trajectory_probability(result, q);
+        printf("  qubit %zu: P(1) = %.4f +/- %.4f\n", q, p, trajectory_standard_error(p, result->measured[q]));
+    }
+}
+
+void free_trajectory_result(TrajectoryResult* result) {
+    if (!result) return;
+    free(result->ones);
+    free(result->measured);
+    memset(result, 0, sizeof(*result));
+}
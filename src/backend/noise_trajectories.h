@@ -0,0 +1,96 @@
+#ifndef NOISE_TRAJECTORIES_H
+#define NOISE_TRAJECTORIES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../assembly/parser.h"
+
+/**
+ * \brief Trajectories run_noise_trajectories runs when none are requested. Enough for a
+ *        standard error of at most 0.016 on every measured probability.
+ */
+#define TRAJECTORY_DEFAULT_COUNT 1000
+
+/**
+ * \brief Knobs for a noise-trajectory run.
+ */
+typedef struct TrajectoryOptions {
+    size_t   trajectories;  /**< Trajectories to run, 0 => TRAJECTORY_DEFAULT_COUNT */
+    size_t   threads;       /**< Worker threads, 0 => online CPUs; capped by the trajectory count
+                                 and by how many dense states fit the memory budget */
+    size_t   memory_budget; /**< Bytes, 0 => cgroup limit or physical RAM */
+    size_t   num_qubits;    /**< Register size, 0 => highest qubit index + 1 */
+    uint64_t seed;          /**< Trajectory k draws from stream k of this seed, so the result does
+                                 not depend on the thread count */
+} TrajectoryOptions;
+
+/**
+ * \brief Measurement statistics of a noise-trajectory run.
+ */
+typedef struct TrajectoryResult {
+    size_t  num_qubits;
+    size_t  trajectories;       /**< Trajectories run */
+    size_t  threads;            /**< Workers that ran them */
+    size_t* ones;               /**< Per qubit: trajectories whose last reported outcome was 1 */
+    size_t* measured;           /**< Per qubit: trajectories that measured the qubit */
+    double  max_standard_error; /**< Largest standard error over the measured qubits */
+    double  seconds;            /**< Wall time of the trajectories */
+} TrajectoryResult;
+
+/**
+ * \brief Fills options with defaults (TRAJECTORY_DEFAULT_COUNT trajectories on every core, seed 0).
+ */
+void init_trajectory_options(TrajectoryOptions* options);
+
+/**
+ * \brief Estimates the measurement statistics of a noisy circuit by Monte Carlo over quantum
+ *        trajectories (interpret_instructions_trajectory). Trajectories are spread over
+ *        worker threads that each own one dense state, reset between trajectories, so memory
+ *        is O(2^n) per worker however many trajectories run.
+ * \param instructions Parsed instructions, with DEPOLARIZE/DAMP/READOUT statements
+ * \param options Run options (NULL => defaults)
+ * \param result Output (release with free_trajectory_result)
+ * \return 0 on success, -2 if not even one dense state fits the budget, -3 on allocation
+ *         failure, other nonzero values from the interpreter
+ */
+int run_noise_trajectories(const InstructionList* instructions, const TrajectoryOptions* options,
+                           TrajectoryResult* result);
+
+/**
+ * \brief Estimated probability that a qubit reads 1, or -1 if no trajectory measured it.
+ */
+double trajectory_probability(const TrajectoryResult* result, size_t qubit);
+
+/**
+ * \brief Standard error sqrt(p (1 - p) / N) of a probability p estimated from N trajectories.
+ *        It shrinks as 1 / sqrt(N): four times the trajectories halve it.
+ */
+double trajectory_standard_error(double probability, size_t trajectories);
+
+/**
+ * \brief Trajectories needed to estimate a probability near 'probability' with standard
+ *        error 'target_error': p (1 - p) / target^2, rounded up. Estimates of exactly 0 or 1
+ *        carry no variance information, so they use the worst case p = 1/2.
+ * \return The trajectory count, or 0 if target_error is not positive
+ */
+size_t trajectories_for_error(double probability, double target_error);
+
+/**
+ * \brief Prints the per-qubit estimates with their standard errors.
+ */
+void print_trajectory_result(const TrajectoryResult* result);
+
+/**
+ * \brief Frees resources associated with a TrajectoryResult.
+ */
+void free_trajectory_result(TrajectoryResult* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NOISE_TRAJECTORIES_H */
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <string.h>
+#include <unistd.h>
 #include "../core/gate_operations.h"
 #include "../core/measurement.h"
 
@@ -13,8 +14,8 @@ typedef struct {
     StateVector* sv;
     const float* gate;
     size_t qubit_index;
-    size_t start_index;
-    size_t end_index;
+    size_t start_index; /**< First amplitude pair (pairs are numbered with the target bit removed) */
+    size_t end_index;   /**< One past the last pair */
 } GateThreadData;
 
 /**
@@ -30,32 +31,30 @@ static void* gate_thread_func(void* arg) {
 
     size_t block_size = (size_t)1 << q_idx;
 
-    for (size_t base = start; base < end; base += (block_size << 1)) {
-        for (size_t offset = 0; offset < block_size; offset++) {
-            size_t i0 = base + offset;
-            size_t i1 = i0 + block_size;
-            if (i1 >= end) break; // ensure we don't go out of range
-
-            float r0 = sv->real[i0];
-            float i0r = sv->imag[i0];
-            float r1 = sv->real[i1];
-            float i1r = sv->imag[i1];
-
-            float new_r0 = gate[0] * r0 - gate[1] * i0r 
-                         + gate[2] * r1 - gate[3] * i1r;
-            float new_i0 = gate[0] * i0r + gate[1] * r0 
-                         + gate[2] * i1r + gate[3] * r1;
-
-            float new_r1 = gate[4] * r0 - gate[5] * i0r 
-                         + gate[6] * r1 - gate[7] * i1r;
-            float new_i1 = gate[4] * i0r + gate[5] * r0 
-                         + gate[6] * i1r + gate[7] * r1;
-
-            sv->real[i0] = new_r0;
-            sv->imag[i0] = new_i0;
-            sv->real[i1] = new_r1;
-            sv->imag[i1] = new_i1;
-        }
+    // Threads own whole pairs, so a pair never straddles two threads' ranges
+    for (size_t pair = start; pair < end; pair++) {
+        size_t i0 = ((pair >> q_idx) << (q_idx + 1)) | (pair & (block_size - 1));
+        size_t i1 = i0 + block_size;
+
+        float r0 = sv->real[i0];
+        float i0r = sv->imag[i0];
+        float r1 = sv->real[i1];
+        float i1r = sv->imag[i1];
+
+        float new_r0 = gate[0] * r0 - gate[1] * i0r 
+                     + gate[2] * r1 - gate[3] * i1r;
+        float new_i0 = gate[0] * i0r + gate[1] * r0 
+                     + gate[2] * i1r + gate[3] * r1;
+
+        float new_r1 = gate[4] * r0 - gate[5] * i0r 
+                     + gate[6] * r1 - gate[7] * i1r;
+        float new_i1 = gate[4] * i0r + gate[5] * r0 
+                     + gate[6] * i1r + gate[7] * r1;
+
+        sv->real[i0] = new_r0;
+        sv->imag[i0] = new_i0;
+        sv->real[i1] = new_r1;
+        sv->imag[i1] = new_i1;
     }
 
     return NULL;
@@ -69,7 +68,8 @@ int parallel_apply_single_qubit_gate(StateVector* sv, const float* gate, size_t
         return apply_single_qubit_gate(sv, gate, qubit_index);
     }
 
-    size_t length = (size_t)1 << sv->num_qubits;
+    size_t length = (size_t)1 << (sv->num_qubits - 1); // amplitude pairs
+    if ((size_t)num_threads > length) num_threads = (int)length;
     pthread_t* threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
     GateThreadData* thread_data = (GateThreadData*)malloc(num_threads * sizeof(GateThreadData));
 
@@ -175,3 +175,133 @@ int parallel_measure_all(StateVector* sv, int* results, int num_threads) {
 
     return 0;
 }
+
+/**
+ * \brief Amplitudes a Pauli-expectation worker claims at once.
+ */
+#define PAULI_CHUNK_AMPLITUDES ((size_t)1 << 16)
+
+/**
+ * \brief Chunks of all groups' passes, handed out in order under 'lock'.
+ */
+typedef struct {
+    const StateVector*   sv;
+    const PauliGrouping* grouping;
+    const size_t*        chunk_units; /**< Per group: units in one chunk */
+    const size_t*        first_chunk; /**< Per group: index of its first chunk; [num_groups] = total */
+    size_t               next;
+    pthread_mutex_t      lock;
+} PauliQueue;
+
+typedef struct {
+    PauliQueue* queue;
+    double*     acc; /**< One accumulator per entry of grouping->order */
+    int         rc;
+} PauliWorker;
+
+static void* pauli_worker(void* arg) {
+    PauliWorker* worker = (PauliWorker*)arg;
+    PauliQueue* queue = worker->queue;
+    const PauliGrouping* grouping = queue->grouping;
+    size_t total = queue->first_chunk[grouping->num_groups];
+    size_t g = 0;
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        size_t chunk = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+        if (chunk >= total) break;
+        while (queue->first_chunk[g + 1] <= chunk) g++;
+        size_t begin = (chunk - queue->first_chunk[g]) * queue->chunk_units[g];
+        int rc = pauli_group_pass(queue->sv, grouping, g, begin, begin + queue->chunk_units[g], worker->acc);
+        if (rc != 0) {
+            worker->rc = rc;
+            break;
+        }
+    }
+    return NULL;
+}
+
+int parallel_pauli_sum_expectation(const StateVector* sv, const PauliSum* sum, int num_threads,
+                                   double* out_total, double* out_terms) {
+    if (!sv || !sum || !out_total) return -1;
+    PauliGrouping grouping;
+    int rc = group_pauli_terms(sum, sv->num_qubits, &grouping);
+    if (rc != 0) return rc;
+
+    size_t groups = grouping.num_groups;
+    size_t* chunk_units = (size_t*)malloc((groups ? groups : 1) * sizeof(size_t));
+    size_t* first_chunk = (size_t*)malloc((groups + 1) * sizeof(size_t));
+    if (!chunk_units || !first_chunk) {
+        free(chunk_units);
+        free(first_chunk);
+        free_pauli_grouping(&grouping);
+        return -1;
+    }
+    size_t amplitudes = (size_t)1 << sv->num_qubits;
+    first_chunk[0] = 0;
+    for (size_t g = 0; g < groups; g++) {
+        size_t units = pauli_group_units(&grouping, g);
+        size_t per_unit = units ? amplitudes / units : 1;
+        size_t chunk = per_unit >= PAULI_CHUNK_AMPLITUDES ? 1 : PAULI_CHUNK_AMPLITUDES / per_unit;
+        chunk_units[g] = chunk;
+        first_chunk[g + 1] = first_chunk[g] + (units + chunk - 1) / chunk;
+    }
+
+    size_t threads = num_threads > 0 ? (size_t)num_threads : 0;
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 1 ? (size_t)online : 1;
+    }
+    if (threads > first_chunk[groups]) threads = first_chunk[groups] ? first_chunk[groups] : 1;
+
+    size_t entries = grouping.num_terms ? grouping.num_terms : 1;
+    PauliWorker* workers = (PauliWorker*)calloc(threads, sizeof(PauliWorker));
+    double* acc = (double*)calloc(threads * entries, sizeof(double));
+    pthread_t* handles = threads > 1 ? (pthread_t*)malloc((threads - 1) * sizeof(pthread_t)) : NULL;
+    if (!workers || !acc || (threads > 1 && !handles)) {
+        free(workers);
+        free(acc);
+        free(handles);
+        free(chunk_units);
+        free(first_chunk);
+        free_pauli_grouping(&grouping);
+        return -1;
+    }
+
+    PauliQueue queue = { sv, &grouping, chunk_units, first_chunk, 0, PTHREAD_MUTEX_INITIALIZER };
+    for (size_t t = 0; t < threads; t++) {
+        workers[t].queue = &queue;
+        workers[t].acc = &acc[t * entries];
+    }
+
+    // The calling thread is worker 0
+    size_t started = 0;
+    for (size_t t = 1; t < threads; t++) {
+        if (pthread_create(&handles[t - 1], NULL, pauli_worker, &workers[t]) != 0) break;
+        started++;
+    }
+    pauli_worker(&workers[0]);
+    for (size_t t = 0; t < started; t++) pthread_join(handles[t], NULL);
+
+    // Merge in worker order
+    double total = 0.0;
+    for (size_t e = 0; e < grouping.num_terms; e++) {
+        double value = 0.0;
+        for (size_t t = 0; t < started + 1; t++) value += workers[t].acc[e];
+        size_t term = grouping.order[e];
+        total += sum->terms[term].coefficient * value;
+        if (out_terms) out_terms[term] = value;
+    }
+    for (size_t t = 0; t < started + 1; t++) {
+        if (workers[t].rc != 0 && rc == 0) rc = workers[t].rc;
+    }
+    *out_total = total;
+
+    free(workers);
+    free(acc);
+    free(handles);
+    free(chunk_units);
+    free(first_chunk);
+    free_pauli_grouping(&grouping);
+    return rc;
+}
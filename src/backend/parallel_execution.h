@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 #include "../core/state_vector.h"
+#include "../core/pauli_expectation.h"
 
 /**
  * \brief Parallelize the application of a single-qubit gate to a large state vector using threads.
@@ -30,6 +31,19 @@ int parallel_apply_single_qubit_gate(StateVector* sv, const float* gate, size_t
  */
 int parallel_measure_all(StateVector* sv, int* results, int num_threads);
 
+/**
+ * \brief <psi|H|psi> of a weighted Pauli sum, as pauli_sum_expectation but with each group's
+ *        read-only pass split into chunks of cosets that the threads claim from a shared counter.
+ * \param sv Normalized state (not modified)
+ * \param sum Terms
+ * \param num_threads Number of threads (<= 0 => online processors)
+ * \param out_total Receives sum_t c_t <P_t>
+ * \param out_terms Optional, sum->size entries: each <P_t> without its coefficient
+ * \return 0 on success, nonzero on error
+ */
+int parallel_pauli_sum_expectation(const StateVector* sv, const PauliSum* sum, int num_threads,
+                                   double* out_total, double* out_terms);
+
 #ifdef __cplusplus
 }
 #endif
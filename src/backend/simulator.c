@@ -0,0 +1,507 @@
+#include "simulator.h"
+#include "../assembly/interpreter.h"
+#include "../assembly/bytecode.h"
+#include "../core/state_vector.h"
+#include "../core/sparse_state_vector.h"
+#include "circuit_partition.h"
+#include "../utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void init_simulation_options(SimulationOptions* options) {
+    if (!options) return;
+    memset(options, 0, sizeof(*options));
+    options->engine = ENGINE_AUTO;
+    options->allow_engine_fallback = 1;
+}
+
+/**
+ * \brief Runs an admitted circuit on one engine. 'mps_max_bond' overrides the option of the
+ *        same name, so automatic choices can size the MPS per qubit group.
+ * \return 0 on success, -3 if the state cannot be allocated, -4 if the circuit does not
+ *         compile or bind, other nonzero values from the interpreter
+ */
+static int run_on_engine(const InstructionList* instructions, size_t num_qubits, EngineKind engine,
+                         size_t mps_max_bond, const SimulationOptions* options, int* promoted,
+                         CompressionStats* compression, MpsStats* mps_stats) {
+    int rc = 0;
+    switch (engine) {
+        case ENGINE_DENSE: {
+            // Lower once; validation and gate lookup stay out of the execution loop
+            BytecodeProgram program;
+            if (compile_bytecode(instructions, num_qubits, &program) != 0) return -4;
+            if (program.num_params > 0 &&
+                bind_bytecode_parameters(&program, options->param_values, options->num_param_values) != 0) {
+                free_bytecode(&program);
+                return -4;
+            }
+            StateVector sv;
+            if (init_state_vector(&sv, num_qubits) != 0) {
+                free_bytecode(&program);
+                return -3;
+            }
+            rc = execute_bytecode(&program, &sv);
+            free_state_vector(&sv);
+            free_bytecode(&program);
+            break;
+        }
+        case ENGINE_COMPRESSED: {
+            CompressedStateVector csv;
+            if (init_compressed_state_vector(&csv, num_qubits, options->compression_block_qubits,
+                                             options->compression_max_error) != 0) {
+                return -3;
+            }
+            rc = interpret_instructions_compressed(instructions, &csv);
+            get_compression_stats(&csv, compression);
+            free_compressed_state_vector(&csv);
+            break;
+        }
+        case ENGINE_SPARSE: {
+            SparseStateVector ssv;
+            StateVector sv;
+            if (init_sparse_state_vector(&ssv, num_qubits, options->sparse_density_threshold) != 0) {
+                return -3;
+            }
+            rc = interpret_instructions_sparse(instructions, &ssv, &sv, promoted);
+            if (*promoted) {
+                free_state_vector(&sv);
+            } else {
+                free_sparse_state_vector(&ssv);
+            }
+            break;
+        }
+        case ENGINE_STABILIZER: {
+            StabilizerTableau tableau;
+            if (init_stabilizer_tableau(&tableau, num_qubits) != 0) return -3;
+            rc = interpret_instructions_stabilizer(instructions, &tableau);
+            free_stabilizer_tableau(&tableau);
+            break;
+        }
+        case ENGINE_MPS: {
+            MpsState mps;
+            // Option 0 is the default and negative keeps everything; init_mps_state uses < 0 and 0
+            double truncation = options->mps_truncation;
+            if (truncation == 0.0) truncation = -1.0;
+            else if (truncation < 0.0) truncation = 0.0;
+            if (init_mps_state(&mps, num_qubits, mps_max_bond, truncation) != 0) return -3;
+            rc = interpret_instructions_mps(instructions, &mps);
+            get_mps_stats(&mps, mps_stats);
+            free_mps_state(&mps);
+            break;
+        }
+        default:
+            return -1;
+    }
+    return rc;
+}
+
+/**
+ * \brief One independently simulated qubit group (the whole register when not split).
+ */
+typedef struct {
+    const InstructionList* list;  /**< Circuit to run: 'owned', or the caller's list */
+    InstructionList   owned;      /**< Extracted component circuit */
+    size_t            num_qubits;
+    size_t            mps_max_bond;
+    MemoryPlan        plan;
+    AdmissionDecision admission;
+    int               promoted;
+    CompressionStats  compression;
+    MpsStats          mps;
+    int               rc;
+    MeasurementLog    log;        /**< Split runs: outcomes, printed in program order afterwards */
+    char              selection[ENGINE_EXPLANATION_LENGTH]; /**< ENGINE_AUTO: why plan.engine was picked */
+} Component;
+
+typedef struct {
+    Component*               components;
+    size_t                   count;
+    size_t                   next;   /**< Next component to hand out, under 'lock' */
+    pthread_mutex_t          lock;
+    const SimulationOptions* options;
+    int                      capture; /**< 1 => outcomes go to each component's log */
+} ComponentQueue;
+
+static void* component_worker(void* arg) {
+    ComponentQueue* queue = (ComponentQueue*)arg;
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        size_t c = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+        if (c >= queue->count) return NULL;
+        Component* comp = &queue->components[c];
+        if (queue->capture) set_measurement_log(&comp->log);
+        comp->rc = run_on_engine(comp->list, comp->num_qubits, comp->plan.engine, comp->mps_max_bond,
+                                 queue->options, &comp->promoted, &comp->compression, &comp->mps);
+        if (queue->capture) set_measurement_log(NULL);
+    }
+}
+
+/**
+ * \brief Runs the components on up to 'workers' threads (the caller is one of them). Split
+ *        runs log their outcomes instead of printing them (see print_outcomes_in_order).
+ */
+static void run_components(Component* components, size_t count, size_t workers, const SimulationOptions* options) {
+    ComponentQueue queue = { components, count, 0, PTHREAD_MUTEX_INITIALIZER, options, count > 1 };
+    pthread_t* threads = (workers > 1) ? (pthread_t*)malloc((workers - 1) * sizeof(pthread_t)) : NULL;
+    size_t started = 0;
+    for (size_t t = 1; threads && t < workers; t++) {
+        if (pthread_create(&threads[t - 1], NULL, component_worker, &queue) != 0) break;
+        started++;
+    }
+    component_worker(&queue);
+    for (size_t t = 0; t < started; t++) pthread_join(threads[t], NULL);
+    free(threads);
+}
+
+/**
+ * \brief One open REPEAT (iterations left, index of the REPEAT) or CALL (return index).
+ */
+typedef struct {
+    int      is_call;
+    uint32_t remaining;
+    size_t   index;
+} ReplayFrame;
+
+/**
+ * \brief Prints the components' logged outcomes in the order an unsplit run prints them. The
+ *        original program's control flow is replayed without a state, and every printed
+ *        MEASURE takes the next outcome of its qubit's component: a component keeps the block
+ *        structure of the whole circuit and logs IF-skipped measurements, so its log lines up.
+ */
+static void print_outcomes_in_order(const InstructionList* list, const size_t* component_of,
+                                    Component* components, size_t count) {
+    size_t pending = 0;
+    for (size_t c = 0; c < count; c++) pending += components[c].log.size;
+    if (pending == 0) return;
+    size_t* next = (size_t*)calloc(count, sizeof(size_t));
+    ReplayFrame* frames = NULL;
+    size_t depth = 0, capacity = 0;
+    size_t pc = 0;
+    while (next && pc < list->size && pending > 0) {
+        const Instruction* instr = &list->data[pc];
+        if (instr->type == INSTR_REPEAT || instr->type == INSTR_CALL) {
+            if (instr->type == INSTR_REPEAT && instr->repeat_count == 0) {
+                pc = instr->link + 1;
+                continue;
+            }
+            if (depth == capacity) {
+                capacity = capacity ? capacity * 2 : 16;
+                ReplayFrame* grown = (ReplayFrame*)realloc(frames, capacity * sizeof(ReplayFrame));
+                if (!grown) break;
+                frames = grown;
+            }
+            frames[depth].is_call = (instr->type == INSTR_CALL);
+            frames[depth].remaining = instr->repeat_count;
+            frames[depth].index = (instr->type == INSTR_CALL) ? pc + 1 : pc;
+            depth++;
+            pc = (instr->type == INSTR_CALL) ? (size_t)instr->link + 1 : pc + 1;
+        } else if (instr->type == INSTR_DEF) {
+            pc = instr->link + 1;
+        } else if (instr->type == INSTR_BLOCK_END) {
+            if (depth == 0) break;
+            ReplayFrame* top = &frames[depth - 1];
+            if (top->is_call) {
+                pc = top->index;
+                depth--;
+            } else if (--top->remaining > 0) {
+                pc = top->index + 1;
+            } else {
+                depth--;
+                pc++;
+            }
+        } else {
+            if (instr->type == INSTR_MEASURE && !instr->target_reg) {
+                size_t c = component_of[instr->qubits[0]];
+                if (c < count && next[c] < components[c].log.size) {
+                    const MeasurementLog* log = &components[c].log;
+                    if (log->outcomes[next[c]] >= 0) {
+                        printf("Measurement of qubit %zu => %d\n", log->qubits[next[c]], log->outcomes[next[c]]);
+                    }
+                    next[c]++;
+                    pending--;
+                }
+            }
+            pc++;
+        }
+    }
+    // Anything the replay could not place (allocation failure) is still printed
+    for (size_t c = 0; c < count && pending > 0; c++) {
+        const MeasurementLog* log = &components[c].log;
+        for (size_t k = next ? next[c] : 0; k < log->size; k++) {
+            if (log->outcomes[k] >= 0) printf("Measurement of qubit %zu => %d\n", log->qubits[k], log->outcomes[k]);
+        }
+    }
+    free(frames);
+    free(next);
+}
+
+/**
+ * \brief Splits the circuit into independent qubit groups when that drops qubits from the
+ *        largest state (several groups, or idle qubits in the register).
+ * \param component_of Receives the partition's qubit -> component map (caller frees)
+ * \return Number of components (0 if the circuit is not split)
+ */
+static size_t split_components(const InstructionList* instructions, size_t num_qubits, Component** out,
+                               size_t** component_of) {
+    CircuitPartition part;
+    if (partition_circuit(instructions, num_qubits, &part) != 0) return 0;
+    size_t count = part.num_components;
+    if (count == 0 || (count == 1 && part.component_qubits[0] == num_qubits)) {
+        free_circuit_partition(&part);
+        return 0;
+    }
+    Component* components = (Component*)calloc(count, sizeof(Component));
+    size_t extracted = 0;
+    while (components && extracted < count &&
+           extract_component(instructions, &part, extracted, &components[extracted].owned) == 0) {
+        components[extracted].list = &components[extracted].owned;
+        components[extracted].num_qubits = part.component_qubits[extracted];
+        extracted++;
+    }
+    *component_of = part.component_of;
+    part.component_of = NULL;
+    free_circuit_partition(&part);
+    if (extracted < count) {
+        // Out of memory: run the whole register instead
+        for (size_t c = 0; c < extracted; c++) free_instruction_list(&components[c].owned);
+        free(components);
+        free(*component_of);
+        *component_of = NULL;
+        return 0;
+    }
+    *out = components;
+    return count;
+}
+
+static void free_components(Component* components, size_t count) {
+    for (size_t c = 0; c < count; c++) {
+        if (components[c].list == &components[c].owned) free_instruction_list(&components[c].owned);
+        free_measurement_log(&components[c].log);
+    }
+    free(components);
+}
+
+int simulate_circuit(const InstructionList* instructions, const SimulationOptions* options,
+                     SimulationSummary* summary) {
+    if (!instructions) return -1;
+
+    SimulationOptions defaults;
+    if (!options) {
+        init_simulation_options(&defaults);
+        options = &defaults;
+    }
+    SimulationSummary local;
+    if (!summary) summary = &local;
+    memset(summary, 0, sizeof(*summary));
+
+    size_t num_qubits = options->num_qubits ? options->num_qubits
+                                            : instruction_list_num_qubits(instructions);
+    if (num_qubits == 0) return 0; // nothing to simulate
+
+    // Qubit groups that never interact get their own small state: 2 x 2^20, not 2^40
+    Component* components = NULL;
+    size_t* component_of = NULL;
+    size_t count = options->disable_splitting ? 0
+                                              : split_components(instructions, num_qubits, &components, &component_of);
+    if (count == 0) {
+        components = (Component*)calloc(1, sizeof(Component));
+        if (!components) return -3;
+        components[0].list = instructions;
+        components[0].num_qubits = num_qubits;
+        count = 1;
+    }
+    summary->components = count;
+
+    // The automatic engine choice predicts with the same model the pre-run report uses
+    CostModel model;
+    init_cost_model(&model, ENGINE_DENSE, num_qubits);
+    model.max_bond = options->mps_max_bond;
+    if (options->calibrate) calibrate_cost_model(&model);
+
+    // Admission control happens before any state is allocated
+    summary->memory_budget = options->memory_budget ? options->memory_budget : detect_memory_budget();
+    size_t largest = 0;
+    size_t total_peak = 0;
+    for (size_t c = 0; c < count; c++) {
+        Component* comp = &components[c];
+        EngineKind requested = options->engine;
+        comp->mps_max_bond = options->mps_max_bond;
+        if (requested == ENGINE_AUTO) {
+            EngineChoice choice;
+            if (select_engine(comp->list, comp->num_qubits, summary->memory_budget, &model,
+                              options->mps_max_bond, options->disable_stabilizer, &choice) != 0) {
+                free(component_of);
+                free_components(components, count);
+                return -3;
+            }
+            requested = choice.engine;
+            if (choice.engine == ENGINE_MPS) comp->mps_max_bond = choice.mps_max_bond;
+            memcpy(comp->selection, choice.explanation, sizeof(comp->selection));
+            log_message(LOG_LEVEL_DEBUG, "Engine choice: %s.", choice.explanation);
+        } else if (requested == ENGINE_DENSE && !options->disable_stabilizer &&
+                   comp->num_qubits >= STABILIZER_MIN_QUBITS && circuit_is_clifford(comp->list)) {
+            // Clifford-only groups run on a tableau: O(n^2) bits instead of 2^n amplitudes
+            requested = ENGINE_STABILIZER;
+            log_message(LOG_LEVEL_INFO, "Clifford circuit: running %zu qubits on the stabilizer engine.",
+                        comp->num_qubits);
+        }
+        comp->admission = admit_job(comp->list, comp->num_qubits, requested, summary->memory_budget,
+                                    options->allow_engine_fallback, options->compression_max_error,
+                                    &comp->plan);
+        if (comp->admission == ADMIT_REFUSED) {
+            log_message(LOG_LEVEL_ERROR, "Job refused: %zu qubits need %zu bytes on the %s engine, budget is %zu.",
+                        comp->num_qubits, comp->plan.peak_bytes, engine_name(comp->plan.engine),
+                        summary->memory_budget);
+            summary->admission = ADMIT_REFUSED;
+            summary->plan = comp->plan;
+            free(component_of);
+            free_components(components, count);
+            return -2;
+        }
+        if (comp->admission == ADMIT_DOWNGRADED) summary->admission = ADMIT_DOWNGRADED;
+        if (comp->num_qubits > components[largest].num_qubits) largest = c;
+        total_peak = (comp->plan.peak_bytes > SIZE_MAX - total_peak) ? SIZE_MAX : total_peak + comp->plan.peak_bytes;
+    }
+    summary->largest_component = components[largest].num_qubits;
+    summary->engine_used = components[largest].plan.engine;
+    summary->plan = components[largest].plan;
+    memcpy(summary->selection, components[largest].selection, sizeof(summary->selection));
+    if (count > 1) {
+        // Split runs: the plan covers every component alive at once
+        summary->plan.num_qubits = num_qubits;
+        summary->plan.peak_bytes = total_peak;
+        log_message(LOG_LEVEL_INFO, "Circuit splits into %zu independent groups (largest %zu of %zu qubits).",
+                    count, summary->largest_component, num_qubits);
+    }
+
+    model.engine = summary->engine_used;
+    for (size_t c = 0; c < count; c++) {
+        CostModel part = model;
+        CircuitCost cost;
+        part.engine = components[c].plan.engine;
+        part.num_qubits = components[c].num_qubits;
+        part.max_bond = components[c].mps_max_bond;
+        if (estimate_circuit_cost(&part, components[c].list, &cost) != 0) {
+            free(component_of);
+            free_components(components, count);
+            return -3;
+        }
+        summary->predicted.gates += cost.gates;
+        summary->predicted.measurements += cost.measurements;
+        summary->predicted.passes += cost.passes;
+        summary->predicted.bytes += cost.bytes;
+        summary->predicted.flops += cost.flops;
+        summary->predicted.seconds += cost.seconds;
+    }
+    if (options->cost_report) {
+        write_cost_report(options->cost_report, &model, &summary->predicted, &summary->plan);
+        fflush(options->cost_report);
+    }
+
+    // Components are independent, so their outcomes form a product distribution whatever the
+    // order they run in; run them side by side if all of them fit at once
+    size_t workers = 1;
+    if (count > 1 && total_peak <= summary->memory_budget) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = online > 1 ? (size_t)online : 1;
+        if (workers > count) workers = count;
+    }
+    double t0 = now_seconds();
+    run_components(components, count, workers, options);
+    summary->seconds = now_seconds() - t0;
+    if (count > 1) print_outcomes_in_order(instructions, component_of, components, count);
+
+    int rc = 0;
+    double fidelity = 1.0;
+    for (size_t c = 0; c < count; c++) {
+        if (components[c].rc != 0 && rc == 0) rc = components[c].rc;
+        summary->promoted_to_dense |= components[c].promoted;
+        if (components[c].plan.engine != ENGINE_MPS) continue;
+        // Components are a tensor product, so their fidelities multiply
+        const MpsStats* m = &components[c].mps;
+        if (m->peak_bond > summary->mps.peak_bond) summary->mps.peak_bond = m->peak_bond;
+        summary->mps.max_bond = m->max_bond;
+        summary->mps.truncations += m->truncations;
+        fidelity *= 1.0 - m->truncation_error;
+    }
+    summary->compression = components[largest].compression;
+    if (summary->mps.max_bond) {
+        summary->mps.truncation_error = 1.0 - fidelity;
+        log_message(LOG_LEVEL_INFO, "MPS run: peak bond %zu (cap %zu), %zu truncation(s), truncation error %.3g.",
+                    summary->mps.peak_bond, summary->mps.max_bond, summary->mps.truncations,
+                    summary->mps.truncation_error);
+    }
+    free(component_of);
+    free_components(components, count);
+    return rc;
+}
+
+int simulate_file(const char* filename, const SimulationOptions* options, SimulationSummary* summary) {
+    if (!filename) return -1;
+
+    SimulationOptions defaults;
+    if (!options) {
+        init_simulation_options(&defaults);
+        options = &defaults;
+    }
+    SimulationSummary local;
+    if (!summary) summary = &local;
+
+    CompileOptions compile = { options->cache_dir, options->optimize, options->measured_only };
+    CacheStats cache;
+    memset(&cache, 0, sizeof(cache));
+    CompiledCircuit circuit;
+    int rc = compile_circuit_cached(filename, &compile, &circuit, &cache);
+    if (rc != 0) {
+        memset(summary, 0, sizeof(*summary));
+        summary->cache = cache;
+        return rc;
+    }
+
+    rc = simulate_circuit(&circuit.instructions, options, summary);
+    summary->cache = cache;
+    free_compiled_circuit(&circuit);
+    return rc;
+}
+
+void print_simulation_summary(const SimulationSummary* summary) {
+    if (!summary) return;
+    static const char* decisions[] = { "admitted", "downgraded", "refused" };
+    printf("Run summary:\n");
+    printf("  engine    : %s%s\n", engine_name(summary->engine_used),
+           summary->promoted_to_dense ? " (promoted to dense)" : "");
+    printf("  admission : %s\n", decisions[summary->admission]);
+    if (summary->selection[0]) printf("  choice    : %s\n", summary->selection);
+    printf("  peak plan : %zu bytes (budget %zu)\n", summary->plan.peak_bytes, summary->memory_budget);
+    if (summary->components > 1) {
+        printf("  split     : %zu independent groups, largest %zu qubits\n",
+               summary->components, summary->largest_component);
+    }
+    printf("  time      : %.6f s (predicted %.6f s, %.1f state passes)\n", summary->seconds,
+           summary->predicted.seconds, summary->predicted.passes);
+    if (summary->cache.hits + summary->cache.misses > 0) {
+        printf("  cache     : %zu hit(s), %zu miss(es), %zu stored (lookup %.6f s, compile %.6f s)\n",
+               summary->cache.hits, summary->cache.misses, summary->cache.stores,
+               summary->cache.lookup_seconds, summary->cache.compile_seconds);
+    }
+    if (summary->engine_used == ENGINE_COMPRESSED) {
+        printf("  compression ratio %.2fx, %.3f us codec overhead per gate\n",
+               summary->compression.compression_ratio, summary->compression.overhead_per_gate * 1e6);
+    }
+    if (summary->engine_used == ENGINE_MPS) {
+        printf("  mps       : peak bond %zu (cap %zu), %zu truncation(s), truncation error %.3g\n",
+               summary->mps.peak_bond, summary->mps.max_bond, summary->mps.truncations,
+               summary->mps.truncation_error);
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "memory_planner.h"
+#include "../core/compressed_state_vector.h"
+#include "../core/mps_state.h"
+#include "circuit_cache.h"
+#include "cost_model.h"
+#include "engine_selector.h"
+
+/**
+ * \brief Knobs for a single simulation run.
+ */
+typedef struct SimulationOptions {
+    EngineKind engine;                /**< Requested engine; ENGINE_AUTO picks one per qubit group */
+    int        allow_engine_fallback; /**< Nonzero lets admission control pick a cheaper engine */
+    size_t     memory_budget;         /**< Bytes, 0 => cgroup limit or physical RAM */
+    size_t     num_qubits;            /**< Register size, 0 => highest qubit index + 1 */
+    size_t     compression_block_qubits; /**< 0 => COMPRESSED_DEFAULT_BLOCK_QUBITS */
+    float      compression_max_error; /**< 0 => lossless compressed storage */
+    double     sparse_density_threshold; /**< 0 => SPARSE_DEFAULT_DENSITY_THRESHOLD */
+    const char* cache_dir;            /**< simulate_file: compile cache directory, NULL => no cache */
+    int        optimize;              /**< simulate_file: run optimize_circuit after parsing */
+    int        measured_only;         /**< simulate_file: simulate only the light cone of the measurements
+                                           (drops gates and renumbers qubits; leave num_qubits 0) */
+    const double* param_values;       /**< Values of the circuit's symbolic parameters (dense engine) */
+    size_t     num_param_values;
+    FILE*      cost_report;           /**< If set, a JSON pre-run report (write_cost_report) goes here */
+    int        calibrate;             /**< Nonzero times the dense kernels before predicting */
+    int        disable_splitting;     /**< Nonzero runs non-interacting qubit groups in one state anyway */
+    int        disable_stabilizer;    /**< Nonzero keeps Clifford circuits on the requested engine
+                                           (and out of ENGINE_AUTO's candidates) */
+    size_t     mps_max_bond;          /**< MPS bond-dimension cap, 0 => MPS_DEFAULT_MAX_BOND; ENGINE_AUTO
+                                           only picks the MPS engine if its bonds stay within it */
+    double     mps_truncation;        /**< MPS weight dropped per split, 0 => MPS_DEFAULT_TRUNCATION,
+                                           negative => drop only exact zeros */
+} SimulationOptions;
+
+/**
+ * \brief What happened during a run.
+ */
+typedef struct SimulationSummary {
+    AdmissionDecision admission;  /**< Admission control result */
+    size_t     memory_budget;     /**< Budget the plan was checked against */
+    MemoryPlan plan;              /**< Plan of the engine that ran */
+    EngineKind engine_used;       /**< Engine that started the run (of the largest component) */
+    size_t     components;        /**< Independent qubit groups run in separate states */
+    size_t     largest_component; /**< Qubits in the largest of them */
+    int        promoted_to_dense; /**< Sparse runs: 1 if the state was promoted midway */
+    CompressionStats compression; /**< Compressed runs only */
+    MpsStats   mps;               /**< MPS runs only: largest peak bond over the components and
+                                       their combined truncation error */
+    CircuitCost predicted;        /**< Cost model estimate for the engine that ran */
+    char       selection[ENGINE_EXPLANATION_LENGTH]; /**< ENGINE_AUTO runs: why the engine of the
+                                                         largest component was chosen, else empty */
+    double     seconds;           /**< Wall time of the execution phase */
+    CacheStats cache;             /**< simulate_file only: compile cache counters */
+} SimulationSummary;
+
+/**
+ * \brief Fills options with defaults (automatic engine choice, fallback allowed, detected budget).
+ */
+void init_simulation_options(SimulationOptions* options);
+
+/**
+ * \brief Plans memory, applies admission control and runs the circuit on the admitted engine.
+ *        Nothing is allocated for the state if the job is refused. Admitted jobs are costed
+ *        first, and the estimate is written to options->cost_report before execution starts.
+ *        Qubit groups that never interact (partition_circuit) run in separate state vectors,
+ *        in parallel when they all fit the budget at once; idle qubits are not allocated.
+ *        Each group is admitted on its own and the summary's plan adds them up. With
+ *        ENGINE_AUTO each group runs on the engine select_engine predicts cheapest, and the
+ *        reason is logged. A group of at least STABILIZER_MIN_QUBITS qubits whose gates are all
+ *        Clifford is run on the stabilizer engine when the dense engine was requested.
+ * \param instructions Parsed (and optionally optimized) instructions
+ * \param options Run options (NULL => defaults)
+ * \param summary Optional output summary
+ * \return 0 on success, -2 if the job was refused, other nonzero values on error
+ */
+int simulate_circuit(const InstructionList* instructions, const SimulationOptions* options,
+                     SimulationSummary* summary);
+
+/**
+ * \brief Compiles a .qasm file (through the compile cache when options->cache_dir is set)
+ *        and runs it with simulate_circuit.
+ * \param filename Path to the .qasm file
+ * \param options Run options (NULL => defaults)
+ * \param summary Optional output summary, including cache hit/miss counters
+ * \return 0 on success, -2 if the job was refused, other nonzero values on error
+ */
+int simulate_file(const char* filename, const SimulationOptions* options, SimulationSummary* summary);
+
+/**
+ * \brief Prints a run summary.
+ */
+void print_simulation_summary(const SimulationSummary* summary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIMULATOR_H */
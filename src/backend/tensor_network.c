@@ -0,0 +1,877 @@
+#include "tensor_network.h"
+#include "memory_planner.h"
+#include "cost_model.h"
+#include "../assembly/interpreter.h"
+#include "../utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/**
+ * \brief Dense tensor over indices of dimension 2. The bit of idx[k] is bit (rank - 1 - k) of
+ *        an entry's offset, so a 2x2 gate with idx { out, in } is the gate matrix as stored.
+ */
+typedef struct {
+    size_t    rank;
+    uint32_t* idx;   /**< Index ids */
+    float*    data;  /**< 2^rank interleaved complex entries */
+} Tensor;
+
+/**
+ * \brief A circuit's tensor network and its contraction plan. Nodes 0 .. num_leaves - 1 are
+ *        the circuit's tensors; step s contracts two nodes into node num_leaves + s.
+ */
+typedef struct {
+    Tensor*   leaves;
+    size_t    num_leaves;
+    size_t    leaf_capacity;
+    uint32_t  num_indices;
+    size_t    num_qubits;
+    size_t*   wire;       /**< Per qubit: open index at the current end of its wire */
+    size_t*   bra;        /**< Per qubit: leaf holding <x_q| */
+    size_t  (*steps)[2];  /**< num_leaves - 1 operand pairs */
+    uint32_t* sliced;     /**< Sliced index ids; bit k of a slice number fixes sliced[k] */
+    size_t    num_sliced;
+} Network;
+
+static void free_network(Network* net) {
+    for (size_t l = 0; l < net->num_leaves; l++) {
+        free(net->leaves[l].idx);
+        free(net->leaves[l].data);
+    }
+    free(net->leaves);
+    free(net->wire);
+    free(net->bra);
+    free(net->steps);
+    free(net->sliced);
+    memset(net, 0, sizeof(*net));
+}
+
+static int add_leaf(Network* net, size_t rank, const uint32_t* idx, const float* data) {
+    if (net->num_leaves == net->leaf_capacity) {
+        size_t capacity = net->leaf_capacity ? net->leaf_capacity * 2 : 64;
+        Tensor* grown = (Tensor*)realloc(net->leaves, capacity * sizeof(Tensor));
+        if (!grown) return -1;
+        net->leaves = grown;
+        net->leaf_capacity = capacity;
+    }
+    Tensor* t = &net->leaves[net->num_leaves];
+    size_t floats = (size_t)2 << rank;
+    t->rank = rank;
+    t->idx = (uint32_t*)malloc(rank * sizeof(uint32_t));
+    t->data = (float*)malloc(floats * sizeof(float));
+    if (!t->idx || !t->data) {
+        free(t->idx);
+        free(t->data);
+        return -1;
+    }
+    memcpy(t->idx, idx, rank * sizeof(uint32_t));
+    if (data) memcpy(t->data, data, floats * sizeof(float));
+    else memset(t->data, 0, floats * sizeof(float));
+    net->num_leaves++;
+    return 0;
+}
+
+/**
+ * \brief Matrix of a gate instruction: 8 floats for single-qubit gates, 32 (apply_two_qubit_gate
+ *        layout) for CNOT and CPHASE.
+ * \return 0 on success, -3 for a gate that cannot be resolved
+ */
+static int gate_tensor(const Instruction* instr, const TensorNetworkOptions* options, float* m) {
+    float angles[MAX_GATE_PARAMS];
+    for (size_t k = 0; k < instr->param_count; k++) {
+        int16_t id = instr->param_ids[k];
+        if (id >= 0 && (size_t)id >= options->num_param_values) {
+            fprintf(stderr, "Tensor network error: gate '%s' has an unbound parameter.\n", instr->gate_name);
+            return -3;
+        }
+        angles[k] = id >= 0 ? (float)(instr->params[k] * options->param_values[id]) : instr->params[k];
+    }
+
+    if (instr->type == INSTR_GATE_SINGLE) {
+        const float* gate = instr->has_matrix ? instr->matrix : NULL;
+        if (!gate && instr->param_count == 0) gate = find_single_qubit_gate(instr->gate_name);
+        if (gate) memcpy(m, gate, 8 * sizeof(float));
+        else if (instr->param_count == 0 || parameterized_gate_matrix(instr->gate_name, angles, m) != 0) {
+            fprintf(stderr, "Tensor network error: unknown gate '%s'.\n", instr->gate_name);
+            return -3;
+        }
+        return 0;
+    }
+
+    memset(m, 0, 32 * sizeof(float));
+    if (strcasecmp(instr->gate_name, "CNOT") == 0) {
+        // |00>, |01> unchanged; |10> <-> |11>
+        m[0] = m[10] = m[22] = m[28] = 1.0f;
+    } else if (strcasecmp(instr->gate_name, "CPHASE") == 0 && instr->param_count == 1) {
+        float phase[8];
+        if (parameterized_gate_matrix("CPHASE", angles, phase) != 0) return -3;
+        m[0] = m[10] = m[20] = 1.0f;
+        m[30] = phase[0];
+        m[31] = phase[1];
+    } else {
+        fprintf(stderr, "Tensor network error: unknown gate '%s'.\n", instr->gate_name);
+        return -3;
+    }
+    return 0;
+}
+
+/**
+ * \brief Appends one gate: its tensor joins the open ends of its wires to fresh indices.
+ */
+static int add_gate(Network* net, const Instruction* instr, const TensorNetworkOptions* options) {
+    float m[32];
+    int rc = gate_tensor(instr, options, m);
+    if (rc != 0) return rc;
+    size_t count = instr->type == INSTR_GATE_SINGLE ? 1 : 2;
+    if (instr->qubit_count != count) return -3;
+    for (size_t s = 0; s < count; s++) {
+        if (instr->qubits[s] >= net->num_qubits) return -1;
+    }
+    if (count == 2 && instr->qubits[0] == instr->qubits[1]) {
+        fprintf(stderr, "Tensor network error: %s control equals target.\n", instr->gate_name);
+        return -3;
+    }
+    uint32_t idx[4];
+    for (size_t s = 0; s < count; s++) {
+        idx[s] = net->num_indices++;
+        idx[count + s] = (uint32_t)net->wire[instr->qubits[s]];
+        net->wire[instr->qubits[s]] = idx[s];
+    }
+    return add_leaf(net, 2 * count, idx, m) != 0 ? -1 : 0;
+}
+
+/**
+ * \brief Builds the network, following REPEAT/DEF/CALL blocks as the interpreter does.
+ */
+static int build_network(const InstructionList* list, size_t num_qubits, const TensorNetworkOptions* options,
+                         Network* net) {
+    memset(net, 0, sizeof(*net));
+    net->num_qubits = num_qubits;
+    net->wire = (size_t*)malloc((num_qubits + 1) * sizeof(size_t));
+    net->bra = (size_t*)malloc((num_qubits + 1) * sizeof(size_t));
+    if (!net->wire || !net->bra) return -1;
+
+    static const float ket[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    for (size_t q = 0; q < num_qubits; q++) {
+        uint32_t idx = net->num_indices++;
+        net->wire[q] = idx;
+        if (add_leaf(net, 1, &idx, ket) != 0) return -1;
+    }
+
+    struct { int is_call; uint32_t remaining; size_t index; } frames[2 * MAX_BLOCK_DEPTH + 2];
+    size_t depth = 0;
+    size_t pc = 0;
+    while (pc < list->size) {
+        const Instruction* instr = &list->data[pc];
+        if (instr->cond_reg || instr->type == INSTR_MEASURE) {
+            fprintf(stderr, "Tensor network error: amplitudes need a circuit without measurements or IF.\n");
+            return -3;
+        }
+        switch (instr->type) {
+            case INSTR_REPEAT:
+            case INSTR_CALL:
+                if (instr->type == INSTR_REPEAT && instr->repeat_count == 0) {
+                    pc = instr->link + 1;
+                    break;
+                }
+                if (depth == sizeof(frames) / sizeof(frames[0])) return -3;
+                frames[depth].is_call = (instr->type == INSTR_CALL);
+                frames[depth].remaining = instr->repeat_count;
+                frames[depth].index = (instr->type == INSTR_CALL) ? pc + 1 : pc;
+                depth++;
+                pc = (instr->type == INSTR_CALL) ? (size_t)instr->link + 1 : pc + 1;
+                break;
+            case INSTR_DEF:
+                pc = instr->link + 1;
+                break;
+            case INSTR_BLOCK_END:
+                if (depth == 0) return -3;
+                if (frames[depth - 1].is_call) {
+                    pc = frames[--depth].index;
+                } else if (--frames[depth - 1].remaining > 0) {
+                    pc = frames[depth - 1].index + 1;
+                } else {
+                    depth--;
+                    pc++;
+                }
+                break;
+            case INSTR_GATE_SINGLE:
+            case INSTR_GATE_MULTI: {
+                int rc = add_gate(net, instr, options);
+                if (rc != 0) return rc;
+                pc++;
+                break;
+            }
+            default:
+                pc++; // noise statements and CREG-only lines: an ideal amplitude ignores them
+                break;
+        }
+    }
+
+    for (size_t q = 0; q < num_qubits; q++) {
+        uint32_t idx = (uint32_t)net->wire[q];
+        net->bra[q] = net->num_leaves;
+        if (add_leaf(net, 1, &idx, NULL) != 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * \brief Index sets of every node (sorted), the union of each step's operands, and the
+ *        per-index slicing mask used while planning.
+ */
+typedef struct {
+    uint32_t** set;
+    size_t*    set_size;
+    uint32_t** span;       /**< Per step: union of the operands' indices */
+    size_t*    span_size;
+    uint8_t*   sliced;     /**< Per index */
+} PlanSets;
+
+static void free_plan_sets(PlanSets* ps, size_t nodes, size_t steps) {
+    if (ps->set) for (size_t i = 0; i < nodes; i++) free(ps->set[i]);
+    if (ps->span) for (size_t s = 0; s < steps; s++) free(ps->span[s]);
+    free(ps->set);
+    free(ps->set_size);
+    free(ps->span);
+    free(ps->span_size);
+    free(ps->sliced);
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * \brief Sizes of A \ B, A ^ B over sorted sets: returns the shared count.
+ */
+static size_t shared_count(const uint32_t* a, size_t na, const uint32_t* b, size_t nb) {
+    size_t i = 0, j = 0, shared = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) i++;
+        else if (a[i] > b[j]) j++;
+        else { shared++; i++; j++; }
+    }
+    return shared;
+}
+
+/**
+ * \brief Greedy contraction order: repeatedly contracts the pair of tensors sharing an index
+ *        whose result adds the fewest entries to the network (result size minus operand
+ *        sizes; ties go to the smaller result). Leftover scalars are multiplied at the end.
+ */
+static int plan_order(Network* net, PlanSets* ps) {
+    size_t leaves = net->num_leaves;
+    size_t nodes = 2 * leaves - 1;
+    size_t (*holder)[2] = (size_t(*)[2])malloc(((size_t)net->num_indices + 1) * sizeof(*holder));
+    uint8_t* alive = (uint8_t*)calloc(nodes, 1);
+    uint8_t* open = (uint8_t*)calloc((size_t)net->num_indices + 1, 1);
+    ps->set = (uint32_t**)calloc(nodes, sizeof(uint32_t*));
+    ps->set_size = (size_t*)calloc(nodes, sizeof(size_t));
+    ps->span = (uint32_t**)calloc(leaves, sizeof(uint32_t*));
+    ps->span_size = (size_t*)calloc(leaves, sizeof(size_t));
+    ps->sliced = (uint8_t*)calloc((size_t)net->num_indices + 1, 1);
+    net->steps = (size_t(*)[2])malloc(leaves * sizeof(*net->steps));
+    int rc = (!holder || !alive || !open || !ps->set || !ps->set_size || !ps->span || !ps->span_size ||
+              !ps->sliced || !net->steps) ? -1 : 0;
+
+    for (uint32_t i = 0; rc == 0 && i < net->num_indices; i++) holder[i][0] = holder[i][1] = SIZE_MAX;
+    for (size_t l = 0; rc == 0 && l < leaves; l++) {
+        const Tensor* t = &net->leaves[l];
+        ps->set[l] = (uint32_t*)malloc((t->rank + 1) * sizeof(uint32_t));
+        if (!ps->set[l]) {
+            rc = -1;
+            break;
+        }
+        memcpy(ps->set[l], t->idx, t->rank * sizeof(uint32_t));
+        qsort(ps->set[l], t->rank, sizeof(uint32_t), compare_u32);
+        ps->set_size[l] = t->rank;
+        alive[l] = 1;
+        for (size_t k = 0; k < t->rank; k++) {
+            size_t* h = holder[t->idx[k]];
+            h[h[0] == SIZE_MAX ? 0 : 1] = l;
+            open[t->idx[k]] = 1;
+        }
+    }
+
+    size_t step = 0;
+    while (rc == 0 && step < leaves - 1) {
+        size_t a = SIZE_MAX, b = SIZE_MAX;
+        double best = 0.0;
+        size_t best_rank = 0;
+        for (uint32_t i = 0; i < net->num_indices; i++) {
+            if (!open[i]) continue;
+            size_t x = holder[i][0], y = holder[i][1];
+            size_t sx = ps->set_size[x], sy = ps->set_size[y];
+            size_t shared = shared_count(ps->set[x], sx, ps->set[y], sy);
+            size_t rank = sx + sy - 2 * shared;
+            double score = ldexp(1.0, (int)rank) - ldexp(1.0, (int)sx) - ldexp(1.0, (int)sy);
+            if (a == SIZE_MAX || score < best || (score == best && rank < best_rank)) {
+                a = x;
+                b = y;
+                best = score;
+                best_rank = rank;
+            }
+        }
+        if (a == SIZE_MAX) {
+            // Only disconnected scalars are left: multiply them together
+            for (size_t n = 0; n < leaves + step; n++) {
+                if (!alive[n]) continue;
+                if (a == SIZE_MAX) a = n;
+                else if (b == SIZE_MAX) b = n;
+            }
+            if (b == SIZE_MAX) {
+                rc = -1;
+                break;
+            }
+        }
+
+        // Result = symmetric difference, span = union
+        size_t node = leaves + step;
+        size_t sa = ps->set_size[a], sb = ps->set_size[b];
+        ps->set[node] = (uint32_t*)malloc((sa + sb + 1) * sizeof(uint32_t));
+        ps->span[step] = (uint32_t*)malloc((sa + sb + 1) * sizeof(uint32_t));
+        if (!ps->set[node] || !ps->span[step]) {
+            rc = -1;
+            break;
+        }
+        size_t i = 0, j = 0, r = 0, u = 0;
+        while (i < sa || j < sb) {
+            uint32_t va = i < sa ? ps->set[a][i] : UINT32_MAX;
+            uint32_t vb = j < sb ? ps->set[b][j] : UINT32_MAX;
+            if (va == vb) {
+                ps->span[step][u++] = va;
+                open[va] = 0;
+                i++;
+                j++;
+            } else {
+                uint32_t v = va < vb ? va : vb;
+                if (va < vb) i++;
+                else j++;
+                ps->span[step][u++] = v;
+                ps->set[node][r++] = v;
+                size_t* h = holder[v];
+                if (h[0] == a || h[0] == b) h[0] = node;
+                else h[1] = node;
+            }
+        }
+        ps->set_size[node] = r;
+        ps->span_size[step] = u;
+        net->steps[step][0] = a;
+        net->steps[step][1] = b;
+        alive[a] = alive[b] = 0;
+        alive[node] = 1;
+        step++;
+    }
+    free(holder);
+    free(alive);
+    free(open);
+    return rc;
+}
+
+static size_t unsliced_count(const uint32_t* set, size_t size, const uint8_t* sliced) {
+    size_t n = 0;
+    for (size_t k = 0; k < size; k++) n += !sliced[set[k]];
+    return n;
+}
+
+/**
+ * \brief Peak memory and work of one slice under the current slicing. The circuit's tensors
+ *        are shared by all slices and not counted; a step holds its operands (or their
+ *        permuted copies), its result and the intermediates still waiting to be used.
+ */
+static void evaluate_slice(const Network* net, const PlanSets* ps, double* peak_bytes, double* flops,
+                           size_t* largest_rank, size_t* widest_step) {
+    size_t leaves = net->num_leaves;
+    double live = 0.0, peak = 0.0, work = 0.0, widest = -1.0;
+    size_t largest = 0;
+    for (size_t s = 0; s + 1 < leaves; s++) {
+        size_t a = net->steps[s][0], b = net->steps[s][1];
+        size_t ra = unsliced_count(ps->set[a], ps->set_size[a], ps->sliced);
+        size_t rb = unsliced_count(ps->set[b], ps->set_size[b], ps->sliced);
+        size_t rr = unsliced_count(ps->set[leaves + s], ps->set_size[leaves + s], ps->sliced);
+        size_t ru = unsliced_count(ps->span[s], ps->span_size[s], ps->sliced);
+        double operands = ldexp(8.0, (int)ra) + ldexp(8.0, (int)rb);
+        double result = ldexp(8.0, (int)rr);
+        double held = live - (a >= leaves ? ldexp(8.0, (int)ra) : 0.0) - (b >= leaves ? ldexp(8.0, (int)rb) : 0.0);
+        if (held + operands + result > peak) peak = held + operands + result;
+        if (result + operands > widest) {
+            widest = result + operands;
+            if (widest_step) *widest_step = s;
+        }
+        work += ldexp(8.0, (int)ru); // one complex multiply-add per entry of the union
+        if (rr > largest) largest = rr;
+        live = held + result;
+    }
+    *peak_bytes = peak;
+    *flops = work;
+    if (largest_rank) *largest_rank = largest;
+}
+
+/**
+ * \brief Slices indices until one slice fits 'budget': each round fixes the index of the
+ *        widest step that lowers the peak most (then the work least).
+ * \return 0 on success, -2 if the budget cannot be met or an extra index stops lowering the peak
+ */
+static int choose_slices(Network* net, PlanSets* ps, double budget, double* peak, double* flops) {
+    size_t widest = 0;
+    net->sliced = (uint32_t*)malloc((TENSOR_NETWORK_MAX_SLICED + 1) * sizeof(uint32_t));
+    if (!net->sliced) return -1;
+    evaluate_slice(net, ps, peak, flops, NULL, &widest);
+    while (*peak > budget) {
+        if (net->num_sliced == TENSOR_NETWORK_MAX_SLICED || net->num_leaves < 2) return -2;
+        uint32_t best = UINT32_MAX;
+        double best_peak = 0.0, best_flops = 0.0;
+        for (size_t k = 0; k < ps->span_size[widest]; k++) {
+            uint32_t i = ps->span[widest][k];
+            if (ps->sliced[i]) continue;
+            double p, f;
+            ps->sliced[i] = 1;
+            evaluate_slice(net, ps, &p, &f, NULL, NULL);
+            ps->sliced[i] = 0;
+            if (best == UINT32_MAX || p < best_peak || (p == best_peak && f < best_flops)) {
+                best = i;
+                best_peak = p;
+                best_flops = f;
+            }
+        }
+        if (best == UINT32_MAX || best_peak >= *peak) return -2; // slicing no longer helps
+        ps->sliced[best] = 1;
+        net->sliced[net->num_sliced++] = best;
+        evaluate_slice(net, ps, peak, flops, NULL, &widest);
+    }
+    return 0;
+}
+
+/**
+ * \brief Builds, orders and slices the network of a circuit and fills in the plan.
+ */
+static int make_plan(const InstructionList* instructions, const TensorNetworkOptions* options, Network* net,
+                     TensorNetworkPlan* plan) {
+    memset(plan, 0, sizeof(*plan));
+    size_t n = options->num_qubits ? options->num_qubits : instruction_list_num_qubits(instructions);
+    int rc = build_network(instructions, n, options, net);
+    if (rc != 0) return rc;
+    plan->num_qubits = n;
+    plan->tensors = net->num_leaves;
+    plan->indices = net->num_indices;
+    plan->slices = 1;
+    plan->threads = 1;
+    if (net->num_leaves == 0) return 0;
+
+    for (size_t l = 0; l < net->num_leaves; l++) plan->network_bytes += (size_t)8 << net->leaves[l].rank;
+    size_t budget = options->memory_budget ? options->memory_budget : detect_memory_budget();
+    if (budget && plan->network_bytes >= budget) {
+        log_message(LOG_LEVEL_ERROR, "Tensor network refused: its %zu tensors need %zu bytes, budget is %zu.",
+                    net->num_leaves, plan->network_bytes, budget);
+        return -2;
+    }
+
+    PlanSets ps;
+    memset(&ps, 0, sizeof(ps));
+    rc = plan_order(net, &ps);
+    double peak = 0.0, flops = 0.0;
+    double room = budget ? (double)(budget - plan->network_bytes) : HUGE_VAL;
+    if (rc == 0) rc = choose_slices(net, &ps, room, &peak, &flops);
+    if (rc == 0) evaluate_slice(net, &ps, &peak, &flops, &plan->largest_rank, NULL);
+    free_plan_sets(&ps, 2 * net->num_leaves - 1, net->num_leaves);
+    if (rc == -2) {
+        log_message(LOG_LEVEL_ERROR, "Tensor network refused: %zu qubits cannot be sliced into %zu bytes.", n, budget);
+    }
+    if (rc != 0) return rc;
+
+    plan->sliced_indices = net->num_sliced;
+    plan->slices = (size_t)1 << net->num_sliced;
+    plan->flops = flops * (double)plan->slices;
+    plan->slice_bytes = peak >= (double)SIZE_MAX ? SIZE_MAX : (size_t)peak;
+
+    size_t threads = options->threads;
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 1 ? (size_t)online : 1;
+    }
+    size_t fit = plan->slice_bytes ? (budget - plan->network_bytes) / plan->slice_bytes : threads;
+    if (budget && threads > fit) threads = fit;
+    if (threads > plan->slices) threads = plan->slices;
+    plan->threads = threads ? threads : 1;
+
+    CostModel model;
+    init_cost_model(&model, ENGINE_DENSE, n);
+    plan->predicted_seconds = plan->flops / (model.flop_rate * (double)plan->threads);
+    return 0;
+}
+
+/**
+ * \brief Permutes a tensor's entries into the index order 'order'. The offset map is split
+ *        into two tables over the high and low halves of the old offset.
+ */
+static int permute_tensor(const Tensor* t, const uint32_t* order, float* out) {
+    size_t rank = t->rank;
+    size_t lo_bits = rank / 2, hi_bits = rank - lo_bits;
+    size_t* lo = (size_t*)calloc((size_t)1 << lo_bits, sizeof(size_t));
+    size_t* hi = (size_t*)calloc((size_t)1 << hi_bits, sizeof(size_t));
+    if (!lo || !hi) {
+        free(lo);
+        free(hi);
+        return -1;
+    }
+    for (size_t k = 0; k < rank; k++) {
+        size_t p = 0;
+        while (order[p] != t->idx[k]) p++;
+        size_t old_bit = rank - 1 - k, new_bit = (size_t)1 << (rank - 1 - p);
+        if (old_bit < lo_bits) {
+            for (size_t v = 0; v < ((size_t)1 << lo_bits); v++) if (v >> old_bit & 1) lo[v] |= new_bit;
+        } else {
+            for (size_t v = 0; v < ((size_t)1 << hi_bits); v++) if (v >> (old_bit - lo_bits) & 1) hi[v] |= new_bit;
+        }
+    }
+    size_t length = (size_t)1 << rank, lo_mask = ((size_t)1 << lo_bits) - 1;
+    for (size_t o = 0; o < length; o++) {
+        size_t d = hi[o >> lo_bits] | lo[o & lo_mask];
+        out[2 * d] = t->data[2 * o];
+        out[2 * d + 1] = t->data[2 * o + 1];
+    }
+    free(lo);
+    free(hi);
+    return 0;
+}
+
+/**
+ * \brief Contracts A and B over their shared indices as one complex matrix product:
+ *        A as [free_A x shared] times B as [shared x free_B]. The result's indices are
+ *        free_A followed by free_B.
+ */
+static int contract_pair(const Tensor* a, const Tensor* b, Tensor* out) {
+    size_t ra = a->rank, rb = b->rank;
+    uint32_t* order_a = (uint32_t*)malloc((ra + 1) * sizeof(uint32_t));
+    uint32_t* order_b = (uint32_t*)malloc((rb + 1) * sizeof(uint32_t));
+    uint8_t* in_b = (uint8_t*)calloc(ra + 1, 1);
+    memset(out, 0, sizeof(*out));
+    if (!order_a || !order_b || !in_b) {
+        free(order_a);
+        free(order_b);
+        free(in_b);
+        return -1;
+    }
+    size_t shared = 0;
+    for (size_t i = 0; i < ra; i++) {
+        for (size_t j = 0; j < rb; j++) in_b[i] |= (a->idx[i] == b->idx[j]);
+        shared += in_b[i];
+    }
+    size_t fa = 0, fb = 0;
+    for (size_t i = 0; i < ra; i++) if (!in_b[i]) order_a[fa++] = a->idx[i];
+    for (size_t i = 0, s = 0; i < ra; i++) {
+        if (in_b[i]) {
+            order_a[fa + s] = a->idx[i];
+            order_b[s++] = a->idx[i];
+        }
+    }
+    for (size_t j = 0; j < rb; j++) {
+        int is_shared = 0;
+        for (size_t s = 0; s < shared; s++) is_shared |= (b->idx[j] == order_b[s]);
+        if (!is_shared) order_b[shared + fb++] = b->idx[j];
+    }
+
+    // Permute the operands only if their index order differs from the product's
+    const float* da = a->data;
+    const float* db = b->data;
+    float* pa = NULL;
+    float* pb = NULL;
+    int rc = 0;
+    if (memcmp(order_a, a->idx, ra * sizeof(uint32_t)) != 0) {
+        pa = (float*)malloc(((size_t)2 << ra) * sizeof(float));
+        rc = pa ? permute_tensor(a, order_a, pa) : -1;
+        da = pa;
+    }
+    if (rc == 0 && memcmp(order_b, b->idx, rb * sizeof(uint32_t)) != 0) {
+        pb = (float*)malloc(((size_t)2 << rb) * sizeof(float));
+        rc = pb ? permute_tensor(b, order_b, pb) : -1;
+        db = pb;
+    }
+
+    size_t m = (size_t)1 << fa, k = (size_t)1 << shared, n = (size_t)1 << fb;
+    if (rc == 0) {
+        out->rank = fa + fb;
+        out->idx = (uint32_t*)malloc((out->rank + 1) * sizeof(uint32_t));
+        out->data = (float*)calloc(2 * m * n, sizeof(float));
+        if (!out->idx || !out->data) rc = -1;
+    }
+    if (rc == 0) {
+        memcpy(out->idx, order_a, fa * sizeof(uint32_t));
+        memcpy(out->idx + fa, order_b + shared, fb * sizeof(uint32_t));
+        for (size_t i = 0; i < m; i++) {
+            float* c = &out->data[2 * i * n];
+            for (size_t s = 0; s < k; s++) {
+                float ar = da[2 * (i * k + s)], ai = da[2 * (i * k + s) + 1];
+                if (ar == 0.0f && ai == 0.0f) continue;
+                const float* row = &db[2 * s * n];
+                for (size_t j = 0; j < n; j++) {
+                    float br = row[2 * j], bi = row[2 * j + 1];
+                    c[2 * j] += ar * br - ai * bi;
+                    c[2 * j + 1] += ar * bi + ai * br;
+                }
+            }
+        }
+    } else {
+        free(out->idx);
+        free(out->data);
+        memset(out, 0, sizeof(*out));
+    }
+    free(pa);
+    free(pb);
+    free(order_a);
+    free(order_b);
+    free(in_b);
+    return rc;
+}
+
+/**
+ * \brief Copies a leaf with its sliced indices fixed to this slice's values.
+ */
+static int fix_sliced(const Tensor* t, const Network* net, uint64_t slice, Tensor* out) {
+    size_t keep = 0;
+    size_t fixed_mask = 0, fixed_bits = 0;
+    for (size_t k = 0; k < t->rank; k++) {
+        size_t bit = (size_t)1 << (t->rank - 1 - k);
+        size_t s = 0;
+        while (s < net->num_sliced && net->sliced[s] != t->idx[k]) s++;
+        if (s == net->num_sliced) {
+            keep++;
+            continue;
+        }
+        fixed_mask |= bit;
+        if (slice >> s & 1) fixed_bits |= bit;
+    }
+    out->rank = keep;
+    out->idx = (uint32_t*)malloc((keep + 1) * sizeof(uint32_t));
+    out->data = (float*)malloc(((size_t)2 << keep) * sizeof(float));
+    if (!out->idx || !out->data) {
+        free(out->idx);
+        free(out->data);
+        return -1;
+    }
+    for (size_t k = 0, r = 0; k < t->rank; k++) {
+        if (!(fixed_mask >> (t->rank - 1 - k) & 1)) out->idx[r++] = t->idx[k];
+    }
+    size_t w = 0;
+    for (size_t o = 0; o < ((size_t)1 << t->rank); o++) {
+        if ((o & fixed_mask) != fixed_bits) continue;
+        out->data[2 * w] = t->data[2 * o];
+        out->data[2 * w + 1] = t->data[2 * o + 1];
+        w++;
+    }
+    return 0;
+}
+
+static int has_sliced_index(const Tensor* t, const Network* net) {
+    for (size_t k = 0; k < t->rank; k++) {
+        for (size_t s = 0; s < net->num_sliced; s++) {
+            if (net->sliced[s] == t->idx[k]) return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \brief Contracts one slice down to a scalar.
+ */
+static int contract_slice(const Network* net, uint64_t slice, double* out_real, double* out_imag) {
+    size_t leaves = net->num_leaves;
+    size_t nodes = 2 * leaves - 1;
+    Tensor* node = (Tensor*)calloc(nodes, sizeof(Tensor));
+    uint8_t* owned = (uint8_t*)calloc(nodes, 1);
+    int rc = (!node || !owned) ? -1 : 0;
+
+    for (size_t l = 0; rc == 0 && l < leaves; l++) {
+        if (has_sliced_index(&net->leaves[l], net)) {
+            rc = fix_sliced(&net->leaves[l], net, slice, &node[l]);
+            owned[l] = 1;
+        } else {
+            node[l] = net->leaves[l];
+        }
+    }
+    for (size_t s = 0; rc == 0 && s + 1 < leaves; s++) {
+        size_t a = net->steps[s][0], b = net->steps[s][1];
+        rc = contract_pair(&node[a], &node[b], &node[leaves + s]);
+        owned[leaves + s] = 1;
+        for (size_t k = 0; k < 2; k++) {
+            size_t x = net->steps[s][k];
+            if (!owned[x]) continue;
+            free(node[x].idx);
+            free(node[x].data);
+            node[x].idx = NULL;
+            node[x].data = NULL;
+            owned[x] = 0;
+        }
+    }
+    if (rc == 0) {
+        *out_real = node[nodes - 1].data[0];
+        *out_imag = node[nodes - 1].data[1];
+    }
+    for (size_t i = 0; node && owned && i < nodes; i++) {
+        if (!owned[i]) continue;
+        free(node[i].idx);
+        free(node[i].data);
+    }
+    free(node);
+    free(owned);
+    return rc;
+}
+
+typedef struct {
+    const Network*  net;
+    size_t          slices;
+    size_t          next;   /**< Next slice to hand out, under 'lock' */
+    pthread_mutex_t lock;
+} SliceQueue;
+
+typedef struct {
+    SliceQueue* queue;
+    double      real;
+    double      imag;
+    int         rc;
+} SliceWorker;
+
+static void* slice_worker(void* arg) {
+    SliceWorker* worker = (SliceWorker*)arg;
+    SliceQueue* queue = worker->queue;
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        size_t s = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+        if (s >= queue->slices) return NULL;
+        double re = 0.0, im = 0.0;
+        int rc = contract_slice(queue->net, s, &re, &im);
+        if (rc != 0) {
+            worker->rc = rc;
+            pthread_mutex_lock(&queue->lock);
+            queue->next = queue->slices;
+            pthread_mutex_unlock(&queue->lock);
+            return NULL;
+        }
+        worker->real += re;
+        worker->imag += im;
+    }
+}
+
+void init_tensor_network_options(TensorNetworkOptions* options) {
+    if (!options) return;
+    memset(options, 0, sizeof(*options));
+}
+
+int plan_tensor_network(const InstructionList* instructions, const TensorNetworkOptions* options,
+                        TensorNetworkPlan* plan) {
+    if (!instructions || !plan) return -1;
+    TensorNetworkOptions defaults;
+    if (!options) {
+        init_tensor_network_options(&defaults);
+        options = &defaults;
+    }
+    Network net;
+    int rc = make_plan(instructions, options, &net, plan);
+    free_network(&net);
+    return rc;
+}
+
+int tensor_network_amplitudes(const InstructionList* instructions, const uint64_t* basis, size_t count,
+                              const TensorNetworkOptions* options, float* out_real, float* out_imag,
+                              TensorNetworkPlan* plan) {
+    if (!instructions || (count > 0 && (!basis || !out_real || !out_imag))) return -1;
+    TensorNetworkOptions defaults;
+    if (!options) {
+        init_tensor_network_options(&defaults);
+        options = &defaults;
+    }
+    TensorNetworkPlan local_plan;
+    if (!plan) plan = &local_plan;
+
+    Network net;
+    int rc = make_plan(instructions, options, &net, plan);
+    if (rc == 0 && plan->num_qubits > 64) rc = -4;
+    if (rc != 0) {
+        free_network(&net);
+        return rc;
+    }
+    log_message(LOG_LEVEL_INFO, "Tensor network: %zu tensors, %zu slice(s) of rank <= %zu (%zu bytes), "
+                "%.3g flops per amplitude, predicted %.3g s on %zu thread(s).",
+                plan->tensors, plan->slices, plan->largest_rank, plan->slice_bytes, plan->flops,
+                plan->predicted_seconds, plan->threads);
+    if (options->cost_report) {
+        write_tensor_network_report(options->cost_report, plan);
+        fflush(options->cost_report);
+    }
+
+    pthread_t* handles = plan->threads > 1 ? (pthread_t*)malloc((plan->threads - 1) * sizeof(pthread_t)) : NULL;
+    SliceWorker* workers = (SliceWorker*)calloc(plan->threads, sizeof(SliceWorker));
+    if (!workers || (plan->threads > 1 && !handles)) rc = -3;
+    for (size_t c = 0; rc == 0 && c < count; c++) {
+        if (net.num_leaves == 0) {
+            out_real[c] = basis[c] == 0 ? 1.0f : 0.0f; // no qubits: the empty state
+            out_imag[c] = 0.0f;
+            continue;
+        }
+        if (net.num_qubits < 64 && (basis[c] >> net.num_qubits) != 0) {
+            out_real[c] = out_imag[c] = 0.0f; // bits above the register are always |0>
+            continue;
+        }
+        for (size_t q = 0; q < net.num_qubits; q++) {
+            float* bra = net.leaves[net.bra[q]].data;
+            int bit = (int)(basis[c] >> q & 1);
+            bra[0] = bit ? 0.0f : 1.0f;
+            bra[2] = bit ? 1.0f : 0.0f;
+        }
+        SliceQueue queue = { &net, plan->slices, 0, PTHREAD_MUTEX_INITIALIZER };
+        for (size_t t = 0; t < plan->threads; t++) {
+            workers[t].queue = &queue;
+            workers[t].real = workers[t].imag = 0.0;
+            workers[t].rc = 0;
+        }
+        size_t started = 0;
+        for (size_t t = 1; t < plan->threads; t++) {
+            if (pthread_create(&handles[t - 1], NULL, slice_worker, &workers[t]) != 0) break;
+            started++;
+        }
+        slice_worker(&workers[0]);
+        for (size_t t = 0; t < started; t++) pthread_join(handles[t], NULL);
+
+        double re = 0.0, im = 0.0;
+        for (size_t t = 0; t <= started; t++) {
+            if (workers[t].rc != 0 && rc == 0) rc = workers[t].rc;
+            re += workers[t].real;
+            im += workers[t].imag;
+        }
+        out_real[c] = (float)re;
+        out_imag[c] = (float)im;
+    }
+    free(handles);
+    free(workers);
+    free_network(&net);
+    return rc;
+}
+
+int write_tensor_network_report(FILE* out, const TensorNetworkPlan* plan) {
+    if (!out || !plan) return -1;
+    fprintf(out, "{\"engine\":\"tensor_network\",\"num_qubits\":%zu,\"tensors\":%zu,\"indices\":%zu,"
+                 "\"largest_rank\":%zu,\"sliced_indices\":%zu,\"slices\":%zu,\"flops\":%.6g,"
+                 "\"network_bytes\":%zu,\"slice_bytes\":%zu,\"threads\":%zu,\"predicted_seconds\":%.6g}\n",
+            plan->num_qubits, plan->tensors, plan->indices, plan->largest_rank, plan->sliced_indices,
+            plan->slices, plan->flops, plan->network_bytes, plan->slice_bytes, plan->threads,
+            plan->predicted_seconds);
+    return ferror(out) ? -2 : 0;
+}
+
+void print_tensor_network_plan(const TensorNetworkPlan* plan) {
+    if (!plan) return;
+    printf("Tensor network plan:\n");
+    printf("  network   : %zu tensors, %zu indices, %zu qubits, %zu bytes\n", plan->tensors, plan->indices,
+           plan->num_qubits, plan->network_bytes);
+    printf("  slicing   : %zu index(es) => %zu slice(s), largest tensor rank %zu, %zu bytes per slice\n",
+           plan->sliced_indices, plan->slices, plan->largest_rank, plan->slice_bytes);
+    printf("  cost      : %.3g flops per amplitude, predicted %.6f s on %zu thread(s)\n",
+           plan->flops, plan->predicted_seconds, plan->threads);
+}
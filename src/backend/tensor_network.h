@@ -0,0 +1,106 @@
+#ifndef TENSOR_NETWORK_H
+#define TENSOR_NETWORK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "../assembly/parser.h"
+
+/**
+ * \brief Most indices run_tensor_network slices: 2^40 slices is far beyond any runtime, so a
+ *        network that needs more is refused.
+ */
+#define TENSOR_NETWORK_MAX_SLICED 40
+
+/**
+ * \brief Knobs for tensor-network amplitude queries.
+ */
+typedef struct TensorNetworkOptions {
+    size_t      memory_budget;   /**< Bytes, 0 => cgroup limit or physical RAM */
+    size_t      threads;         /**< Worker threads, 0 => online CPUs; capped by the slice count
+                                      and by how many slices fit the budget at once */
+    size_t      num_qubits;      /**< Register size, 0 => highest qubit index + 1 */
+    const double* param_values;  /**< Values of the circuit's symbolic parameters */
+    size_t      num_param_values;
+    FILE*       cost_report;     /**< If set, the plan is written here as one JSON line before
+                                      anything is contracted */
+} TensorNetworkOptions;
+
+/**
+ * \brief Contraction plan of a circuit's tensor network, with its cost estimate.
+ */
+typedef struct TensorNetworkPlan {
+    size_t num_qubits;
+    size_t tensors;           /**< Tensors in the network: one per gate plus |0> and <x| per qubit */
+    size_t indices;           /**< Wire segments between them (each of dimension 2) */
+    size_t largest_rank;      /**< Indices of the largest intermediate tensor of one slice */
+    size_t sliced_indices;    /**< Indices fixed to 0 or 1 in each slice */
+    size_t slices;            /**< 2^sliced_indices independent contractions, summed */
+    double flops;             /**< Float operations of one amplitude over all slices */
+    size_t network_bytes;     /**< The circuit's tensors, shared by all slices */
+    size_t slice_bytes;       /**< Peak intermediate memory of contracting one slice */
+    size_t threads;           /**< Slices contracted at once */
+    double predicted_seconds; /**< Per amplitude, from the cost model's flop rate */
+} TensorNetworkPlan;
+
+/**
+ * \brief Fills options with defaults (detected budget, every core).
+ */
+void init_tensor_network_options(TensorNetworkOptions* options);
+
+/**
+ * \brief Builds the tensor network of a circuit (a rank-2 tensor per single-qubit gate, a
+ *        rank-4 tensor per CNOT/CPHASE, |0> and <x| vectors at the ends of each wire), picks a
+ *        contraction order greedily (at each step the pair whose contraction grows the
+ *        network least) and slices indices of the widest step until the network plus one
+ *        slice fits the memory budget. Nothing is contracted.
+ * \param instructions A measurement-free circuit; REPEAT/DEF blocks are followed, noise
+ *        statements skipped, IF guards and measurements rejected
+ * \param options Options (NULL => defaults)
+ * \param plan Output plan
+ * \return 0 on success, -2 if the network cannot be sliced into the budget (or would need more
+ *         than TENSOR_NETWORK_MAX_SLICED sliced indices), -3 for a circuit
+ *         that has no amplitude (measurements, IF guards, unbound or unknown gates), other
+ *         nonzero values on error
+ */
+int plan_tensor_network(const InstructionList* instructions, const TensorNetworkOptions* options,
+                        TensorNetworkPlan* plan);
+
+/**
+ * \brief Computes amplitudes <x|C|0...0> of a circuit without a state vector, so circuits with
+ *        too many qubits for one can be checked. The plan is made once (plan_tensor_network),
+ *        reported, and then each amplitude sums its slices across worker threads.
+ * \param instructions A measurement-free circuit (see plan_tensor_network)
+ * \param basis count basis states x; bit q of basis[k] is qubit q (at most 64 qubits); states
+ *        with bits set above the register have amplitude 0
+ * \param count Number of amplitudes
+ * \param options Options (NULL => defaults)
+ * \param out_real count real parts
+ * \param out_imag count imaginary parts
+ * \param plan Optional output plan
+ * \return 0 on success, nonzero as for plan_tensor_network, or -4 for more than 64 qubits
+ */
+int tensor_network_amplitudes(const InstructionList* instructions, const uint64_t* basis, size_t count,
+                              const TensorNetworkOptions* options, float* out_real, float* out_imag,
+                              TensorNetworkPlan* plan);
+
+/**
+ * \brief Writes a plan as one JSON line, e.g. {"engine":"tensor_network","tensors":312,...}.
+ * \return 0 on success, nonzero on error
+ */
+int write_tensor_network_report(FILE* out, const TensorNetworkPlan* plan);
+
+/**
+ * \brief Prints a plan.
+ */
+void print_tensor_network_plan(const TensorNetworkPlan* plan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TENSOR_NETWORK_H */
@@ -0,0 +1,457 @@
+#include "compressed_state_vector.h"
+#include "gate_operations.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+static const float X_MATRIX[8] = {
+    0.0f, 0.0f, 1.0f, 0.0f,
+    1.0f, 0.0f, 0.0f, 0.0f
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void release_block(CompressedBlock* b) {
+    free(b->data);
+    b->data = NULL;
+    b->kind = BLOCK_ZERO;
+    b->runs = 0;
+    b->nbytes = 0;
+}
+
+/**
+ * \brief Rounds a value onto the lossy quantization grid (step = 2 * max_error).
+ */
+static inline float quantize(float x, float step) {
+    return step > 0.0f ? rintf(x / step) * step : x;
+}
+
+/**
+ * \brief Decodes a block into real/imag arrays of length 'count'.
+ */
+static void decode_block(const CompressedBlock* b, float* real, float* imag,
+                         size_t count, float step) {
+    switch (b->kind) {
+        case BLOCK_ZERO:
+            memset(real, 0, count * sizeof(float));
+            memset(imag, 0, count * sizeof(float));
+            break;
+        case BLOCK_RAW: {
+            const float* src = (const float*)b->data;
+            memcpy(real, src, count * sizeof(float));
+            memcpy(imag, src + count, count * sizeof(float));
+            break;
+        }
+        case BLOCK_Q16: {
+            const int16_t* src = (const int16_t*)b->data;
+            for (size_t i = 0; i < count; i++) {
+                real[i] = (float)src[i] * step;
+                imag[i] = (float)src[count + i] * step;
+            }
+            break;
+        }
+        case BLOCK_RLE: {
+            const uint32_t* lengths = (const uint32_t*)b->data;
+            const float* vr = (const float*)(lengths + b->runs);
+            const float* vi = vr + b->runs;
+            size_t pos = 0;
+            for (uint32_t r = 0; r < b->runs; r++) {
+                for (uint32_t k = 0; k < lengths[r]; k++, pos++) {
+                    real[pos] = vr[r];
+                    imag[pos] = vi[r];
+                }
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * \brief Encodes real/imag arrays into a block, picking the smallest available format.
+ *        In lossy mode the arrays are quantized in place first.
+ * \return 0 on success, nonzero on allocation failure
+ */
+static int encode_block(CompressedBlock* b, float* real, float* imag,
+                        size_t count, float step) {
+    int fits_q16 = (step > 0.0f);
+    int all_zero = 1;
+    uint32_t runs = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (step > 0.0f) {
+            real[i] = quantize(real[i], step);
+            imag[i] = quantize(imag[i], step);
+            if (fabsf(real[i] / step) > 32767.0f || fabsf(imag[i] / step) > 32767.0f) {
+                fits_q16 = 0;
+            }
+        }
+        if (real[i] != 0.0f || imag[i] != 0.0f) all_zero = 0;
+        if (i == 0 || real[i] != real[i - 1] || imag[i] != imag[i - 1]) runs++;
+    }
+
+    release_block(b);
+    if (all_zero) return 0;
+
+    size_t rle_bytes = (size_t)runs * (sizeof(uint32_t) + 2 * sizeof(float));
+    size_t raw_bytes = count * 2 * sizeof(float);
+    size_t q16_bytes = fits_q16 ? count * 2 * sizeof(int16_t) : (size_t)-1;
+
+    if (rle_bytes <= raw_bytes && rle_bytes <= q16_bytes) {
+        uint32_t* lengths = (uint32_t*)malloc(rle_bytes);
+        if (!lengths) return -1;
+        float* vr = (float*)(lengths + runs);
+        float* vi = vr + runs;
+        uint32_t r = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (i == 0 || real[i] != real[i - 1] || imag[i] != imag[i - 1]) {
+                lengths[r] = 0;
+                vr[r] = real[i];
+                vi[r] = imag[i];
+                r++;
+            }
+            lengths[r - 1]++;
+        }
+        b->kind = BLOCK_RLE;
+        b->runs = runs;
+        b->nbytes = rle_bytes;
+        b->data = lengths;
+    } else if (q16_bytes < raw_bytes) {
+        int16_t* codes = (int16_t*)malloc(q16_bytes);
+        if (!codes) return -1;
+        for (size_t i = 0; i < count; i++) {
+            codes[i] = (int16_t)lrintf(real[i] / step);
+            codes[count + i] = (int16_t)lrintf(imag[i] / step);
+        }
+        b->kind = BLOCK_Q16;
+        b->nbytes = q16_bytes;
+        b->data = codes;
+    } else {
+        float* dst = (float*)malloc(raw_bytes);
+        if (!dst) return -1;
+        memcpy(dst, real, count * sizeof(float));
+        memcpy(dst + count, imag, count * sizeof(float));
+        b->kind = BLOCK_RAW;
+        b->nbytes = raw_bytes;
+        b->data = dst;
+    }
+    return 0;
+}
+
+static inline size_t block_length(const CompressedStateVector* csv) {
+    return (size_t)1 << csv->block_qubits;
+}
+
+static inline float quant_step(const CompressedStateVector* csv) {
+    return 2.0f * csv->max_error;
+}
+
+/**
+ * \brief Decompresses blocks b0 (and b1, if distinct) into the working buffer.
+ *        b1 lands directly after b0, so the pair acts as a (block_qubits + 1)-qubit vector.
+ */
+static void load_pair(CompressedStateVector* csv, size_t b0, size_t b1, int pair) {
+    size_t len = block_length(csv);
+    decode_block(&csv->blocks[b0], csv->work_real, csv->work_imag, len, quant_step(csv));
+    if (pair) {
+        decode_block(&csv->blocks[b1], csv->work_real + len, csv->work_imag + len,
+                     len, quant_step(csv));
+    }
+}
+
+static int store_pair(CompressedStateVector* csv, size_t b0, size_t b1, int pair) {
+    size_t len = block_length(csv);
+    if (encode_block(&csv->blocks[b0], csv->work_real, csv->work_imag, len, quant_step(csv)) != 0) {
+        return -1;
+    }
+    if (pair && encode_block(&csv->blocks[b1], csv->work_real + len, csv->work_imag + len,
+                             len, quant_step(csv)) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int init_compressed_state_vector(CompressedStateVector* csv, size_t num_qubits,
+                                 size_t block_qubits, float max_error) {
+    if (!csv || num_qubits == 0) return -1;
+    if (num_qubits >= sizeof(size_t) * 8 - 1) return -2;
+    if (max_error < 0.0f) return -3;
+    memset(csv, 0, sizeof(*csv));
+
+    if (block_qubits == 0) block_qubits = COMPRESSED_DEFAULT_BLOCK_QUBITS;
+    if (block_qubits > num_qubits) block_qubits = num_qubits;
+
+    csv->num_qubits = num_qubits;
+    csv->block_qubits = block_qubits;
+    csv->num_blocks = (size_t)1 << (num_qubits - block_qubits);
+    csv->max_error = max_error;
+
+    size_t len = block_length(csv);
+    csv->blocks = (CompressedBlock*)calloc(csv->num_blocks, sizeof(CompressedBlock));
+    size_t work_bytes = (2 * len * sizeof(float) + 31) & ~(size_t)31;
+    csv->work_real = (float*)aligned_alloc(32, work_bytes);
+    csv->work_imag = (float*)aligned_alloc(32, work_bytes);
+    if (!csv->blocks || !csv->work_real || !csv->work_imag) {
+        free_compressed_state_vector(csv);
+        return -4;
+    }
+
+    // All blocks start as BLOCK_ZERO (calloc); set amplitude 0 => |0...0>
+    memset(csv->work_real, 0, len * sizeof(float));
+    memset(csv->work_imag, 0, len * sizeof(float));
+    csv->work_real[0] = 1.0f;
+    if (store_pair(csv, 0, 0, 0) != 0) {
+        free_compressed_state_vector(csv);
+        return -4;
+    }
+    return 0;
+}
+
+void free_compressed_state_vector(CompressedStateVector* csv) {
+    if (!csv) return;
+    if (csv->blocks) {
+        for (size_t b = 0; b < csv->num_blocks; b++) {
+            release_block(&csv->blocks[b]);
+        }
+        free(csv->blocks);
+    }
+    free(csv->work_real);
+    free(csv->work_imag);
+    memset(csv, 0, sizeof(*csv));
+}
+
+int compressed_apply_single_qubit_gate(CompressedStateVector* csv, const float* gate, size_t qubit_index) {
+    if (!csv || !csv->blocks || !gate) return -1;
+    if (qubit_index >= csv->num_qubits) return -2;
+
+    double t0 = now_seconds();
+    double kernel = 0.0;
+    size_t k = csv->block_qubits;
+    int rc = 0;
+
+    if (qubit_index < k) {
+        StateVector view = { k, csv->work_real, csv->work_imag };
+        for (size_t b = 0; b < csv->num_blocks && rc == 0; b++) {
+            if (csv->blocks[b].kind == BLOCK_ZERO) continue;
+            load_pair(csv, b, b, 0);
+            double tk = now_seconds();
+            apply_single_qubit_gate(&view, gate, qubit_index);
+            kernel += now_seconds() - tk;
+            rc = store_pair(csv, b, b, 0);
+        }
+    } else {
+        // The gate pairs whole blocks: b (bit=0) with b | stride (bit=1)
+        size_t stride = (size_t)1 << (qubit_index - k);
+        StateVector view = { k + 1, csv->work_real, csv->work_imag };
+        for (size_t b = 0; b < csv->num_blocks && rc == 0; b++) {
+            if (b & stride) continue;
+            size_t p = b | stride;
+            if (csv->blocks[b].kind == BLOCK_ZERO && csv->blocks[p].kind == BLOCK_ZERO) continue;
+            load_pair(csv, b, p, 1);
+            double tk = now_seconds();
+            apply_single_qubit_gate(&view, gate, k);
+            kernel += now_seconds() - tk;
+            rc = store_pair(csv, b, p, 1);
+        }
+    }
+
+    double elapsed = now_seconds() - t0;
+    csv->gate_seconds += elapsed;
+    csv->codec_seconds += elapsed - kernel;
+    csv->gates_applied++;
+    return rc == 0 ? 0 : -4;
+}
+
+int compressed_apply_cnot(CompressedStateVector* csv, size_t control_qubit, size_t target_qubit) {
+    if (!csv || !csv->blocks) return -1;
+    if (control_qubit >= csv->num_qubits || target_qubit >= csv->num_qubits) return -2;
+    if (control_qubit == target_qubit) return -3;
+
+    double t0 = now_seconds();
+    double kernel = 0.0;
+    size_t k = csv->block_qubits;
+    int rc = 0;
+
+    if (control_qubit < k && target_qubit < k) {
+        StateVector view = { k, csv->work_real, csv->work_imag };
+        for (size_t b = 0; b < csv->num_blocks && rc == 0; b++) {
+            if (csv->blocks[b].kind == BLOCK_ZERO) continue;
+            load_pair(csv, b, b, 0);
+            double tk = now_seconds();
+            apply_cnot(&view, control_qubit, target_qubit);
+            kernel += now_seconds() - tk;
+            rc = store_pair(csv, b, b, 0);
+        }
+    } else if (control_qubit < k) {
+        // Target selects the block: pair b with b | stride, target becomes qubit k of the view
+        size_t stride = (size_t)1 << (target_qubit - k);
+        StateVector view = { k + 1, csv->work_real, csv->work_imag };
+        for (size_t b = 0; b < csv->num_blocks && rc == 0; b++) {
+            if (b & stride) continue;
+            size_t p = b | stride;
+            if (csv->blocks[b].kind == BLOCK_ZERO && csv->blocks[p].kind == BLOCK_ZERO) continue;
+            load_pair(csv, b, p, 1);
+            double tk = now_seconds();
+            apply_cnot(&view, control_qubit, k);
+            kernel += now_seconds() - tk;
+            rc = store_pair(csv, b, p, 1);
+        }
+    } else if (target_qubit < k) {
+        // Control selects the block: apply X on the target inside every controlled block
+        size_t cmask = (size_t)1 << (control_qubit - k);
+        StateVector view = { k, csv->work_real, csv->work_imag };
+        for (size_t b = 0; b < csv->num_blocks && rc == 0; b++) {
+            if (!(b & cmask) || csv->blocks[b].kind == BLOCK_ZERO) continue;
+            load_pair(csv, b, b, 0);
+            double tk = now_seconds();
+            apply_single_qubit_gate(&view, X_MATRIX, target_qubit);
+            kernel += now_seconds() - tk;
+            rc = store_pair(csv, b, b, 0);
+        }
+    } else {
+        // Both qubits select blocks: a CNOT is a permutation of compressed blocks
+        size_t cmask = (size_t)1 << (control_qubit - k);
+        size_t tmask = (size_t)1 << (target_qubit - k);
+        for (size_t b = 0; b < csv->num_blocks; b++) {
+            if ((b & cmask) && !(b & tmask)) {
+                CompressedBlock tmp = csv->blocks[b];
+                csv->blocks[b] = csv->blocks[b | tmask];
+                csv->blocks[b | tmask] = tmp;
+            }
+        }
+    }
+
+    double elapsed = now_seconds() - t0;
+    csv->gate_seconds += elapsed;
+    csv->codec_seconds += elapsed - kernel;
+    csv->gates_applied++;
+    return rc == 0 ? 0 : -4;
+}
+
+int compressed_measure_qubit(CompressedStateVector* csv, size_t qubit_index, int* out_result) {
+    if (!csv || !csv->blocks || !out_result) return -1;
+    if (qubit_index >= csv->num_qubits) return -2;
+
+    double t0 = now_seconds();
+    size_t k = csv->block_qubits;
+    size_t len = block_length(csv);
+    size_t in_mask = (qubit_index < k) ? ((size_t)1 << qubit_index) : 0;
+    size_t blk_mask = (qubit_index < k) ? 0 : ((size_t)1 << (qubit_index - k));
+
+    // Pass 1: probability of outcome 0
+    double p0 = 0.0, total = 0.0;
+    for (size_t b = 0; b < csv->num_blocks; b++) {
+        if (csv->blocks[b].kind == BLOCK_ZERO) continue;
+        load_pair(csv, b, b, 0);
+        for (size_t i = 0; i < len; i++) {
+            double p = (double)csv->work_real[i] * csv->work_real[i]
+                     + (double)csv->work_imag[i] * csv->work_imag[i];
+            total += p;
+            if (!(b & blk_mask) && !(i & in_mask)) p0 += p;
+        }
+    }
+
+    float rand_val = (float)rand() / (float)RAND_MAX;
+    int outcome = (rand_val < (float)(p0 / (total > 0.0 ? total : 1.0))) ? 0 : 1;
+    double kept = outcome ? (total - p0) : p0;
+    float scale = (kept > 1e-12) ? (float)(1.0 / sqrt(kept)) : 1.0f;
+
+    // Pass 2: collapse and renormalize in one sweep
+    int rc = 0;
+    for (size_t b = 0; b < csv->num_blocks && rc == 0; b++) {
+        if (csv->blocks[b].kind == BLOCK_ZERO) continue;
+        if (blk_mask && (((b & blk_mask) != 0) != outcome)) {
+            release_block(&csv->blocks[b]);
+            continue;
+        }
+        load_pair(csv, b, b, 0);
+        for (size_t i = 0; i < len; i++) {
+            if (in_mask && (((i & in_mask) != 0) != outcome)) {
+                csv->work_real[i] = 0.0f;
+                csv->work_imag[i] = 0.0f;
+            } else {
+                csv->work_real[i] *= scale;
+                csv->work_imag[i] *= scale;
+            }
+        }
+        rc = store_pair(csv, b, b, 0);
+    }
+
+    double elapsed = now_seconds() - t0;
+    csv->gate_seconds += elapsed;
+    csv->codec_seconds += elapsed;
+    csv->gates_applied++;
+    *out_result = outcome;
+    return rc == 0 ? 0 : -4;
+}
+
+int compressed_to_state_vector(const CompressedStateVector* csv, StateVector* sv) {
+    if (!csv || !csv->blocks || !sv) return -1;
+    if (sv->num_qubits != csv->num_qubits) return -2;
+    size_t len = block_length(csv);
+    for (size_t b = 0; b < csv->num_blocks; b++) {
+        decode_block(&csv->blocks[b], sv->real + b * len, sv->imag + b * len,
+                     len, 2.0f * csv->max_error);
+    }
+    return 0;
+}
+
+void get_compression_stats(const CompressedStateVector* csv, CompressionStats* stats) {
+    if (!csv || !stats) return;
+    memset(stats, 0, sizeof(*stats));
+    stats->dense_bytes = ((size_t)1 << csv->num_qubits) * 2 * sizeof(float);
+    for (size_t b = 0; b < csv->num_blocks; b++) {
+        stats->compressed_bytes += csv->blocks[b].nbytes;
+    }
+    // Count the block table and working buffer as well; they are the fixed cost of compression
+    stats->compressed_bytes += csv->num_blocks * sizeof(CompressedBlock)
+                             + 4 * block_length(csv) * sizeof(float);
+    stats->compression_ratio = (double)stats->dense_bytes / (double)stats->compressed_bytes;
+    stats->gates_applied = csv->gates_applied;
+    stats->gate_seconds = csv->gate_seconds;
+    stats->codec_seconds = csv->codec_seconds;
+    stats->overhead_per_gate = csv->gates_applied ? csv->codec_seconds / (double)csv->gates_applied : 0.0;
+}
+
+void print_compression_stats(const CompressedStateVector* csv) {
+    if (!csv) return;
+    CompressionStats st = {0};
+    get_compression_stats(csv, &st);
+    printf("Compressed state (%zu qubits, %zu blocks of 2^%zu, %s):\n",
+           csv->num_qubits, csv->num_blocks, csv->block_qubits,
+           csv->max_error > 0.0f ? "lossy" : "lossless");
+    printf("  dense bytes      : %zu\n", st.dense_bytes);
+    printf("  compressed bytes : %zu (ratio %.2fx)\n", st.compressed_bytes, st.compression_ratio);
+    printf("  gates applied    : %zu, %.6f s total, %.3f us codec overhead per gate\n",
+           st.gates_applied, st.gate_seconds, st.overhead_per_gate * 1e6);
+}
+
+/*
+ * Basic test stub (optional).
+ * Compile with:
+ *   gcc -o test_compressed compressed_state_vector.c state_vector.c gate_operations.c -lm
+ * Then run `./test_compressed`.
+ */
+#ifdef TEST_COMPRESSED_STATE_VECTOR
+int main(void) {
+    const float hadamard[8] = {
+        0.70710678f, 0.0f,  0.70710678f, 0.0f,
+        0.70710678f, 0.0f, -0.70710678f, 0.0f
+    };
+    CompressedStateVector csv;
+    if (init_compressed_state_vector(&csv, 20, 8, 0.0f) != 0) {
+        printf("Error initializing compressed state vector.\n");
+        return 1;
+    }
+    compressed_apply_single_qubit_gate(&csv, hadamard, 19);
+    compressed_apply_cnot(&csv, 19, 0);
+    print_compression_stats(&csv);
+    free_compressed_state_vector(&csv);
+    return 0;
+}
+#endif
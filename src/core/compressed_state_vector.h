@@ -0,0 +1,122 @@
+#ifndef COMPRESSED_STATE_VECTOR_H
+#define COMPRESSED_STATE_VECTOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "state_vector.h"
+
+/**
+ * \brief Default number of qubits covered by one compressed block (2^10 amplitudes = 8 KiB dense).
+ */
+#define COMPRESSED_DEFAULT_BLOCK_QUBITS 10
+
+/**
+ * \brief Storage format of a single compressed block.
+ */
+typedef enum {
+    BLOCK_ZERO,   /**< All amplitudes are zero; no payload is stored */
+    BLOCK_RLE,    /**< Run-length encoded (real, imag) pairs */
+    BLOCK_RAW,    /**< Uncompressed float pairs */
+    BLOCK_Q16     /**< Lossy mode only: 16-bit quantized real and imag codes */
+} BlockKind;
+
+/**
+ * \brief One independently compressed block of 2^block_qubits amplitudes.
+ */
+typedef struct CompressedBlock {
+    BlockKind kind;
+    uint32_t  runs;    /**< Number of runs (BLOCK_RLE only) */
+    size_t    nbytes;  /**< Size of the payload in bytes */
+    void*     data;    /**< Encoded payload (NULL for BLOCK_ZERO) */
+} CompressedBlock;
+
+/**
+ * \brief Counters describing the cost of running on compressed storage.
+ */
+typedef struct CompressionStats {
+    size_t dense_bytes;        /**< Bytes a dense StateVector of the same size would use */
+    size_t compressed_bytes;   /**< Current payload bytes across all blocks */
+    double compression_ratio;  /**< dense_bytes / compressed_bytes */
+    size_t gates_applied;      /**< Number of gates (and measurements) applied so far */
+    double gate_seconds;       /**< Total wall time spent inside gate calls */
+    double codec_seconds;      /**< Part of gate_seconds spent decompressing/recompressing */
+    double overhead_per_gate;  /**< codec_seconds / gates_applied */
+} CompressionStats;
+
+/**
+ * \brief State vector stored as independently compressed blocks.
+ *        Gates decompress only the blocks they touch into a small working buffer.
+ */
+typedef struct CompressedStateVector {
+    size_t num_qubits;         /**< Number of qubits in this system */
+    size_t block_qubits;       /**< log2 of the amplitudes per block */
+    size_t num_blocks;         /**< 2^(num_qubits - block_qubits) */
+    CompressedBlock* blocks;   /**< Block table */
+    float  max_error;          /**< 0 => lossless; otherwise absolute error bound per stored amplitude */
+    float* work_real;          /**< Working buffer, two blocks wide */
+    float* work_imag;
+    size_t gates_applied;
+    double gate_seconds;
+    double codec_seconds;
+} CompressedStateVector;
+
+/**
+ * \brief Allocates a CompressedStateVector in the |0...0> state.
+ * \param csv Pointer to a CompressedStateVector struct
+ * \param num_qubits Number of qubits
+ * \param block_qubits log2 of the block size (0 selects COMPRESSED_DEFAULT_BLOCK_QUBITS)
+ * \param max_error 0 for lossless storage, or the maximum absolute error allowed per amplitude
+ * \return 0 on success, nonzero on error
+ */
+int init_compressed_state_vector(CompressedStateVector* csv, size_t num_qubits,
+                                 size_t block_qubits, float max_error);
+
+/**
+ * \brief Frees resources associated with a CompressedStateVector.
+ */
+void free_compressed_state_vector(CompressedStateVector* csv);
+
+/**
+ * \brief Applies a 2x2 single-qubit gate (same layout as apply_single_qubit_gate).
+ * \return 0 on success, nonzero on error
+ */
+int compressed_apply_single_qubit_gate(CompressedStateVector* csv, const float* gate, size_t qubit_index);
+
+/**
+ * \brief Applies a CNOT. Blocks selected purely by the control/target block bits are
+ *        swapped without being decompressed.
+ * \return 0 on success, nonzero on error
+ */
+int compressed_apply_cnot(CompressedStateVector* csv, size_t control_qubit, size_t target_qubit);
+
+/**
+ * \brief Measures a qubit in the computational basis and collapses the compressed state.
+ * \return 0 on success, nonzero on error
+ */
+int compressed_measure_qubit(CompressedStateVector* csv, size_t qubit_index, int* out_result);
+
+/**
+ * \brief Decompresses the whole state into an initialized dense StateVector of the same size.
+ * \return 0 on success, nonzero on error
+ */
+int compressed_to_state_vector(const CompressedStateVector* csv, StateVector* sv);
+
+/**
+ * \brief Fills out the compression ratio and per-gate time overhead.
+ */
+void get_compression_stats(const CompressedStateVector* csv, CompressionStats* stats);
+
+/**
+ * \brief Prints the compression statistics (for run summaries).
+ */
+void print_compression_stats(const CompressedStateVector* csv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPRESSED_STATE_VECTOR_H */
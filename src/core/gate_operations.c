@@ -141,6 +141,154 @@ int apply_cnot(StateVector* sv, size_t control_qubit, size_t target_qubit) {
     return 0;
 }
 
+int apply_controlled_phase(StateVector* sv, size_t control_qubit, size_t target_qubit,
+                           float phase_real, float phase_imag) {
+    if (!sv) return -1;
+    if (control_qubit >= sv->num_qubits || target_qubit >= sv->num_qubits) return -2;
+    if (control_qubit == target_qubit) return -3;
+
+    // Enumerate only the quarter of the indices with both bits set, by inserting
+    // the two fixed bits into a counter over the remaining n-2 bits
+    size_t lo = control_qubit < target_qubit ? control_qubit : target_qubit;
+    size_t hi = control_qubit < target_qubit ? target_qubit : control_qubit;
+    size_t lo_mask = ((size_t)1 << lo) - 1;
+    size_t hi_mask = ((size_t)1 << hi) - 1;
+    size_t both = ((size_t)1 << lo) | ((size_t)1 << hi);
+    size_t quarter = (size_t)1 << (sv->num_qubits - 2);
+
+    for (size_t k = 0; k < quarter; k++) {
+        size_t i = (k & lo_mask) | ((k & ~lo_mask) << 1);       // insert a 0 at bit lo
+        i = (i & hi_mask) | ((i & ~hi_mask) << 1);              // insert a 0 at bit hi
+        i |= both;
+        float r = sv->real[i];
+        float im = sv->imag[i];
+        sv->real[i] = phase_real * r - phase_imag * im;
+        sv->imag[i] = phase_real * im + phase_imag * r;
+    }
+    return 0;
+}
+
+/**
+ * \brief One group of four amplitudes through the 4x4 gate (scalar path).
+ */
+static inline void apply_4x4_group(StateVector* sv, const float* gate, size_t base, const size_t* offsets) {
+    float in_r[4], in_i[4];
+    for (size_t c = 0; c < 4; c++) {
+        in_r[c] = sv->real[base + offsets[c]];
+        in_i[c] = sv->imag[base + offsets[c]];
+    }
+    for (size_t r = 0; r < 4; r++) {
+        const float* row = &gate[8 * r];
+        float acc_r = 0.0f, acc_i = 0.0f;
+        for (size_t c = 0; c < 4; c++) {
+            acc_r += row[2 * c] * in_r[c] - row[2 * c + 1] * in_i[c];
+            acc_i += row[2 * c] * in_i[c] + row[2 * c + 1] * in_r[c];
+        }
+        sv->real[base + offsets[r]] = acc_r;
+        sv->imag[base + offsets[r]] = acc_i;
+    }
+}
+
+int apply_two_qubit_gate(StateVector* sv, const float* gate, size_t qubit_a, size_t qubit_b) {
+    if (!sv || !gate) return -1;
+    if (qubit_a >= sv->num_qubits || qubit_b >= sv->num_qubits) return -2;
+    if (qubit_a == qubit_b) return -3;
+
+    size_t lo = qubit_a < qubit_b ? qubit_a : qubit_b;
+    size_t hi = qubit_a < qubit_b ? qubit_b : qubit_a;
+    size_t lo_mask = ((size_t)1 << lo) - 1;
+    size_t hi_mask = ((size_t)1 << hi) - 1;
+    size_t a_bit = (size_t)1 << qubit_a;
+    size_t b_bit = (size_t)1 << qubit_b;
+    const size_t offsets[4] = { 0, b_bit, a_bit, a_bit | b_bit };
+    size_t quarter = (size_t)1 << (sv->num_qubits - 2);
+
+    size_t k = 0;
+#ifdef __SSE__
+    // With both qubits above bit 1, four consecutive base indices are four consecutive
+    // amplitudes: process them as one vector per local basis state
+    if (lo >= 2) {
+        __m128 g_r[16], g_i[16];
+        for (size_t e = 0; e < 16; e++) {
+            g_r[e] = _mm_set1_ps(gate[2 * e]);
+            g_i[e] = _mm_set1_ps(gate[2 * e + 1]);
+        }
+        for (; k + 4 <= quarter; k += 4) {
+            size_t i = (k & lo_mask) | ((k & ~lo_mask) << 1);
+            i = (i & hi_mask) | ((i & ~hi_mask) << 1);
+            __m128 in_r[4], in_i[4];
+            for (size_t c = 0; c < 4; c++) {
+                in_r[c] = _mm_loadu_ps(&sv->real[i + offsets[c]]);
+                in_i[c] = _mm_loadu_ps(&sv->imag[i + offsets[c]]);
+            }
+            for (size_t r = 0; r < 4; r++) {
+                __m128 acc_r = _mm_setzero_ps();
+                __m128 acc_i = _mm_setzero_ps();
+                for (size_t c = 0; c < 4; c++) {
+                    __m128 gr = g_r[4 * r + c], gi = g_i[4 * r + c];
+                    acc_r = _mm_add_ps(acc_r, _mm_sub_ps(_mm_mul_ps(gr, in_r[c]), _mm_mul_ps(gi, in_i[c])));
+                    acc_i = _mm_add_ps(acc_i, _mm_add_ps(_mm_mul_ps(gr, in_i[c]), _mm_mul_ps(gi, in_r[c])));
+                }
+                _mm_storeu_ps(&sv->real[i + offsets[r]], acc_r);
+                _mm_storeu_ps(&sv->imag[i + offsets[r]], acc_i);
+            }
+        }
+    }
+#endif
+    for (; k < quarter; k++) {
+        size_t i = (k & lo_mask) | ((k & ~lo_mask) << 1);       // insert a 0 at bit lo
+        i = (i & hi_mask) | ((i & ~hi_mask) << 1);              // insert a 0 at bit hi
+        apply_4x4_group(sv, gate, i, offsets);
+    }
+    return 0;
+}
+
+// A 64-byte line holds 16 floats, so bits below 4 never skip a line
+#define CACHE_LINE_QUBITS 4
+
+int dense_kernel_cost(DenseKernel kernel, size_t num_qubits, size_t low_qubit, size_t high_qubit,
+                      KernelCost* cost) {
+    if (!cost) return -1;
+    double amplitudes = ldexp(1.0, (int)num_qubits);
+    double lines = 1.0; // fraction of the real/imag arrays' lines touched
+    double flops_per_amp = 0.0;
+    double sweeps = 1.0;
+    switch (kernel) {
+        case KERNEL_GATE_1Q:
+            flops_per_amp = 14.0; // two complex multiplies and one add per output
+            break;
+        case KERNEL_GATE_2Q:
+            flops_per_amp = 30.0; // four complex multiplies and three adds per output
+            break;
+        case KERNEL_CNOT:
+            // Swaps the half with the control set
+            lines = (low_qubit < CACHE_LINE_QUBITS) ? 1.0 : 0.5;
+            break;
+        case KERNEL_CPHASE:
+            // Rephases the quarter with both bits set
+            lines = (high_qubit < CACHE_LINE_QUBITS) ? 1.0 : (low_qubit < CACHE_LINE_QUBITS) ? 0.5 : 0.25;
+            flops_per_amp = 6.0 * 0.25;
+            break;
+        case KERNEL_MEASURE:
+            // Probability sweep (read only), collapse, normalize
+            sweeps = 3.0;
+            lines = 2.0 / 3.0;
+            flops_per_amp = 6.0;
+            break;
+        default:
+            return -2;
+    }
+    cost->passes = sweeps * lines;
+    cost->bytes = amplitudes * 2.0 * sizeof(float) * 2.0 * sweeps * lines; // read + write
+    cost->flops = amplitudes * flops_per_amp;
+    return 0;
+}
+
+double kernel_cost_seconds(const KernelCost* cost, double bandwidth, double flop_rate) {
+    if (!cost || bandwidth <= 0.0 || flop_rate <= 0.0) return 0.0;
+    return cost->bytes / bandwidth + cost->flops / flop_rate;
+}
+
 /*
  * Basic test stub (optional). 
  * Compile with:
@@ -31,6 +31,83 @@ int apply_single_qubit_gate(StateVector* sv, const float* gate, size_t qubit_ind
  */
 int apply_cnot(StateVector* sv, size_t control_qubit, size_t target_qubit);
 
+/**
+ * \brief Applies a controlled phase: multiplies the amplitudes where both qubits are 1
+ *        by (phase_real + i * phase_imag). The gate is symmetric in its two qubits.
+ * \param sv The state vector
+ * \param control_qubit Index of the control qubit
+ * \param target_qubit Index of the target qubit
+ * \param phase_real Real part of e^{i phi}
+ * \param phase_imag Imaginary part of e^{i phi}
+ * \return 0 on success, nonzero on error
+ */
+int apply_controlled_phase(StateVector* sv, size_t control_qubit, size_t target_qubit,
+                           float phase_real, float phase_imag);
+
+/**
+ * \brief Applies a 4x4 two-qubit gate. Within each group of four amplitudes the local
+ *        basis index is (bit of qubit_a) * 2 + (bit of qubit_b), so for qubit_a = control
+ *        and qubit_b = target a CNOT swaps local states 2 and 3.
+ * \param sv The state vector
+ * \param gate 4x4 complex matrix, row-major, interleaved: gate[8 * row + 2 * col] is the real
+ *             part of entry (row, col) and gate[8 * row + 2 * col + 1] its imaginary part
+ * \param qubit_a Qubit for the high bit of the local index
+ * \param qubit_b Qubit for the low bit of the local index
+ * \return 0 on success, nonzero on error
+ */
+int apply_two_qubit_gate(StateVector* sv, const float* gate, size_t qubit_a, size_t qubit_b);
+
+/**
+ * \brief Default sustained memory bandwidth (bytes/s) of the roofline cost model.
+ */
+#define KERNEL_DEFAULT_BANDWIDTH 16e9
+
+/**
+ * \brief Default sustained float throughput (operations/s) of the roofline cost model.
+ */
+#define KERNEL_DEFAULT_FLOP_RATE 20e9
+
+/**
+ * \brief Dense state-vector kernels the cost model knows about.
+ */
+typedef enum {
+    KERNEL_GATE_1Q,   /**< apply_single_qubit_gate */
+    KERNEL_GATE_2Q,   /**< apply_two_qubit_gate */
+    KERNEL_CNOT,      /**< apply_cnot */
+    KERNEL_CPHASE,    /**< apply_controlled_phase */
+    KERNEL_MEASURE,   /**< measure_qubit (probability sweep, collapse, normalize) */
+    KERNEL_COUNT
+} DenseKernel;
+
+/**
+ * \brief Work done by one kernel call.
+ */
+typedef struct KernelCost {
+    double passes; /**< Fraction of the state's cache lines touched, in full sweeps */
+    double bytes;  /**< Bytes read plus bytes written */
+    double flops;  /**< Float additions and multiplications */
+} KernelCost;
+
+/**
+ * \brief Estimates the memory traffic and arithmetic of one dense kernel call. Kernels that
+ *        only touch amplitudes with some bits set (CNOT, CPHASE) still pull in every cache
+ *        line when those bits are among the lowest four, since a 64-byte line holds 16 floats.
+ * \param kernel Kernel to cost
+ * \param num_qubits Register size
+ * \param low_qubit Lowest qubit that selects the touched amplitudes (CNOT: the control;
+ *                  CPHASE: the lower of the two), ignored by full-sweep kernels
+ * \param high_qubit CPHASE only: the higher of the two qubits
+ * \param cost Output cost
+ * \return 0 on success, nonzero on error
+ */
+int dense_kernel_cost(DenseKernel kernel, size_t num_qubits, size_t low_qubit, size_t high_qubit,
+                      KernelCost* cost);
+
+/**
+ * \brief Roofline time of a kernel call: bytes / bandwidth + flops / flop_rate.
+ */
+double kernel_cost_seconds(const KernelCost* cost, double bandwidth, double flop_rate);
+
 #ifdef __cplusplus
 }
 #endif
@@ -64,15 +64,18 @@ static void normalize(StateVector* sv) {
 }
 
 int measure_qubit(StateVector* sv, size_t qubit_index, int* out_result) {
+    // Generate random number to decide measurement outcome
+    float rand_val = (float)rand()/(float)RAND_MAX;
+    return measure_qubit_sampled(sv, qubit_index, rand_val, out_result);
+}
+
+int measure_qubit_sampled(StateVector* sv, size_t qubit_index, double random_value, int* out_result) {
     if (!sv || !out_result) return -1;
     if (qubit_index >= sv->num_qubits) return -2;
 
     // Probability that qubit_index is 0
     float p0 = measure_probability(sv, qubit_index, 0);
-
-    // Generate random number to decide measurement outcome
-    float rand_val = (float)rand()/(float)RAND_MAX;
-    int outcome = (rand_val < p0) ? 0 : 1;
+    int outcome = (random_value < p0) ? 0 : 1;
 
     // Collapse the state vector
     collapse(sv, qubit_index, outcome);
@@ -17,6 +17,18 @@ extern "C" {
  */
 int measure_qubit(StateVector* sv, size_t qubit_index, int* out_result);
 
+/**
+ * \brief Like measure_qubit, but the outcome is decided by a caller-supplied uniform value
+ *        instead of rand(): 0 if random_value < P(0), else 1. Lets each thread use its own
+ *        random stream.
+ * \param sv Pointer to the StateVector
+ * \param qubit_index Index of the qubit to measure
+ * \param random_value Uniform sample in [0, 1)
+ * \param out_result Pointer to an integer where the measurement result (0 or 1) is stored
+ * \return 0 on success, nonzero on error
+ */
+int measure_qubit_sampled(StateVector* sv, size_t qubit_index, double random_value, int* out_result);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,774 @@
+#include "mps_state.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+#define MPS_MAX_SWEEPS 60
+
+/*
+ * Dense work happens in double precision on interleaved complex arrays; only the stored
+ * site tensors are float.
+ */
+
+static size_t sat_add(size_t a, size_t b) {
+    return (a > SIZE_MAX - b) ? SIZE_MAX : a + b;
+}
+
+static size_t sat_mul(size_t a, size_t b) {
+    return (a != 0 && b > SIZE_MAX / a) ? SIZE_MAX : a * b;
+}
+
+/**
+ * \brief Largest dimension bond 'b' (between sites b - 1 and b) can reach: 2^min(b, n - b),
+ *        capped at max_bond.
+ */
+static size_t bond_limit(size_t num_qubits, size_t b, size_t max_bond) {
+    size_t side = b < num_qubits - b ? b : num_qubits - b;
+    if (side >= sizeof(size_t) * 8 - 1) return max_bond;
+    size_t full = (size_t)1 << side;
+    return full < max_bond ? full : max_bond;
+}
+
+size_t mps_state_bytes(size_t num_qubits, size_t max_bond) {
+    if (max_bond == 0) max_bond = MPS_DEFAULT_MAX_BOND;
+    size_t bytes = sat_mul(num_qubits + 1, sizeof(size_t) + sizeof(float*));
+    size_t widest = 1;
+    for (size_t q = 0; q < num_qubits; q++) {
+        size_t l = bond_limit(num_qubits, q, max_bond), r = bond_limit(num_qubits, q + 1, max_bond);
+        bytes = sat_add(bytes, sat_mul(sat_mul(l, r), 4 * sizeof(float)));
+        if (l > widest) widest = l;
+    }
+    // One split: theta, its working copy and the two factors, each (2 chi)^2 complex doubles
+    size_t side = sat_mul(2, widest);
+    return sat_add(bytes, sat_mul(sat_mul(side, side), 4 * 2 * sizeof(double)));
+}
+
+int init_mps_state(MpsState* mps, size_t num_qubits, size_t max_bond, double truncation_threshold) {
+    if (!mps || num_qubits == 0) return -1;
+    memset(mps, 0, sizeof(*mps));
+    mps->num_qubits = num_qubits;
+    mps->max_bond = max_bond ? max_bond : MPS_DEFAULT_MAX_BOND;
+    mps->truncation_threshold = truncation_threshold < 0.0 ? MPS_DEFAULT_TRUNCATION : truncation_threshold;
+    mps->peak_bond = 1;
+    mps->fidelity = 1.0;
+    mps->bond = (size_t*)malloc((num_qubits + 1) * sizeof(size_t));
+    mps->tensors = (float**)calloc(num_qubits, sizeof(float*));
+    if (!mps->bond || !mps->tensors) {
+        free_mps_state(mps);
+        return -2;
+    }
+    for (size_t b = 0; b <= num_qubits; b++) mps->bond[b] = 1;
+    for (size_t q = 0; q < num_qubits; q++) {
+        mps->tensors[q] = (float*)calloc(4, sizeof(float));
+        if (!mps->tensors[q]) {
+            fprintf(stderr, "Error: could not allocate a %zu-qubit MPS.\n", num_qubits);
+            free_mps_state(mps);
+            return -2;
+        }
+        mps->tensors[q][0] = 1.0f; // |0>
+    }
+    return 0;
+}
+
+void free_mps_state(MpsState* mps) {
+    if (!mps) return;
+    if (mps->tensors) {
+        for (size_t q = 0; q < mps->num_qubits; q++) free(mps->tensors[q]);
+    }
+    free(mps->tensors);
+    free(mps->bond);
+    memset(mps, 0, sizeof(*mps));
+}
+
+/**
+ * \brief Replaces site q's tensor with a left x 2 x right double tensor and updates its bonds.
+ */
+static int store_tensor(MpsState* mps, size_t q, const double* data, size_t left, size_t right) {
+    size_t count = left * 2 * right * 2;
+    float* t = (float*)malloc(count * sizeof(float));
+    if (!t) return -2;
+    for (size_t i = 0; i < count; i++) t[i] = (float)data[i];
+    free(mps->tensors[q]);
+    mps->tensors[q] = t;
+    mps->bond[q] = left;
+    mps->bond[q + 1] = right;
+    if (left > mps->peak_bond) mps->peak_bond = left;
+    if (right > mps->peak_bond) mps->peak_bond = right;
+    return 0;
+}
+
+static double* load_tensor(const MpsState* mps, size_t q) {
+    size_t count = mps->bond[q] * 2 * mps->bond[q + 1] * 2;
+    double* d = (double*)malloc(count * sizeof(double));
+    if (!d) return NULL;
+    for (size_t i = 0; i < count; i++) d[i] = mps->tensors[q][i];
+    return d;
+}
+
+/**
+ * \brief conj(x) . y over two complex columns (one complex per SSE2 register).
+ */
+static void column_overlap(const double* x, const double* y, size_t rows, double* out_re, double* out_im) {
+#ifdef __SSE2__
+    __m128d same = _mm_setzero_pd(), cross = _mm_setzero_pd();
+    for (size_t i = 0; i < rows; i++) {
+        __m128d xv = _mm_loadu_pd(x + 2 * i), yv = _mm_loadu_pd(y + 2 * i);
+        same = _mm_add_pd(same, _mm_mul_pd(xv, yv));                                   // xr yr, xi yi
+        cross = _mm_add_pd(cross, _mm_mul_pd(xv, _mm_shuffle_pd(yv, yv, 1)));         // xr yi, xi yr
+    }
+    double a[2], b[2];
+    _mm_storeu_pd(a, same);
+    _mm_storeu_pd(b, cross);
+    *out_re = a[0] + a[1];
+    *out_im = b[0] - b[1];
+#else
+    double gr = 0.0, gi = 0.0;
+    for (size_t i = 0; i < rows; i++) {
+        double xr = x[2 * i], xi = x[2 * i + 1], yr = y[2 * i], yi = y[2 * i + 1];
+        gr += xr * yr + xi * yi;
+        gi += xr * yi - xi * yr;
+    }
+    *out_re = gr;
+    *out_im = gi;
+#endif
+}
+
+/**
+ * \brief (x, y) <- (c x - p y, q x + c y) with complex p = s e^{-i phi}, q = s e^{i phi}.
+ */
+static void rotate_columns(double* x, double* y, size_t rows, double c, double pr, double pi) {
+#ifdef __SSE2__
+    // z * (r + i m) = r z + m (-zi, zr)
+    __m128d cv = _mm_set1_pd(c);
+    __m128d prv = _mm_set1_pd(pr), piv = _mm_set_pd(pi, -pi);   // p
+    __m128d qiv = _mm_set_pd(-pi, pi);                          // q = conj(p)
+    for (size_t i = 0; i < rows; i++) {
+        __m128d xv = _mm_loadu_pd(x + 2 * i), yv = _mm_loadu_pd(y + 2 * i);
+        __m128d xs = _mm_shuffle_pd(xv, xv, 1), ys = _mm_shuffle_pd(yv, yv, 1);
+        __m128d py = _mm_add_pd(_mm_mul_pd(prv, yv), _mm_mul_pd(piv, ys));
+        __m128d qx = _mm_add_pd(_mm_mul_pd(prv, xv), _mm_mul_pd(qiv, xs));
+        _mm_storeu_pd(x + 2 * i, _mm_sub_pd(_mm_mul_pd(cv, xv), py));
+        _mm_storeu_pd(y + 2 * i, _mm_add_pd(qx, _mm_mul_pd(cv, yv)));
+    }
+#else
+    for (size_t i = 0; i < rows; i++) {
+        double xr = x[2 * i], xi = x[2 * i + 1], yr = y[2 * i], yi = y[2 * i + 1];
+        x[2 * i] = c * xr - (pr * yr - pi * yi);
+        x[2 * i + 1] = c * xi - (pr * yi + pi * yr);
+        y[2 * i] = (pr * xr + pi * xi) + c * yr;
+        y[2 * i + 1] = (pr * xi - pi * xr) + c * yi;
+    }
+#endif
+}
+
+/**
+ * \brief One-sided Jacobi orthogonalization of the columns of a complex rows x cols matrix,
+ *        given column-major in 'a' (overwritten). On return the columns are mutually
+ *        orthogonal: column j is s_j u_j. Columns may be permuted; the rotations themselves
+ *        are not accumulated.
+ * \param norms Workspace of cols doubles
+ */
+static void jacobi_columns(double* a, size_t rows, size_t cols, double* norms) {
+    double floor = 0.0;
+
+    for (int sweep = 0; sweep < MPS_MAX_SWEEPS; sweep++) {
+        // Squared column norms are updated with each rotation and refreshed once per sweep
+        double total = 0.0;
+        for (size_t j = 0; j < cols; j++) {
+            double n2 = 0.0;
+            for (size_t i = 0; i < 2 * rows; i++) n2 += a[2 * j * rows + i] * a[2 * j * rows + i];
+            norms[j] = n2;
+            total += n2;
+        }
+        // Pairs whose overlap is below double resolution of the whole matrix are left alone,
+        // so numerically-zero columns do not keep the sweep going
+        if (sweep == 0) floor = 1e-30 * total;
+        int rotated = 0;
+        for (size_t j = 0; j + 1 < cols; j++) {
+            // Rotate against the largest remaining column first (de Rijk pivoting): fewer sweeps
+            size_t best = j;
+            for (size_t k = j + 1; k < cols; k++) {
+                if (norms[k] > norms[best]) best = k;
+            }
+            if (best != j) {
+                double* pj = a + 2 * j * rows;
+                double* pb = a + 2 * best * rows;
+                for (size_t i = 0; i < 2 * rows; i++) {
+                    double tmp = pj[i];
+                    pj[i] = pb[i];
+                    pb[i] = tmp;
+                }
+                double tmp = norms[j];
+                norms[j] = norms[best];
+                norms[best] = tmp;
+            }
+            for (size_t k = j + 1; k < cols; k++) {
+                double alpha = norms[j], beta = norms[k];
+                if (alpha * beta <= floor * floor) continue;
+                double* aj = a + 2 * j * rows;
+                double* ak = a + 2 * k * rows;
+                double gr, gi;
+                column_overlap(aj, ak, rows, &gr, &gi);
+                double g = sqrt(gr * gr + gi * gi);
+                if (g <= 1e-10 * sqrt(alpha * beta) || g <= floor) continue;
+                rotated = 1;
+
+                // Rotate (a_j, e^{-i phi} a_k) as a real pair, phi = arg(gamma)
+                double zeta = (beta - alpha) / (2.0 * g);
+                double t = (zeta >= 0.0 ? 1.0 : -1.0) / (fabs(zeta) + sqrt(1.0 + zeta * zeta));
+                double c = 1.0 / sqrt(1.0 + t * t), s = c * t;
+                double er = gr / g, ei = gi / g; // e^{i phi}
+                norms[j] = alpha - t * g;
+                norms[k] = beta + t * g;
+                rotate_columns(aj, ak, rows, c, s * er, -s * ei);
+            }
+        }
+        if (!rotated) break;
+    }
+}
+
+/**
+ * \brief Number of singular values to keep: the smallest are dropped while their relative
+ *        weight stays within 'threshold', then the rest is cut to 'cap'. Exact zeros always go.
+ * \param discarded Receives the dropped relative weight
+ */
+static size_t kept_values(const double* s, size_t count, size_t cap, double threshold, double* discarded) {
+    double total = 0.0;
+    for (size_t j = 0; j < count; j++) total += s[j] * s[j];
+    size_t k = count;
+    while (k > 1 && s[k - 1] <= 1e-13 * s[0]) k--; // rank deficiency, not truncation
+    double tail = 0.0;
+    while (k > 1 && tail + s[k - 1] * s[k - 1] <= threshold * total) {
+        tail += s[k - 1] * s[k - 1];
+        k--;
+    }
+    while (k > cap) {
+        tail += s[k - 1] * s[k - 1];
+        k--;
+    }
+    *discarded = total > 0.0 ? tail / total : 0.0;
+    return k;
+}
+
+/**
+ * \brief Rank-dropping QR of T = M or, with 'adjoint', T = M^H, for a row-major complex
+ *        rows x cols matrix M: T = Q R with Q (column-major, T's row count x rank) having
+ *        orthonormal columns and R row-major rank x (T's column count). Columns are
+ *        orthogonalized twice by Gram-Schmidt; those left with no weight add no column to Q.
+ * \return 0 on success, nonzero if out of memory
+ */
+static int complex_qr(const double* m, size_t rows, size_t cols, int adjoint,
+                      double* q, double* r, size_t* out_rank) {
+    size_t tr = adjoint ? cols : rows;
+    size_t tc = adjoint ? rows : cols;
+    double* t = (double*)malloc(tr * 2 * sizeof(double));
+    if (!t) return -2;
+    double total = 0.0;
+    for (size_t i = 0; i < 2 * rows * cols; i++) total += m[i] * m[i];
+    memset(r, 0, (tr < tc ? tr : tc) * tc * 2 * sizeof(double));
+
+    size_t rank = 0;
+    for (size_t j = 0; j < tc; j++) {
+        for (size_t i = 0; i < tr; i++) { // column j of T
+            size_t at = adjoint ? j * cols + i : i * cols + j;
+            t[2 * i] = m[2 * at];
+            t[2 * i + 1] = adjoint ? -m[2 * at + 1] : m[2 * at + 1];
+        }
+        for (int pass = 0; pass < 2; pass++) {
+            for (size_t k = 0; k < rank; k++) {
+                const double* qk = q + 2 * k * tr;
+                double cr, ci;
+                column_overlap(qk, t, tr, &cr, &ci);
+                for (size_t i = 0; i < tr; i++) {
+                    t[2 * i] -= cr * qk[2 * i] - ci * qk[2 * i + 1];
+                    t[2 * i + 1] -= cr * qk[2 * i + 1] + ci * qk[2 * i];
+                }
+                r[2 * (k * tc + j)] += cr;
+                r[2 * (k * tc + j) + 1] += ci;
+            }
+        }
+        double n2 = 0.0;
+        for (size_t i = 0; i < 2 * tr; i++) n2 += t[i] * t[i];
+        if (rank == tr || n2 <= 1e-26 * total) continue;
+        double norm = sqrt(n2);
+        double* qn = q + 2 * rank * tr;
+        for (size_t i = 0; i < 2 * tr; i++) qn[i] = t[i] / norm;
+        r[2 * (rank * tc + j)] = norm;
+        rank++;
+    }
+    free(t);
+    *out_rank = rank > 0 ? rank : 1;
+    if (rank == 0) { // zero matrix: keep a bond of 1
+        memset(q, 0, tr * 2 * sizeof(double));
+        q[0] = 1.0;
+    }
+    return 0;
+}
+
+/**
+ * \brief SVD of a row-major complex rows x cols matrix: M = U diag(s) Vh with
+ *        k = min(rows, cols) singular values in descending order. u is rows x k, vh is k x cols,
+ *        both row-major.
+ *
+ *        The tall form T (M, or M^H when wide) is first reduced to T = Q R and the Jacobi
+ *        sweeps run on the columns of R^H = V S W^H, which are few and already close to
+ *        orthogonal, so they converge in a few sweeps. V are T's right singular vectors and its
+ *        left ones follow by projection, u_j = T v_j / s_j.
+ * \return 0 on success, nonzero if out of memory
+ */
+static int complex_svd(const double* m, size_t rows, size_t cols, double* u, double* s, double* vh) {
+    int wide = cols > rows;
+    size_t tr = wide ? cols : rows; // tall shape: tr x tc
+    size_t tc = wide ? rows : cols;
+    double* q = (double*)malloc(tr * tc * 2 * sizeof(double));
+    double* r = (double*)malloc(tc * tc * 2 * sizeof(double));
+    double* x = (double*)malloc(tc * tc * 2 * sizeof(double));
+    size_t* order = (size_t*)malloc(tc * sizeof(size_t));
+    double* norms = (double*)malloc(tc * sizeof(double));
+    size_t rank = 0;
+    int rc = -2;
+    if (!q || !r || !x || !order || !norms || complex_qr(m, rows, cols, wide, q, r, &rank) != 0) goto done;
+
+    // X = R^H, column-major tc x rank
+    for (size_t j = 0; j < rank; j++) {
+        for (size_t i = 0; i < tc; i++) {
+            x[2 * (j * tc + i)] = r[2 * (j * tc + i)];
+            x[2 * (j * tc + i) + 1] = -r[2 * (j * tc + i) + 1];
+        }
+    }
+    jacobi_columns(x, tc, rank, norms);
+
+    for (size_t j = 0; j < rank; j++) {
+        double n2 = 0.0;
+        for (size_t i = 0; i < 2 * tc; i++) n2 += x[2 * j * tc + i] * x[2 * j * tc + i];
+        norms[j] = sqrt(n2);
+        order[j] = j;
+    }
+    for (size_t j = 1; j < rank; j++) { // insertion sort, descending
+        size_t o = order[j], i = j;
+        while (i > 0 && norms[order[i - 1]] < norms[o]) {
+            order[i] = order[i - 1];
+            i--;
+        }
+        order[i] = o;
+    }
+
+    size_t k = tc;
+    memset(u, 0, rows * k * 2 * sizeof(double));
+    memset(vh, 0, k * cols * 2 * sizeof(double));
+    memset(s, 0, k * sizeof(double));
+    for (size_t jj = 0; jj < rank; jj++) {
+        size_t j = order[jj];
+        double sj = norms[j];
+        if (sj <= 0.0) break;
+        double inv = 1.0 / sj;
+        s[jj] = sj;
+        // Right vectors of T: v = x_j / s_j (tc entries)
+        for (size_t i = 0; i < tc; i++) {
+            double re = x[2 * (j * tc + i)] * inv, im = x[2 * (j * tc + i) + 1] * inv;
+            if (!wide) {
+                vh[2 * (jj * cols + i)] = re;   // Vh[jj][i] = conj(V[i][jj])
+                vh[2 * (jj * cols + i) + 1] = -im;
+            } else {
+                u[2 * (i * k + jj)] = re;       // M = T^H = V S U_T^H: U[i][jj] = V[i][jj]
+                u[2 * (i * k + jj) + 1] = im;
+            }
+        }
+        // Left vectors of T: T x_j / s_j^2 (tr entries)
+        for (size_t i = 0; i < tr; i++) {
+            double re = 0.0, im = 0.0;
+            for (size_t c = 0; c < tc; c++) {
+                // T[i][c] is m[i][c], or conj(m[c][i]) when wide
+                double mr = wide ? m[2 * (c * cols + i)] : m[2 * (i * cols + c)];
+                double mi = wide ? -m[2 * (c * cols + i) + 1] : m[2 * (i * cols + c) + 1];
+                double xr = x[2 * (j * tc + c)], xi = x[2 * (j * tc + c) + 1];
+                re += mr * xr - mi * xi;
+                im += mr * xi + mi * xr;
+            }
+            re *= inv * inv;
+            im *= inv * inv;
+            if (!wide) {
+                u[2 * (i * k + jj)] = re;       // U[i][jj]
+                u[2 * (i * k + jj) + 1] = im;
+            } else {
+                vh[2 * (jj * cols + i)] = re;   // Vh[jj][i] = conj(U_T[i][jj])
+                vh[2 * (jj * cols + i) + 1] = -im;
+            }
+        }
+    }
+    rc = 0;
+done:
+    free(q);
+    free(r);
+    free(x);
+    free(order);
+    free(norms);
+    return rc;
+}
+
+/**
+ * \brief Moves the orthogonality center one site right (direction +1) or left (-1) with an
+ *        exact QR split; only directions carrying no weight are dropped from the bond.
+ */
+static int shift_center(MpsState* mps, int direction) {
+    size_t c = mps->center;
+    size_t next = direction > 0 ? c + 1 : c - 1;
+    size_t left = mps->bond[c], right = mps->bond[c + 1];
+    size_t next_left = mps->bond[next], next_right = mps->bond[next + 1];
+    // Right: A_c (2 left x right) = Q R. Left: A_c^H (2 right x left) = Q R, so A_c = R^H Q^H.
+    size_t tr = direction > 0 ? 2 * left : 2 * right;
+    size_t tc = direction > 0 ? right : left;
+    size_t k = tr < tc ? tr : tc;
+
+    double* m = load_tensor(mps, c); // row-major (l, p, r): already (2l x r) and (l x 2r)
+    double* nb = load_tensor(mps, next);
+    double* q = (double*)malloc(tr * k * 2 * sizeof(double));
+    double* r = (double*)malloc(k * tc * 2 * sizeof(double));
+    double* site = (double*)malloc(tr * k * 2 * sizeof(double));
+    double* out = NULL;
+    size_t keep;
+    int rc = -2;
+    if (!m || !nb || !q || !r || !site) goto done;
+    if (direction > 0) {
+        if (complex_qr(m, 2 * left, right, 0, q, r, &keep) != 0) goto done;
+        // A_c = Q (2 left x keep); A_next = R A_next, (keep x right) . (right x 2 next_right)
+        for (size_t i = 0; i < tr; i++) {
+            for (size_t j = 0; j < keep; j++) {
+                site[2 * (i * keep + j)] = q[2 * (j * tr + i)];
+                site[2 * (i * keep + j) + 1] = q[2 * (j * tr + i) + 1];
+            }
+        }
+        out = (double*)calloc(keep * 2 * next_right * 2, sizeof(double));
+        if (!out) goto done;
+        for (size_t j = 0; j < keep; j++) {
+            for (size_t mid = 0; mid < right; mid++) {
+                double ar = r[2 * (j * tc + mid)], ai = r[2 * (j * tc + mid) + 1];
+                if (ar == 0.0 && ai == 0.0) continue;
+                for (size_t x = 0; x < 2 * next_right; x++) {
+                    double br = nb[2 * (mid * 2 * next_right + x)], bi = nb[2 * (mid * 2 * next_right + x) + 1];
+                    out[2 * (j * 2 * next_right + x)] += ar * br - ai * bi;
+                    out[2 * (j * 2 * next_right + x) + 1] += ar * bi + ai * br;
+                }
+            }
+        }
+        if (store_tensor(mps, c, site, left, keep) != 0 || store_tensor(mps, next, out, keep, next_right) != 0) goto done;
+    } else {
+        if (complex_qr(m, left, 2 * right, 1, q, r, &keep) != 0) goto done;
+        // A_c = Q^H (keep x 2 right); A_next = A_next R^H, (2 next_left x left) . (left x keep)
+        for (size_t j = 0; j < keep; j++) {
+            for (size_t i = 0; i < tr; i++) {
+                site[2 * (j * tr + i)] = q[2 * (j * tr + i)];
+                site[2 * (j * tr + i) + 1] = -q[2 * (j * tr + i) + 1];
+            }
+        }
+        out = (double*)calloc(next_left * 2 * keep * 2, sizeof(double));
+        if (!out) goto done;
+        for (size_t x = 0; x < 2 * next_left; x++) {
+            for (size_t mid = 0; mid < left; mid++) {
+                double ar = nb[2 * (x * left + mid)], ai = nb[2 * (x * left + mid) + 1];
+                if (ar == 0.0 && ai == 0.0) continue;
+                for (size_t j = 0; j < keep; j++) {
+                    double br = r[2 * (j * tc + mid)], bi = -r[2 * (j * tc + mid) + 1];
+                    out[2 * (x * keep + j)] += ar * br - ai * bi;
+                    out[2 * (x * keep + j) + 1] += ar * bi + ai * br;
+                }
+            }
+        }
+        if (store_tensor(mps, c, site, keep, right) != 0 || store_tensor(mps, next, out, next_left, keep) != 0) goto done;
+    }
+    mps->center = next;
+    rc = 0;
+done:
+    free(m);
+    free(nb);
+    free(q);
+    free(r);
+    free(site);
+    free(out);
+    return rc;
+}
+
+static int move_center(MpsState* mps, size_t site) {
+    while (mps->center < site) {
+        if (shift_center(mps, +1) != 0) return -2;
+    }
+    while (mps->center > site) {
+        if (shift_center(mps, -1) != 0) return -2;
+    }
+    return 0;
+}
+
+/**
+ * \brief Applies a 4x4 gate to neighbouring sites i and i + 1, whose physical indices form
+ *        the gate's local index as (site i) * 2 + (site i + 1), and splits them with a
+ *        truncated SVD. The center ends on site i + 1.
+ */
+static int apply_two_site(MpsState* mps, size_t i, const double* gate) {
+    if (move_center(mps, i) != 0) return -2;
+    size_t l = mps->bond[i], mid = mps->bond[i + 1], r = mps->bond[i + 2];
+    size_t rows = 2 * l, cols = 2 * r;
+    size_t k = rows < cols ? rows : cols;
+    double* a = load_tensor(mps, i);
+    double* b = load_tensor(mps, i + 1);
+    double* theta = (double*)calloc(rows * cols * 2, sizeof(double));
+    double* next = (double*)calloc(rows * cols * 2, sizeof(double));
+    double* u = (double*)malloc(rows * k * 2 * sizeof(double));
+    double* s = (double*)malloc(k * sizeof(double));
+    double* vh = (double*)malloc(k * cols * 2 * sizeof(double));
+    int rc = -2;
+    if (!a || !b || !theta || !next || !u || !s || !vh) goto done;
+
+    // theta[(l, p1), (p2, r)] = sum_m A[l, p1, m] B[m, p2, r]
+    for (size_t x = 0; x < rows; x++) {
+        for (size_t m = 0; m < mid; m++) {
+            double ar = a[2 * (x * mid + m)], ai = a[2 * (x * mid + m) + 1];
+            if (ar == 0.0 && ai == 0.0) continue;
+            for (size_t y = 0; y < cols; y++) {
+                double br = b[2 * (m * cols + y)], bi = b[2 * (m * cols + y) + 1];
+                theta[2 * (x * cols + y)] += ar * br - ai * bi;
+                theta[2 * (x * cols + y) + 1] += ar * bi + ai * br;
+            }
+        }
+    }
+    // Gate on (p1, p2)
+    for (size_t li = 0; li < l; li++) {
+        for (size_t ri = 0; ri < r; ri++) {
+            for (size_t out = 0; out < 4; out++) {
+                double re = 0.0, im = 0.0;
+                for (size_t in = 0; in < 4; in++) {
+                    size_t at = ((li * 2 + (in >> 1)) * cols + (in & 1) * r + ri) * 2;
+                    double gr = gate[8 * out + 2 * in], gi = gate[8 * out + 2 * in + 1];
+                    re += gr * theta[at] - gi * theta[at + 1];
+                    im += gr * theta[at + 1] + gi * theta[at];
+                }
+                size_t at = ((li * 2 + (out >> 1)) * cols + (out & 1) * r + ri) * 2;
+                next[at] = re;
+                next[at + 1] = im;
+            }
+        }
+    }
+    if (complex_svd(next, rows, cols, u, s, vh) != 0) goto done;
+
+    double discarded;
+    size_t keep = kept_values(s, k, mps->max_bond, mps->truncation_threshold, &discarded);
+    if (discarded > 0.0) {
+        mps->fidelity *= 1.0 - discarded;
+        mps->truncations++;
+    }
+    // Left site: U (2l x keep); right site: S Vh renormalized to the kept weight
+    double kept = 0.0;
+    for (size_t j = 0; j < keep; j++) kept += s[j] * s[j];
+    double scale = kept > 0.0 ? 1.0 / sqrt(kept) : 0.0;
+    for (size_t x = 0; x < rows; x++) {
+        for (size_t j = 0; j < keep; j++) {
+            theta[2 * (x * keep + j)] = u[2 * (x * k + j)];
+            theta[2 * (x * keep + j) + 1] = u[2 * (x * k + j) + 1];
+        }
+    }
+    for (size_t j = 0; j < keep; j++) {
+        for (size_t y = 0; y < cols; y++) {
+            next[2 * (j * cols + y)] = s[j] * scale * vh[2 * (j * cols + y)];
+            next[2 * (j * cols + y) + 1] = s[j] * scale * vh[2 * (j * cols + y) + 1];
+        }
+    }
+    if (store_tensor(mps, i, theta, l, keep) != 0 || store_tensor(mps, i + 1, next, keep, r) != 0) goto done;
+    mps->center = i + 1;
+    rc = 0;
+done:
+    free(a);
+    free(b);
+    free(theta);
+    free(next);
+    free(u);
+    free(s);
+    free(vh);
+    return rc;
+}
+
+int mps_apply_single_qubit_gate(MpsState* mps, const float* gate, size_t qubit_index) {
+    if (!mps || !gate || qubit_index >= mps->num_qubits) return -1;
+    // A unitary on the physical index keeps the site's orthonormality
+    float* t = mps->tensors[qubit_index];
+    size_t l = mps->bond[qubit_index], r = mps->bond[qubit_index + 1];
+    for (size_t li = 0; li < l; li++) {
+        for (size_t ri = 0; ri < r; ri++) {
+            float* a0 = t + 2 * ((li * 2 + 0) * r + ri);
+            float* a1 = t + 2 * ((li * 2 + 1) * r + ri);
+            float r0 = a0[0], i0 = a0[1], r1 = a1[0], i1 = a1[1];
+            a0[0] = gate[0] * r0 - gate[1] * i0 + gate[2] * r1 - gate[3] * i1;
+            a0[1] = gate[0] * i0 + gate[1] * r0 + gate[2] * i1 + gate[3] * r1;
+            a1[0] = gate[4] * r0 - gate[5] * i0 + gate[6] * r1 - gate[7] * i1;
+            a1[1] = gate[4] * i0 + gate[5] * r0 + gate[6] * i1 + gate[7] * r1;
+        }
+    }
+    return 0;
+}
+
+int mps_apply_two_qubit_gate(MpsState* mps, const float* gate, size_t qubit_a, size_t qubit_b) {
+    if (!mps || !gate || qubit_a >= mps->num_qubits || qubit_b >= mps->num_qubits) return -1;
+    if (qubit_a == qubit_b) return -3;
+    static const double swap[32] = {
+        1, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 1, 0, 0, 0,
+        0, 0, 1, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 1, 0
+    };
+    size_t lo = qubit_a < qubit_b ? qubit_a : qubit_b;
+    size_t hi = qubit_a ^ qubit_b ^ lo;
+
+    // Local index is (left site) * 2 + (right site): transpose the gate if qubit_a is the right one
+    double local[32];
+    for (size_t row = 0; row < 4; row++) {
+        for (size_t col = 0; col < 4; col++) {
+            size_t pr = (qubit_a == lo) ? row : ((row & 1) << 1) | (row >> 1);
+            size_t pc = (qubit_a == lo) ? col : ((col & 1) << 1) | (col >> 1);
+            local[8 * pr + 2 * pc] = gate[8 * row + 2 * col];
+            local[8 * pr + 2 * pc + 1] = gate[8 * row + 2 * col + 1];
+        }
+    }
+
+    // Walk qubit lo up to site hi - 1, apply, and walk it back
+    for (size_t site = lo; site + 1 < hi; site++) {
+        if (apply_two_site(mps, site, swap) != 0) return -2;
+    }
+    if (apply_two_site(mps, hi - 1, local) != 0) return -2;
+    for (size_t site = hi - 1; site-- > lo;) {
+        if (apply_two_site(mps, site, swap) != 0) return -2;
+    }
+    return 0;
+}
+
+int mps_apply_cnot(MpsState* mps, size_t control_qubit, size_t target_qubit) {
+    static const float cnot[32] = {
+        1, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 1, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 1, 0,
+        0, 0, 0, 0, 1, 0, 0, 0
+    };
+    return mps_apply_two_qubit_gate(mps, cnot, control_qubit, target_qubit);
+}
+
+int mps_apply_controlled_phase(MpsState* mps, size_t control_qubit, size_t target_qubit,
+                               float phase_real, float phase_imag) {
+    float cphase[32];
+    memset(cphase, 0, sizeof(cphase));
+    cphase[0] = cphase[10] = cphase[20] = 1.0f;
+    cphase[30] = phase_real;
+    cphase[31] = phase_imag;
+    return mps_apply_two_qubit_gate(mps, cphase, control_qubit, target_qubit);
+}
+
+int mps_measure_qubit(MpsState* mps, size_t qubit_index, int* out_result) {
+    if (!mps || !out_result || qubit_index >= mps->num_qubits) return -1;
+    if (move_center(mps, qubit_index) != 0) return -2;
+
+    // With the center here, the site tensor's weight per physical index is the probability
+    float* t = mps->tensors[qubit_index];
+    size_t l = mps->bond[qubit_index], r = mps->bond[qubit_index + 1];
+    double p[2] = { 0.0, 0.0 };
+    for (size_t li = 0; li < l; li++) {
+        for (size_t bit = 0; bit < 2; bit++) {
+            for (size_t ri = 0; ri < r; ri++) {
+                const float* a = t + 2 * ((li * 2 + bit) * r + ri);
+                p[bit] += (double)a[0] * a[0] + (double)a[1] * a[1];
+            }
+        }
+    }
+    double total = p[0] + p[1];
+    if (total <= 0.0) return -3;
+    float rand_val = (float)rand() / (float)RAND_MAX;
+    int outcome = (rand_val < (float)(p[0] / total)) ? 0 : 1;
+
+    float scale = (float)(1.0 / sqrt(p[outcome]));
+    for (size_t li = 0; li < l; li++) {
+        for (size_t bit = 0; bit < 2; bit++) {
+            for (size_t ri = 0; ri < r; ri++) {
+                float* a = t + 2 * ((li * 2 + bit) * r + ri);
+                float keep = ((int)bit == outcome) ? scale : 0.0f;
+                a[0] *= keep;
+                a[1] *= keep;
+            }
+        }
+    }
+    *out_result = outcome;
+    return 0;
+}
+
+int mps_amplitude(const MpsState* mps, uint64_t basis, float* out_real, float* out_imag) {
+    if (!mps || !out_real || !out_imag) return -1;
+    size_t width = 1;
+    for (size_t b = 0; b <= mps->num_qubits; b++) {
+        if (mps->bond[b] > width) width = mps->bond[b];
+    }
+    double* row = (double*)calloc(2 * width, sizeof(double));
+    double* next = (double*)calloc(2 * width, sizeof(double));
+    if (!row || !next) {
+        free(row);
+        free(next);
+        return -2;
+    }
+    row[0] = 1.0;
+    for (size_t q = 0; q < mps->num_qubits; q++) {
+        size_t l = mps->bond[q], r = mps->bond[q + 1];
+        size_t bit = (q < 64) ? (size_t)((basis >> q) & 1u) : 0;
+        const float* t = mps->tensors[q];
+        memset(next, 0, 2 * r * sizeof(double));
+        for (size_t li = 0; li < l; li++) {
+            for (size_t ri = 0; ri < r; ri++) {
+                const float* a = t + 2 * ((li * 2 + bit) * r + ri);
+                next[2 * ri] += row[2 * li] * a[0] - row[2 * li + 1] * a[1];
+                next[2 * ri + 1] += row[2 * li] * a[1] + row[2 * li + 1] * a[0];
+            }
+        }
+        double* swap = row;
+        row = next;
+        next = swap;
+    }
+    *out_real = (float)row[0];
+    *out_imag = (float)row[1];
+    free(row);
+    free(next);
+    return 0;
+}
+
+void get_mps_stats(const MpsState* mps, MpsStats* stats) {
+    if (!mps || !stats) return;
+    stats->max_bond = mps->max_bond;
+    stats->peak_bond = mps->peak_bond;
+    stats->truncations = mps->truncations;
+    stats->truncation_error = 1.0 - mps->fidelity;
+}
+
+int mps_kernel_cost(DenseKernel kernel, size_t num_qubits, size_t bond, size_t distance, KernelCost* cost) {
+    if (!cost) return -1;
+    double chi = (double)(bond ? bond : 1);
+    double tensor_bytes = chi * chi * 2.0 * 2.0 * sizeof(float);
+    double state_bytes = tensor_bytes * (double)(num_qubits ? num_qubits : 1);
+    // A split: contraction, QR and about eight Jacobi sweeps over a 2 chi x 2 chi matrix
+    double split_flops = 8.0 * 24.0 * pow(2.0 * chi, 3.0);
+    double splits = 1.0;
+    switch (kernel) {
+        case KERNEL_GATE_1Q:
+            cost->bytes = 2.0 * tensor_bytes;
+            cost->flops = 14.0 * chi * chi * 2.0;
+            cost->passes = cost->bytes / (2.0 * state_bytes);
+            return 0;
+        case KERNEL_GATE_2Q:
+        case KERNEL_CNOT:
+        case KERNEL_CPHASE:
+            splits = distance > 1 ? 2.0 * (double)distance - 1.0 : 1.0; // SWAPs there and back
+            break;
+        case KERNEL_MEASURE:
+            break;
+        default:
+            return -2;
+    }
+    cost->bytes = splits * 4.0 * tensor_bytes;
+    cost->flops = splits * split_flops;
+    cost->passes = cost->bytes / (2.0 * state_bytes);
+    return 0;
+}
@@ -0,0 +1,137 @@
+#ifndef MPS_STATE_H
+#define MPS_STATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "gate_operations.h"
+
+/**
+ * \brief Default bond-dimension cap: 64 keeps each SVD at 128 x 128 and represents any state
+ *        of up to 12 qubits exactly.
+ */
+#define MPS_DEFAULT_MAX_BOND 64
+
+/**
+ * \brief Default truncation threshold: singular values are dropped, smallest first, while
+ *        their total relative weight (sum of squares) stays below this.
+ */
+#define MPS_DEFAULT_TRUNCATION 1e-10
+
+/**
+ * \brief Matrix product state: one rank-3 tensor per qubit, A[q] of shape
+ *        bond[q] x 2 x bond[q + 1], stored row-major as interleaved complex floats
+ *        (entry (l, p, r) at 2 * ((l * 2 + p) * bond[q + 1] + r)). Memory grows with the bond
+ *        dimensions, which stay small for low-entanglement circuits, instead of 2^n.
+ *
+ *        The state is kept in mixed canonical form around 'center': tensors left of it are
+ *        left-orthonormal and those right of it right-orthonormal, so SVD truncation at the
+ *        center is optimal and its discarded weight is the exact error of that step.
+ */
+typedef struct MpsState {
+    size_t  num_qubits;           /**< Number of qubits (sites) */
+    size_t  max_bond;             /**< Bond-dimension cap chi */
+    double  truncation_threshold; /**< Relative weight that may be dropped per split */
+    size_t* bond;                 /**< num_qubits + 1 bond dimensions; bond[0] = bond[n] = 1 */
+    float** tensors;              /**< Site tensors, see above */
+    size_t  center;               /**< Orthogonality center */
+    size_t  peak_bond;            /**< Largest bond dimension reached */
+    size_t  truncations;          /**< Splits that dropped a nonzero singular value */
+    double  fidelity;             /**< Product of (1 - discarded weight) over all splits */
+} MpsState;
+
+/**
+ * \brief Fidelity report of an MPS run.
+ */
+typedef struct MpsStats {
+    size_t max_bond;          /**< Cap the run used */
+    size_t peak_bond;         /**< Largest bond dimension reached */
+    size_t truncations;       /**< Splits that dropped weight */
+    double truncation_error;  /**< 1 - fidelity: estimated infidelity with the exact state */
+} MpsStats;
+
+/**
+ * \brief Initializes an MPS in the |0...0> state (all bonds 1).
+ * \param mps Pointer to an MpsState struct
+ * \param num_qubits Number of qubits
+ * \param max_bond Bond-dimension cap (0 => MPS_DEFAULT_MAX_BOND)
+ * \param truncation_threshold Weight that may be dropped per split (< 0 => MPS_DEFAULT_TRUNCATION;
+ *        0 drops only exact zeros)
+ * \return 0 on success, nonzero on error
+ */
+int init_mps_state(MpsState* mps, size_t num_qubits, size_t max_bond, double truncation_threshold);
+
+/**
+ * \brief Frees resources associated with an MpsState.
+ */
+void free_mps_state(MpsState* mps);
+
+/**
+ * \brief Bytes an MPS of num_qubits qubits needs when every bond is at its largest possible
+ *        dimension under max_bond, plus the SVD workspace of one split (SIZE_MAX on overflow).
+ */
+size_t mps_state_bytes(size_t num_qubits, size_t max_bond);
+
+/**
+ * \brief Applies a 2x2 gate as a local update of one site tensor.
+ * \return 0 on success, nonzero on error
+ */
+int mps_apply_single_qubit_gate(MpsState* mps, const float* gate, size_t qubit_index);
+
+/**
+ * \brief Applies a 4x4 gate (apply_two_qubit_gate layout) by contracting the two sites,
+ *        applying the gate and splitting them again with a truncated SVD. Qubits that are
+ *        not neighbours are first brought together with SWAPs, and moved back afterwards.
+ * \return 0 on success, nonzero on error
+ */
+int mps_apply_two_qubit_gate(MpsState* mps, const float* gate, size_t qubit_a, size_t qubit_b);
+
+/**
+ * \brief Applies a CNOT (a two-qubit gate update).
+ * \return 0 on success, nonzero on error
+ */
+int mps_apply_cnot(MpsState* mps, size_t control_qubit, size_t target_qubit);
+
+/**
+ * \brief Applies diag(1, 1, 1, e^{i phi}) (a two-qubit gate update).
+ * \return 0 on success, nonzero on error
+ */
+int mps_apply_controlled_phase(MpsState* mps, size_t control_qubit, size_t target_qubit,
+                               float phase_real, float phase_imag);
+
+/**
+ * \brief Measures one qubit: sweeps the orthogonality center to it, samples the outcome from
+ *        the local probabilities with rand() and projects the site tensor.
+ * \param out_result 0 or 1
+ * \return 0 on success, nonzero on error
+ */
+int mps_measure_qubit(MpsState* mps, size_t qubit_index, int* out_result);
+
+/**
+ * \brief Contracts the amplitude of one basis state (bit q of 'basis' is qubit q).
+ * \return 0 on success, nonzero on error
+ */
+int mps_amplitude(const MpsState* mps, uint64_t basis, float* out_real, float* out_imag);
+
+/**
+ * \brief Fills an MpsStats from an MPS.
+ */
+void get_mps_stats(const MpsState* mps, MpsStats* stats);
+
+/**
+ * \brief Work of one MPS kernel at bond dimension 'bond', in the units of dense_kernel_cost.
+ *        Two-qubit kernels are dominated by the SVD of a 2 bond x 2 bond matrix and scale
+ *        with the number of SWAP steps 'distance' - 1 needed to make the qubits neighbours;
+ *        a measurement is costed as one split.
+ * \return 0 on success, nonzero on error
+ */
+int mps_kernel_cost(DenseKernel kernel, size_t num_qubits, size_t bond, size_t distance, KernelCost* cost);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MPS_STATE_H */
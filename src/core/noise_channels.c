@@ -0,0 +1,116 @@
+#include "noise_channels.h"
+#include <math.h>
+#include <strings.h>
+
+int noise_channel_from_name(const char* name, NoiseChannel* out_channel) {
+    if (!name || !out_channel) return -1;
+    if (strcasecmp(name, "DEPOLARIZE") == 0) *out_channel = NOISE_DEPOLARIZING;
+    else if (strcasecmp(name, "DAMP") == 0) *out_channel = NOISE_AMPLITUDE_DAMPING;
+    else if (strcasecmp(name, "READOUT") == 0) *out_channel = NOISE_READOUT;
+    else return -2;
+    return 0;
+}
+
+/**
+ * \brief Applies X (pauli 0), Y (1) or Z (2) to one qubit, pair by pair.
+ */
+static void apply_pauli(StateVector* sv, int pauli, size_t qubit_index) {
+    size_t length = (size_t)1 << sv->num_qubits;
+    size_t mask = (size_t)1 << qubit_index;
+    float* re = sv->real;
+    float* im = sv->imag;
+
+    for (size_t base = 0; base < length; base += 2 * mask) {
+        for (size_t i = base; i < base + mask; i++) {
+            size_t j = i | mask;
+            float r0 = re[i], i0 = im[i], r1 = re[j], i1 = im[j];
+            if (pauli == 0) {
+                re[i] = r1; im[i] = i1;
+                re[j] = r0; im[j] = i0;
+            } else if (pauli == 1) {
+                // Y|0> = i|1>, Y|1> = -i|0>
+                re[i] = i1;  im[i] = -r1;
+                re[j] = -i0; im[j] = r0;
+            } else {
+                re[j] = -r1; im[j] = -i1;
+            }
+        }
+    }
+}
+
+/**
+ * \brief Total probability of the amplitudes with the qubit set.
+ */
+static double excited_probability(const StateVector* sv, size_t qubit_index) {
+    size_t length = (size_t)1 << sv->num_qubits;
+    size_t mask = (size_t)1 << qubit_index;
+    double p1 = 0.0;
+    for (size_t base = mask; base < length; base += 2 * mask) {
+        for (size_t i = base; i < base + mask; i++) {
+            p1 += (double)sv->real[i] * sv->real[i] + (double)sv->imag[i] * sv->imag[i];
+        }
+    }
+    return p1;
+}
+
+/**
+ * \brief Amplitude damping trajectory step: K1 = sqrt(gamma) |0><1| with probability
+ *        gamma * P(1), else K0 = diag(1, sqrt(1 - gamma)); either way renormalized.
+ */
+static void apply_damping(StateVector* sv, float gamma, size_t qubit_index, double random_value) {
+    size_t length = (size_t)1 << sv->num_qubits;
+    size_t mask = (size_t)1 << qubit_index;
+    float* re = sv->real;
+    float* im = sv->imag;
+    double p1 = excited_probability(sv, qubit_index);
+    double jump = gamma * p1;
+
+    if (random_value < jump) {
+        // Decay: the qubit's |1> branch moves to |0>, the old |0> branch is annihilated
+        float scale = (float)(1.0 / sqrt(p1));
+        for (size_t base = 0; base < length; base += 2 * mask) {
+            for (size_t i = base; i < base + mask; i++) {
+                re[i] = re[i | mask] * scale;
+                im[i] = im[i | mask] * scale;
+                re[i | mask] = 0.0f;
+                im[i | mask] = 0.0f;
+            }
+        }
+        return;
+    }
+    // No decay: the |1> branch shrinks, which is evidence for |0>
+    float keep = (float)(1.0 / sqrt(1.0 - jump));
+    float shrink = (float)sqrt(1.0 - gamma) * keep;
+    for (size_t base = 0; base < length; base += 2 * mask) {
+        for (size_t i = base; i < base + mask; i++) {
+            re[i] *= keep;
+            im[i] *= keep;
+            re[i | mask] *= shrink;
+            im[i | mask] *= shrink;
+        }
+    }
+}
+
+int apply_noise_channel(StateVector* sv, NoiseChannel channel, float probability, size_t qubit_index,
+                        double random_value) {
+    if (!sv || !sv->real || !sv->imag) return -1;
+    if (qubit_index >= sv->num_qubits) return -2;
+    if (!(probability >= 0.0f && probability <= 1.0f)) return -4;
+
+    switch (channel) {
+        case NOISE_DEPOLARIZING:
+            // Given an error (random_value < p), random_value / p is again uniform: it picks the Pauli
+            if (random_value < probability) {
+                int pauli = (int)(3.0 * random_value / probability);
+                apply_pauli(sv, pauli < 3 ? pauli : 2, qubit_index);
+            }
+            return 0;
+        case NOISE_AMPLITUDE_DAMPING:
+            if (probability > 0.0f) apply_damping(sv, probability, qubit_index, random_value);
+            return 0;
+        case NOISE_READOUT:
+            return -3;
+        default:
+            return -1;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef NOISE_CHANNELS_H
+#define NOISE_CHANNELS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "state_vector.h"
+
+/**
+ * \brief Single-qubit noise channels of the assembly language.
+ */
+typedef enum NoiseChannel {
+    NOISE_DEPOLARIZING,      /**< "DEPOLARIZE(p) q": X, Y or Z, each with probability p / 3 */
+    NOISE_AMPLITUDE_DAMPING, /**< "DAMP(gamma) q": |1> decays to |0> with probability gamma */
+    NOISE_READOUT,           /**< "READOUT(p) q": later measurements of q report the wrong bit with probability p */
+    NOISE_CHANNEL_COUNT
+} NoiseChannel;
+
+/**
+ * \brief Looks up a channel by its statement name ("DEPOLARIZE", "DAMP", "READOUT").
+ * \param name Statement name, case-insensitive
+ * \param out_channel Receives the channel
+ * \return 0 on success, nonzero for an unknown name
+ */
+int noise_channel_from_name(const char* name, NoiseChannel* out_channel);
+
+/**
+ * \brief Applies one stochastically chosen Kraus operator of a channel, renormalized, as in
+ *        a quantum trajectory: averaged over random_value the result is the channel applied
+ *        to the density matrix. Depolarizing picks the Pauli from random_value alone;
+ *        amplitude damping jumps to |0> with probability gamma * P(q = 1) and otherwise
+ *        applies diag(1, sqrt(1 - gamma)).
+ * \param sv Pointer to the StateVector
+ * \param channel NOISE_DEPOLARIZING or NOISE_AMPLITUDE_DAMPING
+ * \param probability p or gamma, in [0, 1]
+ * \param qubit_index Qubit the channel acts on
+ * \param random_value Uniform sample in [0, 1)
+ * \return 0 on success, -3 for NOISE_READOUT (it acts on outcomes, not on the state),
+ *         other nonzero values on error
+ */
+int apply_noise_channel(StateVector* sv, NoiseChannel channel, float probability, size_t qubit_index,
+                        double random_value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NOISE_CHANNELS_H */
@@ -0,0 +1,420 @@
+#include "pauli_expectation.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+
+#ifdef __SSE__
+#  include <xmmintrin.h>
+#endif
+#ifdef __SSE4_2__
+#  include <nmmintrin.h>
+#endif
+
+#define MASK_BITS (sizeof(size_t) * 8)
+
+static inline unsigned popcount64(uint64_t v) {
+#ifdef __SSE4_2__
+    return (unsigned)_mm_popcnt_u64(v);
+#else
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (unsigned)((v * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+/**
+ * \brief Spreads the low bits of 'value' over the set bits of 'mask', lowest first.
+ */
+static size_t deposit_bits(size_t value, size_t mask) {
+    size_t out = 0;
+    for (; mask; mask &= mask - 1, value >>= 1) {
+        if (value & 1) out |= mask & (~mask + 1);
+    }
+    return out;
+}
+
+/**
+ * \brief Inverse of deposit_bits: gathers the bits of 'value' under 'mask' into the low bits.
+ */
+static size_t compress_bits(size_t value, size_t mask) {
+    size_t out = 0;
+    for (size_t k = 0; mask; mask &= mask - 1, k++) {
+        if (value & mask & (~mask + 1)) out |= (size_t)1 << k;
+    }
+    return out;
+}
+
+int parse_pauli_string(const char* text, PauliString* out) {
+    if (!text || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    out->coefficient = 1.0;
+    const char* p = text;
+    for (;;) {
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0') return 0;
+        char op = (char)toupper((unsigned char)*p++);
+        if (op != 'I' && op != 'X' && op != 'Y' && op != 'Z') return -2;
+        if (!isdigit((unsigned char)*p)) {
+            // A bare "I" is the identity on everything
+            if (op == 'I' && (*p == '\0' || isspace((unsigned char)*p))) continue;
+            return -2;
+        }
+        size_t qubit = 0;
+        while (isdigit((unsigned char)*p)) {
+            qubit = qubit * 10 + (size_t)(*p++ - '0');
+            if (qubit >= MASK_BITS) return -3;
+        }
+        if (*p != '\0' && !isspace((unsigned char)*p)) return -2;
+        size_t bit = (size_t)1 << qubit;
+        if ((out->x_mask | out->z_mask) & bit) return -3;
+        if (op == 'X' || op == 'Y') out->x_mask |= bit;
+        if (op == 'Z' || op == 'Y') out->z_mask |= bit;
+    }
+}
+
+int init_pauli_sum(PauliSum* sum) {
+    if (!sum) return -1;
+    sum->size = 0;
+    sum->capacity = 16;
+    sum->terms = (PauliString*)malloc(sum->capacity * sizeof(PauliString));
+    return sum->terms ? 0 : -1;
+}
+
+int add_pauli_term(PauliSum* sum, double coefficient, const char* text) {
+    if (!sum || !sum->terms) return -1;
+    PauliString term;
+    int rc = parse_pauli_string(text, &term);
+    if (rc != 0) return rc;
+    term.coefficient = coefficient;
+    if (sum->size == sum->capacity) {
+        PauliString* grown = (PauliString*)realloc(sum->terms, 2 * sum->capacity * sizeof(PauliString));
+        if (!grown) return -1;
+        sum->terms = grown;
+        sum->capacity *= 2;
+    }
+    sum->terms[sum->size++] = term;
+    return 0;
+}
+
+void free_pauli_sum(PauliSum* sum) {
+    if (!sum) return;
+    free(sum->terms);
+    sum->terms = NULL;
+    sum->size = sum->capacity = 0;
+}
+
+void free_pauli_grouping(PauliGrouping* grouping) {
+    if (!grouping) return;
+    free(grouping->groups);
+    free(grouping->order);
+    free(grouping->local_index);
+    free(grouping->outside_mask);
+    memset(grouping, 0, sizeof(*grouping));
+}
+
+int group_pauli_terms(const PauliSum* sum, size_t num_qubits, PauliGrouping* grouping) {
+    if (!sum || !grouping || num_qubits == 0 || num_qubits >= MASK_BITS) return -1;
+    memset(grouping, 0, sizeof(*grouping));
+    size_t count = sum->size;
+    size_t slots = count ? count : 1;
+    grouping->num_qubits = num_qubits;
+    grouping->num_terms = count;
+    grouping->groups = (PauliGroup*)calloc(slots, sizeof(PauliGroup));
+    grouping->order = (size_t*)malloc(slots * sizeof(size_t));
+    grouping->local_index = (size_t*)malloc(slots * sizeof(size_t));
+    grouping->outside_mask = (size_t*)malloc(slots * sizeof(size_t));
+    size_t* group_of = (size_t*)malloc(slots * sizeof(size_t));
+    size_t* support = (size_t*)calloc(slots, sizeof(size_t));
+    size_t* z_bits = (size_t*)calloc(slots, sizeof(size_t));
+    if (!grouping->groups || !grouping->order || !grouping->local_index || !grouping->outside_mask ||
+        !group_of || !support || !z_bits) {
+        free(group_of);
+        free(support);
+        free(z_bits);
+        free_pauli_grouping(grouping);
+        return -1;
+    }
+
+    // First fit: a term joins the first group that acts like it on every shared qubit
+    size_t register_mask = ((size_t)1 << num_qubits) - 1;
+    size_t groups = 0;
+    for (size_t t = 0; t < count; t++) {
+        const PauliString* s = &sum->terms[t];
+        size_t acts = s->x_mask | s->z_mask;
+        if (acts & ~register_mask) {
+            free(group_of);
+            free(support);
+            free(z_bits);
+            free_pauli_grouping(grouping);
+            return -2;
+        }
+        size_t g = groups;
+        if (popcount64(s->x_mask) <= PAULI_MAX_ROTATED_QUBITS) {
+            for (g = 0; g < groups; g++) {
+                PauliGroup* grp = &grouping->groups[g];
+                size_t flips = grp->x_basis | grp->y_basis;
+                size_t shared = acts & support[g];
+                if (grp->direct || (((s->x_mask ^ flips) | (s->z_mask ^ z_bits[g])) & shared)) continue;
+                if (popcount64(flips | s->x_mask) <= PAULI_MAX_ROTATED_QUBITS) break;
+            }
+        }
+        if (g == groups) {
+            groups++;
+            grouping->groups[g].direct = popcount64(s->x_mask) > PAULI_MAX_ROTATED_QUBITS;
+        }
+        PauliGroup* grp = &grouping->groups[g];
+        grp->x_basis |= s->x_mask & ~s->z_mask;
+        grp->y_basis |= s->x_mask & s->z_mask;
+        support[g] |= acts;
+        z_bits[g] |= s->z_mask;
+        grp->count++;
+        group_of[t] = g;
+    }
+    grouping->num_groups = groups;
+
+    // Stable counting sort of the terms by group
+    for (size_t g = 0, first = 0; g < groups; g++) {
+        grouping->groups[g].first = first;
+        first += grouping->groups[g].count;
+        grouping->groups[g].count = 0;
+    }
+    for (size_t t = 0; t < count; t++) {
+        PauliGroup* grp = &grouping->groups[group_of[t]];
+        grouping->order[grp->first + grp->count++] = t;
+    }
+
+    // Gather the rotated qubits plus the lowest others: qubits 0 and 1 keep each group of four
+    // local amplitudes contiguous in the state
+    size_t target = num_qubits < PAULI_LOCAL_QUBITS ? num_qubits : PAULI_LOCAL_QUBITS;
+    for (size_t g = 0; g < groups; g++) {
+        PauliGroup* grp = &grouping->groups[g];
+        if (!grp->direct) {
+            size_t local = grp->x_basis | grp->y_basis;
+            for (size_t q = 0; q < num_qubits; q++) {
+                if (q >= 2 && popcount64(local) >= target) break;
+                local |= (size_t)1 << q;
+            }
+            grp->local_mask = local;
+        }
+        for (size_t e = grp->first; e < grp->first + grp->count; e++) {
+            const PauliString* s = &sum->terms[grouping->order[e]];
+            size_t acts = s->x_mask | s->z_mask;
+            grouping->local_index[e] = compress_bits(acts & grp->local_mask, grp->local_mask);
+            grouping->outside_mask[e] = acts & ~grp->local_mask;
+        }
+    }
+    free(group_of);
+    free(support);
+    free(z_bits);
+    return 0;
+}
+
+size_t pauli_group_units(const PauliGrouping* grouping, size_t group) {
+    if (!grouping || group >= grouping->num_groups) return 0;
+    const PauliGroup* grp = &grouping->groups[group];
+    if (grp->direct) return (size_t)1 << (grouping->num_qubits - 1);
+    return (size_t)1 << (grouping->num_qubits - popcount64(grp->local_mask));
+}
+
+/**
+ * \brief Unnormalized basis change of one local qubit at 'stride': H for the X basis, H S^dagger
+ *        for the Y basis (the pair (a, b) becomes (a + b', a - b') with b' = b or -i b).
+ */
+static void rotate_local(float* re, float* im, size_t size, size_t stride, int y_basis) {
+    for (size_t block = 0; block < size; block += 2 * stride) {
+        size_t i = block;
+#ifdef __SSE__
+        for (; stride >= 4 && i + 4 <= block + stride; i += 4) {
+            __m128 ar = _mm_loadu_ps(re + i), ai = _mm_loadu_ps(im + i);
+            __m128 br = _mm_loadu_ps(re + i + stride), bi = _mm_loadu_ps(im + i + stride);
+            if (y_basis) {
+                __m128 t = br;
+                br = bi;
+                bi = _mm_sub_ps(_mm_setzero_ps(), t);
+            }
+            _mm_storeu_ps(re + i, _mm_add_ps(ar, br));
+            _mm_storeu_ps(im + i, _mm_add_ps(ai, bi));
+            _mm_storeu_ps(re + i + stride, _mm_sub_ps(ar, br));
+            _mm_storeu_ps(im + i + stride, _mm_sub_ps(ai, bi));
+        }
+#endif
+        for (; i < block + stride; i++) {
+            float ar = re[i], ai = im[i], br = re[i + stride], bi = im[i + stride];
+            if (y_basis) {
+                float t = br;
+                br = bi;
+                bi = -t;
+            }
+            re[i] = ar + br;
+            im[i] = ai + bi;
+            re[i + stride] = ar - br;
+            im[i + stride] = ai - bi;
+        }
+    }
+}
+
+/**
+ * \brief In-place Walsh-Hadamard transform: p[u] becomes sum_l (-1)^{|l & u|} p[l].
+ */
+static void walsh_hadamard(float* p, size_t size) {
+    for (size_t stride = 1; stride < size; stride <<= 1) {
+        for (size_t block = 0; block < size; block += 2 * stride) {
+            size_t i = block;
+#ifdef __SSE__
+            for (; stride >= 4 && i + 4 <= block + stride; i += 4) {
+                __m128 a = _mm_loadu_ps(p + i), b = _mm_loadu_ps(p + i + stride);
+                _mm_storeu_ps(p + i, _mm_add_ps(a, b));
+                _mm_storeu_ps(p + i + stride, _mm_sub_ps(a, b));
+            }
+#endif
+            for (; i < block + stride; i++) {
+                float a = p[i], b = p[i + stride];
+                p[i] = a + b;
+                p[i + stride] = a - b;
+            }
+        }
+    }
+}
+
+/**
+ * \brief Grouped pass: per coset, gather, rotate, square, transform, then one lookup per term.
+ */
+static int grouped_pass(const StateVector* sv, const PauliGrouping* grouping, const PauliGroup* grp,
+                        size_t begin, size_t end, double* acc) {
+    size_t local = grp->local_mask;
+    size_t bits = popcount64(local);
+    size_t size = (size_t)1 << bits;
+    float* re = (float*)malloc(size * sizeof(float));
+    float* im = (float*)malloc(size * sizeof(float));
+    size_t* offset = (size_t*)malloc(size * sizeof(size_t));
+    if (!re || !im || !offset) {
+        free(re);
+        free(im);
+        free(offset);
+        return -1;
+    }
+    for (size_t l = 0; l < size; l++) offset[l] = deposit_bits(l, local);
+    size_t rotated_stride[PAULI_MAX_ROTATED_QUBITS];
+    int rotated_y[PAULI_MAX_ROTATED_QUBITS];
+    size_t rotated = 0;
+    for (size_t rest = local, k = 0; rest; rest &= rest - 1, k++) {
+        size_t bit = rest & (~rest + 1);
+        if (!((grp->x_basis | grp->y_basis) & bit)) continue;
+        rotated_stride[rotated] = (size_t)1 << k;
+        rotated_y[rotated++] = (grp->y_basis & bit) != 0;
+    }
+    // Each unnormalized H doubles the probabilities
+    double scale = 1.0 / (double)((size_t)1 << rotated);
+
+    size_t register_mask = ((size_t)1 << grouping->num_qubits) - 1;
+    size_t base = deposit_bits(begin, ~local & register_mask);
+    for (size_t c = begin; c < end; c++) {
+        size_t l = 0;
+#ifdef __SSE__
+        // Qubits 0 and 1 are local, so runs of four local amplitudes are contiguous
+        for (; size >= 4 && l < size; l += 4) {
+            _mm_storeu_ps(re + l, _mm_loadu_ps(sv->real + base + offset[l]));
+            _mm_storeu_ps(im + l, _mm_loadu_ps(sv->imag + base + offset[l]));
+        }
+#endif
+        for (; l < size; l++) {
+            re[l] = sv->real[base + offset[l]];
+            im[l] = sv->imag[base + offset[l]];
+        }
+        for (size_t r = 0; r < rotated; r++) rotate_local(re, im, size, rotated_stride[r], rotated_y[r]);
+
+        l = 0;
+#ifdef __SSE__
+        for (; l + 4 <= size; l += 4) {
+            __m128 a = _mm_loadu_ps(re + l), b = _mm_loadu_ps(im + l);
+            _mm_storeu_ps(re + l, _mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)));
+        }
+#endif
+        for (; l < size; l++) re[l] = re[l] * re[l] + im[l] * im[l];
+        walsh_hadamard(re, size);
+
+        for (size_t e = grp->first; e < grp->first + grp->count; e++) {
+            double v = (double)re[grouping->local_index[e]] * scale;
+            acc[e] += (popcount64(base & grouping->outside_mask[e]) & 1u) ? -v : v;
+        }
+        base = ((base | local) + 1) & ~local;
+    }
+    free(re);
+    free(im);
+    free(offset);
+    return 0;
+}
+
+/**
+ * \brief Direct pass of one string with flip mask x: sums conj(a_{j ^ x}) P a_j over the pairs
+ *        (j, j ^ x), keeping the real or imaginary part as the number of Y factors requires.
+ */
+static void direct_pass(const StateVector* sv, const PauliGrouping* grouping, const PauliGroup* grp,
+                        size_t begin, size_t end, double* acc) {
+    size_t flips = grp->x_basis | grp->y_basis;
+    size_t z = grouping->outside_mask[grp->first] & ~grp->x_basis;
+    unsigned ys = popcount64(grp->y_basis);
+    size_t high = flips;
+    while (high & (high - 1)) high &= high - 1; // pairs are split on the highest flipped qubit
+    size_t low = high - 1;
+    double sum = 0.0;
+    for (size_t c = begin; c < end; c++) {
+        size_t j = ((c & ~low) << 1) | (c & low);
+        size_t k = j ^ flips;
+        double f = (ys & 1u) ? (double)sv->real[k] * sv->imag[j] - (double)sv->imag[k] * sv->real[j]
+                             : (double)sv->real[k] * sv->real[j] + (double)sv->imag[k] * sv->imag[j];
+        sum += (popcount64(j & z) & 1u) ? -f : f;
+    }
+    // i^{#Y} from the Y factors, times i for the imaginary part when #Y is odd
+    unsigned quarter = (ys & 1u) ? ys + 1 : ys;
+    acc[grp->first] += ((quarter / 2) & 1u) ? -2.0 * sum : 2.0 * sum;
+}
+
+int pauli_group_pass(const StateVector* sv, const PauliGrouping* grouping, size_t group, size_t begin,
+                     size_t end, double* acc) {
+    if (!sv || !grouping || !acc || group >= grouping->num_groups) return -1;
+    if (sv->num_qubits != grouping->num_qubits) return -2;
+    size_t units = pauli_group_units(grouping, group);
+    if (end > units) end = units;
+    if (begin >= end) return 0;
+    const PauliGroup* grp = &grouping->groups[group];
+    if (grp->direct) {
+        direct_pass(sv, grouping, grp, begin, end, acc);
+        return 0;
+    }
+    return grouped_pass(sv, grouping, grp, begin, end, acc);
+}
+
+int pauli_sum_expectation(const StateVector* sv, const PauliSum* sum, double* out_total, double* out_terms) {
+    if (!sv || !sum || !out_total) return -1;
+    PauliGrouping grouping;
+    int rc = group_pauli_terms(sum, sv->num_qubits, &grouping);
+    if (rc != 0) return rc;
+    double* acc = (double*)calloc(sum->size ? sum->size : 1, sizeof(double));
+    if (!acc) {
+        free_pauli_grouping(&grouping);
+        return -1;
+    }
+    for (size_t g = 0; g < grouping.num_groups && rc == 0; g++) {
+        rc = pauli_group_pass(sv, &grouping, g, 0, pauli_group_units(&grouping, g), acc);
+    }
+    double total = 0.0;
+    for (size_t e = 0; e < grouping.num_terms; e++) {
+        size_t t = grouping.order[e];
+        total += sum->terms[t].coefficient * acc[e];
+        if (out_terms) out_terms[t] = acc[e];
+    }
+    *out_total = total;
+    free(acc);
+    free_pauli_grouping(&grouping);
+    return rc;
+}
+
+int pauli_expectation(const StateVector* sv, const PauliString* pauli, double* out_value) {
+    if (!sv || !pauli || !out_value) return -1;
+    PauliSum single = { (PauliString*)pauli, 1, 1 };
+    return pauli_sum_expectation(sv, &single, out_value, NULL);
+}
@@ -0,0 +1,156 @@
+#ifndef PAULI_EXPECTATION_H
+#define PAULI_EXPECTATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "state_vector.h"
+
+/**
+ * \brief Most qubits a grouped pass rotates into the X or Y basis. Each coset of them is
+ *        gathered into a local buffer of up to 2^(PAULI_MAX_ROTATED_QUBITS + 2) amplitudes;
+ *        a string that flips more qubits is evaluated on its own by pairing amplitudes.
+ */
+#define PAULI_MAX_ROTATED_QUBITS 10
+
+/**
+ * \brief Local qubits a grouped pass gathers at least (rotated ones first, then the lowest
+ *        others), so each Walsh-Hadamard transform serves 2^PAULI_LOCAL_QUBITS amplitudes.
+ */
+#define PAULI_LOCAL_QUBITS 8
+
+/**
+ * \brief A weighted Pauli string c * P_0 (x) P_1 (x) ..., stored as bit masks: X sets the
+ *        qubit's x bit, Z its z bit and Y both. Qubits in neither mask carry the identity.
+ */
+typedef struct PauliString {
+    double coefficient;
+    size_t x_mask;
+    size_t z_mask;
+} PauliString;
+
+/**
+ * \brief Dynamic array of weighted Pauli strings (a Hamiltonian or other observable).
+ */
+typedef struct PauliSum {
+    PauliString* terms;
+    size_t       size;
+    size_t       capacity;
+} PauliSum;
+
+/**
+ * \brief One pass over the state: terms that commute qubit-wise, so a single local basis
+ *        change makes all of them diagonal.
+ */
+typedef struct PauliGroup {
+    size_t x_basis;     /**< Qubits read in the X basis */
+    size_t y_basis;     /**< Qubits read in the Y basis */
+    size_t local_mask;  /**< Qubits gathered per coset: the rotated ones plus low qubits */
+    size_t first;       /**< First entry of the group in PauliGrouping.order */
+    size_t count;       /**< Terms in the group */
+    int    direct;      /**< 1 for a single string that flips more than PAULI_MAX_ROTATED_QUBITS
+                             qubits, evaluated by pairing amplitudes instead */
+} PauliGroup;
+
+/**
+ * \brief Qubit-wise commuting groups of a PauliSum (see group_pauli_terms).
+ */
+typedef struct PauliGrouping {
+    size_t      num_qubits;
+    PauliGroup* groups;
+    size_t      num_groups;
+    size_t*     order;        /**< Term indices, group by group */
+    size_t*     local_index;  /**< Per entry of 'order': the term's local qubits, as a local index */
+    size_t*     outside_mask; /**< Per entry of 'order': the term's qubits outside local_mask */
+    size_t      num_terms;
+} PauliGrouping;
+
+/**
+ * \brief Parses a Pauli string such as "X0 Z3 Y12" (case-insensitive; "I", "" and identity
+ *        factors like "I4" leave qubits out). The coefficient is set to 1.
+ * \param text Factors separated by spaces
+ * \param out Receives the string
+ * \return 0 on success, -2 for a malformed factor, -3 if a qubit appears twice or its index
+ *         does not fit a mask
+ */
+int parse_pauli_string(const char* text, PauliString* out);
+
+/**
+ * \brief Initializes an empty PauliSum.
+ * \return 0 on success, nonzero on error
+ */
+int init_pauli_sum(PauliSum* sum);
+
+/**
+ * \brief Appends coefficient * text (parse_pauli_string syntax).
+ * \return 0 on success, the parse error or -1 on allocation failure
+ */
+int add_pauli_term(PauliSum* sum, double coefficient, const char* text);
+
+/**
+ * \brief Frees a PauliSum.
+ */
+void free_pauli_sum(PauliSum* sum);
+
+/**
+ * \brief Groups the terms of a sum: each term joins the first group it commutes with qubit-wise
+ *        (same Pauli wherever both act) while the group rotates at most PAULI_MAX_ROTATED_QUBITS
+ *        qubits. A Heisenberg chain XX + YY + ZZ on up to 10 qubits needs three groups.
+ * \param sum Terms to group
+ * \param num_qubits Register size of the states the grouping will be used on
+ * \param grouping Output (release with free_pauli_grouping)
+ * \return 0 on success, -2 if a term acts on a qubit >= num_qubits, other nonzero values on error
+ */
+int group_pauli_terms(const PauliSum* sum, size_t num_qubits, PauliGrouping* grouping);
+
+/**
+ * \brief Frees a PauliGrouping.
+ */
+void free_pauli_grouping(PauliGrouping* grouping);
+
+/**
+ * \brief Work units of one group: cosets of its local qubits, or amplitude pairs of a direct
+ *        group. Passes over disjoint unit ranges can run on different threads.
+ */
+size_t pauli_group_units(const PauliGrouping* grouping, size_t group);
+
+/**
+ * \brief Adds the unit range [begin, end) of one group to its terms' unweighted expectations.
+ *        Reads the state only. Each coset is gathered, rotated into the group's basis, squared
+ *        and Walsh-Hadamard transformed (SSE where available), after which every term is one
+ *        lookup per coset.
+ * \param sv State the grouping was built for
+ * \param grouping Grouping
+ * \param group Group index
+ * \param begin First unit
+ * \param end One past the last unit
+ * \param acc Accumulators, one per entry of grouping->order (the group's entries are
+ *            acc[first .. first + count))
+ * \return 0 on success, nonzero on error
+ */
+int pauli_group_pass(const StateVector* sv, const PauliGrouping* grouping, size_t group, size_t begin,
+                     size_t end, double* acc);
+
+/**
+ * \brief <psi|P|psi> of one string (its coefficient included) in one read-only pass.
+ * \return 0 on success, nonzero on error
+ */
+int pauli_expectation(const StateVector* sv, const PauliString* pauli, double* out_value);
+
+/**
+ * \brief <psi|H|psi> of a weighted sum, one pass per qubit-wise commuting group.
+ * \param sv Normalized state
+ * \param sum Terms
+ * \param out_total Receives sum_t c_t <P_t>
+ * \param out_terms Optional, sum->size entries: each <P_t> without its coefficient
+ * \return 0 on success, nonzero on error
+ */
+int pauli_sum_expectation(const StateVector* sv, const PauliSum* sum, double* out_total, double* out_terms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PAULI_EXPECTATION_H */
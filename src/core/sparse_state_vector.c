@@ -0,0 +1,272 @@
+#include "sparse_state_vector.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#define SPARSE_EMPTY_KEY UINT64_MAX
+#define SPARSE_INITIAL_CAPACITY 64
+
+static inline size_t hash_index(uint64_t key, size_t capacity) {
+    // Fibonacci hashing with a fold so low table bits see the high product bits
+    uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 32;
+    return (size_t)h & (capacity - 1);
+}
+
+static int alloc_table(uint64_t** keys, float** real, float** imag, size_t capacity) {
+    *keys = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+    *real = (float*)malloc(capacity * sizeof(float));
+    *imag = (float*)malloc(capacity * sizeof(float));
+    if (!*keys || !*real || !*imag) {
+        free(*keys); free(*real); free(*imag);
+        *keys = NULL; *real = NULL; *imag = NULL;
+        return -1;
+    }
+    memset(*keys, 0xFF, capacity * sizeof(uint64_t)); // SPARSE_EMPTY_KEY
+    return 0;
+}
+
+/**
+ * \brief Finds the slot holding 'key', or the free slot where it would be inserted.
+ */
+static inline size_t find_slot(const uint64_t* keys, size_t capacity, uint64_t key) {
+    size_t pos = hash_index(key, capacity);
+    while (keys[pos] != SPARSE_EMPTY_KEY && keys[pos] != key) {
+        pos = (pos + 1) & (capacity - 1);
+    }
+    return pos;
+}
+
+/**
+ * \brief Makes sure the scratch table can take 'entries' insertions at <= 50% load.
+ */
+static int reserve_scratch(SparseStateVector* ssv, size_t entries) {
+    size_t needed = SPARSE_INITIAL_CAPACITY;
+    while (needed < 2 * entries) needed <<= 1;
+    if (ssv->scratch_capacity >= needed) {
+        memset(ssv->scratch_keys, 0xFF, ssv->scratch_capacity * sizeof(uint64_t));
+        return 0;
+    }
+    free(ssv->scratch_keys); free(ssv->scratch_real); free(ssv->scratch_imag);
+    ssv->scratch_capacity = 0;
+    if (alloc_table(&ssv->scratch_keys, &ssv->scratch_real, &ssv->scratch_imag, needed) != 0) {
+        return -1;
+    }
+    ssv->scratch_capacity = needed;
+    return 0;
+}
+
+/**
+ * \brief Inserts into the scratch table (keys are unique per rebuild, so this never merges).
+ */
+static inline void scratch_put(SparseStateVector* ssv, uint64_t key, float r, float im, size_t* count) {
+    if (r * r + im * im < ssv->prune_eps) return;
+    size_t pos = find_slot(ssv->scratch_keys, ssv->scratch_capacity, key);
+    ssv->scratch_keys[pos] = key;
+    ssv->scratch_real[pos] = r;
+    ssv->scratch_imag[pos] = im;
+    (*count)++;
+}
+
+/**
+ * \brief Swaps the scratch table in as the live table.
+ */
+static void commit_scratch(SparseStateVector* ssv, size_t count) {
+    uint64_t* k = ssv->keys; float* r = ssv->real; float* i = ssv->imag; size_t c = ssv->capacity;
+    ssv->keys = ssv->scratch_keys; ssv->real = ssv->scratch_real; ssv->imag = ssv->scratch_imag;
+    ssv->capacity = ssv->scratch_capacity;
+    ssv->scratch_keys = k; ssv->scratch_real = r; ssv->scratch_imag = i;
+    ssv->scratch_capacity = c;
+    ssv->size = count;
+}
+
+int init_sparse_state_vector(SparseStateVector* ssv, size_t num_qubits, double density_threshold) {
+    if (!ssv) return -1;
+    if (num_qubits == 0 || num_qubits > SPARSE_MAX_QUBITS) return -2;
+    memset(ssv, 0, sizeof(*ssv));
+    ssv->num_qubits = num_qubits;
+    ssv->density_threshold = (density_threshold > 0.0) ? density_threshold : SPARSE_DEFAULT_DENSITY_THRESHOLD;
+    ssv->prune_eps = SPARSE_DEFAULT_PRUNE_EPS;
+
+    if (alloc_table(&ssv->keys, &ssv->real, &ssv->imag, SPARSE_INITIAL_CAPACITY) != 0) {
+        return -3;
+    }
+    ssv->capacity = SPARSE_INITIAL_CAPACITY;
+
+    // |0...0>
+    size_t pos = find_slot(ssv->keys, ssv->capacity, 0);
+    ssv->keys[pos] = 0;
+    ssv->real[pos] = 1.0f;
+    ssv->imag[pos] = 0.0f;
+    ssv->size = 1;
+    return 0;
+}
+
+void free_sparse_state_vector(SparseStateVector* ssv) {
+    if (!ssv) return;
+    free(ssv->keys); free(ssv->real); free(ssv->imag);
+    free(ssv->scratch_keys); free(ssv->scratch_real); free(ssv->scratch_imag);
+    memset(ssv, 0, sizeof(*ssv));
+}
+
+int sparse_apply_single_qubit_gate(SparseStateVector* ssv, const float* gate, size_t qubit_index) {
+    if (!ssv || !ssv->keys || !gate) return -1;
+    if (qubit_index >= ssv->num_qubits) return -2;
+
+    uint64_t mask = (uint64_t)1 << qubit_index;
+
+    // Diagonal gates (Z, S, T, ...) never create new entries: update in place
+    if (gate[2] == 0.0f && gate[3] == 0.0f && gate[4] == 0.0f && gate[5] == 0.0f) {
+        for (size_t s = 0; s < ssv->capacity; s++) {
+            if (ssv->keys[s] == SPARSE_EMPTY_KEY) continue;
+            const float* d = (ssv->keys[s] & mask) ? &gate[6] : &gate[0];
+            float r = ssv->real[s], im = ssv->imag[s];
+            ssv->real[s] = d[0] * r - d[1] * im;
+            ssv->imag[s] = d[0] * im + d[1] * r;
+        }
+        return 0;
+    }
+
+    // General gate: each stored entry contributes to at most two output entries
+    if (reserve_scratch(ssv, 2 * ssv->size) != 0) return -3;
+    size_t count = 0;
+    for (size_t s = 0; s < ssv->capacity; s++) {
+        uint64_t key = ssv->keys[s];
+        if (key == SPARSE_EMPTY_KEY) continue;
+
+        uint64_t partner = key ^ mask;
+        size_t ppos = find_slot(ssv->keys, ssv->capacity, partner);
+        int has_partner = (ssv->keys[ppos] == partner);
+        if ((key & mask) && has_partner) continue; // handled from the |..0..> side
+
+        float r0, i0, r1, i1;
+        if (key & mask) {
+            r0 = 0.0f; i0 = 0.0f;
+            r1 = ssv->real[s]; i1 = ssv->imag[s];
+        } else {
+            r0 = ssv->real[s]; i0 = ssv->imag[s];
+            r1 = has_partner ? ssv->real[ppos] : 0.0f;
+            i1 = has_partner ? ssv->imag[ppos] : 0.0f;
+        }
+
+        float new_r0 = gate[0] * r0 - gate[1] * i0 + gate[2] * r1 - gate[3] * i1;
+        float new_i0 = gate[0] * i0 + gate[1] * r0 + gate[2] * i1 + gate[3] * r1;
+        float new_r1 = gate[4] * r0 - gate[5] * i0 + gate[6] * r1 - gate[7] * i1;
+        float new_i1 = gate[4] * i0 + gate[5] * r0 + gate[6] * i1 + gate[7] * r1;
+
+        uint64_t k0 = key & ~mask;
+        scratch_put(ssv, k0, new_r0, new_i0, &count);
+        scratch_put(ssv, k0 | mask, new_r1, new_i1, &count);
+    }
+    commit_scratch(ssv, count);
+    return 0;
+}
+
+int sparse_apply_cnot(SparseStateVector* ssv, size_t control_qubit, size_t target_qubit) {
+    if (!ssv || !ssv->keys) return -1;
+    if (control_qubit >= ssv->num_qubits || target_qubit >= ssv->num_qubits) return -2;
+    if (control_qubit == target_qubit) return -3;
+
+    uint64_t cmask = (uint64_t)1 << control_qubit;
+    uint64_t tmask = (uint64_t)1 << target_qubit;
+
+    if (reserve_scratch(ssv, ssv->size) != 0) return -4;
+    size_t count = 0;
+    for (size_t s = 0; s < ssv->capacity; s++) {
+        uint64_t key = ssv->keys[s];
+        if (key == SPARSE_EMPTY_KEY) continue;
+        if (key & cmask) key ^= tmask;
+        scratch_put(ssv, key, ssv->real[s], ssv->imag[s], &count);
+    }
+    commit_scratch(ssv, count);
+    return 0;
+}
+
+int sparse_apply_controlled_phase(SparseStateVector* ssv, size_t control_qubit, size_t target_qubit,
+                                  float phase_real, float phase_imag) {
+    if (!ssv || !ssv->keys) return -1;
+    if (control_qubit >= ssv->num_qubits || target_qubit >= ssv->num_qubits) return -2;
+    if (control_qubit == target_qubit) return -3;
+
+    uint64_t both = ((uint64_t)1 << control_qubit) | ((uint64_t)1 << target_qubit);
+    for (size_t s = 0; s < ssv->capacity; s++) {
+        if (ssv->keys[s] == SPARSE_EMPTY_KEY || (ssv->keys[s] & both) != both) continue;
+        float r = ssv->real[s], im = ssv->imag[s];
+        ssv->real[s] = phase_real * r - phase_imag * im;
+        ssv->imag[s] = phase_real * im + phase_imag * r;
+    }
+    return 0;
+}
+
+int sparse_measure_qubit(SparseStateVector* ssv, size_t qubit_index, int* out_result) {
+    if (!ssv || !ssv->keys || !out_result) return -1;
+    if (qubit_index >= ssv->num_qubits) return -2;
+
+    uint64_t mask = (uint64_t)1 << qubit_index;
+    double p0 = 0.0, total = 0.0;
+    for (size_t s = 0; s < ssv->capacity; s++) {
+        if (ssv->keys[s] == SPARSE_EMPTY_KEY) continue;
+        double p = (double)ssv->real[s] * ssv->real[s] + (double)ssv->imag[s] * ssv->imag[s];
+        total += p;
+        if (!(ssv->keys[s] & mask)) p0 += p;
+    }
+
+    float rand_val = (float)rand() / (float)RAND_MAX;
+    int outcome = (rand_val < (float)(p0 / (total > 0.0 ? total : 1.0))) ? 0 : 1;
+    double kept = outcome ? (total - p0) : p0;
+    float scale = (kept > 1e-12) ? (float)(1.0 / sqrt(kept)) : 1.0f;
+
+    // Collapse + renormalize while rebuilding (dropped entries leave no tombstones)
+    if (reserve_scratch(ssv, ssv->size) != 0) return -3;
+    size_t count = 0;
+    for (size_t s = 0; s < ssv->capacity; s++) {
+        uint64_t key = ssv->keys[s];
+        if (key == SPARSE_EMPTY_KEY) continue;
+        if (((key & mask) != 0) != outcome) continue;
+        scratch_put(ssv, key, ssv->real[s] * scale, ssv->imag[s] * scale, &count);
+    }
+    commit_scratch(ssv, count);
+
+    *out_result = outcome;
+    return 0;
+}
+
+void sparse_get_amplitude(const SparseStateVector* ssv, uint64_t index, float* out_real, float* out_imag) {
+    float r = 0.0f, im = 0.0f;
+    if (ssv && ssv->keys) {
+        size_t pos = find_slot(ssv->keys, ssv->capacity, index);
+        if (ssv->keys[pos] == index) {
+            r = ssv->real[pos];
+            im = ssv->imag[pos];
+        }
+    }
+    if (out_real) *out_real = r;
+    if (out_imag) *out_imag = im;
+}
+
+double sparse_density(const SparseStateVector* ssv) {
+    if (!ssv || ssv->num_qubits == 0) return 0.0;
+    return ldexp((double)ssv->size, -(int)ssv->num_qubits);
+}
+
+int sparse_should_promote(const SparseStateVector* ssv) {
+    if (!ssv) return 0;
+    if (ssv->num_qubits >= sizeof(size_t) * 8 - 4) return 0; // dense length would not be addressable
+    return sparse_density(ssv) > ssv->density_threshold;
+}
+
+int sparse_promote_to_dense(SparseStateVector* ssv, StateVector* sv) {
+    if (!ssv || !ssv->keys || !sv) return -1;
+    if (init_state_vector(sv, ssv->num_qubits) != 0) return -2;
+
+    sv->real[0] = 0.0f; // init_state_vector starts in |0...0>
+    for (size_t s = 0; s < ssv->capacity; s++) {
+        uint64_t key = ssv->keys[s];
+        if (key == SPARSE_EMPTY_KEY) continue;
+        sv->real[key] = ssv->real[s];
+        sv->imag[key] = ssv->imag[s];
+    }
+    free_sparse_state_vector(ssv);
+    return 0;
+}
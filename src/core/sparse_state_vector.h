@@ -0,0 +1,115 @@
+#ifndef SPARSE_STATE_VECTOR_H
+#define SPARSE_STATE_VECTOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "state_vector.h"
+
+/**
+ * \brief Largest register the sparse engine can index (basis states are 64-bit keys).
+ */
+#define SPARSE_MAX_QUBITS 63
+
+/**
+ * \brief Default density (nonzeros / 2^n) above which the sparse form should be promoted.
+ *        A sparse entry costs ~64 bytes (key + amplitude at <= 50% load, double-buffered),
+ *        a dense amplitude costs 8, so 1/8 is the point where dense is never larger.
+ */
+#define SPARSE_DEFAULT_DENSITY_THRESHOLD 0.125
+
+/**
+ * \brief Amplitudes with squared magnitude below this are dropped from the table.
+ */
+#define SPARSE_DEFAULT_PRUNE_EPS 1e-16f
+
+/**
+ * \brief Sparse state: an open-addressing (linear probing) hash table mapping
+ *        basis index -> amplitude. Only nonzero amplitudes are stored.
+ */
+typedef struct SparseStateVector {
+    size_t    num_qubits;          /**< Number of qubits in this system */
+    uint64_t* keys;                /**< Basis indices, SPARSE_EMPTY_KEY marks a free slot */
+    float*    real;                /**< Real parts, parallel to keys */
+    float*    imag;                /**< Imag parts, parallel to keys */
+    size_t    capacity;            /**< Table slots (power of two) */
+    size_t    size;                /**< Number of stored nonzero amplitudes */
+    uint64_t* scratch_keys;        /**< Second table used while rebuilding after a gate */
+    float*    scratch_real;
+    float*    scratch_imag;
+    size_t    scratch_capacity;
+    double    density_threshold;   /**< Promote to dense once size / 2^n exceeds this */
+    float     prune_eps;           /**< Squared-magnitude cutoff for dropping amplitudes */
+} SparseStateVector;
+
+/**
+ * \brief Initializes a SparseStateVector in the |0...0> state.
+ * \param ssv Pointer to a SparseStateVector struct
+ * \param num_qubits Number of qubits (at most SPARSE_MAX_QUBITS)
+ * \param density_threshold Promotion threshold (<= 0 selects SPARSE_DEFAULT_DENSITY_THRESHOLD)
+ * \return 0 on success, nonzero on error
+ */
+int init_sparse_state_vector(SparseStateVector* ssv, size_t num_qubits, double density_threshold);
+
+/**
+ * \brief Frees resources associated with a SparseStateVector.
+ */
+void free_sparse_state_vector(SparseStateVector* ssv);
+
+/**
+ * \brief Applies a 2x2 single-qubit gate, touching only the stored nonzero entries.
+ * \return 0 on success, nonzero on error
+ */
+int sparse_apply_single_qubit_gate(SparseStateVector* ssv, const float* gate, size_t qubit_index);
+
+/**
+ * \brief Applies a CNOT by remapping the keys of entries whose control bit is set.
+ * \return 0 on success, nonzero on error
+ */
+int sparse_apply_cnot(SparseStateVector* ssv, size_t control_qubit, size_t target_qubit);
+
+/**
+ * \brief Applies a controlled phase in place (diagonal, so no entries are created).
+ * \return 0 on success, nonzero on error
+ */
+int sparse_apply_controlled_phase(SparseStateVector* ssv, size_t control_qubit, size_t target_qubit,
+                                  float phase_real, float phase_imag);
+
+/**
+ * \brief Measures a qubit in the computational basis and collapses the sparse state.
+ * \return 0 on success, nonzero on error
+ */
+int sparse_measure_qubit(SparseStateVector* ssv, size_t qubit_index, int* out_result);
+
+/**
+ * \brief Looks up the amplitude of a basis state (0 if not stored).
+ */
+void sparse_get_amplitude(const SparseStateVector* ssv, uint64_t index, float* out_real, float* out_imag);
+
+/**
+ * \brief Fraction of the 2^n basis states currently stored.
+ */
+double sparse_density(const SparseStateVector* ssv);
+
+/**
+ * \brief Returns 1 if the density has crossed the threshold and a dense vector of this size
+ *        can be addressed, 0 otherwise.
+ */
+int sparse_should_promote(const SparseStateVector* ssv);
+
+/**
+ * \brief Scatters the sparse state into a newly initialized dense StateVector and frees the table.
+ * \param ssv Sparse state (freed on success)
+ * \param sv Uninitialized StateVector that receives the amplitudes
+ * \return 0 on success, nonzero on error (ssv is left intact)
+ */
+int sparse_promote_to_dense(SparseStateVector* ssv, StateVector* sv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPARSE_STATE_VECTOR_H */
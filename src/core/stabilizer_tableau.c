@@ -0,0 +1,441 @@
+#include "stabilizer_tableau.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+#ifdef __SSE4_2__
+#  include <nmmintrin.h>
+#endif
+
+/**
+ * \brief Word-parallel helpers: a lane is two words with SSE2, one word otherwise. 'words'
+ *        is always even, so columns never end in a partial lane.
+ */
+#ifdef __SSE2__
+typedef __m128i Lane;
+#  define LANE_WORDS 2
+static inline Lane lane_load(const uint64_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void lane_store(uint64_t* p, Lane v) { _mm_storeu_si128((__m128i*)p, v); }
+static inline Lane lane_and(Lane a, Lane b) { return _mm_and_si128(a, b); }
+static inline Lane lane_xor(Lane a, Lane b) { return _mm_xor_si128(a, b); }
+static inline Lane lane_andnot(Lane a, Lane b) { return _mm_andnot_si128(a, b); } // ~a & b
+#else
+typedef uint64_t Lane;
+#  define LANE_WORDS 1
+static inline Lane lane_load(const uint64_t* p) { return *p; }
+static inline void lane_store(uint64_t* p, Lane v) { *p = v; }
+static inline Lane lane_and(Lane a, Lane b) { return a & b; }
+static inline Lane lane_xor(Lane a, Lane b) { return a ^ b; }
+static inline Lane lane_andnot(Lane a, Lane b) { return ~a & b; }
+#endif
+
+static inline int get_bit(const uint64_t* column, size_t row) {
+    return (int)((column[row >> 6] >> (row & 63)) & 1u);
+}
+
+static inline void set_bit(uint64_t* column, size_t row, int value) {
+    uint64_t mask = (uint64_t)1 << (row & 63);
+    column[row >> 6] = value ? (column[row >> 6] | mask) : (column[row >> 6] & ~mask);
+}
+
+static size_t column_words(size_t num_qubits) {
+    size_t words = (2 * num_qubits + 63) / 64;
+    return (words + 1) & ~(size_t)1;
+}
+
+size_t stabilizer_tableau_bytes(size_t num_qubits) {
+    if (num_qubits > SIZE_MAX / 4) return SIZE_MAX;
+    size_t words = column_words(num_qubits);
+    size_t columns = 2 * num_qubits + 3; // x, z, r and two counters
+    if (words > SIZE_MAX / sizeof(uint64_t) / columns) return SIZE_MAX;
+    return columns * words * sizeof(uint64_t);
+}
+
+int init_stabilizer_tableau(StabilizerTableau* tableau, size_t num_qubits) {
+    if (!tableau || num_qubits == 0) return -1;
+    if (stabilizer_tableau_bytes(num_qubits) == SIZE_MAX) return -2;
+    memset(tableau, 0, sizeof(*tableau));
+    size_t words = column_words(num_qubits);
+    tableau->num_qubits = num_qubits;
+    tableau->words = words;
+    tableau->x = (uint64_t*)calloc(num_qubits * words, sizeof(uint64_t));
+    tableau->z = (uint64_t*)calloc(num_qubits * words, sizeof(uint64_t));
+    tableau->r = (uint64_t*)calloc(words, sizeof(uint64_t));
+    tableau->scratch = (uint64_t*)calloc(2 * words, sizeof(uint64_t));
+    if (!tableau->x || !tableau->z || !tableau->r || !tableau->scratch) {
+        fprintf(stderr, "Error: could not allocate a %zu-qubit stabilizer tableau.\n", num_qubits);
+        free_stabilizer_tableau(tableau);
+        return -2;
+    }
+    // Destabilizer i = X_i, stabilizer i = Z_i
+    for (size_t q = 0; q < num_qubits; q++) {
+        set_bit(tableau->x + q * words, q, 1);
+        set_bit(tableau->z + q * words, num_qubits + q, 1);
+    }
+    return 0;
+}
+
+void free_stabilizer_tableau(StabilizerTableau* tableau) {
+    if (!tableau) return;
+    free(tableau->x);
+    free(tableau->z);
+    free(tableau->r);
+    free(tableau->scratch);
+    memset(tableau, 0, sizeof(*tableau));
+}
+
+/*
+ * Column updates (conjugation rules of Aaronson & Gottesman), applied to all rows at once.
+ */
+
+static void column_h(StabilizerTableau* t, size_t q) {
+    uint64_t* x = t->x + q * t->words;
+    uint64_t* z = t->z + q * t->words;
+    for (size_t w = 0; w < t->words; w += LANE_WORDS) {
+        Lane xv = lane_load(x + w), zv = lane_load(z + w);
+        lane_store(t->r + w, lane_xor(lane_load(t->r + w), lane_and(xv, zv)));
+        lane_store(x + w, zv);
+        lane_store(z + w, xv);
+    }
+}
+
+static void column_s(StabilizerTableau* t, size_t q) {
+    uint64_t* x = t->x + q * t->words;
+    uint64_t* z = t->z + q * t->words;
+    for (size_t w = 0; w < t->words; w += LANE_WORDS) {
+        Lane xv = lane_load(x + w), zv = lane_load(z + w);
+        lane_store(t->r + w, lane_xor(lane_load(t->r + w), lane_and(xv, zv)));
+        lane_store(z + w, lane_xor(zv, xv));
+    }
+}
+
+/**
+ * \brief Paulis only flip signs: X anticommutes with rows holding Z, Z with rows holding X.
+ */
+static void column_pauli(StabilizerTableau* t, size_t q, int flip_on_x, int flip_on_z) {
+    const uint64_t* x = t->x + q * t->words;
+    const uint64_t* z = t->z + q * t->words;
+    for (size_t w = 0; w < t->words; w += LANE_WORDS) {
+        Lane flip = !flip_on_z ? lane_load(x + w)
+                  : !flip_on_x ? lane_load(z + w) : lane_xor(lane_load(x + w), lane_load(z + w));
+        lane_store(t->r + w, lane_xor(lane_load(t->r + w), flip));
+    }
+}
+
+static void column_cnot(StabilizerTableau* t, size_t c, size_t g) {
+    uint64_t* xc = t->x + c * t->words;
+    uint64_t* zc = t->z + c * t->words;
+    uint64_t* xt = t->x + g * t->words;
+    uint64_t* zt = t->z + g * t->words;
+    for (size_t w = 0; w < t->words; w += LANE_WORDS) {
+        Lane xcv = lane_load(xc + w), zcv = lane_load(zc + w);
+        Lane xtv = lane_load(xt + w), ztv = lane_load(zt + w);
+        // r ^= xc & zt & ~(xt ^ zc)
+        Lane flip = lane_andnot(lane_xor(xtv, zcv), lane_and(xcv, ztv));
+        lane_store(t->r + w, lane_xor(lane_load(t->r + w), flip));
+        lane_store(xt + w, lane_xor(xtv, xcv));
+        lane_store(zc + w, lane_xor(zcv, ztv));
+    }
+}
+
+static void column_cz(StabilizerTableau* t, size_t a, size_t b) {
+    uint64_t* xa = t->x + a * t->words;
+    uint64_t* za = t->z + a * t->words;
+    uint64_t* xb = t->x + b * t->words;
+    uint64_t* zb = t->z + b * t->words;
+    for (size_t w = 0; w < t->words; w += LANE_WORDS) {
+        Lane xav = lane_load(xa + w), zav = lane_load(za + w);
+        Lane xbv = lane_load(xb + w), zbv = lane_load(zb + w);
+        Lane flip = lane_and(lane_and(xav, xbv), lane_xor(zav, zbv));
+        lane_store(t->r + w, lane_xor(lane_load(t->r + w), flip));
+        lane_store(za + w, lane_xor(zav, xbv));
+        lane_store(zb + w, lane_xor(zbv, xav));
+    }
+}
+
+/**
+ * \brief Signed Pauli code of a 2x2 matrix: 0 +X, 1 -X, 2 +Y, 3 -Y, 4 +Z, 5 -Z, -1 if none.
+ */
+static int pauli_code(const double* m) {
+    static const double paulis[6][8] = {
+        {  0, 0,  1, 0,  1, 0,  0, 0 }, {  0, 0, -1, 0, -1, 0,  0, 0 },
+        {  0, 0,  0,-1,  0, 1,  0, 0 }, {  0, 0,  0, 1,  0,-1,  0, 0 },
+        {  1, 0,  0, 0,  0, 0, -1, 0 }, { -1, 0,  0, 0,  0, 0,  1, 0 }
+    };
+    for (int p = 0; p < 6; p++) {
+        int match = 1;
+        for (int e = 0; e < 8 && match; e++) match = fabs(m[e] - paulis[p][e]) < 1e-3;
+        if (match) return p;
+    }
+    return -1;
+}
+
+/**
+ * \brief out = U P U^dagger for a gate U in float layout and P in double layout.
+ */
+static void conjugate(const float* u, const double* p, double* out) {
+    double up[8];
+    for (int r = 0; r < 2; r++) {
+        for (int c = 0; c < 2; c++) {
+            double re = 0.0, im = 0.0;
+            for (int k = 0; k < 2; k++) {
+                double ar = u[4 * r + 2 * k], ai = u[4 * r + 2 * k + 1];
+                double br = p[4 * k + 2 * c], bi = p[4 * k + 2 * c + 1];
+                re += ar * br - ai * bi;
+                im += ar * bi + ai * br;
+            }
+            up[4 * r + 2 * c] = re;
+            up[4 * r + 2 * c + 1] = im;
+        }
+    }
+    for (int r = 0; r < 2; r++) {
+        for (int c = 0; c < 2; c++) {
+            double re = 0.0, im = 0.0;
+            for (int k = 0; k < 2; k++) {
+                double ar = up[4 * r + 2 * k], ai = up[4 * r + 2 * k + 1];
+                double br = u[4 * c + 2 * k], bi = -u[4 * c + 2 * k + 1]; // (U^dagger)[k][c] = conj(U[c][k])
+                re += ar * br - ai * bi;
+                im += ar * bi + ai * br;
+            }
+            out[4 * r + 2 * c] = re;
+            out[4 * r + 2 * c + 1] = im;
+        }
+    }
+}
+
+/**
+ * \brief Shortest H/S/X/Y/Z sequence (applied left to right) for each single-qubit Clifford,
+ *        indexed by the signed Paulis it maps X and Z to. NULL pairs would not commute right.
+ */
+static const char* const CLIFFORD_WORDS[6][6] = {
+    /* X -> +X */ { NULL,  NULL,  "SHS",  "HSH",  "",    "X"   },
+    /* X -> -X */ { NULL,  NULL,  "HSHZ", "HSHY", "Z",   "Y"   },
+    /* X -> +Y */ { "SHX", "SHZ", NULL,   NULL,   "S",   "SY"  },
+    /* X -> -Y */ { "SH",  "SHY", NULL,   NULL,   "SZ",  "SX"  },
+    /* X -> +Z */ { "H",   "HZ",  "HS",   "HSZ",  NULL,  NULL  },
+    /* X -> -Z */ { "HX",  "HY",  "HSY",  "HSX",  NULL,  NULL  }
+};
+
+static const char* clifford_word(const float* gate) {
+    static const double pauli_x[8] = { 0, 0, 1, 0, 1, 0, 0, 0 };
+    static const double pauli_z[8] = { 1, 0, 0, 0, 0, 0, -1, 0 };
+    double image[8];
+    conjugate(gate, pauli_x, image);
+    int x_code = pauli_code(image);
+    conjugate(gate, pauli_z, image);
+    int z_code = pauli_code(image);
+    if (x_code < 0 || z_code < 0) return NULL;
+    return CLIFFORD_WORDS[x_code][z_code];
+}
+
+int is_clifford_gate(const float* gate) {
+    return gate && clifford_word(gate) != NULL;
+}
+
+int tableau_apply_single_qubit_gate(StabilizerTableau* tableau, const float* gate, size_t qubit_index) {
+    if (!tableau || !gate || qubit_index >= tableau->num_qubits) return -1;
+    const char* word = clifford_word(gate);
+    if (!word) return -3;
+    for (; *word; word++) {
+        switch (*word) {
+            case 'H': column_h(tableau, qubit_index); break;
+            case 'S': column_s(tableau, qubit_index); break;
+            case 'X': column_pauli(tableau, qubit_index, 0, 1); break;
+            case 'Y': column_pauli(tableau, qubit_index, 1, 1); break;
+            case 'Z': column_pauli(tableau, qubit_index, 1, 0); break;
+        }
+    }
+    return 0;
+}
+
+int tableau_apply_cnot(StabilizerTableau* tableau, size_t control_qubit, size_t target_qubit) {
+    if (!tableau || control_qubit >= tableau->num_qubits || target_qubit >= tableau->num_qubits) return -1;
+    if (control_qubit == target_qubit) return -2;
+    column_cnot(tableau, control_qubit, target_qubit);
+    return 0;
+}
+
+int tableau_apply_controlled_phase(StabilizerTableau* tableau, size_t control_qubit, size_t target_qubit,
+                                   float phase_real, float phase_imag) {
+    if (!tableau || control_qubit >= tableau->num_qubits || target_qubit >= tableau->num_qubits) return -1;
+    if (control_qubit == target_qubit) return -2;
+    if (fabsf(phase_imag) > 1e-4f || fabsf(fabsf(phase_real) - 1.0f) > 1e-4f) return -3;
+    if (phase_real < 0.0f) column_cz(tableau, control_qubit, target_qubit);
+    return 0;
+}
+
+/**
+ * \brief Multiplies source row 'src' into every row selected by 'mask' (rowsum of Aaronson &
+ *        Gottesman, for many target rows at once). The Pauli product's phase exponent is
+ *        accumulated per target row in two bit-sliced counters (mod 4).
+ */
+static void multiply_rows(StabilizerTableau* t, const uint64_t* mask, size_t src) {
+    uint64_t* c0 = t->scratch;
+    uint64_t* c1 = t->scratch + t->words;
+    memset(t->scratch, 0, 2 * t->words * sizeof(uint64_t));
+
+    for (size_t q = 0; q < t->num_qubits; q++) {
+        uint64_t* x = t->x + q * t->words;
+        uint64_t* z = t->z + q * t->words;
+        int xs = get_bit(x, src), zs = get_bit(z, src);
+        if (!xs && !zs) continue;
+        for (size_t w = 0; w < t->words; w++) {
+            uint64_t m = mask[w], xw = x[w], zw = z[w];
+            // g(source, target) is +1 or -1 on these target rows (0 elsewhere)
+            uint64_t plus, minus;
+            if (xs && zs) {        // Y: g = z - x
+                plus = zw & ~xw;
+                minus = xw & ~zw;
+            } else if (xs) {       // X: g = z (2x - 1)
+                plus = zw & xw;
+                minus = zw & ~xw;
+            } else {               // Z: g = x (1 - 2z)
+                plus = xw & ~zw;
+                minus = xw & zw;
+            }
+            plus &= m;
+            minus &= m;
+            c1[w] ^= c0[w] & plus;  // +1
+            c0[w] ^= plus;
+            c0[w] ^= minus;         // -1
+            c1[w] ^= c0[w] & minus;
+            if (xs) x[w] ^= m;
+            if (zs) z[w] ^= m;
+        }
+    }
+    // Commuting rows sum to 0 or 2 (c0 = 0): the new sign is r ^ r_src ^ c1
+    uint64_t rs = get_bit(t->r, src) ? ~(uint64_t)0 : 0;
+    for (size_t w = 0; w < t->words; w++) t->r[w] ^= mask[w] & (c1[w] ^ rs);
+}
+
+static inline unsigned popcount64(uint64_t v) {
+#ifdef __SSE4_2__
+    return (unsigned)_mm_popcnt_u64(v);
+#else
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (unsigned)((v * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+/**
+ * \brief Sign bit of the product of the (commuting) rows selected by 'mask'. Per qubit, writing
+ *        each factor as i^{xz} X^x Z^z, the product of the column is
+ *        i^{#Y + 2 #(z_i x_j, i < j) - XZ} X^X Z^Z, so the phase needs only popcounts and a
+ *        prefix parity of the z bits: O(n) words per qubit instead of one rowsum per row.
+ */
+static int product_sign(const StabilizerTableau* t, const uint64_t* mask) {
+    unsigned phase = 0; // power of i, mod 4
+    for (size_t w = 0; w < t->words; w++) phase += 2u * popcount64(t->r[w] & mask[w]);
+    for (size_t q = 0; q < t->num_qubits; q++) {
+        const uint64_t* x = t->x + q * t->words;
+        const uint64_t* z = t->z + q * t->words;
+        unsigned ys = 0, xs = 0, zs = 0, pairs = 0;
+        uint64_t carry = 0; // parity of the selected z bits in earlier words
+        for (size_t w = 0; w < t->words; w++) {
+            uint64_t xw = x[w] & mask[w], zw = z[w] & mask[w];
+            if (!(xw | zw)) continue;
+            // Bit b of 'before' = parity of the selected z bits below b
+            uint64_t before = zw << 1;
+            before ^= before << 1;
+            before ^= before << 2;
+            before ^= before << 4;
+            before ^= before << 8;
+            before ^= before << 16;
+            before ^= before << 32;
+            before ^= carry;
+            pairs += popcount64(xw & before);
+            ys += popcount64(xw & zw);
+            xs += popcount64(xw);
+            zs += popcount64(zw);
+            if (popcount64(zw) & 1u) carry = ~carry;
+        }
+        phase += ys + 2u * pairs - ((xs & zs) & 1u);
+    }
+    // Commuting rows multiply to +-1 times a Pauli string: phase is 0 or 2
+    return (int)((phase >> 1) & 1u);
+}
+
+int tableau_measure_qubit(StabilizerTableau* tableau, size_t qubit_index, int* out_result) {
+    if (!tableau || !out_result || qubit_index >= tableau->num_qubits) return -1;
+    StabilizerTableau* t = tableau;
+    size_t n = t->num_qubits;
+    size_t words = t->words;
+    uint64_t* xq = t->x + qubit_index * words;
+
+    // A stabilizer with X or Y on the qubit anticommutes with Z: the outcome is random
+    size_t p = 2 * n;
+    for (size_t row = n; row < 2 * n; row++) {
+        if (get_bit(xq, row)) {
+            p = row;
+            break;
+        }
+    }
+
+    if (p < 2 * n) {
+        // Every other row that anticommutes with Z absorbs row p
+        uint64_t* mask = (uint64_t*)malloc(words * sizeof(uint64_t));
+        if (!mask) return -2;
+        memcpy(mask, xq, words * sizeof(uint64_t));
+        set_bit(mask, p, 0);
+        multiply_rows(t, mask, p);
+        free(mask);
+
+        // Row p becomes the destabilizer, and +-Z on the qubit the new stabilizer
+        int outcome = (rand() > RAND_MAX / 2) ? 1 : 0;
+        for (size_t q = 0; q < n; q++) {
+            uint64_t* x = t->x + q * words;
+            uint64_t* z = t->z + q * words;
+            set_bit(x, p - n, get_bit(x, p));
+            set_bit(z, p - n, get_bit(z, p));
+            set_bit(x, p, 0);
+            set_bit(z, p, q == qubit_index);
+        }
+        set_bit(t->r, p - n, get_bit(t->r, p));
+        set_bit(t->r, p, outcome);
+        *out_result = outcome;
+        return 0;
+    }
+
+    // Deterministic: Z on the qubit is the product of the stabilizers whose destabilizers
+    // hold X there, and the outcome is that product's sign
+    uint64_t* mask = (uint64_t*)calloc(words, sizeof(uint64_t));
+    if (!mask) return -2;
+    for (size_t row = 0; row < n; row++) {
+        if (get_bit(xq, row)) set_bit(mask, row + n, 1);
+    }
+    *out_result = product_sign(t, mask);
+    free(mask);
+    return 0;
+}
+
+int tableau_kernel_cost(DenseKernel kernel, size_t num_qubits, KernelCost* cost) {
+    if (!cost) return -1;
+    double rows = 2.0 * (double)num_qubits + 1.0; // x and z columns plus the signs
+    double column_bytes = (double)column_words(num_qubits) * sizeof(uint64_t);
+    double columns;
+    switch (kernel) {
+        case KERNEL_GATE_1Q:
+            columns = 3.0; // x, z, r
+            break;
+        case KERNEL_CNOT:
+        case KERNEL_CPHASE:
+            columns = 5.0;
+            break;
+        case KERNEL_MEASURE:
+            columns = rows; // a random outcome rewrites every column
+            break;
+        default:
+            return -2;
+    }
+    // Bit logic is free next to the memory traffic
+    cost->passes = columns / rows;
+    cost->bytes = columns * column_bytes * 2.0; // read + write
+    cost->flops = 0.0;
+    return 0;
+}
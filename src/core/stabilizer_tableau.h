@@ -0,0 +1,97 @@
+#ifndef STABILIZER_TABLEAU_H
+#define STABILIZER_TABLEAU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "gate_operations.h"
+
+/**
+ * \brief Stabilizer state of an n-qubit register in Aaronson-Gottesman form: n destabilizer
+ *        rows and n stabilizer rows, each a Pauli string (x and z bits per qubit) with a
+ *        sign bit r. Clifford gates update it in O(n) and measurements in O(n^2), so
+ *        registers of thousands of qubits are cheap.
+ *
+ *        Storage is column-major and bit-packed: the x bits of qubit j for all 2n rows are
+ *        x[j * words .. (j + 1) * words), 64 rows per word, likewise for z. A gate on qubit j
+ *        is a handful of word-wide logic ops over that column, two words per SSE2 register.
+ */
+typedef struct StabilizerTableau {
+    size_t    num_qubits;  /**< Number of qubits n */
+    size_t    words;       /**< 64-bit words per column (2n rows, rounded up to an even count) */
+    uint64_t* x;           /**< X bits, num_qubits columns */
+    uint64_t* z;           /**< Z bits, num_qubits columns */
+    uint64_t* r;           /**< Sign bits, one column */
+    uint64_t* scratch;     /**< Two columns of phase counters used by measurement */
+} StabilizerTableau;
+
+/**
+ * \brief Bytes a tableau of num_qubits qubits allocates (SIZE_MAX if that overflows).
+ */
+size_t stabilizer_tableau_bytes(size_t num_qubits);
+
+/**
+ * \brief Initializes a tableau in the |0...0> state (destabilizers X_i, stabilizers Z_i).
+ * \param tableau Pointer to a StabilizerTableau struct
+ * \param num_qubits Number of qubits
+ * \return 0 on success, nonzero on error
+ */
+int init_stabilizer_tableau(StabilizerTableau* tableau, size_t num_qubits);
+
+/**
+ * \brief Frees resources associated with a StabilizerTableau.
+ */
+void free_stabilizer_tableau(StabilizerTableau* tableau);
+
+/**
+ * \brief Returns 1 if a 2x2 gate (apply_single_qubit_gate layout) is a Clifford gate up to a
+ *        global phase, i.e. it maps X and Z to signed Paulis. Fused products of H, S and the
+ *        Paulis qualify; T and arbitrary rotations do not.
+ */
+int is_clifford_gate(const float* gate);
+
+/**
+ * \brief Applies a single-qubit Clifford gate given as a 2x2 matrix. The matrix is matched to
+ *        a short H/S/Pauli sequence (global phases are dropped).
+ * \return 0 on success, -3 if the gate is not Clifford, other nonzero values on error
+ */
+int tableau_apply_single_qubit_gate(StabilizerTableau* tableau, const float* gate, size_t qubit_index);
+
+/**
+ * \brief Applies a CNOT.
+ * \return 0 on success, nonzero on error
+ */
+int tableau_apply_cnot(StabilizerTableau* tableau, size_t control_qubit, size_t target_qubit);
+
+/**
+ * \brief Applies a controlled phase diag(1, 1, 1, e^{i phi}). Only phi = 0 (identity) and
+ *        phi = pi (CZ) are Clifford.
+ * \return 0 on success, -3 if the phase is not +1 or -1, other nonzero values on error
+ */
+int tableau_apply_controlled_phase(StabilizerTableau* tableau, size_t control_qubit, size_t target_qubit,
+                                   float phase_real, float phase_imag);
+
+/**
+ * \brief Measures one qubit in the computational basis and collapses the tableau. Random
+ *        outcomes draw from rand(), like the other engines.
+ * \param out_result 0 or 1
+ * \return 0 on success, nonzero on error
+ */
+int tableau_measure_qubit(StabilizerTableau* tableau, size_t qubit_index, int* out_result);
+
+/**
+ * \brief Work of one tableau kernel, in the units of dense_kernel_cost. Single-qubit gates
+ *        touch 3 columns, two-qubit gates 5, and a measurement may rewrite the whole tableau.
+ *        Only KERNEL_GATE_1Q, KERNEL_CNOT, KERNEL_CPHASE and KERNEL_MEASURE are meaningful.
+ * \return 0 on success, nonzero on error
+ */
+int tableau_kernel_cost(DenseKernel kernel, size_t num_qubits, KernelCost* cost);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STABILIZER_TABLEAU_H */
@@ -6,11 +6,15 @@
 
 int init_state_vector(StateVector* sv, size_t num_qubits) {
     if (!sv) return -1;
+    // 2^n floats per array must be addressable in bytes (length * sizeof(float) * 2)
+    if (num_qubits >= sizeof(size_t) * 8 - 3) return -3;
     sv->num_qubits = num_qubits;
 
     size_t length = ((size_t)1 << num_qubits);
-    sv->real = (float*)aligned_alloc(32, length * sizeof(float));
-    sv->imag = (float*)aligned_alloc(32, length * sizeof(float));
+    // aligned_alloc requires the size to be a multiple of the alignment
+    size_t bytes = (length * sizeof(float) + 31) & ~(size_t)31;
+    sv->real = (float*)aligned_alloc(32, bytes);
+    sv->imag = (float*)aligned_alloc(32, bytes);
     if (!sv->real || !sv->imag) {
         free(sv->real);
         free(sv->imag);
@@ -26,6 +30,14 @@ int init_state_vector(StateVector* sv, size_t num_qubits) {
     return 0;
 }
 
+void reset_state_vector(StateVector* sv) {
+    if (!sv || !sv->real || !sv->imag) return;
+    size_t length = ((size_t)1 << sv->num_qubits);
+    memset(sv->real, 0, length * sizeof(float));
+    memset(sv->imag, 0, length * sizeof(float));
+    sv->real[0] = 1.0f;
+}
+
 void free_state_vector(StateVector* sv) {
     if (!sv) return;
     if (sv->real) free(sv->real);
@@ -22,10 +22,16 @@ typedef struct StateVector {
  * \brief Allocates and initializes a StateVector in the |0...0> state.
  * \param sv Pointer to a StateVector struct
  * \param num_qubits Number of qubits
- * \return 0 on success, nonzero on error
+ * \return 0 on success, -2 if allocation fails, -3 if 2^num_qubits amplitudes cannot be addressed
  */
 int init_state_vector(StateVector* sv, size_t num_qubits);
 
+/**
+ * \brief Resets an initialized StateVector to |0...0> without reallocating it.
+ * \param sv Pointer to an initialized StateVector
+ */
+void reset_state_vector(StateVector* sv);
+
 /**
  * \brief Frees resources associated with a StateVector.
  * \param sv Pointer to a StateVector struct
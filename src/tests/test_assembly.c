@@ -1,11 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <unistd.h>
 
 // Include assembly headers
 #include "../assembly/lexer.h"
 #include "../assembly/parser.h"
 #include "../assembly/interpreter.h"
+#include "../assembly/stream_interpreter.h"
+#include "../assembly/bytecode.h"
+#include "../assembly/parallel_frontend.h"
 #include "../core/state_vector.h"
 
 static void test_lexer() {
@@ -112,11 +117,712 @@ static void test_interpreter() {
     free_instruction_list(&instr_list);
 }
 
+static void test_interpreter_sparse_promotion() {
+    TokenList token_list;
+    init_token_list(&token_list);
+    lex_line("H 0", &token_list);
+    lex_line("CNOT 0 1", &token_list);
+    lex_line("H 2", &token_list);
+
+    InstructionList instr_list;
+    init_instruction_list(&instr_list);
+    parse_tokens(&token_list, &instr_list);
+
+    // Density 2/8 after CNOT stays sparse, 4/8 after "H 2" crosses 0.3
+    SparseStateVector ssv;
+    StateVector sv;
+    int promoted = 0;
+    init_sparse_state_vector(&ssv, 3, 0.3);
+    if (interpret_instructions_sparse(&instr_list, &ssv, &sv, &promoted) != 0 || !promoted) {
+        fprintf(stderr, "test_interpreter_sparse_promotion: expected promotion to dense.\n");
+        exit(EXIT_FAILURE);
+    }
+    // (|000> + |011> + |100> + |111>) / 2, within the precision of the stored H matrix
+    float eps = 1e-3f;
+    if (fabsf(sv.real[0] - 0.5f) > eps || fabsf(sv.real[7] - 0.5f) > eps || fabsf(sv.real[1]) > eps) {
+        fprintf(stderr, "test_interpreter_sparse_promotion: wrong amplitudes after promotion.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    free_state_vector(&sv);
+    free_token_list(&token_list);
+    free_instruction_list(&instr_list);
+}
+
+static void test_buffer_lexer() {
+    const char* source =
+        "// header comment\n"
+        "H 0  # trailing\n"
+        "\n"
+        "CNOT 0 12//no space\n"
+        "  MEASURE 12";
+    size_t size = strlen(source);
+
+    // The buffer lexer must agree with lex_line on every line
+    TokenList token_list;
+    init_token_list(&token_list);
+    char line[64];
+    const char* p = source;
+    while (*p) {
+        const char* nl = strchr(p, '\n');
+        size_t len = nl ? (size_t)(nl - p) : strlen(p);
+        memcpy(line, p, len);
+        line[len] = '\0';
+        lex_line(line, &token_list);
+        p += len + (nl ? 1 : 0);
+    }
+
+    TokenViewList views;
+    init_token_view_list(&views);
+    if (lex_buffer(source, size, &views) != 0 || views.size != token_list.size) {
+        fprintf(stderr, "test_buffer_lexer: expected %zu tokens, got %zu.\n", token_list.size, views.size);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < views.size; i++) {
+        const TokenView* v = &views.data[i];
+        if (v->type != token_list.data[i].type ||
+            v->length != strlen(token_list.data[i].text) ||
+            strncmp(source + v->offset, token_list.data[i].text, v->length) != 0) {
+            fprintf(stderr, "test_buffer_lexer: token %zu differs from lex_line.\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    // parse_file holds one view per token of the whole file, so the view stays packed
+    if (sizeof(TokenView) != 16) {
+        fprintf(stderr, "test_buffer_lexer: TokenView is %zu bytes, expected 16.\n", sizeof(TokenView));
+        exit(EXIT_FAILURE);
+    }
+    // "MEASURE" sits on line 5
+    if (views.data[views.size - 2].line != 5) {
+        fprintf(stderr, "test_buffer_lexer: wrong line number %u.\n", views.data[views.size - 2].line);
+        exit(EXIT_FAILURE);
+    }
+
+    InstructionList instr_list;
+    init_instruction_list(&instr_list);
+    if (parse_token_views(source, &views, &instr_list) != 0 || instr_list.size != 3 ||
+        instr_list.data[1].qubits[1] != 12 || instr_list.data[2].qubits[0] != 12) {
+        fprintf(stderr, "test_buffer_lexer: parse_token_views mismatch.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Same program through a mapped file
+    char path[] = "/tmp/qasm_lexer_testXXXXXX";
+    int fd = mkstemp(path);
+    FILE* fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!fp) {
+        fprintf(stderr, "test_buffer_lexer: cannot create temp file.\n");
+        exit(EXIT_FAILURE);
+    }
+    fputs(source, fp);
+    fclose(fp);
+
+    InstructionList from_file;
+    init_instruction_list(&from_file);
+    if (parse_file(path, &from_file) != 0 || from_file.size != 3 ||
+        strcmp(from_file.data[1].gate_name, "CNOT") != 0) {
+        fprintf(stderr, "test_buffer_lexer: parse_file mismatch.\n");
+        exit(EXIT_FAILURE);
+    }
+    remove(path);
+
+    free_instruction_list(&from_file);
+    free_instruction_list(&instr_list);
+    free_token_view_list(&views);
+    free_token_list(&token_list);
+}
+
+static void test_streaming_interpreter() {
+    // A few hundred lines, streamed in tiny batches through a tiny ring to force wrap-around
+    const char* gates[] = { "H", "T", "X", "S", "Z", "Y" };
+    size_t cap = 16384, len = 0;
+    char* source = (char*)malloc(cap);
+    for (int k = 0; k < 300; k++) {
+        if (k % 3 == 2) {
+            len += (size_t)snprintf(source + len, cap - len, "CNOT %d %d\n", k % 4, (k + 1) % 4);
+        } else {
+            len += (size_t)snprintf(source + len, cap - len, "%s %d // step %d\n", gates[k % 6], k % 4, k);
+        }
+    }
+
+    TokenViewList views;
+    InstructionList instr_list;
+    init_token_view_list(&views);
+    init_instruction_list(&instr_list);
+    lex_buffer(source, len, &views);
+    parse_token_views(source, &views, &instr_list);
+
+    StateVector expected, streamed;
+    init_state_vector(&expected, 4);
+    init_state_vector(&streamed, 4);
+    interpret_instructions(&instr_list, &expected);
+
+    StreamOptions options = { 7, 8 };
+    StreamStats stats;
+    if (interpret_buffer_streaming(source, len, &streamed, &options, &stats) != 0 ||
+        stats.instructions != instr_list.size || stats.batches != (300 + 6) / 7) {
+        fprintf(stderr, "test_streaming_interpreter: run failed (%zu instructions, %zu batches).\n",
+                stats.instructions, stats.batches);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < 16; i++) {
+        if (fabsf(expected.real[i] - streamed.real[i]) > 1e-6f ||
+            fabsf(expected.imag[i] - streamed.imag[i]) > 1e-6f) {
+            fprintf(stderr, "test_streaming_interpreter: amplitude %zu differs.\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Classical registers carry across batches: declared, written and read one line per batch
+    const char* classical = "CREG c 1\nX 0\nMEASURE 0 -> c[0]\nIF c==1 X 1\nIF c==0 X 2\n";
+    StreamOptions single_line = { 1, 8 };
+    StateVector classical_sv;
+    init_state_vector(&classical_sv, 3);
+    if (interpret_buffer_streaming(classical, strlen(classical), &classical_sv, &single_line, NULL) != 0 ||
+        fabsf(classical_sv.real[3] - 1.0f) > 1e-6f) {
+        fprintf(stderr, "test_streaming_interpreter: classical register not carried across batches.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_state_vector(&classical_sv);
+
+    // A parse error in a later batch stops the run with an error
+    const char* bad = "H 0\nH 1\nCNOT 0\n";
+    if (interpret_buffer_streaming(bad, strlen(bad), &streamed, &options, NULL) == 0) {
+        fprintf(stderr, "test_streaming_interpreter: expected a parse error.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    free_state_vector(&expected);
+    free_state_vector(&streamed);
+    free_instruction_list(&instr_list);
+    free_token_view_list(&views);
+    free(source);
+}
+
+static void parse_string(const char* source, InstructionList* instr_list) {
+    TokenViewList views;
+    init_token_view_list(&views);
+    init_instruction_list(instr_list);
+    lex_buffer(source, strlen(source), &views);
+    parse_token_views(source, &views, instr_list);
+    free_token_view_list(&views);
+}
+
+static void expect_same_state(const StateVector* a, const StateVector* b, const char* what) {
+    size_t length = (size_t)1 << a->num_qubits;
+    for (size_t i = 0; i < length; i++) {
+        if (fabsf(a->real[i] - b->real[i]) > 1e-5f || fabsf(a->imag[i] - b->imag[i]) > 1e-5f) {
+            fprintf(stderr, "%s: amplitude %zu differs.\n", what, i);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void test_bytecode() {
+    const char* source = "H 0\nT 1\nCNOT 0 2\nS 2\nY 1\nCNOT 2 1\nX 0\n";
+    TokenViewList views;
+    InstructionList instr_list;
+    init_token_view_list(&views);
+    init_instruction_list(&instr_list);
+    lex_buffer(source, strlen(source), &views);
+    parse_token_views(source, &views, &instr_list);
+
+    // "T 1 ... Y 1" fuses into one op (nothing touches qubit 1 in between) and
+    // "CNOT 0 2; S 2" into one 4x4 op, plus OP_HALT
+    BytecodeProgram program;
+    if (compile_bytecode(&instr_list, 0, &program) != 0 || program.num_qubits != 3 ||
+        program.size != instr_list.size - 1 || program.code[2].opcode != OP_GATE_2Q ||
+        program.code[program.size - 1].opcode != OP_HALT) {
+        fprintf(stderr, "test_bytecode: unexpected compiled program.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    StateVector expected, compiled;
+    init_state_vector(&expected, 3);
+    init_state_vector(&compiled, 3);
+    interpret_instructions(&instr_list, &expected);
+    if (execute_bytecode(&program, &compiled) != 0) {
+        fprintf(stderr, "test_bytecode: execution failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    expect_same_state(&expected, &compiled, "test_bytecode: compiled vs interpreted");
+    free_bytecode(&program);
+
+    // Operands are validated at compile time, before anything runs
+    if (compile_bytecode(&instr_list, 2, &program) == 0) {
+        fprintf(stderr, "test_bytecode: out-of-range qubit not rejected.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // A longer two-qubit stretch (both orientations, CPHASE, rotations) on qubits 3 and 4,
+    // so the vector kernel runs, interleaved with gates on other qubits
+    const char* pair_source = "H 3\nH 4\nH 0\nCNOT 3 4\nRY(0.3) 4\nCNOT 4 3\nX 1\nT 3\n"
+                              "CPHASE(0.7) 4 3\nH 4\nCNOT 0 4\nS 3\nMEASURE 0\n";
+    TokenViewList pair_views;
+    InstructionList pair_list;
+    init_token_view_list(&pair_views);
+    init_instruction_list(&pair_list);
+    lex_buffer(pair_source, strlen(pair_source), &pair_views);
+    parse_token_views(pair_source, &pair_views, &pair_list);
+    free_token_view_list(&pair_views);
+    StateVector pair_expected, pair_compiled;
+    init_state_vector(&pair_expected, 5);
+    init_state_vector(&pair_compiled, 5);
+    // Both runs measure qubit 0 with the same random draw
+    srand(7);
+    interpret_instructions(&pair_list, &pair_expected);
+    size_t blocks = 0;
+    if (compile_bytecode(&pair_list, 0, &program) != 0) {
+        fprintf(stderr, "test_bytecode: two-qubit program did not compile.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t k = 0; k < program.size; k++) blocks += (program.code[k].opcode == OP_GATE_2Q);
+    srand(7);
+    execute_bytecode(&program, &pair_compiled);
+    if (blocks != 1) {
+        fprintf(stderr, "test_bytecode: expected one 4x4 block, got %zu.\n", blocks);
+        exit(EXIT_FAILURE);
+    }
+    expect_same_state(&pair_expected, &pair_compiled, "test_bytecode: two-qubit block");
+    free_bytecode(&program);
+    free_state_vector(&pair_expected);
+    free_state_vector(&pair_compiled);
+    free_instruction_list(&pair_list);
+
+    // An unknown gate on the first line emits no op; the program must still start at code[0]
+    const char* unknown_source = "FOO 0\nH 0\n";
+    TokenViewList unknown_views;
+    InstructionList unknown_list;
+    init_token_view_list(&unknown_views);
+    init_instruction_list(&unknown_list);
+    lex_buffer(unknown_source, strlen(unknown_source), &unknown_views);
+    parse_token_views(unknown_source, &unknown_views, &unknown_list);
+    free_token_view_list(&unknown_views);
+    StateVector unknown_state;
+    init_state_vector(&unknown_state, 1);
+    if (compile_bytecode(&unknown_list, 0, &program) != 0 || program.size != 2 ||
+        program.code[1].opcode != OP_HALT || execute_bytecode(&program, &unknown_state) != 0 ||
+        fabsf(unknown_state.real[1] - 0.70710678f) > 1e-6f) {
+        fprintf(stderr, "test_bytecode: dropped first instruction corrupted the program.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_bytecode(&program);
+    free_state_vector(&unknown_state);
+    free_instruction_list(&unknown_list);
+
+    free_state_vector(&expected);
+    free_state_vector(&compiled);
+    free_instruction_list(&instr_list);
+    free_token_view_list(&views);
+}
+
+static void test_parameterized_gates() {
+    // "RX(theta / 2)" lexes as gate + parameter list, spaces and all
+    TokenList token_list;
+    init_token_list(&token_list);
+    lex_line("RX(theta / 2) 0", &token_list);
+    if (token_list.size != 3 || token_list.data[1].type != TOKEN_PARAMS ||
+        strcmp(token_list.data[1].text, "(theta / 2)") != 0) {
+        fprintf(stderr, "test_parameterized_gates: parameter list not lexed as one token.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_token_list(&token_list);
+
+    InstructionList sweep, fixed;
+    parse_string("H 0\nRX(theta) 0\nRY(-pi/2) 1\nU3(pi/2, phi, 0) 2\n"
+                 "CPHASE(2*theta) 0 2\nRZ(phi) 1\nCNOT 1 2\n", &sweep);
+    if (sweep.size != 7 || sweep.num_params != 2 || find_parameter(&sweep, "theta") != 0 ||
+        find_parameter(&sweep, "phi") != 1 || sweep.data[4].params[0] != 2.0f) {
+        fprintf(stderr, "test_parameterized_gates: unexpected parse of symbolic gates.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    BytecodeProgram program;
+    StateVector swept, reference;
+    init_state_vector(&swept, 3);
+    if (compile_bytecode(&sweep, 0, &program) != 0 || execute_bytecode(&program, &swept) == 0) {
+        fprintf(stderr, "test_parameterized_gates: unbound program should not run.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Each sweep point must match the same circuit written with literal angles
+    const double points[2][2] = { { 0.3, 1.1 }, { 0.7, 1.1 } };
+    for (int k = 0; k < 2; k++) {
+        char source[256];
+        snprintf(source, sizeof(source), "H 0\nRX(%.17g) 0\nRY(-pi/2) 1\nU3(pi/2, %.17g, 0) 2\n"
+                 "CPHASE(%.17g) 0 2\nRZ(%.17g) 1\nCNOT 1 2\n",
+                 points[k][0], points[k][1], 2.0 * points[k][0], points[k][1]);
+        parse_string(source, &fixed);
+        init_state_vector(&reference, 3);
+        interpret_instructions(&fixed, &reference);
+
+        free_state_vector(&swept);
+        init_state_vector(&swept, 3);
+        if (bind_bytecode_parameters(&program, points[k], 2) != 0 || execute_bytecode(&program, &swept) != 0) {
+            fprintf(stderr, "test_parameterized_gates: bind/execute failed.\n");
+            exit(EXIT_FAILURE);
+        }
+        expect_same_state(&reference, &swept, "test_parameterized_gates: sweep point");
+        free_state_vector(&reference);
+        free_instruction_list(&fixed);
+    }
+    free_bytecode(&program);
+    free_state_vector(&swept);
+    free_instruction_list(&sweep);
+
+    // RX(pi)|0> = -i|1>
+    parse_string("RX(pi) 0\n", &fixed);
+    init_state_vector(&reference, 1);
+    interpret_instructions(&fixed, &reference);
+    if (fabsf(reference.imag[1] + 1.0f) > 1e-6f || fabsf(reference.real[0]) > 1e-6f) {
+        fprintf(stderr, "test_parameterized_gates: RX(pi) gave the wrong state.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_state_vector(&reference);
+    free_instruction_list(&fixed);
+
+    // Fixed gates take no parameters; rotations need exactly their own count
+    const char* bad[] = { "H(0.5) 0\n", "RX 0\n", "U3(1, 2) 0\n", "RZ(theta/phi) 0\n" };
+    for (size_t b = 0; b < sizeof(bad) / sizeof(bad[0]); b++) {
+        TokenViewList views;
+        init_token_view_list(&views);
+        init_instruction_list(&fixed);
+        lex_buffer(bad[b], strlen(bad[b]), &views);
+        if (parse_token_views(bad[b], &views, &fixed) == 0) {
+            fprintf(stderr, "test_parameterized_gates: '%s' should not parse.\n", bad[b]);
+            exit(EXIT_FAILURE);
+        }
+        free_token_view_list(&views);
+        free_instruction_list(&fixed);
+    }
+}
+
+static void test_repeat_blocks() {
+    // A Trotter-style layer repeated 5 times, with a subcircuit and a nested loop
+    const char* looped =
+        "DEF layer {\n  RX(0.3) 0\n  RY(0.2) 1\n  CNOT 0 1\n  T 1\n  H 2\n}\n"
+        "REPEAT 5 {\n  layer\n  REPEAT 2 { S 2 CNOT 1 2 }\n  H 0\n}\n"
+        "REPEAT 0 { X 0 }\nlayer\n";
+    char unrolled[2048] = "";
+    const char* layer = "RX(0.3) 0\nRY(0.2) 1\nCNOT 0 1\nT 1\nH 2\n";
+    for (int k = 0; k < 5; k++) {
+        strcat(unrolled, layer);
+        strcat(unrolled, "S 2\nCNOT 1 2\nS 2\nCNOT 1 2\nH 0\n");
+    }
+    strcat(unrolled, layer);
+
+    InstructionList blocks, flat;
+    parse_string(looped, &blocks);
+    parse_string(unrolled, &flat);
+    if (blocks.size != 19 || blocks.data[0].type != INSTR_DEF || blocks.data[0].link != 6 ||
+        blocks.data[8].type != INSTR_CALL || blocks.data[8].link != 0 || blocks.data[7].repeat_count != 5) {
+        fprintf(stderr, "test_repeat_blocks: unexpected block structure (%zu instructions).\n", blocks.size);
+        exit(EXIT_FAILURE);
+    }
+
+    StateVector expected, looped_sv, compiled;
+    init_state_vector(&expected, 3);
+    init_state_vector(&looped_sv, 3);
+    init_state_vector(&compiled, 3);
+    interpret_instructions(&flat, &expected);
+    if (interpret_instructions(&blocks, &looped_sv) != 0) {
+        fprintf(stderr, "test_repeat_blocks: interpreter failed on blocks.\n");
+        exit(EXIT_FAILURE);
+    }
+    expect_same_state(&expected, &looped_sv, "test_repeat_blocks: interpreter");
+
+    // Bytecode stays proportional to the source, not to the trip counts
+    BytecodeProgram program;
+    if (compile_bytecode(&blocks, 0, &program) != 0 || program.size > blocks.size + 1 ||
+        program.max_depth != 2 || execute_bytecode(&program, &compiled) != 0) {
+        fprintf(stderr, "test_repeat_blocks: bytecode compile/execute failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    expect_same_state(&expected, &compiled, "test_repeat_blocks: bytecode");
+    free_bytecode(&program);
+
+    // Malformed blocks are parse errors
+    const char* bad[] = { "H 0\n}\n", "REPEAT 2 {\nH 0\n", "REPEAT x { H 0 }\n",
+                          "DEF a {\nDEF b { H 0 }\n}\n", "DEF H { X 0 }\n", "REPEAT 2 H 0\n" };
+    for (size_t b = 0; b < sizeof(bad) / sizeof(bad[0]); b++) {
+        TokenViewList views;
+        InstructionList list;
+        init_token_view_list(&views);
+        init_instruction_list(&list);
+        lex_buffer(bad[b], strlen(bad[b]), &views);
+        if (parse_token_views(bad[b], &views, &list) == 0) {
+            fprintf(stderr, "test_repeat_blocks: '%s' should not parse.\n", bad[b]);
+            exit(EXIT_FAILURE);
+        }
+        free_token_view_list(&views);
+        free_instruction_list(&list);
+    }
+
+    free_state_vector(&expected);
+    free_state_vector(&looped_sv);
+    free_state_vector(&compiled);
+    free_instruction_list(&blocks);
+    free_instruction_list(&flat);
+}
+
+static void test_classical_registers() {
+    // Teleport RY(0.8)|0> from qubit 0 to qubit 2 with in-engine feed-forward corrections
+    const char* source =
+        "CREG m0 1\nCREG m1 1\n"
+        "RY(0.8) 0\nH 1\nCNOT 1 2\nCNOT 0 1\nH 0\n"
+        "MEASURE 0 -> m0[0]\nMEASURE 1 -> m1[0]\n"
+        "IF m1==1 X 2\nIF m0 == 1 Z 2\n";
+    InstructionList program;
+    parse_string(source, &program);
+    if (program.size != 9 || program.num_cregs != 2 || find_classical_register(&program, "m1") != 1 ||
+        program.data[5].target_reg != 1 || program.data[7].cond_reg != 2 || program.data[7].cond_value != 1) {
+        fprintf(stderr, "test_classical_registers: unexpected parse.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    BytecodeProgram compiled;
+    if (compile_bytecode(&program, 0, &compiled) != 0 || compiled.num_cregs != 2) {
+        fprintf(stderr, "test_classical_registers: compile failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    srand(7);
+    for (int run = 0; run < 16; run++) {
+        StateVector sv;
+        uint32_t cregs[2] = { 0, 0 };
+        init_state_vector(&sv, 3);
+        int rc = (run % 2) ? execute_bytecode_classical(&compiled, &sv, cregs)
+                           : interpret_instructions_classical(&program, &sv, cregs);
+        if (rc != 0) {
+            fprintf(stderr, "test_classical_registers: run %d failed.\n", run);
+            exit(EXIT_FAILURE);
+        }
+        // Qubits 0 and 1 collapsed onto the recorded bits; qubit 2 holds the teleported state
+        double p1 = 0.0;
+        for (size_t i = 0; i < 8; i++) {
+            double p = (double)sv.real[i] * sv.real[i] + (double)sv.imag[i] * sv.imag[i];
+            if (p > 1e-6 && ((i & 1) != cregs[0] || ((i >> 1) & 1) != cregs[1])) {
+                fprintf(stderr, "test_classical_registers: registers disagree with the state.\n");
+                exit(EXIT_FAILURE);
+            }
+            if (i & 4) p1 += p;
+        }
+        if (fabs(p1 - sin(0.4) * sin(0.4)) > 1e-5) {
+            fprintf(stderr, "test_classical_registers: teleported state is wrong (p1 = %f).\n", p1);
+            exit(EXIT_FAILURE);
+        }
+        free_state_vector(&sv);
+    }
+    free_bytecode(&compiled);
+    free_instruction_list(&program);
+
+    const char* bad[] = { "IF c==1 X 0\n", "CREG c 0\n", "CREG c 2\nIF c==4 X 0\n",
+                          "CREG c 1\nMEASURE 0 -> c[1]\n", "CREG c 1\nX 0\nIF c==1\n",
+                          "CREG c 1\nIF c==1 REPEAT 2 { X 0 }\n", "CREG c 1\nCREG c 2\n" };
+    for (size_t b = 0; b < sizeof(bad) / sizeof(bad[0]); b++) {
+        TokenViewList views;
+        InstructionList list;
+        init_token_view_list(&views);
+        init_instruction_list(&list);
+        lex_buffer(bad[b], strlen(bad[b]), &views);
+        if (parse_token_views(bad[b], &views, &list) == 0) {
+            fprintf(stderr, "test_classical_registers: '%s' should not parse.\n", bad[b]);
+            exit(EXIT_FAILURE);
+        }
+        free_token_view_list(&views);
+        free_instruction_list(&list);
+    }
+}
+
+static void expect_same_program(const InstructionList* a, const InstructionList* b, const char* what) {
+    int same = a->size == b->size && a->num_params == b->num_params;
+    for (size_t p = 0; same && p < a->num_params; p++) {
+        same = strcmp(a->param_names[p], b->param_names[p]) == 0;
+    }
+    for (size_t i = 0; same && i < a->size; i++) {
+        const Instruction* x = &a->data[i];
+        const Instruction* y = &b->data[i];
+        same = x->type == y->type && strcmp(x->gate_name, y->gate_name) == 0 &&
+               x->qubit_count == y->qubit_count && x->qubits[0] == y->qubits[0] &&
+               x->qubits[1] == y->qubits[1] && x->param_count == y->param_count &&
+               memcmp(x->params, y->params, sizeof(x->params)) == 0 &&
+               memcmp(x->param_ids, y->param_ids, sizeof(x->param_ids)) == 0 && x->link == y->link;
+    }
+    if (!same) {
+        fprintf(stderr, "%s: parallel and sequential parses differ.\n", what);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void test_parallel_frontend() {
+    // ~200 KB of generated circuit, parameters first used in different chunks
+    size_t cap = 1 << 18, len = 0;
+    char* source = (char*)malloc(cap);
+    for (int i = 0; i < 8000; i++) {
+        len += (size_t)snprintf(source + len, cap - len, "H %d\nRZ(a%d * 2) %d\nCNOT %d %d\n",
+                                i % 5, (i * 7) % 40, i % 5, i % 5, (i + 1) % 5);
+    }
+
+    FrontendOptions options = { 4, 4096 };
+    FrontendStats stats;
+    InstructionList sequential, parallel;
+    parse_string(source, &sequential);
+    init_instruction_list(&parallel);
+    if (parse_buffer_parallel(source, len, &parallel, &options, &stats) != 0 || stats.chunks != 4 ||
+        stats.sequential_parse) {
+        fprintf(stderr, "test_parallel_frontend: parallel parse failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    expect_same_program(&sequential, &parallel, "test_parallel_frontend");
+    free_instruction_list(&parallel);
+    free_instruction_list(&sequential);
+
+    // A block spanning chunks falls back to a single-threaded parse of the lexed chunks
+    len = (size_t)snprintf(source, cap, "REPEAT 3 {\n");
+    for (int i = 0; i < 2000; i++) len += (size_t)snprintf(source + len, cap - len, "X %d\n", i % 3);
+    len += (size_t)snprintf(source + len, cap - len, "}\nH 0\n");
+    parse_string(source, &sequential);
+    init_instruction_list(&parallel);
+    if (parse_buffer_parallel(source, len, &parallel, &options, &stats) != 0 || !stats.sequential_parse) {
+        fprintf(stderr, "test_parallel_frontend: block program not parsed sequentially.\n");
+        exit(EXIT_FAILURE);
+    }
+    expect_same_program(&sequential, &parallel, "test_parallel_frontend (blocks)");
+    free_instruction_list(&parallel);
+    free_instruction_list(&sequential);
+
+    // Errors report global line numbers, whichever chunk they are in
+    len = 0;
+    for (int i = 0; i < 3000; i++) len += (size_t)snprintf(source + len, cap - len, "X 0\n");
+    len += (size_t)snprintf(source + len, cap - len, "CNOT 0\n");
+    char captured[256] = "";
+    FILE* sink = tmpfile();
+    fflush(stderr);
+    int saved = dup(fileno(stderr));
+    dup2(fileno(sink), fileno(stderr));
+    init_instruction_list(&parallel);
+    int rc = parse_buffer_parallel(source, len, &parallel, &options, &stats);
+    fflush(stderr);
+    dup2(saved, fileno(stderr));
+    close(saved);
+    rewind(sink);
+    size_t got = fread(captured, 1, sizeof(captured) - 1, sink);
+    captured[got] = '\0';
+    fclose(sink);
+    if (rc == 0 || strstr(captured, "(line 3001)") == NULL) {
+        fprintf(stderr, "test_parallel_frontend: wrong error location: %s\n", captured);
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&parallel);
+
+    // With errors in two chunks only the first is reported, as the sequential parser would
+    len = 0;
+    for (int i = 0; i < 3000; i++) {
+        len += (size_t)snprintf(source + len, cap - len, (i == 1000 || i == 2500) ? "CNOT 0\n" : "X 0\n");
+    }
+    sink = tmpfile();
+    fflush(stderr);
+    saved = dup(fileno(stderr));
+    dup2(fileno(sink), fileno(stderr));
+    init_instruction_list(&parallel);
+    rc = parse_buffer_parallel(source, len, &parallel, &options, &stats);
+    fflush(stderr);
+    dup2(saved, fileno(stderr));
+    close(saved);
+    rewind(sink);
+    got = fread(captured, 1, sizeof(captured) - 1, sink);
+    captured[got] = '\0';
+    fclose(sink);
+    if (rc == 0 || stats.chunks < 2 || strstr(captured, "(line 1001)") == NULL ||
+        strstr(captured, "(line 2501)") != NULL) {
+        fprintf(stderr, "test_parallel_frontend: unexpected diagnostics: %s\n", captured);
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&parallel);
+    free(source);
+}
+
+static void test_noise_statements() {
+    InstructionList program;
+    parse_string("H 0\nDEPOLARIZE(0.1) 0\nCNOT 0 1\nDAMP(pi/4) 1\nREADOUT(0.02) 0\n", &program);
+    if (program.size != 5 || program.data[1].type != INSTR_NOISE || program.data[3].type != INSTR_NOISE ||
+        program.data[4].qubits[0] != 0 || fabsf(program.data[3].params[0] - 0.78539816f) > 1e-6f ||
+        fabsf(program.data[4].params[0] - 0.02f) > 1e-6f) {
+        fprintf(stderr, "test_noise_statements: unexpected parse.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Ideal runs skip the channels, interpreted or compiled
+    InstructionList ideal;
+    parse_string("H 0\nCNOT 0 1\n", &ideal);
+    StateVector a, b, c;
+    init_state_vector(&a, 2);
+    init_state_vector(&b, 2);
+    init_state_vector(&c, 2);
+    BytecodeProgram compiled;
+    if (interpret_instructions(&program, &a) != 0 || interpret_instructions(&ideal, &b) != 0 ||
+        compile_bytecode(&program, 0, &compiled) != 0 || execute_bytecode(&compiled, &c) != 0) {
+        fprintf(stderr, "test_noise_statements: ideal run failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    expect_same_state(&a, &b, "noise skipped by the interpreter");
+    expect_same_state(&c, &b, "noise skipped by the bytecode");
+    free_bytecode(&compiled);
+    free_state_vector(&a);
+    free_state_vector(&b);
+    free_state_vector(&c);
+    free_instruction_list(&ideal);
+    free_instruction_list(&program);
+
+    // A trajectory samples them: DAMP(1) always decays and READOUT(1) always flips, also
+    // for outcomes stored in a register
+    parse_string("CREG c 1\nX 0\nDAMP(1) 0\nX 1\nREADOUT(1) 1\nMEASURE 0\nMEASURE 1 -> c[0]\n"
+                 "IF c==0 X 2\nMEASURE 2\n", &program);
+    StateVector sv;
+    RandomStream rng;
+    float readout[3];
+    int8_t outcomes[3];
+    init_state_vector(&sv, 3);
+    seed_random_stream(&rng, 1, 0);
+    TrajectoryState trajectory = { &sv, &rng, readout, outcomes };
+    if (interpret_instructions_trajectory(&program, &trajectory) != 0 ||
+        outcomes[0] != 0 || outcomes[1] != 0 || outcomes[2] != 1) {
+        fprintf(stderr, "test_noise_statements: trajectory outcomes %d %d %d, expected 0 0 1.\n",
+                outcomes[0], outcomes[1], outcomes[2]);
+        exit(EXIT_FAILURE);
+    }
+    free_state_vector(&sv);
+    free_instruction_list(&program);
+
+    const char* bad[] = { "DEPOLARIZE(theta) 0\n", "DAMP(1.5) 0\n", "READOUT 0\n", "DAMP(0.1)\n" };
+    for (size_t k = 0; k < sizeof(bad) / sizeof(bad[0]); k++) {
+        TokenViewList views;
+        InstructionList list;
+        init_token_view_list(&views);
+        init_instruction_list(&list);
+        lex_buffer(bad[k], strlen(bad[k]), &views);
+        if (parse_token_views(bad[k], &views, &list) == 0) {
+            fprintf(stderr, "test_noise_statements: '%s' should not parse.\n", bad[k]);
+            exit(EXIT_FAILURE);
+        }
+        free_token_view_list(&views);
+        free_instruction_list(&list);
+    }
+}
+
 int main(void) {
     printf("Running test_assembly...\n");
     test_lexer();
+    test_buffer_lexer();
     test_parser();
     test_interpreter();
+    test_interpreter_sparse_promotion();
+    test_streaming_interpreter();
+    test_bytecode();
+    test_parameterized_gates();
+    test_repeat_blocks();
+    test_classical_registers();
+    test_parallel_frontend();
+    test_noise_statements();
     printf("All test_assembly tests passed!\n");
     return 0;
 }
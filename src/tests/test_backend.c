@@ -2,15 +2,27 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <unistd.h>
+#include <pthread.h>
 
 // Include backend headers
 #include "../backend/circuit_optimizer.h"
 #include "../backend/parallel_execution.h"
 #include "../backend/memory_management.h"
+#include "../backend/memory_planner.h"
+#include "../backend/simulator.h"
+#include "../backend/circuit_cache.h"
+#include "../backend/cost_model.h"
+#include "../backend/circuit_partition.h"
+#include "../backend/noise_trajectories.h"
+#include "../backend/tensor_network.h"
+#include "../backend/engine_selector.h"
 
 // Include assembly for InstructionList
 #include "../assembly/parser.h"
 #include "../assembly/lexer.h"
+#include "../assembly/interpreter.h"
+#include "../assembly/bytecode.h"
 
 // Include core for state vector ops
 #include "../core/state_vector.h"
@@ -65,6 +77,435 @@ static void test_circuit_optimizer() {
     free_instruction_list(&instr_list);
 }
 
+/**
+ * \brief Optimized circuits may differ by a global phase: compare after removing it.
+ */
+static void expect_same_state_up_to_phase(const StateVector* a, const StateVector* b, const char* what) {
+    size_t length = (size_t)1 << a->num_qubits;
+    size_t ref = 0;
+    for (size_t i = 1; i < length; i++) {
+        if (fabsf(a->real[i]) + fabsf(a->imag[i]) > fabsf(a->real[ref]) + fabsf(a->imag[ref])) ref = i;
+    }
+    // phase = b[ref] / a[ref], of unit modulus for equivalent states
+    float norm = a->real[ref] * a->real[ref] + a->imag[ref] * a->imag[ref];
+    float pr = (b->real[ref] * a->real[ref] + b->imag[ref] * a->imag[ref]) / norm;
+    float pi = (b->imag[ref] * a->real[ref] - b->real[ref] * a->imag[ref]) / norm;
+    for (size_t i = 0; i < length; i++) {
+        float re = a->real[i] * pr - a->imag[i] * pi;
+        float im = a->real[i] * pi + a->imag[i] * pr;
+        if (fabsf(re - b->real[i]) > 1e-5f || fabsf(im - b->imag[i]) > 1e-5f) {
+            fprintf(stderr, "%s: amplitude %zu differs.\n", what, i);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static size_t optimize_source(const char* source, InstructionList* instr_list, OptimizerStats* stats) {
+    TokenViewList views;
+    init_token_view_list(&views);
+    init_instruction_list(instr_list);
+    lex_buffer(source, strlen(source), &views);
+    parse_token_views(source, &views, instr_list);
+    free_token_view_list(&views);
+    optimize_circuit_with_stats(instr_list, stats);
+    return instr_list->size;
+}
+
+static void test_optimizer_commutation() {
+    struct { const char* source; size_t expected; } cases[] = {
+        { "X 0\nH 1\nX 0\n", 1 },                 // other qubits do not block
+        { "Z 0\nCNOT 0 1\nZ 0\n", 1 },            // Z passes a CNOT control
+        { "X 1\nCNOT 0 1\nX 1\n", 1 },            // X passes a CNOT target
+        { "Z 1\nCNOT 0 1\nZ 1\n", 3 },            // ...but Z does not
+        { "CNOT 0 1\nT 0\nX 1\nCNOT 0 1\n", 2 },  // CNOT pair around commuting gates
+        { "RZ(0.5) 0\nRZ(0.25) 0\n", 1 },
+        { "RX(theta) 0\nRX(theta) 0\n", 1 },
+        { "RX(theta) 0\nRX(phi) 0\n", 2 },
+        { "CREG c 1\nMEASURE 1 -> c[0]\nIF c==1 X 0\nX 0\n", 3 }, // guarded gates stay
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        InstructionList instr_list;
+        size_t size = optimize_source(cases[i].source, &instr_list, NULL);
+        if (size != cases[i].expected) {
+            fprintf(stderr, "test_optimizer_commutation: case %zu left %zu gates, expected %zu.\n",
+                    i, size, cases[i].expected);
+            exit(EXIT_FAILURE);
+        }
+        free_instruction_list(&instr_list);
+    }
+
+    // Phase folding turns T T into S (H H gives the wire a fresh variable, so S 0 stays apart);
+    // the first pass then cancels H H and merges S S into Z, the second confirms the fixpoint
+    InstructionList instr_list;
+    OptimizerStats stats;
+    if (optimize_source("S 0\nH 0\nH 0\nT 0\nT 0\n", &instr_list, &stats) != 1 || stats.gates_before != 5 ||
+        stats.folded_phases != 1 || stats.gates_after != 1 || stats.passes != 2 || stats.pass_gates[0] != 1 ||
+        strcmp(instr_list.data[0].gate_name, "Z") != 0) {
+        fprintf(stderr, "test_optimizer_commutation: S H H T T not reduced to Z (%zu passes).\n", stats.passes);
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+
+    // The optimized circuit prepares the same state
+    const char* source = "H 0\nH 1\nH 2\nT 0\nCNOT 0 1\nT 0\nRX(0.3) 2\nCNOT 2 1\n"
+                         "RX(0.4) 2\nS 1\nCPHASE(0.5) 0 2\nZ 0\nCPHASE(0.25) 2 0\nS 1\n";
+    TokenViewList views;
+    InstructionList original;
+    init_token_view_list(&views);
+    init_instruction_list(&original);
+    lex_buffer(source, strlen(source), &views);
+    parse_token_views(source, &views, &original);
+    free_token_view_list(&views);
+    optimize_source(source, &instr_list, &stats);
+    if (stats.gates_after >= stats.gates_before) {
+        fprintf(stderr, "test_optimizer_commutation: nothing was merged.\n");
+        exit(EXIT_FAILURE);
+    }
+    StateVector expected, optimized;
+    init_state_vector(&expected, 3);
+    init_state_vector(&optimized, 3);
+    interpret_instructions(&original, &expected);
+    interpret_instructions(&instr_list, &optimized);
+    expect_same_state_up_to_phase(&expected, &optimized, "test_optimizer_commutation");
+    free_state_vector(&expected);
+    free_state_vector(&optimized);
+    free_instruction_list(&original);
+    free_instruction_list(&instr_list);
+}
+
+static void test_gate_fusion() {
+    // "H T H S" on qubit 0 and "H RY" on qubit 1 become one matrix each; the CNOT splits the runs
+    const char* source = "H 0\nH 1\nT 0\nH 0\nS 0\nCNOT 0 1\nH 1\nRY(0.7) 1\nX 0\n";
+    InstructionList original, fused;
+    TokenViewList views;
+    init_token_view_list(&views);
+    init_instruction_list(&original);
+    lex_buffer(source, strlen(source), &views);
+    parse_token_views(source, &views, &original);
+    free_token_view_list(&views);
+
+    OptimizerStats stats;
+    optimize_source(source, &fused, &stats);
+    if (fused.size != 5 || !fused.data[0].has_matrix || strcmp(fused.data[0].gate_name, "FUSED") != 0 ||
+        stats.fused_gates != 4) {
+        fprintf(stderr, "test_gate_fusion: expected FUSED 0, H 1, CNOT, FUSED 1, X 0 (got %zu gates).\n",
+                fused.size);
+        exit(EXIT_FAILURE);
+    }
+    StateVector expected, actual, compiled;
+    init_state_vector(&expected, 2);
+    init_state_vector(&actual, 2);
+    interpret_instructions(&original, &expected);
+    interpret_instructions(&fused, &actual);
+    for (size_t i = 0; i < 4; i++) {
+        if (fabsf(expected.real[i] - actual.real[i]) > 1e-5f || fabsf(expected.imag[i] - actual.imag[i]) > 1e-5f) {
+            fprintf(stderr, "test_gate_fusion: amplitude %zu differs.\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // The compiled form copies the matrices, so it outlives the list
+    BytecodeProgram program;
+    init_state_vector(&compiled, 2);
+    if (compile_bytecode(&fused, 0, &program) != 0) {
+        fprintf(stderr, "test_gate_fusion: fused list does not compile.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&fused);
+    execute_bytecode(&program, &compiled);
+    for (size_t i = 0; i < 4; i++) {
+        if (fabsf(expected.real[i] - compiled.real[i]) > 1e-5f || fabsf(expected.imag[i] - compiled.imag[i]) > 1e-5f) {
+            fprintf(stderr, "test_gate_fusion: compiled amplitude %zu differs.\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    free_bytecode(&program);
+    free_state_vector(&expected);
+    free_state_vector(&actual);
+    free_state_vector(&compiled);
+    free_instruction_list(&original);
+
+    // H X H = Z, so "H X H Z" is the identity and disappears entirely
+    if (optimize_source("H 0\nX 0\nH 0\nZ 0\n", &fused, &stats) != 0 || stats.fused_gates != 4) {
+        fprintf(stderr, "test_gate_fusion: identity run not removed.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&fused);
+
+    // Symbolic angles are rebound later, so they end a run instead of joining it
+    optimize_source("H 0\nRZ(theta) 0\nH 0\n", &fused, &stats);
+    if (fused.size != 3 || stats.fused_gates != 0) {
+        fprintf(stderr, "test_gate_fusion: symbolic gate was fused.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&fused);
+}
+
+static void test_phase_folding() {
+    struct { const char* source; size_t folded; size_t expected; } cases[] = {
+        // T on x0^x1 twice, with a CNOT pair between them: one S, and the CNOT pair cancels
+        { "H 0\nH 1\nCNOT 0 1\nT 1\nCNOT 0 1\nCNOT 0 1\nT 1\n", 1, 4 },
+        // The second T finds x0^x1 on the other wire
+        { "H 0\nH 1\nCNOT 0 1\nT 1\nCNOT 0 1\nCNOT 1 0\nT 0\n", 1, 6 },
+        // T on x, then T on x^1: the phases cancel up to a global phase
+        { "H 0\nT 0\nX 0\nT 0\n", 2, 1 },
+        // T S Z T on x0 (the CNOT pair restores it) sum to a full turn
+        { "H 0\nT 0\nS 0\nRZ(0.5) 1\nZ 0\nCNOT 1 0\nCNOT 1 0\nT 0\nH 1\n", 4, 2 },
+        // H starts a fresh variable (the run still fuses) and a loop body is kept apart
+        { "H 0\nT 0\nH 0\nT 0\n", 0, 1 },
+        { "H 0\nT 0\nREPEAT 2 {\nT 0\n}\nT 0\n", 0, 5 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        InstructionList original, folded;
+        TokenViewList views;
+        init_token_view_list(&views);
+        init_instruction_list(&original);
+        lex_buffer(cases[i].source, strlen(cases[i].source), &views);
+        parse_token_views(cases[i].source, &views, &original);
+        free_token_view_list(&views);
+
+        OptimizerStats stats;
+        size_t size = optimize_source(cases[i].source, &folded, &stats);
+        if (stats.folded_phases != cases[i].folded || size != cases[i].expected) {
+            fprintf(stderr, "test_phase_folding: case %zu folded %zu and left %zu, expected %zu and %zu.\n",
+                    i, stats.folded_phases, size, cases[i].folded, cases[i].expected);
+            exit(EXIT_FAILURE);
+        }
+        StateVector expected, actual;
+        init_state_vector(&expected, 2);
+        init_state_vector(&actual, 2);
+        interpret_instructions(&original, &expected);
+        interpret_instructions(&folded, &actual);
+        expect_same_state_up_to_phase(&expected, &actual, "test_phase_folding");
+        free_state_vector(&expected);
+        free_state_vector(&actual);
+        free_instruction_list(&original);
+        free_instruction_list(&folded);
+    }
+}
+
+static void parse_source(const char* source, InstructionList* instr_list) {
+    TokenViewList views;
+    init_token_view_list(&views);
+    init_instruction_list(instr_list);
+    lex_buffer(source, strlen(source), &views);
+    parse_token_views(source, &views, instr_list);
+    free_token_view_list(&views);
+}
+
+static void test_dead_gates() {
+    // T and S only rephase qubit 1 before it is measured; the final state keeps up to a phase
+    const char* source = "H 0\nCNOT 0 1\nT 1\nS 1\nMEASURE 1\nH 0\n";
+    InstructionList original, pruned;
+    DeadGateStats dead;
+    parse_source(source, &original);
+    parse_source(source, &pruned);
+    if (eliminate_dead_gates(&pruned, 0, &dead) != 0 || pruned.size != 4 || dead.diagonal != 2 ||
+        dead.flips + dead.unmeasured != 0 || fabs(dead.sweeps_saved - 2.0) > 1e-9) {
+        fprintf(stderr, "test_dead_gates: expected T and S before MEASURE to go (got %zu gates).\n",
+                pruned.size);
+        exit(EXIT_FAILURE);
+    }
+    StateVector expected, actual;
+    init_state_vector(&expected, 2);
+    init_state_vector(&actual, 2);
+    srand(11);
+    interpret_instructions(&original, &expected);
+    srand(11);
+    interpret_instructions(&pruned, &actual);
+    expect_same_state_up_to_phase(&expected, &actual, "test_dead_gates");
+    free_state_vector(&expected);
+    free_state_vector(&actual);
+    free_instruction_list(&original);
+    free_instruction_list(&pruned);
+
+    // Gates under an IF stay, even a diagonal one right before a measurement
+    parse_source("CREG c 1\nH 0\nMEASURE 0 -> c[0]\nIF c==1 Z 1\nIF c==1 T 2\nMEASURE 1\n", &pruned);
+    if (eliminate_dead_gates(&pruned, 1, &dead) != 0 || pruned.size != 5 || dead.diagonal + dead.unmeasured != 0) {
+        fprintf(stderr, "test_dead_gates: a gate under an IF was removed (got %zu gates).\n", pruned.size);
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&pruned);
+
+    // Measured-only: nothing after the last MEASURE matters, and the X becomes a readout flip
+    parse_source("H 0\nH 1\nCNOT 0 1\nH 2\nX 1\nMEASURE 1\nH 0\nT 2\n", &pruned);
+    if (eliminate_dead_gates(&pruned, 1, &dead) != 0 || pruned.size != 4 || dead.flips != 1 ||
+        dead.unmeasured != 3 || !pruned.data[3].invert_result || fabs(dead.sweeps_saved - 4.0) > 1e-9) {
+        fprintf(stderr, "test_dead_gates: expected H 0, H 1, CNOT 0 1, inverted MEASURE 1 (got %zu gates).\n",
+                pruned.size);
+        exit(EXIT_FAILURE);
+    }
+    BytecodeProgram program;
+    if (compile_bytecode(&pruned, 0, &program) != 0 || program.code[program.size - 2].opcode != OP_MEASURE ||
+        program.code[program.size - 2].flip != 1) {
+        fprintf(stderr, "test_dead_gates: the readout flip is lost in bytecode.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_bytecode(&program);
+    free_instruction_list(&pruned);
+
+    // Without measurements the final state is the output; blocks are barriers
+    parse_source("H 0\nT 0\n", &pruned);
+    eliminate_dead_gates(&pruned, 1, &dead);
+    if (pruned.size != 2) {
+        fprintf(stderr, "test_dead_gates: an unmeasured circuit must be kept.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&pruned);
+    parse_source("H 0\nMEASURE 0\nREPEAT 2 {\nH 1\n}\nH 2\n", &pruned);
+    if (eliminate_dead_gates(&pruned, 1, &dead) != 0 || dead.unmeasured != 1 || pruned.size != 5 ||
+        pruned.data[2].link != 4) {
+        fprintf(stderr, "test_dead_gates: expected only the trailing H 2 to go.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&pruned);
+
+    // optimize_circuit drops the phase-only case on its own
+    OptimizerStats stats;
+    if (optimize_source("H 0\nZ 0\nMEASURE 0\n", &pruned, &stats) != 2 || stats.dead_gates != 1) {
+        fprintf(stderr, "test_dead_gates: optimizer kept Z before MEASURE.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&pruned);
+}
+
+static void test_light_cone() {
+    // Only qubit 3 is measured; it depends on qubit 5 through the CNOT and on nothing else
+    const char* source = "H 0\nH 5\nCNOT 5 3\nH 7\nT 7\nMEASURE 3\nH 2\n";
+    InstructionList instr_list;
+    LightConeStats cone;
+    size_t map[8];
+    parse_source(source, &instr_list);
+    if (reduce_to_light_cone(&instr_list, map, &cone) != 0 || cone.qubits_before != 8 ||
+        cone.qubits_after != 2 || instr_list.size != 3 || cone.dead.unmeasured != 4 ||
+        map[3] != 0 || map[5] != 1 || map[0] != SIZE_MAX || map[7] != SIZE_MAX) {
+        fprintf(stderr, "test_light_cone: expected qubits 3 and 5 only (got %zu qubits, %zu gates).\n",
+                cone.qubits_after, instr_list.size);
+        exit(EXIT_FAILURE);
+    }
+    const Instruction* cnot = &instr_list.data[1];
+    const Instruction* measure = &instr_list.data[2];
+    if (instr_list.data[0].qubits[0] != 1 || cnot->qubits[0] != 1 || cnot->qubits[1] != 0 ||
+        measure->qubits[0] != 0 || measure->source_qubit != 3) {
+        fprintf(stderr, "test_light_cone: qubits were not renumbered.\n");
+        exit(EXIT_FAILURE);
+    }
+    BytecodeProgram program;
+    if (compile_bytecode(&instr_list, 0, &program) != 0 || program.num_qubits != 2 ||
+        program.code[2].opcode != OP_MEASURE || program.code[2].q1 != 3) {
+        fprintf(stderr, "test_light_cone: reduced circuit does not compile to 2 qubits.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_bytecode(&program);
+    free_instruction_list(&instr_list);
+
+    // simulate_file sizes the run for the reduced register
+    char path[] = "/tmp/qasm_cone_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, source, strlen(source)) != (ssize_t)strlen(source)) {
+        fprintf(stderr, "test_light_cone: cannot write a temporary circuit.\n");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    SimulationOptions options;
+    SimulationSummary summary;
+    init_simulation_options(&options);
+    options.measured_only = 1;
+    if (simulate_file(path, &options, &summary) != 0 || summary.plan.num_qubits != 2) {
+        fprintf(stderr, "test_light_cone: simulate_file ran %zu qubits.\n", summary.plan.num_qubits);
+        exit(EXIT_FAILURE);
+    }
+    remove(path);
+}
+
+static void test_circuit_partition() {
+    // {0, 2} share a CNOT, {1, 3} share a register read by IF, 5 is alone and 4 is idle
+    InstructionList instr_list, part1;
+    parse_source("H 0\nCNOT 0 2\nH 1\nCREG c 1\nMEASURE 1 -> c[0]\nIF c==1 X 3\nH 5\n", &instr_list);
+    CircuitPartition part;
+    if (partition_circuit(&instr_list, 0, &part) != 0 || part.num_components != 3 ||
+        part.component_of[0] != 0 || part.component_of[2] != 0 || part.component_of[1] != 1 ||
+        part.component_of[3] != 1 || part.component_of[5] != 2 || part.component_of[4] != SIZE_MAX ||
+        part.local_index[2] != 1 || part.local_index[3] != 1 || part.component_qubits[2] != 1) {
+        fprintf(stderr, "test_circuit_partition: unexpected components (%zu).\n", part.num_components);
+        exit(EXIT_FAILURE);
+    }
+    if (extract_component(&instr_list, &part, 1, &part1) != 0 || part1.size != 3 || part1.num_cregs != 1 ||
+        part1.data[0].qubits[0] != 0 || part1.data[1].source_qubit != 1 || part1.data[2].qubits[0] != 1 ||
+        part1.data[2].cond_reg != 1 || instruction_list_num_qubits(&part1) != 2) {
+        fprintf(stderr, "test_circuit_partition: component 1 was not extracted (%zu instructions).\n", part1.size);
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&part1);
+    free_circuit_partition(&part);
+    free_instruction_list(&instr_list);
+
+    // Two entangled 20-qubit halves: 2 x 2^20 amplitudes fit a budget 2^40 never would. The
+    // T gates keep them off the stabilizer engine
+    char* source = (char*)malloc(4096);
+    size_t len = 0;
+    for (int half = 0; half < 2; half++) {
+        len += (size_t)sprintf(source + len, "H %d\nT %d\n", 20 * half, 20 * half); // T: not Clifford
+        for (int q = 1; q < 20; q++) len += (size_t)sprintf(source + len, "CNOT %d %d\n", 20 * half + q - 1, 20 * half + q);
+        len += (size_t)sprintf(source + len, "MEASURE %d\n", 20 * half + 19);
+    }
+    parse_source(source, &instr_list);
+    free(source);
+    SimulationOptions options;
+    SimulationSummary summary;
+    init_simulation_options(&options);
+    options.engine = ENGINE_DENSE;
+    options.memory_budget = (size_t)64 << 20;
+    options.allow_engine_fallback = 0;
+    if (simulate_circuit(&instr_list, &options, &summary) != 0 || summary.components != 2 ||
+        summary.largest_component != 20 || summary.engine_used != ENGINE_DENSE ||
+        summary.plan.peak_bytes > options.memory_budget || summary.predicted.gates != 42) {
+        fprintf(stderr, "test_circuit_partition: split run failed (%zu components).\n", summary.components);
+        exit(EXIT_FAILURE);
+    }
+    options.disable_splitting = 1;
+    if (simulate_circuit(&instr_list, &options, &summary) != -2) {
+        fprintf(stderr, "test_circuit_partition: the unsplit run should not fit.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+
+    // Split runs print outcomes in program order, through loops and IF-skipped measurements
+    const char* ordered = "X 1\nMEASURE 1\nMEASURE 0\nCREG c 1\nREPEAT 2 {\nMEASURE 1\nX 2\n"
+                          "MEASURE 2 -> c[0]\nIF c==1 MEASURE 2\n}\n";
+    const char* expected = "Measurement of qubit 1 => 1\nMeasurement of qubit 0 => 0\n"
+                           "Measurement of qubit 1 => 1\nMeasurement of qubit 2 => 1\n"
+                           "Measurement of qubit 1 => 1\n";
+    EngineKind engines[] = { ENGINE_DENSE, ENGINE_SPARSE };
+    parse_source(ordered, &instr_list);
+    for (size_t e = 0; e < 2; e++) {
+        for (int split = 0; split < 2; split++) {
+            init_simulation_options(&options);
+            options.engine = engines[e];
+            options.disable_splitting = !split;
+            char captured[512] = "";
+            FILE* sink = tmpfile();
+            fflush(stdout);
+            int saved = dup(fileno(stdout));
+            dup2(fileno(sink), fileno(stdout));
+            int rc = simulate_circuit(&instr_list, &options, &summary);
+            fflush(stdout);
+            dup2(saved, fileno(stdout));
+            close(saved);
+            rewind(sink);
+            size_t got = fread(captured, 1, sizeof(captured) - 1, sink);
+            captured[got] = '\0';
+            fclose(sink);
+            if (rc != 0 || summary.components != (split ? 3u : 1u) || strcmp(captured, expected) != 0) {
+                fprintf(stderr, "test_circuit_partition: %s %s run printed:\n%s", engine_name(engines[e]),
+                        split ? "split" : "unsplit", captured);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    free_instruction_list(&instr_list);
+}
+
 static void test_parallel_execution() {
     // We'll apply a single-qubit gate in parallel and compare results 
     // to a single-threaded approach.
@@ -100,6 +541,52 @@ static void test_parallel_execution() {
     free_state_vector(&sv_single);
 }
 
+static void test_parallel_pauli_expectation() {
+    // 18 qubits: each group's pass spans several chunks, so four threads share it
+    StateVector sv;
+    init_state_vector(&sv, 18);
+    size_t dim = (size_t)1 << sv.num_qubits;
+    double norm = 0.0;
+    for (size_t i = 0; i < dim; i++) {
+        sv.real[i] = (float)cos(0.37 * (double)i) + 0.1f;
+        sv.imag[i] = (float)sin(0.11 * (double)(i ^ (i >> 5)));
+        norm += (double)sv.real[i] * sv.real[i] + (double)sv.imag[i] * sv.imag[i];
+    }
+    float scale = (float)(1.0 / sqrt(norm));
+    for (size_t i = 0; i < dim; i++) {
+        sv.real[i] *= scale;
+        sv.imag[i] *= scale;
+    }
+
+    PauliSum sum;
+    init_pauli_sum(&sum);
+    add_pauli_term(&sum, 0.5, "Z0 Z17");
+    add_pauli_term(&sum, -1.0, "X3 X4");
+    add_pauli_term(&sum, 2.0, "Y9 Y10 Z12");
+    add_pauli_term(&sum, 0.25, "X0 X1 X2 X3 X4 X5 X6 X7 X8 X9 X10 Y17");
+    add_pauli_term(&sum, 1.5, "I");
+
+    double serial = 0.0, parallel = 0.0;
+    double serial_terms[5], parallel_terms[5];
+    if (pauli_sum_expectation(&sv, &sum, &serial, serial_terms) != 0 ||
+        parallel_pauli_sum_expectation(&sv, &sum, 4, &parallel, parallel_terms) != 0) {
+        fprintf(stderr, "Pauli expectation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t t = 0; t < sum.size; t++) {
+        if (fabs(serial_terms[t] - parallel_terms[t]) > 1e-6) {
+            fprintf(stderr, "Parallel <P_%zu> = %f, serial %f.\n", t, parallel_terms[t], serial_terms[t]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (fabs(serial - parallel) > 1e-5 || fabs(parallel_terms[4] - 1.0) > 1e-5) {
+        fprintf(stderr, "Parallel Pauli sum %f, serial %f.\n", parallel, serial);
+        exit(EXIT_FAILURE);
+    }
+    free_pauli_sum(&sum);
+    free_state_vector(&sv);
+}
+
 static void test_memory_management() {
     // Just confirm aligned_malloc and aligned_free work without crashing 
     // and produce valid alignment
@@ -124,11 +611,734 @@ static void test_memory_management() {
     aligned_free(ptr);
 }
 
+static void test_memory_planner() {
+    TokenList token_list;
+    init_token_list(&token_list);
+
+    // A 50-qubit GHZ preparation: impossible dense, tiny sparse (the T keeps it off the
+    // stabilizer engine)
+    lex_line("H 0", &token_list);
+    lex_line("T 0", &token_list);
+    for (int q = 1; q < 50; q++) {
+        char line[32];
+        snprintf(line, sizeof(line), "CNOT %d %d", q - 1, q);
+        lex_line(line, &token_list);
+    }
+    lex_line("MEASURE 49", &token_list);
+
+    InstructionList instr_list;
+    init_instruction_list(&instr_list);
+    parse_tokens(&token_list, &instr_list);
+
+    const size_t budget = (size_t)64 << 20; // 64 MiB
+    MemoryPlan plan;
+    if (plan_memory(&instr_list, 0, ENGINE_DENSE, 0.0f, &plan) != 0 ||
+        plan.num_qubits != 50 || plan.peak_bytes <= budget) {
+        fprintf(stderr, "test_memory_planner: dense plan should exceed the budget.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (admit_job(&instr_list, 0, ENGINE_DENSE, budget, 0, 0.0f, &plan) != ADMIT_REFUSED) {
+        fprintf(stderr, "test_memory_planner: job should be refused without fallback.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (admit_job(&instr_list, 0, ENGINE_DENSE, budget, 1, 0.0f, &plan) != ADMIT_DOWNGRADED ||
+        plan.engine != ENGINE_SPARSE) {
+        fprintf(stderr, "test_memory_planner: expected fallback to the sparse engine.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Typo-sized registers must be refused before anything is allocated
+    SimulationOptions options;
+    init_simulation_options(&options);
+    options.engine = ENGINE_DENSE;
+    options.memory_budget = budget;
+    options.allow_engine_fallback = 0;
+    if (simulate_circuit(&instr_list, &options, NULL) != -2) {
+        fprintf(stderr, "test_memory_planner: simulate_circuit should refuse the job.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    SimulationSummary summary;
+    options.allow_engine_fallback = 1;
+    if (simulate_circuit(&instr_list, &options, &summary) != 0 ||
+        summary.engine_used != ENGINE_SPARSE || summary.admission != ADMIT_DOWNGRADED) {
+        fprintf(stderr, "test_memory_planner: fallback run failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // The dense plan sizes the bytecode lowering and its compile-time tables
+    MemoryPlan small;
+    if (plan_memory(&instr_list, 0, ENGINE_DENSE, 0.0f, &plan) != 0) {
+        fprintf(stderr, "test_memory_planner: dense plan failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t program_bytes = 0, scratch_bytes = 0;
+    bytecode_footprint(&instr_list, &program_bytes, &scratch_bytes);
+    if (plan.fusion_bytes == 0 || plan.fusion_bytes != program_bytes ||
+        plan.scratch_bytes != scratch_bytes || plan.scratch_bytes == 0 ||
+        plan_memory(&instr_list, 20, ENGINE_DENSE, 0.0f, &small) != 0 ||
+        small.peak_bytes != small.state_bytes + small.scratch_bytes + small.fusion_bytes + small.pool_bytes) {
+        fprintf(stderr, "test_memory_planner: dense plan should include the bytecode footprint.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Only CNOT and CPHASE are known not to branch among multi-qubit gates
+    InstructionList multi;
+    init_instruction_list(&multi);
+    Instruction gate;
+    memset(&gate, 0, sizeof(gate));
+    gate.type = INSTR_GATE_MULTI;
+    gate.qubits[0] = 0;
+    gate.qubits[1] = 1;
+    gate.qubit_count = 2;
+    strcpy(gate.gate_name, "CNOT");
+    append_instruction(&multi, &gate);
+    strcpy(gate.gate_name, "CPHASE");
+    append_instruction(&multi, &gate);
+    if (estimate_support_qubits(&multi, 2) != 0) {
+        fprintf(stderr, "test_memory_planner: CNOT and CPHASE should not branch.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(gate.gate_name, "ISWAP");
+    append_instruction(&multi, &gate);
+    if (estimate_support_qubits(&multi, 2) != 1) {
+        fprintf(stderr, "test_memory_planner: other multi-qubit gates should branch.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&multi);
+
+    free_token_list(&token_list);
+    free_instruction_list(&instr_list);
+}
+
+static size_t count_opcode(const char* source, size_t num_qubits, Opcode opcode) {
+    InstructionList list;
+    TokenViewList views;
+    init_token_view_list(&views);
+    init_instruction_list(&list);
+    lex_buffer(source, strlen(source), &views);
+    parse_token_views(source, &views, &list);
+    free_token_view_list(&views);
+    BytecodeProgram program;
+    size_t count = 0;
+    if (compile_bytecode(&list, num_qubits, &program) == 0) {
+        for (size_t i = 0; i < program.size; i++) count += (program.code[i].opcode == opcode);
+        free_bytecode(&program);
+    }
+    free_instruction_list(&list);
+    return count;
+}
+
+static void test_cost_model() {
+    const char* source = "H 0\nREPEAT 10 {\nH 1\nCNOT 1 2\n}\nMEASURE 0\n";
+    InstructionList instr_list;
+    TokenViewList views;
+    init_token_view_list(&views);
+    init_instruction_list(&instr_list);
+    lex_buffer(source, strlen(source), &views);
+    parse_token_views(source, &views, &instr_list);
+    free_token_view_list(&views);
+
+    // Loop bodies count once per iteration
+    CostModel model;
+    CircuitCost cost, h, cnot, measure;
+    init_cost_model(&model, ENGINE_DENSE, 20);
+    memset(&h, 0, sizeof(h));
+    memset(&cnot, 0, sizeof(cnot));
+    memset(&measure, 0, sizeof(measure));
+    instruction_cost(&model, &instr_list.data[0], &h);
+    instruction_cost(&model, &instr_list.data[3], &cnot);
+    instruction_cost(&model, &instr_list.data[5], &measure);
+    double expected = 11.0 * h.seconds + 10.0 * cnot.seconds + measure.seconds;
+    if (estimate_circuit_cost(&model, &instr_list, &cost) != 0 || cost.gates != 21 ||
+        cost.measurements != 1 || fabs(cost.seconds - expected) > 1e-9 * expected ||
+        cnot.bytes > h.bytes || cnot.flops != 0.0 || h.passes != 1.0) {
+        fprintf(stderr, "test_cost_model: unexpected dense estimate (%zu gates, %g s).\n",
+                cost.gates, cost.seconds);
+        exit(EXIT_FAILURE);
+    }
+
+    // Ten more qubits cost 1024x; the sparse engine only pays for its support
+    CircuitCost small, sparse;
+    init_cost_model(&model, ENGINE_DENSE, 10);
+    estimate_circuit_cost(&model, &instr_list, &small);
+    init_cost_model(&model, ENGINE_SPARSE, 20);
+    estimate_circuit_cost(&model, &instr_list, &sparse);
+    if (fabs(cost.seconds / small.seconds - 1024.0) > 1e-6 || sparse.seconds >= cost.seconds) {
+        fprintf(stderr, "test_cost_model: cost does not scale with the state.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (calibrate_cost_model(&model) != 0 || !model.calibrated ||
+        !(model.bandwidth > 0.0) || !(model.flop_rate > 0.0)) {
+        fprintf(stderr, "test_cost_model: calibration failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Pre-run report: one JSON object per job, written before execution
+    FILE* report = tmpfile();
+    SimulationOptions options;
+    SimulationSummary summary;
+    init_simulation_options(&options);
+    options.cost_report = report;
+    if (!report || simulate_circuit(&instr_list, &options, &summary) != 0 || summary.predicted.gates != 21) {
+        fprintf(stderr, "test_cost_model: simulate_circuit did not cost the job.\n");
+        exit(EXIT_FAILURE);
+    }
+    char line[512] = "";
+    rewind(report);
+    if (!fgets(line, sizeof(line), report) || strncmp(line, "{\"engine\":\"dense\",\"num_qubits\":3,", 33) != 0 ||
+        !strstr(line, "\"gates\":21,") || !strstr(line, "\"predicted_seconds\":") ||
+        !strstr(line, "\"peak_bytes\":") || line[strlen(line) - 2] != '}') {
+        fprintf(stderr, "test_cost_model: unexpected report '%s'.\n", line);
+        exit(EXIT_FAILURE);
+    }
+    fclose(report);
+    free_instruction_list(&instr_list);
+
+    // The optimizer reports what it saved
+    OptimizerStats stats;
+    optimize_source("H 0\nH 0\nX 1\n", &instr_list, &stats);
+    if (!(stats.seconds_after < stats.seconds_before) || stats.seconds_after <= 0.0) {
+        fprintf(stderr, "test_cost_model: optimizer stats lack predicted times.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+
+    // A CNOT whose control skips cache lines plus one neighbour is cheaper unfused; two pay off
+    if (count_opcode("CNOT 4 5\nH 5\n", 8, OP_GATE_2Q) != 0 ||
+        count_opcode("CNOT 4 5\nH 5\nH 4\n", 8, OP_GATE_2Q) != 1) {
+        fprintf(stderr, "test_cost_model: two-qubit blocks ignore the cost model.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+typedef struct {
+    const char*            path;
+    const CompiledCircuit* circuit;
+    int                    failures;
+} CacheWriter;
+
+static void* store_repeatedly(void* arg) {
+    CacheWriter* w = (CacheWriter*)arg;
+    for (int k = 0; k < 50; k++) {
+        if (save_compiled_circuit(w->path, &w->circuit->instructions, w->circuit->key,
+                                  42, 0) != 0) {
+            w->failures++;
+        }
+    }
+    return NULL;
+}
+
+static void test_circuit_cache() {
+    char dir[] = "/tmp/qasm_cache_XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "test_circuit_cache: cannot create a temporary directory.\n");
+        exit(EXIT_FAILURE);
+    }
+    char source[512], cache_dir[512];
+    snprintf(source, sizeof(source), "%s/bell.qasm", dir);
+    snprintf(cache_dir, sizeof(cache_dir), "%s/cache", dir);
+    FILE* fp = fopen(source, "w");
+    fputs("H 0\nX 1\nX 1\nCNOT 0 1\nMEASURE 1\n", fp);
+    fclose(fp);
+
+    CompileOptions options = { cache_dir, 1, 0 };
+    CacheStats stats;
+    memset(&stats, 0, sizeof(stats));
+    CompiledCircuit first, second;
+    if (compile_circuit_cached(source, &options, &first, &stats) != 0 || first.from_cache ||
+        stats.misses != 1 || stats.stores != 1) {
+        fprintf(stderr, "test_circuit_cache: first compile should miss and store.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (compile_circuit_cached(source, &options, &second, &stats) != 0 || !second.from_cache ||
+        stats.hits != 1 || second.instructions.size != first.instructions.size) {
+        fprintf(stderr, "test_circuit_cache: second compile should hit.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < first.instructions.size; i++) {
+        const Instruction* a = &first.instructions.data[i];
+        const Instruction* b = &second.instructions.data[i];
+        if (a->type != b->type || strcmp(a->gate_name, b->gate_name) != 0 ||
+            a->qubit_count != b->qubit_count || a->qubits[0] != b->qubits[0]) {
+            fprintf(stderr, "test_circuit_cache: cached instruction %zu differs.\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Different optimizer settings must not reuse the optimized stream
+    CompiledCircuit unoptimized;
+    options.optimize = 0;
+    if (compile_circuit_cached(source, &options, &unoptimized, &stats) != 0 || unoptimized.from_cache ||
+        stats.misses != 2) {
+        fprintf(stderr, "test_circuit_cache: settings change should miss.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // A truncated cache file is rejected, not trusted
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%016llx.qbc", cache_dir, (unsigned long long)first.key);
+    truncate(path, sizeof(CircuitFileHeader) + 8);
+    CompiledCircuit rebuilt;
+    options.optimize = 1;
+    if (compile_circuit_cached(source, &options, &rebuilt, &stats) != 0 || rebuilt.from_cache) {
+        fprintf(stderr, "test_circuit_cache: truncated cache file should be rebuilt.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Threads of one process storing the same key never publish a partial file
+    char shared[600];
+    snprintf(shared, sizeof(shared), "%s/shared.qbc", cache_dir);
+    CacheWriter writers[2] = { { shared, &first, 0 }, { shared, &first, 0 } };
+    pthread_t writer;
+    pthread_create(&writer, NULL, store_repeatedly, &writers[1]);
+    store_repeatedly(&writers[0]);
+    pthread_join(writer, NULL);
+    CompiledCircuit stored;
+    if (writers[0].failures || writers[1].failures ||
+        load_compiled_circuit(shared, first.key, 42, &stored) != 0 ||
+        stored.instructions.size != first.instructions.size) {
+        fprintf(stderr, "test_circuit_cache: concurrent stores of one key failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_compiled_circuit(&stored);
+    remove(shared);
+
+    // The run summary carries the counters
+    SimulationOptions sim;
+    SimulationSummary summary;
+    init_simulation_options(&sim);
+    sim.cache_dir = cache_dir;
+    sim.optimize = 1;
+    if (simulate_file(source, &sim, &summary) != 0 || summary.cache.hits != 1) {
+        fprintf(stderr, "test_circuit_cache: simulate_file should report a cache hit.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    char key_path[600];
+    snprintf(key_path, sizeof(key_path), "%s/%016llx.qbc", cache_dir, (unsigned long long)unoptimized.key);
+    free_compiled_circuit(&first);
+    free_compiled_circuit(&second);
+    free_compiled_circuit(&unoptimized);
+    free_compiled_circuit(&rebuilt);
+    remove(path);
+    remove(key_path);
+    rmdir(cache_dir);
+    remove(source);
+    rmdir(dir);
+}
+
+static void test_stabilizer_engine() {
+    struct { const char* source; int clifford; } cases[] = {
+        { "H 0\nS 1\nCNOT 0 1\nY 1\nMEASURE 0\n", 1 },
+        { "H 0\nT 0\n", 0 },
+        { "RZ(1.5707963) 0\nCPHASE(3.1415927) 0 1\n", 1 },
+        { "CPHASE(1.5707963) 0 1\n", 0 },
+        { "RZ(theta) 0\n", 0 },
+    };
+    InstructionList instr_list;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        parse_source(cases[c].source, &instr_list);
+        if (circuit_is_clifford(&instr_list) != cases[c].clifford) {
+            fprintf(stderr, "test_stabilizer_engine: case %zu misclassified.\n", c);
+            exit(EXIT_FAILURE);
+        }
+        free_instruction_list(&instr_list);
+    }
+
+    // Fused runs of Clifford gates stay Clifford
+    OptimizerStats stats;
+    optimize_source("H 0\nS 0\nH 0\nX 0\nCNOT 0 1\n", &instr_list, &stats);
+    MemoryPlan plan;
+    if (stats.fused_gates == 0 || !circuit_is_clifford(&instr_list) ||
+        plan_memory(&instr_list, 0, ENGINE_STABILIZER, 0.0f, &plan) != 0 || plan.overflow) {
+        fprintf(stderr, "test_stabilizer_engine: fused Clifford run rejected.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+    parse_source("H 0\nT 0\n", &instr_list);
+    plan_memory(&instr_list, 0, ENGINE_STABILIZER, 0.0f, &plan);
+    if (!plan.overflow) {
+        fprintf(stderr, "test_stabilizer_engine: T accepted by the stabilizer plan.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+
+    // A 1000-qubit GHZ circuit with a syndrome-style measurement into a register
+    char* source = (char*)malloc(32 * 1024);
+    size_t len = (size_t)sprintf(source, "CREG c 1\nH 0\n");
+    for (int q = 1; q < 1000; q++) len += (size_t)sprintf(source + len, "CNOT %d %d\n", q - 1, q);
+    len += (size_t)sprintf(source + len, "MEASURE 999 -> c[0]\nIF c==1 X 0\nMEASURE 0\n");
+    parse_source(source, &instr_list);
+    free(source);
+    SimulationOptions options;
+    SimulationSummary summary;
+    init_simulation_options(&options);
+    options.engine = ENGINE_DENSE;
+    options.memory_budget = (size_t)64 << 20;
+    options.allow_engine_fallback = 0;
+    if (simulate_circuit(&instr_list, &options, &summary) != 0 || summary.engine_used != ENGINE_STABILIZER ||
+        summary.admission != ADMIT_OK || summary.plan.peak_bytes > options.memory_budget) {
+        fprintf(stderr, "test_stabilizer_engine: 1000-qubit GHZ was not routed to the tableau.\n");
+        exit(EXIT_FAILURE);
+    }
+    options.disable_stabilizer = 1;
+    if (simulate_circuit(&instr_list, &options, &summary) != -2) {
+        fprintf(stderr, "test_stabilizer_engine: disable_stabilizer was ignored.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+
+    // Small Clifford circuits stay dense unless the tableau is asked for
+    parse_source("H 0\nCNOT 0 1\nMEASURE 1\n", &instr_list);
+    init_simulation_options(&options);
+    options.engine = ENGINE_DENSE;
+    if (simulate_circuit(&instr_list, &options, &summary) != 0 || summary.engine_used != ENGINE_DENSE) {
+        fprintf(stderr, "test_stabilizer_engine: small circuit left the dense engine.\n");
+        exit(EXIT_FAILURE);
+    }
+    options.engine = ENGINE_STABILIZER;
+    if (simulate_circuit(&instr_list, &options, &summary) != 0 || summary.engine_used != ENGINE_STABILIZER) {
+        fprintf(stderr, "test_stabilizer_engine: explicit stabilizer run failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+}
+
+static void test_mps_engine() {
+    // 60 qubits of H, T and nearest-neighbour CNOT / CPHASE: far beyond dense, cheap as an MPS
+    char* source = (char*)malloc(16 * 1024);
+    size_t len = (size_t)sprintf(source, "CREG c 1\n");
+    for (int q = 0; q < 60; q++) len += (size_t)sprintf(source + len, "H %d\nT %d\n", q, q);
+    for (int q = 1; q < 60; q++) {
+        len += (size_t)sprintf(source + len, q % 2 ? "CNOT %d %d\n" : "CPHASE(0.7) %d %d\n", q - 1, q);
+    }
+    len += (size_t)sprintf(source + len, "MEASURE 0 -> c[0]\nIF c==1 X 59\nMEASURE 59\n");
+    InstructionList instr_list;
+    parse_source(source, &instr_list);
+    free(source);
+
+    SimulationOptions options;
+    SimulationSummary summary;
+    init_simulation_options(&options);
+    options.memory_budget = (size_t)64 << 20;
+    options.engine = ENGINE_MPS;
+    options.allow_engine_fallback = 0;
+    if (simulate_circuit(&instr_list, &options, &summary) != 0 || summary.engine_used != ENGINE_MPS ||
+        summary.admission != ADMIT_OK || summary.mps.max_bond != MPS_DEFAULT_MAX_BOND ||
+        summary.mps.peak_bond < 2 || summary.mps.peak_bond > 4 || summary.mps.truncation_error > 1e-6) {
+        fprintf(stderr, "test_mps_engine: 60-qubit MPS run failed (peak bond %zu, error %g).\n",
+                summary.mps.peak_bond, summary.mps.truncation_error);
+        exit(EXIT_FAILURE);
+    }
+
+    // A bond cap of 1 forces truncation, which the summary reports
+    options.mps_max_bond = 1;
+    if (simulate_circuit(&instr_list, &options, &summary) != 0 || summary.mps.peak_bond != 1 ||
+        summary.mps.truncations == 0 || summary.mps.truncation_error <= 0.0) {
+        fprintf(stderr, "test_mps_engine: capped run did not report truncation.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Approximate, so never a fallback: the dense request is refused instead
+    init_simulation_options(&options);
+    options.engine = ENGINE_DENSE;
+    options.memory_budget = (size_t)64 << 20;
+    if (simulate_circuit(&instr_list, &options, &summary) != -2) {
+        fprintf(stderr, "test_mps_engine: fallback picked the MPS engine.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+}
+
+static void test_noise_trajectories() {
+    // Analytic P(1): DAMP(0.3) on |1> leaves 0.7, DEPOLARIZE(0.3) on |0> flips with 2/3 * 0.3,
+    // READOUT(0.2) on |0> reports 1 with 0.2
+    InstructionList instr_list;
+    parse_source("X 0\nDAMP(0.3) 0\nMEASURE 0\nDEPOLARIZE(0.3) 1\nMEASURE 1\nREADOUT(0.2) 2\nMEASURE 2\n",
+                 &instr_list);
+    const double expected[3] = { 0.7, 0.2, 0.2 };
+
+    TrajectoryOptions options;
+    TrajectoryResult serial, parallel;
+    init_trajectory_options(&options);
+    options.trajectories = 4000;
+    options.seed = 42;
+    options.threads = 1;
+    if (run_noise_trajectories(&instr_list, &options, &serial) != 0 || serial.trajectories != 4000 ||
+        serial.threads != 1) {
+        fprintf(stderr, "test_noise_trajectories: serial run failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t q = 0; q < 3; q++) {
+        double p = trajectory_probability(&serial, q);
+        double se = trajectory_standard_error(expected[q], serial.measured[q]);
+        if (serial.measured[q] != 4000 || fabs(p - expected[q]) > 5.0 * se) {
+            fprintf(stderr, "test_noise_trajectories: qubit %zu estimated %f, expected %f +/- %f.\n",
+                    q, p, expected[q], se);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Trajectory k always uses stream k, so the thread count cannot change the counts
+    options.threads = 3;
+    if (run_noise_trajectories(&instr_list, &options, &parallel) != 0 || parallel.threads != 3) {
+        fprintf(stderr, "test_noise_trajectories: parallel run failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t q = 0; q < 3; q++) {
+        if (parallel.ones[q] != serial.ones[q]) {
+            fprintf(stderr, "test_noise_trajectories: qubit %zu differs across thread counts.\n", q);
+            exit(EXIT_FAILURE);
+        }
+    }
+    free_trajectory_result(&serial);
+    free_trajectory_result(&parallel);
+
+    // The error estimator: 2500 trajectories give 0.01 at p = 1/2
+    if (fabs(trajectory_standard_error(0.5, 2500) - 0.01) > 1e-12 || trajectories_for_error(0.5, 0.01) != 2500 ||
+        trajectories_for_error(0.0, 0.01) != 2500 || trajectories_for_error(0.1, 0.01) != 900) {
+        fprintf(stderr, "test_noise_trajectories: error estimator is wrong.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Not even one worker state fits: refused before anything is allocated
+    options.memory_budget = 16;
+    if (run_noise_trajectories(&instr_list, &options, &serial) != -2) {
+        fprintf(stderr, "test_noise_trajectories: tiny budget was not refused.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+}
+
+static void test_tensor_network() {
+    // 10 qubits of layered rotations and nearest-neighbour CNOT / CPHASE, with a REPEAT block
+    char* source = (char*)malloc(16 * 1024);
+    size_t len = 0;
+    const char* singles[] = { "H", "T", "RY(0.3)", "S", "RX(1.1)" };
+    for (int layer = 0; layer < 8; layer++) {
+        for (int q = 0; q < 10; q++) len += (size_t)sprintf(source + len, "%s %d\n", singles[(q + layer) % 5], q);
+        for (int q = layer % 2; q + 1 < 10; q += 2) {
+            len += (size_t)sprintf(source + len, q % 3 ? "CNOT %d %d\n" : "CPHASE(0.7) %d %d\n", q, q + 1);
+        }
+    }
+    len += (size_t)sprintf(source + len, "REPEAT 2 {\nH 3\nCNOT 3 8\nDEPOLARIZE(0.1) 8\n}\n");
+    InstructionList instr_list;
+    parse_source(source, &instr_list);
+    free(source);
+
+    StateVector sv;
+    init_state_vector(&sv, 10);
+    interpret_instructions(&instr_list, &sv);
+    const uint64_t basis[3] = { 0, 37, 1023 };
+    float re[3], im[3];
+
+    TensorNetworkOptions options;
+    TensorNetworkPlan plan;
+    init_tensor_network_options(&options);
+    FILE* report = tmpfile();
+    options.cost_report = report;
+    if (tensor_network_amplitudes(&instr_list, basis, 3, &options, re, im, &plan) != 0 ||
+        plan.tensors != 20 + 80 + 36 + 4 || plan.slices != 1) {
+        fprintf(stderr, "test_tensor_network: contraction failed (%zu tensors).\n", plan.tensors);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t k = 0; k < 3; k++) {
+        if (fabsf(re[k] - sv.real[basis[k]]) > 1e-5f || fabsf(im[k] - sv.imag[basis[k]]) > 1e-5f) {
+            fprintf(stderr, "test_tensor_network: amplitude %llu differs from the state vector.\n",
+                    (unsigned long long)basis[k]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    char line[512] = "";
+    rewind(report);
+    if (!report || !fgets(line, sizeof(line), report) || strncmp(line, "{\"engine\":\"tensor_network\",", 27) != 0 ||
+        !strstr(line, "\"slices\":1,") || !strstr(line, "\"predicted_seconds\":")) {
+        fprintf(stderr, "test_tensor_network: unexpected report '%s'.\n", line);
+        exit(EXIT_FAILURE);
+    }
+    fclose(report);
+
+    // A budget below the unsliced peak forces slicing; the slices' sum is the same amplitude
+    options.cost_report = NULL;
+    size_t room = plan.slice_bytes / 2;
+    options.memory_budget = plan.network_bytes + room;
+    options.threads = 2;
+    if (tensor_network_amplitudes(&instr_list, basis, 3, &options, re, im, &plan) != 0 ||
+        plan.slices < 2 || plan.slice_bytes > room) {
+        fprintf(stderr, "test_tensor_network: sliced run failed (%zu slices).\n", plan.slices);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t k = 0; k < 3; k++) {
+        if (fabsf(re[k] - sv.real[basis[k]]) > 1e-5f || fabsf(im[k] - sv.imag[basis[k]]) > 1e-5f) {
+            fprintf(stderr, "test_tensor_network: sliced amplitude %llu differs.\n", (unsigned long long)basis[k]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    free_state_vector(&sv);
+    free_instruction_list(&instr_list);
+
+    // 50-qubit GHZ state: far beyond a state vector, two nonzero amplitudes of 1/sqrt(2)
+    source = (char*)malloc(4096);
+    len = (size_t)sprintf(source, "H 0\n");
+    for (int q = 1; q < 50; q++) len += (size_t)sprintf(source + len, "CNOT %d %d\n", q - 1, q);
+    parse_source(source, &instr_list);
+    free(source);
+    const uint64_t ghz[3] = { 0, ((uint64_t)1 << 50) - 1, 1 };
+    init_tensor_network_options(&options);
+    if (tensor_network_amplitudes(&instr_list, ghz, 3, &options, re, im, &plan) != 0 ||
+        fabsf(re[0] - 0.70710678f) > 1e-5f || fabsf(re[1] - 0.70710678f) > 1e-5f || fabsf(re[2]) > 1e-6f ||
+        plan.largest_rank > 4) {
+        fprintf(stderr, "test_tensor_network: GHZ amplitudes %f %f %f (rank %zu).\n", re[0], re[1], re[2],
+                plan.largest_rank);
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+
+    // Basis states above the register are orthogonal to every state of it
+    parse_source("H 0\n", &instr_list);
+    const uint64_t above[6] = { 2, 3, 4, 5, 6, 7 };
+    float above_re[6], above_im[6];
+    if (tensor_network_amplitudes(&instr_list, above, 6, &options, above_re, above_im, NULL) != 0) {
+        fprintf(stderr, "test_tensor_network: one-qubit contraction failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t k = 0; k < 6; k++) {
+        if (above_re[k] != 0.0f || above_im[k] != 0.0f) {
+            fprintf(stderr, "test_tensor_network: basis %llu above the register has amplitude %f.\n",
+                    (unsigned long long)above[k], above_re[k]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    free_instruction_list(&instr_list);
+
+    // Measurements have no single amplitude
+    parse_source("H 0\nMEASURE 0\n", &instr_list);
+    if (plan_tensor_network(&instr_list, NULL, &plan) != -3) {
+        fprintf(stderr, "test_tensor_network: measured circuit was not rejected.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+}
+
+static void test_engine_selector() {
+    // Depth, counts and measurement placement; the REPEAT body runs 5 times
+    InstructionList instr_list;
+    CircuitProfile profile;
+    parse_source("REPEAT 5 {\nH 0\nCNOT 0 2\n}\nMEASURE 2\n", &instr_list);
+    if (analyze_circuit(&instr_list, 0, &profile) != 0 || profile.gates != 10 || profile.two_qubit_gates != 5 ||
+        profile.depth != 11 || profile.max_distance != 2 || profile.max_cut != 5 || profile.bond_qubits != 1 ||
+        !profile.clifford || profile.mid_circuit) {
+        fprintf(stderr, "test_engine_selector: unexpected profile (depth %zu, cut %zu).\n", profile.depth,
+                profile.max_cut);
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+    parse_source("H 0\nMEASURE 0\nX 0\n", &instr_list);
+    if (analyze_circuit(&instr_list, 0, &profile) != 0 || !profile.mid_circuit) {
+        fprintf(stderr, "test_engine_selector: mid-circuit measurement not seen.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+
+    // One circuit per engine: each profile feature should steer the choice
+    const size_t budget = (size_t)1 << 30;
+    EngineChoice choice;
+    char* source = (char*)malloc(64 * 1024);
+    size_t len = (size_t)sprintf(source, "H 0\n"); // Clifford GHZ: tableau
+    for (int q = 1; q < 1000; q++) len += (size_t)sprintf(source + len, "CNOT %d %d\n", q - 1, q);
+    parse_source(source, &instr_list);
+    if (select_engine(&instr_list, 0, budget, NULL, 0, 0, &choice) != 0 || choice.engine != ENGINE_STABILIZER ||
+        !choice.fits || choice.profile.depth != 1000) {
+        fprintf(stderr, "test_engine_selector: Clifford GHZ chose %s.\n", engine_name(choice.engine));
+        exit(EXIT_FAILURE);
+    }
+    if (select_engine(&instr_list, 0, budget, NULL, 0, 1, &choice) != 0 || choice.engine == ENGINE_STABILIZER ||
+        choice.eligible[ENGINE_STABILIZER]) {
+        fprintf(stderr, "test_engine_selector: disable_stabilizer was ignored.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+
+    len = 0; // 40-qubit GHZ with a T: two nonzero amplitudes
+    len += (size_t)sprintf(source + len, "H 0\nT 0\n");
+    for (int q = 1; q < 40; q++) len += (size_t)sprintf(source + len, "CNOT %d %d\n", q - 1, q);
+    parse_source(source, &instr_list);
+    if (select_engine(&instr_list, 0, budget, NULL, 0, 0, &choice) != 0 || choice.engine != ENGINE_SPARSE ||
+        choice.profile.support_qubits != 1) {
+        fprintf(stderr, "test_engine_selector: sparse GHZ chose %s.\n", engine_name(choice.engine));
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+
+    len = 0; // 60-qubit nearest-neighbour chain of H, T, CNOT and CPHASE: a bond-2 MPS
+    for (int q = 0; q < 60; q++) len += (size_t)sprintf(source + len, "H %d\nT %d\n", q, q);
+    for (int q = 1; q < 60; q++) {
+        len += (size_t)sprintf(source + len, q % 2 ? "CNOT %d %d\n" : "CPHASE(0.7) %d %d\n", q - 1, q);
+    }
+    parse_source(source, &instr_list);
+    if (select_engine(&instr_list, 0, budget, NULL, 0, 0, &choice) != 0 || choice.engine != ENGINE_MPS ||
+        choice.mps_max_bond != 2 || choice.profile.max_distance != 1 || choice.peak_bytes[ENGINE_DENSE] <= budget) {
+        fprintf(stderr, "test_engine_selector: MPS chain chose %s.\n", engine_name(choice.engine));
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+
+    len = 0; // 16 qubits, all-to-all CNOTs after H on every qubit: dense
+    for (int q = 0; q < 16; q++) len += (size_t)sprintf(source + len, "H %d\nT %d\n", q, q);
+    for (int a = 0; a < 16; a++) {
+        for (int b = a + 1; b < 16; b++) len += (size_t)sprintf(source + len, "CNOT %d %d\n", a, b);
+    }
+    len += (size_t)sprintf(source + len, "MEASURE 0\n");
+    parse_source(source, &instr_list);
+    free(source);
+    if (select_engine(&instr_list, 0, budget, NULL, 0, 0, &choice) != 0 || choice.engine != ENGINE_DENSE ||
+        choice.eligible[ENGINE_MPS] || choice.profile.max_distance != 15) {
+        fprintf(stderr, "test_engine_selector: dense circuit chose %s.\n", engine_name(choice.engine));
+        exit(EXIT_FAILURE);
+    }
+
+    // simulate_circuit picks automatically by default and explains why; an engine overrides it
+    SimulationOptions options;
+    SimulationSummary summary;
+    init_simulation_options(&options);
+    options.memory_budget = budget;
+    if (options.engine != ENGINE_AUTO || simulate_circuit(&instr_list, &options, &summary) != 0 ||
+        summary.engine_used != ENGINE_DENSE || strncmp(summary.selection, "dense for 16 qubits", 19) != 0) {
+        fprintf(stderr, "test_engine_selector: automatic run explained '%s'.\n", summary.selection);
+        exit(EXIT_FAILURE);
+    }
+    options.engine = ENGINE_COMPRESSED;
+    if (simulate_circuit(&instr_list, &options, &summary) != 0 || summary.engine_used != ENGINE_COMPRESSED ||
+        summary.selection[0] != '\0') {
+        fprintf(stderr, "test_engine_selector: the engine override was ignored.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_instruction_list(&instr_list);
+}
+
 int main(void) {
     printf("Running test_backend...\n");
     test_circuit_optimizer();
+    test_optimizer_commutation();
+    test_gate_fusion();
+    test_phase_folding();
+    test_dead_gates();
+    test_light_cone();
+    test_circuit_partition();
     test_parallel_execution();
+    test_parallel_pauli_expectation();
     test_memory_management();
+    test_memory_planner();
+    test_circuit_cache();
+    test_cost_model();
+    test_stabilizer_engine();
+    test_mps_engine();
+    test_noise_trajectories();
+    test_tensor_network();
+    test_engine_selector();
     printf("All test_backend tests passed!\n");
     return 0;
 }
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
 
@@ -8,6 +9,12 @@
 #include "../core/state_vector.h"
 #include "../core/gate_operations.h"
 #include "../core/measurement.h"
+#include "../core/compressed_state_vector.h"
+#include "../core/sparse_state_vector.h"
+#include "../core/stabilizer_tableau.h"
+#include "../core/mps_state.h"
+#include "../core/noise_channels.h"
+#include "../core/pauli_expectation.h"
 
 // Utility macro to assert approximate equality
 #define ASSERT_FLOAT_CLOSE(a, b, tol) \
@@ -26,7 +33,7 @@ static void test_qubit_init() {
     ASSERT_FLOAT_CLOSE(q.state[1].r, 0.0f, 1e-6);
 
     // Try a normalized custom state
-    int rc = init_qubit_state(&q, 0.707f, 0.0f, 0.707f, 0.0f);
+    int rc = init_qubit_state(&q, 0.70710678f, 0.0f, 0.70710678f, 0.0f);
     if (rc != 0) {
         fprintf(stderr, "init_qubit_state returned error for valid state.\n");
         exit(EXIT_FAILURE);
@@ -51,6 +58,12 @@ static void test_state_vector_init() {
     }
 
     free_state_vector(&sv);
+
+    // Registers whose length overflows size_t are rejected instead of wrapping
+    if (init_state_vector(&sv, 64) == 0) {
+        fprintf(stderr, "init_state_vector accepted an unaddressable register.\n");
+        exit(EXIT_FAILURE);
+    }
 }
 
 static void test_gate_operations() {
@@ -72,6 +85,63 @@ static void test_gate_operations() {
     free_state_vector(&sv);
 }
 
+static void test_controlled_phase() {
+    StateVector sv;
+    init_state_vector(&sv, 3);
+    // Uniform superposition with exact amplitudes, then CPHASE(pi/2) on qubits 2 and 0
+    for (size_t i = 0; i < 8; i++) {
+        sv.real[i] = 1.0f;
+        sv.imag[i] = 0.0f;
+    }
+    apply_controlled_phase(&sv, 2, 0, 0.0f, 1.0f);
+    for (size_t i = 0; i < 8; i++) {
+        int both = (i & 1) && (i & 4);
+        ASSERT_FLOAT_CLOSE(sv.real[i], both ? 0.0f : 1.0f, 1e-6);
+        ASSERT_FLOAT_CLOSE(sv.imag[i], both ? 1.0f : 0.0f, 1e-6);
+    }
+    if (apply_controlled_phase(&sv, 1, 1, 0.0f, 1.0f) == 0) {
+        fprintf(stderr, "test_controlled_phase: equal qubits should be rejected.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_state_vector(&sv);
+}
+
+static void test_two_qubit_gate() {
+    // CNOT as a 4x4 (local index = 2 * control bit + target bit) must match apply_cnot,
+    // on both the vector path (both qubits >= 2) and the scalar path
+    float cnot[32] = { 0.0f };
+    cnot[8 * 0 + 2 * 0] = 1.0f;
+    cnot[8 * 1 + 2 * 1] = 1.0f;
+    cnot[8 * 2 + 2 * 3] = 1.0f;
+    cnot[8 * 3 + 2 * 2] = 1.0f;
+    const size_t pairs[][2] = { { 4, 2 }, { 2, 5 }, { 0, 3 }, { 1, 0 } };
+    for (size_t p = 0; p < sizeof(pairs) / sizeof(pairs[0]); p++) {
+        StateVector a, b;
+        init_state_vector(&a, 6);
+        init_state_vector(&b, 6);
+        for (size_t i = 0; i < 64; i++) {
+            a.real[i] = b.real[i] = (float)i;
+            a.imag[i] = b.imag[i] = -(float)(i % 7);
+        }
+        apply_two_qubit_gate(&a, cnot, pairs[p][0], pairs[p][1]);
+        apply_cnot(&b, pairs[p][0], pairs[p][1]);
+        for (size_t i = 0; i < 64; i++) {
+            ASSERT_FLOAT_CLOSE(a.real[i], b.real[i], 1e-6);
+            ASSERT_FLOAT_CLOSE(a.imag[i], b.imag[i], 1e-6);
+        }
+        free_state_vector(&a);
+        free_state_vector(&b);
+    }
+
+    StateVector sv;
+    init_state_vector(&sv, 2);
+    if (apply_two_qubit_gate(&sv, cnot, 1, 1) == 0 || apply_two_qubit_gate(&sv, cnot, 0, 2) == 0) {
+        fprintf(stderr, "test_two_qubit_gate: invalid qubits should be rejected.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_state_vector(&sv);
+}
+
 static void test_measurement() {
     srand((unsigned)time(NULL));
 
@@ -91,12 +161,536 @@ static void test_measurement() {
     free_state_vector(&sv);
 }
 
+static void test_compressed_state_vector() {
+    const float h_gate[8] = {
+        0.70710678f, 0.0f,  0.70710678f, 0.0f,
+        0.70710678f, 0.0f, -0.70710678f, 0.0f
+    };
+
+    // 6 qubits split into blocks of 2^2 so gates hit both in-block and cross-block paths
+    StateVector dense, unpacked;
+    CompressedStateVector csv;
+    init_state_vector(&dense, 6);
+    init_state_vector(&unpacked, 6);
+    if (init_compressed_state_vector(&csv, 6, 2, 0.0f) != 0) {
+        fprintf(stderr, "init_compressed_state_vector returned error.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const size_t h_targets[3] = { 0, 3, 5 };
+    for (size_t k = 0; k < 3; k++) {
+        apply_single_qubit_gate(&dense, h_gate, h_targets[k]);
+        compressed_apply_single_qubit_gate(&csv, h_gate, h_targets[k]);
+    }
+    const size_t cnots[4][2] = { {0, 1}, {0, 4}, {5, 1}, {3, 4} };
+    for (size_t k = 0; k < 4; k++) {
+        apply_cnot(&dense, cnots[k][0], cnots[k][1]);
+        compressed_apply_cnot(&csv, cnots[k][0], cnots[k][1]);
+    }
+
+    compressed_to_state_vector(&csv, &unpacked);
+    for (size_t i = 0; i < 64; i++) {
+        ASSERT_FLOAT_CLOSE(unpacked.real[i], dense.real[i], 1e-6);
+        ASSERT_FLOAT_CLOSE(unpacked.imag[i], dense.imag[i], 1e-6);
+    }
+
+    CompressionStats stats;
+    get_compression_stats(&csv, &stats);
+    if (stats.gates_applied != 7 || stats.compressed_bytes == 0) {
+        fprintf(stderr, "Compression stats mismatch (gates=%zu).\n", stats.gates_applied);
+        exit(EXIT_FAILURE);
+    }
+
+    free_compressed_state_vector(&csv);
+    free_state_vector(&unpacked);
+    free_state_vector(&dense);
+
+    // A structured 16-qubit state should store far below its dense size
+    init_compressed_state_vector(&csv, 16, 8, 0.0f);
+    compressed_apply_single_qubit_gate(&csv, h_gate, 15);
+    get_compression_stats(&csv, &stats);
+    if (stats.compression_ratio < 10.0) {
+        fprintf(stderr, "Expected high compression ratio, got %.2f.\n", stats.compression_ratio);
+        exit(EXIT_FAILURE);
+    }
+    free_compressed_state_vector(&csv);
+}
+
+static void test_sparse_state_vector() {
+    const float h_gate[8] = {
+        0.70710678f, 0.0f,  0.70710678f, 0.0f,
+        0.70710678f, 0.0f, -0.70710678f, 0.0f
+    };
+    const float t_gate[8] = {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 0.70710678f, 0.70710678f
+    };
+
+    // Compare against the dense engine on a small register
+    StateVector dense;
+    SparseStateVector ssv;
+    init_state_vector(&dense, 4);
+    if (init_sparse_state_vector(&ssv, 4, 0.0) != 0) {
+        fprintf(stderr, "init_sparse_state_vector returned error.\n");
+        exit(EXIT_FAILURE);
+    }
+    apply_single_qubit_gate(&dense, h_gate, 2);
+    sparse_apply_single_qubit_gate(&ssv, h_gate, 2);
+    apply_single_qubit_gate(&dense, t_gate, 2);
+    sparse_apply_single_qubit_gate(&ssv, t_gate, 2);
+    apply_cnot(&dense, 2, 0);
+    sparse_apply_cnot(&ssv, 2, 0);
+    apply_single_qubit_gate(&dense, h_gate, 0);
+    sparse_apply_single_qubit_gate(&ssv, h_gate, 0);
+    for (uint64_t i = 0; i < 16; i++) {
+        float r, im;
+        sparse_get_amplitude(&ssv, i, &r, &im);
+        ASSERT_FLOAT_CLOSE(r, dense.real[i], 1e-6);
+        ASSERT_FLOAT_CLOSE(im, dense.imag[i], 1e-6);
+    }
+    free_sparse_state_vector(&ssv);
+    free_state_vector(&dense);
+
+    // A 48-qubit GHZ state holds two amplitudes; H twice returns to a single entry
+    init_sparse_state_vector(&ssv, 48, 0.0);
+    sparse_apply_single_qubit_gate(&ssv, h_gate, 0);
+    for (size_t q = 1; q < 48; q++) {
+        sparse_apply_cnot(&ssv, q - 1, q);
+    }
+    if (ssv.size != 2 || sparse_should_promote(&ssv)) {
+        fprintf(stderr, "Sparse GHZ state has %zu entries.\n", ssv.size);
+        exit(EXIT_FAILURE);
+    }
+    int first = -1, outcome = -1;
+    sparse_measure_qubit(&ssv, 0, &first);
+    sparse_measure_qubit(&ssv, 47, &outcome);
+    if (first != outcome || ssv.size != 1) {
+        fprintf(stderr, "Sparse GHZ measurement mismatch (%d vs %d).\n", first, outcome);
+        exit(EXIT_FAILURE);
+    }
+    free_sparse_state_vector(&ssv);
+
+    // Promotion once the density crosses the threshold
+    init_sparse_state_vector(&ssv, 3, 0.5);
+    sparse_apply_single_qubit_gate(&ssv, h_gate, 0);
+    sparse_apply_single_qubit_gate(&ssv, h_gate, 1);
+    sparse_apply_single_qubit_gate(&ssv, h_gate, 2);
+    if (!sparse_should_promote(&ssv) || sparse_promote_to_dense(&ssv, &dense) != 0) {
+        fprintf(stderr, "Sparse promotion failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < 8; i++) {
+        ASSERT_FLOAT_CLOSE(dense.real[i], 0.35355339f, 1e-5);
+    }
+    free_state_vector(&dense);
+}
+
+static void test_stabilizer_tableau() {
+    const float h_gate[8] = {
+        0.70710678f, 0.0f,  0.70710678f, 0.0f,
+        0.70710678f, 0.0f, -0.70710678f, 0.0f
+    };
+    const float s_gate[8] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+    const float y_gate[8] = { 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+    const float t_gate[8] = {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 0.70710678f, 0.70710678f
+    };
+    // S.H with a global phase, as the optimizer would fuse it
+    const float sh_gate[8] = {
+        0.0f, 0.70710678f, 0.0f,  0.70710678f,
+        -0.70710678f, 0.0f, 0.70710678f, 0.0f
+    };
+    if (!is_clifford_gate(h_gate) || !is_clifford_gate(sh_gate) || is_clifford_gate(t_gate)) {
+        fprintf(stderr, "is_clifford_gate misclassified a gate.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Bell pair: the first outcome is random, the second must agree with it
+    StabilizerTableau tab;
+    if (init_stabilizer_tableau(&tab, 2) != 0) {
+        fprintf(stderr, "init_stabilizer_tableau returned error.\n");
+        exit(EXIT_FAILURE);
+    }
+    int a = -1, b = -1;
+    tableau_apply_single_qubit_gate(&tab, h_gate, 0);
+    tableau_apply_cnot(&tab, 0, 1);
+    tableau_measure_qubit(&tab, 0, &a);
+    tableau_measure_qubit(&tab, 1, &b);
+    if (a != b || tableau_apply_single_qubit_gate(&tab, t_gate, 0) != -3 ||
+        tableau_apply_controlled_phase(&tab, 0, 1, 0.0f, 1.0f) != -3) {
+        fprintf(stderr, "Stabilizer Bell pair failed (%d, %d).\n", a, b);
+        exit(EXIT_FAILURE);
+    }
+    free_stabilizer_tableau(&tab);
+
+    // Random Clifford circuits against the dense engine: wherever the dense state says an
+    // outcome is certain, the tableau must produce it; both then collapse to the same branch
+    for (int trial = 0; trial < 50; trial++) {
+        const size_t n = 5;
+        StateVector sv;
+        init_state_vector(&sv, n);
+        init_stabilizer_tableau(&tab, n);
+        for (int g = 0; g < 40; g++) {
+            size_t q = (size_t)rand() % n, t = (q + 1 + (size_t)rand() % (n - 1)) % n;
+            const float* gates[3] = { h_gate, s_gate, y_gate };
+            int kind = rand() % 5;
+            if (kind < 3) {
+                apply_single_qubit_gate(&sv, gates[kind], q);
+                tableau_apply_single_qubit_gate(&tab, gates[kind], q);
+            } else if (kind == 3) {
+                apply_cnot(&sv, q, t);
+                tableau_apply_cnot(&tab, q, t);
+            } else {
+                apply_controlled_phase(&sv, q, t, -1.0f, 0.0f);
+                tableau_apply_controlled_phase(&tab, q, t, -1.0f, 0.0f);
+            }
+        }
+        for (size_t q = 0; q < n; q++) {
+            float p1 = 0.0f;
+            for (size_t i = 0; i < ((size_t)1 << n); i++) {
+                if ((i >> q) & 1) p1 += sv.real[i] * sv.real[i] + sv.imag[i] * sv.imag[i];
+            }
+            int outcome = -1;
+            tableau_measure_qubit(&tab, q, &outcome);
+            if ((p1 < 1e-4f && outcome != 0) || (p1 > 1.0f - 1e-4f && outcome != 1) ||
+                (p1 > 1e-4f && p1 < 1.0f - 1e-4f && fabsf(p1 - 0.5f) > 1e-3f)) {
+                fprintf(stderr, "Stabilizer measurement disagrees with dense (p1 = %f, outcome %d).\n", p1, outcome);
+                exit(EXIT_FAILURE);
+            }
+            float norm = 1.0f / sqrtf(outcome ? p1 : 1.0f - p1);
+            for (size_t i = 0; i < ((size_t)1 << n); i++) {
+                float keep = (((i >> q) & 1) == (size_t)outcome) ? norm : 0.0f;
+                sv.real[i] *= keep;
+                sv.imag[i] *= keep;
+            }
+        }
+        free_stabilizer_tableau(&tab);
+        free_state_vector(&sv);
+    }
+
+    // A 1000-qubit GHZ state needs a few hundred kilobytes of tableau
+    if (init_stabilizer_tableau(&tab, 1000) != 0) {
+        fprintf(stderr, "init_stabilizer_tableau(1000) returned error.\n");
+        exit(EXIT_FAILURE);
+    }
+    tableau_apply_single_qubit_gate(&tab, h_gate, 0);
+    for (size_t q = 1; q < 1000; q++) tableau_apply_cnot(&tab, q - 1, q);
+    tableau_measure_qubit(&tab, 500, &a);
+    for (size_t q = 0; q < 1000; q += 37) {
+        tableau_measure_qubit(&tab, q, &b);
+        if (b != a) {
+            fprintf(stderr, "1000-qubit GHZ outcomes disagree at qubit %zu.\n", q);
+            exit(EXIT_FAILURE);
+        }
+    }
+    free_stabilizer_tableau(&tab);
+}
+
+static void test_mps_state() {
+    const float h_gate[8] = {
+        0.70710678f, 0.0f,  0.70710678f, 0.0f,
+        0.70710678f, 0.0f, -0.70710678f, 0.0f
+    };
+    const float t_gate[8] = {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 0.70710678f, 0.70710678f
+    };
+    // H (x) T as a 4x4 gate, a generic entangling-free two-qubit update
+    float ht_gate[32];
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 4; col++) {
+            const float* x = &h_gate[2 * (2 * (row >> 1) + (col >> 1))];
+            const float* y = &t_gate[2 * (2 * (row & 1) + (col & 1))];
+            ht_gate[2 * (4 * row + col)] = x[0] * y[0] - x[1] * y[1];
+            ht_gate[2 * (4 * row + col) + 1] = x[0] * y[1] + x[1] * y[0];
+        }
+    }
+
+    // Random circuits with non-neighbouring two-qubit gates, against the dense engine
+    for (int trial = 0; trial < 20; trial++) {
+        const size_t n = 6;
+        StateVector sv;
+        MpsState mps;
+        init_state_vector(&sv, n);
+        if (init_mps_state(&mps, n, 0, 0.0) != 0) {
+            fprintf(stderr, "init_mps_state returned error.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int g = 0; g < 40; g++) {
+            size_t q = (size_t)rand() % n, t = (q + 1 + (size_t)rand() % (n - 1)) % n;
+            int kind = rand() % 5;
+            if (kind == 0) {
+                apply_single_qubit_gate(&sv, h_gate, q);
+                mps_apply_single_qubit_gate(&mps, h_gate, q);
+            } else if (kind == 1) {
+                apply_single_qubit_gate(&sv, t_gate, q);
+                mps_apply_single_qubit_gate(&mps, t_gate, q);
+            } else if (kind == 2) {
+                apply_cnot(&sv, q, t);
+                mps_apply_cnot(&mps, q, t);
+            } else if (kind == 3) {
+                apply_controlled_phase(&sv, q, t, 0.3f, 0.9539392f);
+                mps_apply_controlled_phase(&mps, q, t, 0.3f, 0.9539392f);
+            } else {
+                apply_two_qubit_gate(&sv, ht_gate, q, t);
+                mps_apply_two_qubit_gate(&mps, ht_gate, q, t);
+            }
+        }
+        for (uint64_t i = 0; i < ((uint64_t)1 << n); i++) {
+            float re = 0.0f, im = 0.0f;
+            mps_amplitude(&mps, i, &re, &im);
+            if (fabsf(re - sv.real[i]) > 1e-4f || fabsf(im - sv.imag[i]) > 1e-4f) {
+                fprintf(stderr, "MPS amplitude %llu differs from dense.\n", (unsigned long long)i);
+                exit(EXIT_FAILURE);
+            }
+        }
+        MpsStats stats;
+        get_mps_stats(&mps, &stats);
+        if (stats.peak_bond > 8 || stats.truncation_error > 1e-6) {
+            fprintf(stderr, "Exact MPS run reported peak bond %zu, error %g.\n", stats.peak_bond, stats.truncation_error);
+            exit(EXIT_FAILURE);
+        }
+        free_mps_state(&mps);
+        free_state_vector(&sv);
+    }
+
+    // A 100-qubit GHZ state needs bond 2 everywhere; every outcome agrees
+    MpsState mps;
+    init_mps_state(&mps, 100, 0, -1.0);
+    mps_apply_single_qubit_gate(&mps, h_gate, 0);
+    for (size_t q = 1; q < 100; q++) mps_apply_cnot(&mps, q - 1, q);
+    int a = -1, b = -1;
+    mps_measure_qubit(&mps, 50, &a);
+    for (size_t q = 0; q < 100; q += 7) {
+        mps_measure_qubit(&mps, q, &b);
+        if (b != a) {
+            fprintf(stderr, "100-qubit MPS GHZ outcomes disagree at qubit %zu.\n", q);
+            exit(EXIT_FAILURE);
+        }
+    }
+    MpsStats stats;
+    get_mps_stats(&mps, &stats);
+    if (stats.peak_bond != 2 || stats.truncation_error > 1e-6) {
+        fprintf(stderr, "MPS GHZ reported peak bond %zu, error %g.\n", stats.peak_bond, stats.truncation_error);
+        exit(EXIT_FAILURE);
+    }
+    free_mps_state(&mps);
+
+    // With the bond capped at 2 an entangling circuit must truncate, and say so
+    init_mps_state(&mps, 8, 2, 0.0);
+    for (int g = 0; g < 30; g++) {
+        size_t q = (size_t)rand() % 7;
+        mps_apply_single_qubit_gate(&mps, h_gate, q);
+        mps_apply_single_qubit_gate(&mps, t_gate, q + 1);
+        mps_apply_cnot(&mps, q, q + 1);
+    }
+    get_mps_stats(&mps, &stats);
+    if (stats.peak_bond != 2 || stats.truncations == 0 || stats.truncation_error <= 0.0) {
+        fprintf(stderr, "Capped MPS reported peak bond %zu, %zu truncations, error %g.\n",
+                stats.peak_bond, stats.truncations, stats.truncation_error);
+        exit(EXIT_FAILURE);
+    }
+    free_mps_state(&mps);
+}
+
+static void test_noise_channels() {
+    const float h_gate[8] = {
+        0.70710678f, 0.0f,  0.70710678f, 0.0f,
+        0.70710678f, 0.0f, -0.70710678f, 0.0f
+    };
+    StateVector sv;
+    init_state_vector(&sv, 2);
+
+    // Depolarizing: random_value < p picks X, Y, Z in thirds of [0, p); above p nothing happens
+    apply_noise_channel(&sv, NOISE_DEPOLARIZING, 0.3f, 1, 0.05);  // X on qubit 1
+    ASSERT_FLOAT_CLOSE(sv.real[2], 1.0f, 1e-6f);
+    apply_noise_channel(&sv, NOISE_DEPOLARIZING, 0.3f, 1, 0.15);  // Y|1> = -i|0>
+    ASSERT_FLOAT_CLOSE(sv.imag[0], -1.0f, 1e-6f);
+    apply_noise_channel(&sv, NOISE_DEPOLARIZING, 0.3f, 0, 0.5);   // no error
+    apply_noise_channel(&sv, NOISE_DEPOLARIZING, 0.3f, 0, 0.25);  // Z|0> = |0>
+    ASSERT_FLOAT_CLOSE(sv.imag[0], -1.0f, 1e-6f);
+
+    // Amplitude damping with gamma = 1 always decays |1>
+    reset_state_vector(&sv);
+    ASSERT_FLOAT_CLOSE(sv.real[0], 1.0f, 1e-6f);
+    ASSERT_FLOAT_CLOSE(sv.imag[0], 0.0f, 1e-6f);
+    apply_noise_channel(&sv, NOISE_DEPOLARIZING, 1.0f, 0, 0.0);   // X
+    apply_noise_channel(&sv, NOISE_AMPLITUDE_DAMPING, 1.0f, 0, 0.99);
+    ASSERT_FLOAT_CLOSE(sv.real[0], 1.0f, 1e-6f);
+    ASSERT_FLOAT_CLOSE(sv.real[1], 0.0f, 1e-6f);
+
+    // On |+> with gamma = 1/2 the jump has probability 1/4; otherwise |1> is damped to weight 1/3
+    reset_state_vector(&sv);
+    apply_single_qubit_gate(&sv, h_gate, 0);
+    apply_noise_channel(&sv, NOISE_AMPLITUDE_DAMPING, 0.5f, 0, 0.3);
+    ASSERT_FLOAT_CLOSE(sv.real[0] * sv.real[0], 2.0f / 3.0f, 1e-5f);
+    ASSERT_FLOAT_CLOSE(sv.real[1] * sv.real[1], 1.0f / 3.0f, 1e-5f);
+    reset_state_vector(&sv);
+    apply_single_qubit_gate(&sv, h_gate, 0);
+    apply_noise_channel(&sv, NOISE_AMPLITUDE_DAMPING, 0.5f, 0, 0.2);
+    ASSERT_FLOAT_CLOSE(sv.real[0], 1.0f, 1e-5f);
+    ASSERT_FLOAT_CLOSE(sv.real[1], 0.0f, 1e-6f);
+
+    // Readout errors act on outcomes, not on the state
+    NoiseChannel channel;
+    if (noise_channel_from_name("readout", &channel) != 0 || channel != NOISE_READOUT ||
+        apply_noise_channel(&sv, NOISE_READOUT, 0.1f, 0, 0.0) != -3 ||
+        apply_noise_channel(&sv, NOISE_DEPOLARIZING, 1.5f, 0, 0.0) == 0) {
+        fprintf(stderr, "Noise channel lookup or validation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // measure_qubit_sampled takes its outcome from the supplied value
+    int outcome = -1;
+    reset_state_vector(&sv);
+    apply_single_qubit_gate(&sv, h_gate, 1);
+    measure_qubit_sampled(&sv, 1, 0.7, &outcome);
+    if (outcome != 1) {
+        fprintf(stderr, "measure_qubit_sampled(0.7) on |+> gave %d.\n", outcome);
+        exit(EXIT_FAILURE);
+    }
+    ASSERT_FLOAT_CLOSE(sv.real[2], 1.0f, 1e-6f);
+    free_state_vector(&sv);
+}
+
+/**
+ * \brief <psi|P|psi> (without the coefficient) by applying P to a copy of the state.
+ */
+static double brute_force_pauli(const StateVector* sv, const PauliString* p) {
+    const float x_gate[8] = { 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+    const float y_gate[8] = { 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+    const float z_gate[8] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f };
+    StateVector copy;
+    init_state_vector(&copy, sv->num_qubits);
+    size_t dim = (size_t)1 << sv->num_qubits;
+    memcpy(copy.real, sv->real, dim * sizeof(float));
+    memcpy(copy.imag, sv->imag, dim * sizeof(float));
+    for (size_t q = 0; q < sv->num_qubits; q++) {
+        int x = (int)((p->x_mask >> q) & 1u), z = (int)((p->z_mask >> q) & 1u);
+        if (x && z) apply_single_qubit_gate(&copy, y_gate, q);
+        else if (x) apply_single_qubit_gate(&copy, x_gate, q);
+        else if (z) apply_single_qubit_gate(&copy, z_gate, q);
+    }
+    double value = 0.0;
+    for (size_t i = 0; i < dim; i++) {
+        value += (double)sv->real[i] * copy.real[i] + (double)sv->imag[i] * copy.imag[i];
+    }
+    free_state_vector(&copy);
+    return value;
+}
+
+static void fill_random_state(StateVector* sv, unsigned seed) {
+    size_t dim = (size_t)1 << sv->num_qubits;
+    double norm = 0.0;
+    srand(seed);
+    for (size_t i = 0; i < dim; i++) {
+        sv->real[i] = (float)rand() / RAND_MAX - 0.5f;
+        sv->imag[i] = (float)rand() / RAND_MAX - 0.5f;
+        norm += (double)sv->real[i] * sv->real[i] + (double)sv->imag[i] * sv->imag[i];
+    }
+    float scale = (float)(1.0 / sqrt(norm));
+    for (size_t i = 0; i < dim; i++) {
+        sv->real[i] *= scale;
+        sv->imag[i] *= scale;
+    }
+}
+
+static void test_pauli_expectation() {
+    PauliString p;
+    if (parse_pauli_string("X0 y3 Z12", &p) != 0 || p.x_mask != 0x9 || p.z_mask != 0x1008 ||
+        parse_pauli_string("X0 Q1", &p) != -2 || parse_pauli_string("X0 Z0", &p) != -3 ||
+        parse_pauli_string("Z64", &p) != -3 || parse_pauli_string("I", &p) != 0 || p.x_mask || p.z_mask) {
+        fprintf(stderr, "parse_pauli_string failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // A mixed sum on 7 qubits: every term against the brute force, and the weighted total
+    const char* texts[] = { "Z0", "X1", "Y2", "X0 X1", "Y0 Y1", "Z0 Z1 Z2", "X6 Y5 Z4", "Y6", "I", "X3 Z6", "Y1 Y4" };
+    size_t count = sizeof(texts) / sizeof(texts[0]);
+    StateVector sv;
+    init_state_vector(&sv, 7);
+    fill_random_state(&sv, 7);
+    PauliSum sum;
+    init_pauli_sum(&sum);
+    for (size_t t = 0; t < count; t++) add_pauli_term(&sum, 0.5 + (double)t, texts[t]);
+    double total = 0.0, expected = 0.0;
+    double terms[16];
+    if (pauli_sum_expectation(&sv, &sum, &total, terms) != 0) {
+        fprintf(stderr, "pauli_sum_expectation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t t = 0; t < count; t++) {
+        double exact = brute_force_pauli(&sv, &sum.terms[t]);
+        expected += sum.terms[t].coefficient * exact;
+        ASSERT_FLOAT_CLOSE((float)terms[t], (float)exact, 1e-5f);
+    }
+    ASSERT_FLOAT_CLOSE((float)total, (float)expected, 1e-4f);
+    ASSERT_FLOAT_CLOSE((float)terms[8], 1.0f, 1e-5f); // identity
+
+    // A term on a qubit outside the register is rejected
+    add_pauli_term(&sum, 1.0, "Z7");
+    if (pauli_sum_expectation(&sv, &sum, &total, NULL) != -2) {
+        fprintf(stderr, "pauli_sum_expectation accepted a qubit outside the register.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_pauli_sum(&sum);
+    free_state_vector(&sv);
+
+    // A string flipping all 12 qubits takes the pair kernel
+    init_state_vector(&sv, 12);
+    fill_random_state(&sv, 12);
+    parse_pauli_string("X0 X1 X2 X3 X4 X5 X6 X7 X8 X9 Y10 Y11", &p);
+    p.coefficient = -2.0;
+    double value = 0.0;
+    pauli_expectation(&sv, &p, &value);
+    ASSERT_FLOAT_CLOSE((float)value, (float)(-2.0 * brute_force_pauli(&sv, &p)), 1e-5f);
+    parse_pauli_string("Y0 X1 X2 X3 X4 X5 X6 X7 X8 X9 X10 Z11", &p);
+    p.coefficient = 1.0;
+    pauli_expectation(&sv, &p, &value);
+    ASSERT_FLOAT_CLOSE((float)value, (float)brute_force_pauli(&sv, &p), 1e-5f);
+    free_state_vector(&sv);
+
+    // A Heisenberg chain XX + YY + ZZ on 10 qubits needs three passes
+    init_state_vector(&sv, 10);
+    fill_random_state(&sv, 10);
+    init_pauli_sum(&sum);
+    char text[32];
+    expected = 0.0;
+    for (int q = 0; q + 1 < 10; q++) {
+        const char* names[] = { "X", "Y", "Z" };
+        for (int k = 0; k < 3; k++) {
+            snprintf(text, sizeof(text), "%s%d %s%d", names[k], q, names[k], q + 1);
+            add_pauli_term(&sum, 1.0, text);
+            expected += brute_force_pauli(&sv, &sum.terms[sum.size - 1]);
+        }
+    }
+    PauliGrouping grouping;
+    if (group_pauli_terms(&sum, 10, &grouping) != 0 || grouping.num_groups != 3) {
+        fprintf(stderr, "Heisenberg chain was not grouped into three passes.\n");
+        exit(EXIT_FAILURE);
+    }
+    free_pauli_grouping(&grouping);
+    pauli_sum_expectation(&sv, &sum, &total, NULL);
+    ASSERT_FLOAT_CLOSE((float)total, (float)expected, 1e-4f);
+    free_pauli_sum(&sum);
+    free_state_vector(&sv);
+}
+
 int main(void) {
     printf("Running test_core...\n");
     test_qubit_init();
     test_state_vector_init();
     test_gate_operations();
+    test_controlled_phase();
+    test_two_qubit_gate();
     test_measurement();
+    test_compressed_state_vector();
+    test_sparse_state_vector();
+    test_stabilizer_tableau();
+    test_mps_state();
+    test_noise_channels();
+    test_pauli_expectation();
     printf("All test_core tests passed!\n");
     return 0;
 }
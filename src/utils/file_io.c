@@ -3,6 +3,14 @@
 #include <string.h>
 #include <errno.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#  define FILE_IO_HAVE_MMAP 1
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
 char* read_file_to_string(const char* filename, size_t* out_size) {
     if (!filename) return NULL;
 
@@ -50,3 +58,57 @@ int write_string_to_file(const char* filename, const char* content) {
 
     return (written == len) ? 0 : -3;
 }
+
+int map_file_readonly(const char* filename, MappedFile* out) {
+    if (!filename || !out) return -1;
+    memset(out, 0, sizeof(*out));
+
+#ifdef FILE_IO_HAVE_MMAP
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -2;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -3;
+    }
+    if (st.st_size == 0) {
+        // mmap rejects empty mappings; an empty file is simply an empty buffer
+        close(fd);
+        out->data = "";
+        return 0;
+    }
+
+    void* addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps its own reference
+    if (addr == MAP_FAILED) return -4;
+#ifdef MADV_SEQUENTIAL
+    madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+    out->data = (const char*)addr;
+    out->size = (size_t)st.st_size;
+    out->mapped = 1;
+    return 0;
+#else
+    char* buffer = read_file_to_string(filename, &out->size);
+    if (!buffer) return -2;
+    out->data = buffer;
+    return 0;
+#endif
+}
+
+void unmap_file(MappedFile* mf) {
+    if (!mf || !mf->data) return;
+#ifdef FILE_IO_HAVE_MMAP
+    if (mf->mapped) {
+        munmap((void*)mf->data, mf->size);
+    } else if (mf->size > 0) {
+        free((void*)mf->data);
+    }
+#else
+    free((void*)mf->data);
+#endif
+    mf->data = NULL;
+    mf->size = 0;
+    mf->mapped = 0;
+}
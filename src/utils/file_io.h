@@ -6,6 +6,16 @@ extern "C" {
 #endif
 
 #include <stdio.h>
+#include <stddef.h>
+
+/**
+ * \brief A read-only view of a whole file, memory-mapped where the platform allows it.
+ */
+typedef struct MappedFile {
+    const char* data;   /**< File contents (not NUL-terminated when mapped) */
+    size_t      size;   /**< Length in bytes */
+    int         mapped; /**< 1 if data is an mmap'd region, 0 if it is a heap copy */
+} MappedFile;
 
 /**
  * \brief Reads the entire contents of a file into memory.
@@ -24,6 +34,20 @@ char* read_file_to_string(const char* filename, size_t* out_size);
  */
 int write_string_to_file(const char* filename, const char* content);
 
+/**
+ * \brief Maps a file read-only into memory (falls back to read_file_to_string where mmap is unavailable).
+ * \param filename Path to the file
+ * \param out MappedFile to fill in; release it with unmap_file
+ * \return 0 on success, nonzero on error
+ */
+int map_file_readonly(const char* filename, MappedFile* out);
+
+/**
+ * \brief Releases a MappedFile.
+ * \param mf MappedFile filled in by map_file_readonly
+ */
+void unmap_file(MappedFile* mf);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,3 +28,39 @@ int normalize_complex_array(float* real, float* imag, size_t length) {
     }
     return 0;
 }
+
+/**
+ * \brief splitmix64 step, used to expand a seed into xoshiro state.
+ */
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+void seed_random_stream(RandomStream* rng, uint64_t seed, uint64_t stream) {
+    if (!rng) return;
+    // Mix the stream index in before expanding, so neighbouring streams share no state
+    uint64_t x = seed;
+    uint64_t mixed = splitmix64(&x) ^ (stream * 0xD1B54A32D192ED03ull);
+    x = mixed;
+    for (int k = 0; k < 4; k++) rng->s[k] = splitmix64(&x);
+}
+
+double random_uniform(RandomStream* rng) {
+    uint64_t* s = rng->s;
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return (double)(result >> 11) * (1.0 / 9007199254740992.0);
+}
@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * \brief Multiply two complex numbers (a + i*b) * (c + i*d) = (a*c - b*d) + i(a*d + b*c).
@@ -27,6 +28,30 @@ void complex_multiply(float a, float b, float c, float d, float* out_real, float
  */
 int normalize_complex_array(float* real, float* imag, size_t length);
 
+/**
+ * \brief State of a xoshiro256** pseudo-random generator. Unlike rand(), each stream is
+ *        private to its owner, so threads can draw numbers without sharing state.
+ */
+typedef struct RandomStream {
+    uint64_t s[4];
+} RandomStream;
+
+/**
+ * \brief Seeds stream number 'stream' of 'seed'. Different streams of one seed are
+ *        statistically independent, and a stream only depends on (seed, stream).
+ * \param rng Pointer to a RandomStream
+ * \param seed Seed shared by all streams of a run
+ * \param stream Stream index, e.g. a trajectory or thread number
+ */
+void seed_random_stream(RandomStream* rng, uint64_t seed, uint64_t stream);
+
+/**
+ * \brief Draws a uniform double in [0, 1) (53 random bits).
+ * \param rng Pointer to a seeded RandomStream
+ * \return The next value of the stream
+ */
+double random_uniform(RandomStream* rng);
+
 #ifdef __cplusplus
 }
 #endif